@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+
+import argparse
+import json
+import statistics
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+METRICS = ("frame_ms", "cpu_ms", "submit_ms", "latency_ms")
+STATS = ("mean", "p50", "p95", "p99")
+
+
+def run_bench(exe: Path, path_file: Path, flags: list[str], out: Path) -> dict:
+	"""Run one benchmark replay and read back its report
+
+	:param exe:       Path of the Lesson10 executable
+	:param path_file: Camera path to replay
+	:param flags:     Extra command line flags for this configuration
+	:param out:       Path to write the JSON report to
+	:return:          The parsed report
+	"""
+	subprocess.run([str(exe), "--bench", str(path_file), "--bench-out", str(out), *flags],
+		cwd=exe.parent, check=True)
+	with open(out) as f:
+		return json.load(f)
+
+
+def median_report(reports: list[dict]) -> dict[str, dict[str, float]]:
+	"""Median of each statistic across runs of the same configuration"""
+	return {m: {s: statistics.median(r[m][s] for r in reports) for s in STATS} for m in METRICS}
+
+
+if __name__ == "__main__":
+	parser = argparse.ArgumentParser(
+		description="Compare Lesson10 --bench with the render thread against drawing on the main thread",
+		epilog="Flags after -- are passed to Lesson10 in both configurations.")
+	parser.add_argument("exe", type=Path, help="path of the Lesson10 executable")
+	parser.add_argument("path_file", type=Path, help="camera path to replay, such as Data/Bench.path")
+	parser.add_argument("-n", "--runs", type=int, default=3, help="runs of each configuration, interleaved")
+	argv = sys.argv[1:]
+	split = argv.index("--") if "--" in argv else len(argv)
+	args, extra = parser.parse_args(argv[:split]), argv[split + 1:]
+
+	configs = {"main thread": ["--no-render-thread", *extra], "render thread": extra}
+	reports: dict[str, list[dict]] = {name: [] for name in configs}
+	with tempfile.TemporaryDirectory() as tmp:
+		for run in range(args.runs):
+			for name, flags in configs.items():
+				reports[name].append(run_bench(args.exe.resolve(), args.path_file.resolve(), flags,
+					Path(tmp) / f"{name.replace(' ', '_')}_{run}.json"))
+
+	before, after = (median_report(reports[name]) for name in configs)
+	print(f"Median of {args.runs} runs, {reports['render thread'][0]['driver']} "
+		f"{reports['render thread'][0]['width']}x{reports['render thread'][0]['height']}")
+	print(f"{'':20}{'main thread':>14}{'render thread':>16}{'change':>10}")
+	for m in METRICS:
+		for s in STATS:
+			b, a = before[m][s], after[m][s]
+			change = f"{(a - b) / b * 100:+.1f}%" if b > 0 else "-"
+			print(f"{m + ' ' + s:20}{b:14.3f}{a:16.3f}{change:>10}")
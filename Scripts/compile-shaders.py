@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 
+import hashlib
 import os
 import shutil
 import sys
@@ -55,7 +56,7 @@ def compile_metal_shaders(
 		Path(obj).unlink()
 
 
-Shader = namedtuple("Shader", ["source", "type", "output"])
+Shader = namedtuple("Shader", ["source", "type", "output", "defines"], defaults=[()])
 
 
 def shaders_suffixes(shaders: list[Shader],
@@ -71,7 +72,8 @@ def shaders_suffixes(shaders: list[Shader],
 		yield Shader(
 			f"{s.source}.{in_suffix}" if in_suffix else s.source,
 			s.type,
-			f"{s.output}.{out_suffix}" if out_suffix else s.output)
+			f"{s.output}.{out_suffix}" if out_suffix else s.output,
+			s.defines)
 
 
 def compile_spirv_shaders(shaders: Iterable[Shader],
@@ -89,7 +91,8 @@ def compile_spirv_shaders(shaders: Iterable[Shader],
 		flags = []
 
 	for shader in shaders:
-		sflags = [*flags, "-V", "-S", shader.type, "-o", shader.output, shader.source]
+		defines = [f"-D{d}" for d in shader.defines]
+		sflags = [*flags, *defines, "-V", "-S", shader.type, "-o", shader.output, shader.source]
 		subprocess.run([glslang, *sflags], cwd=cwd, check=True)
 
 
@@ -106,7 +109,7 @@ def compile_dxil_shaders(shaders: Iterable[Shader], dxc: str | None = None, cwd:
 		entry, shader_type = {
 			"vert": ("VertexMain", "vs_6_0"),
 			"frag": ("FragmentMain", "ps_6_0") }[shader.type]
-		cflags = ["-E", entry, "-T", shader_type]
+		cflags = ["-E", entry, "-T", shader_type, *(f"-D{d}" for d in shader.defines)]
 		subprocess.run([dxc, *cflags, "-Fo", shader.output, shader.source], cwd=cwd, check=True)
 
 
@@ -120,10 +123,25 @@ def compile_dxbc_shaders(shaders: Iterable[Shader], cwd: Path | None = None) ->
 		entry, shader_type = {
 			"vert": ("VertexMain", "vs_5_1"),
 			"frag": ("FragmentMain", "ps_5_1") }[shader.type]
-		cflags = ["/E", entry, "/T", shader_type]
+		cflags = ["/E", entry, "/T", shader_type, *(f"/D{d}" for d in shader.defines)]
 		subprocess.run(["fxc", *cflags, "/Fo", shader.output, shader.source], cwd=cwd, check=True)
 
 
+def write_source_hashes(sources: Iterable[Path], stamp: Path, cwd: Path) -> None:
+	"""Record which shader sources the binaries were built from, CMake warns when they no longer match
+
+	:param sources: Shader source paths, relative to cwd
+	:param stamp:   Path of the file to write, one "<sha256>  <path>" line per source sorted by path
+	:param cwd:     Directory the paths are relative to
+	"""
+	lines = []
+	for source in sorted(s.as_posix() for s in sources):
+		# Line endings are normalized so a checkout converting them still matches
+		data = (cwd / source).read_bytes().replace(b"\r\n", b"\n")
+		lines.append(f"{hashlib.sha256(data).hexdigest()}  {source}\n")
+	(cwd / stamp).write_text("".join(lines), newline="\n")
+
+
 def compile_shaders() -> None:
 	root = Path(sys.argv[0]).resolve().parent.parent
 
@@ -132,7 +150,28 @@ def compile_shaders() -> None:
 	dest_dir = Path("Data/Shaders")
 	shaders = [
 		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.vertex"),
-		Shader(src_dir / "Shader.fragment", "frag", dest_dir / "Shader.fragment")]
+		Shader(src_dir / "Shader.fragment", "frag", dest_dir / "Shader.fragment"),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.instanced.vertex", ("INSTANCED",)),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.array.vertex", ("TEXTURE_ARRAY",)),
+		Shader(src_dir / "Shader.fragment", "frag", dest_dir / "Shader.array.fragment", ("TEXTURE_ARRAY",)),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.array.instanced.vertex",
+			("INSTANCED", "TEXTURE_ARRAY")),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.packed.vertex", ("PACKED",)),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.packed.instanced.vertex",
+			("PACKED", "INSTANCED")),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.array.packed.vertex",
+			("PACKED", "TEXTURE_ARRAY")),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.array.packed.instanced.vertex",
+			("PACKED", "INSTANCED", "TEXTURE_ARRAY")),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.depth.vertex", ("DEPTH_ONLY",)),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.depth.instanced.vertex",
+			("DEPTH_ONLY", "INSTANCED")),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.depth.packed.vertex",
+			("DEPTH_ONLY", "PACKED")),
+		Shader(src_dir / "Shader.vertex", "vert", dest_dir / "Shader.depth.packed.instanced.vertex",
+			("DEPTH_ONLY", "PACKED", "INSTANCED")),
+		Shader(src_dir / "Shader.fragment", "frag", dest_dir / "Shader.depth.fragment", ("DEPTH_ONLY",)),
+		Shader(src_dir / "Shader.fragment", "frag", dest_dir / "Shader.overdraw.fragment", ("OVERDRAW",))]
 
 	dest_dir.mkdir(exist_ok=True)
 
@@ -164,6 +203,9 @@ def compile_shaders() -> None:
 	if system == "Windows":  # FXC is only available thru the Windows SDK
 		compile_dxbc_shaders(shaders_suffixes(shaders, "hlsl", "fxb"), cwd=root)
 
+	sources = [path.relative_to(root) for path in (root / src_dir).glob("Shader.*")]
+	write_source_hashes(sources, dest_dir / "Shader.sources", root)
+
 
 if __name__ == "__main__":
 	compile_shaders()
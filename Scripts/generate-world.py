@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+
+import argparse
+import random
+from pathlib import Path
+from typing import TextIO
+
+Corner = tuple[float, float, float, float, float]
+Quad = tuple[str, list[Corner]]
+
+ROOM_SIZE = 6.0
+ROOM_HEIGHT = 1.0
+DOOR_WIDTH = 1.5
+
+
+def write_quad(f: TextIO, comment: str, corners: list[Corner]) -> None:
+	"""Write a quad as two triangles in World.txt syntax
+
+	:param f:       Output text stream
+	:param comment: Comment line to precede the quad
+	:param corners: Four (x, y, z, u, v) corners in winding order
+	"""
+	f.write(f"\n// {comment}\n")
+	for tri in ((0, 1, 2), (0, 3, 2)):
+		for i in tri:
+			x, y, z, u, v = corners[i]
+			f.write(f"{x:.2f} {y:.2f} {z:.2f} {u:.2f} {v:.2f}\n")
+
+
+def wall(x0: float, z0: float, x1: float, z1: float) -> Quad:
+	"""Make a vertical wall quad between two points on the floor"""
+	length = abs(x1 - x0) + abs(z1 - z0)
+	return ("Wall", [
+		(x0, ROOM_HEIGHT, z0, 0, 1), (x0, 0, z0, 0, 0), (x1, 0, z1, length, 0), (x1, ROOM_HEIGHT, z1, length, 1)])
+
+
+def box(half_width: float, height: float) -> list[Quad]:
+	"""Make the faces of a square box standing on the origin, for use as a prop model"""
+	w, h = half_width, height
+	quads = [("Top", [(-w, h, -w, 0, 1), (-w, h, w, 0, 0), (w, h, w, 1, 0), (w, h, -w, 1, 1)])]
+	for x0, z0, x1, z1 in ((-w, w, w, w), (w, w, w, -w), (w, -w, -w, -w), (-w, -w, -w, w)):
+		quads.append(("Side", [(x0, h, z0, 0, 1), (x0, 0, z0, 0, 0), (x1, 0, z1, 1, 0), (x1, h, z1, 1, 1)]))
+	return quads
+
+
+PROPS = [("Crate", box(0.15, 0.3)), ("Pillar", box(0.08, ROOM_HEIGHT))]
+PROP_MARGIN = 0.5  # Closest a prop is placed to a room's walls
+
+
+def generate_maze(rooms: int, rng: random.Random) -> set[tuple[int, int, int, int]]:
+	"""Carve a random spanning tree through a square grid of rooms
+
+	:param rooms: Number of rooms along each side of the grid
+	:param rng:   Random number generator
+	:return:      Set of connected (x, z, x, z) room pairs, smallest room first
+	"""
+	doors = set()
+	visited = {(0, 0)}
+	stack = [(0, 0)]
+	while stack:
+		x, z = stack[-1]
+		neighbours = [(x + dx, z + dz) for dx, dz in ((1, 0), (-1, 0), (0, 1), (0, -1))
+			if 0 <= x + dx < rooms and 0 <= z + dz < rooms and (x + dx, z + dz) not in visited]
+		if not neighbours:
+			stack.pop()
+			continue
+		n = rng.choice(neighbours)
+		visited.add(n)
+		doors.add((*min((x, z), n), *max((x, z), n)))
+		stack.append(n)
+	return doors
+
+
+def generate_world(path: Path, rooms: int, seed: int, sectors: bool, props: int = 0) -> tuple[int, int, int]:
+	"""Generate a synthetic maze of rooms joined by doorways
+
+	:param path:    Path of the world file to write
+	:param rooms:   Number of rooms along each side of the grid
+	:param seed:    Random seed for the maze layout
+	:param sectors: Write each room as its own sector joined by portals, otherwise write one big sector
+	:param props:   Number of crates & pillars scattered through each room
+	:return:        Number of triangles, portals and prop instances written
+	"""
+	rng = random.Random(seed)
+	doors = generate_maze(rooms, rng)
+	side = (ROOM_SIZE - DOOR_WIDTH) / 2
+
+	room_quads: list[list[Quad]] = []
+	portals = []
+	for gz in range(rooms):
+		for gx in range(rooms):
+			x0, z0 = gx * ROOM_SIZE, gz * ROOM_SIZE
+			x1, z1 = x0 + ROOM_SIZE, z0 + ROOM_SIZE
+			quads = [
+				("Floor", [(x0, 0, z0, 0, 6), (x0, 0, z1, 0, 0), (x1, 0, z1, 6, 0), (x1, 0, z0, 6, 6)]),
+				("Ceiling", [(x0, 1, z0, 0, 6), (x0, 1, z1, 0, 0), (x1, 1, z1, 6, 0), (x1, 1, z0, 6, 6)])]
+			# Walls along -x, +x, -z & +z with a doorway where the maze connects rooms
+			for (ax, az, bx, bz), neighbour in (
+					((x0, z0, x0, z1), (gx - 1, gz)), ((x1, z0, x1, z1), (gx + 1, gz)),
+					((x0, z0, x1, z0), (gx, gz - 1)), ((x0, z1, x1, z1), (gx, gz + 1))):
+				pair = (*min((gx, gz), neighbour), *max((gx, gz), neighbour))
+				if pair not in doors:
+					quads.append(wall(ax, az, bx, bz))
+					continue
+				dx, dz = (bx - ax) / ROOM_SIZE, (bz - az) / ROOM_SIZE
+				quads.append(wall(ax, az, ax + dx * side, az + dz * side))
+				quads.append(wall(bx - dx * side, bz - dz * side, bx, bz))
+				if neighbour > (gx, gz):
+					px0, pz0 = ax + dx * side, az + dz * side
+					px1, pz1 = bx - dx * side, bz - dz * side
+					a = gz * rooms + gx
+					b = neighbour[1] * rooms + neighbour[0]
+					portals.append((a, b, [(px0, 0, pz0), (px0, ROOM_HEIGHT, pz0), (px1, ROOM_HEIGHT, pz1), (px1, 0, pz1)]))
+			room_quads.append(quads)
+
+	numtriangles = 0
+	with open(path, "w", newline="\n") as f:
+		if not sectors:
+			room_quads = [[q for quads in room_quads for q in quads]]
+			portals = []
+		for i, quads in enumerate(room_quads):
+			f.write(f"// Sector {i}\nNUMPOLLIES {len(quads) * 2}\n")
+			for comment, corners in quads:
+				write_quad(f, comment, corners)
+			f.write("\n")
+			numtriangles += len(quads) * 2
+		for a, b, corners in portals:
+			f.write(f"PORTAL {a} {b}\n")
+			for x, y, z in corners:
+				f.write(f"{x:.2f} {y:.2f} {z:.2f}\n")
+		if props == 0:
+			return numtriangles, len(portals), 0
+		for i, (name, quads) in enumerate(PROPS):
+			f.write(f"\n// Prop {i}: {name}\nPROP {len(quads) * 2}\n")
+			for comment, corners in quads:
+				write_quad(f, comment, corners)
+		f.write("\n")
+		for gz in range(rooms):
+			for gx in range(rooms):
+				for _ in range(props):
+					x = gx * ROOM_SIZE + rng.uniform(PROP_MARGIN, ROOM_SIZE - PROP_MARGIN)
+					z = gz * ROOM_SIZE + rng.uniform(PROP_MARGIN, ROOM_SIZE - PROP_MARGIN)
+					prop = rng.randrange(len(PROPS))
+					scale = rng.uniform(0.8, 1.2) if prop == 0 else 1.0
+					f.write(f"INSTANCE {prop} {x:.2f} 0.00 {z:.2f} {rng.uniform(0, 360):.1f} {scale:.2f}\n")
+	return numtriangles, len(portals), rooms * rooms * props
+
+
+if __name__ == "__main__":
+	parser = argparse.ArgumentParser(description="Generate a synthetic maze world for load time & visibility tests")
+	parser.add_argument("output", type=Path, help="path of the world file to write")
+	parser.add_argument("-r", "--rooms", type=int, default=32, help="rooms along each side of the grid")
+	parser.add_argument("-s", "--seed", type=int, default=10, help="random seed for the maze layout")
+	parser.add_argument("--sectors", action="store_true", help="write each room as a sector joined by portals")
+	parser.add_argument("-p", "--props", type=int, default=0, help="crates & pillars to scatter through each room")
+	args = parser.parse_args()
+	numtriangles, numportals, numinstances = generate_world(
+		args.output, args.rooms, args.seed, args.sectors, args.props)
+	print(f"Wrote {numtriangles} triangles, {numportals} portals and {numinstances} props to {args.output}")
@@ -9,10 +9,27 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <float.h>
+#include <stdio.h>  // fwrite to stdout, SDL has no stream for it
 #include <SDL3/SDL.h>
 #define SDL_MAIN_USE_CALLBACKS
 #include <SDL3/SDL_main.h>
 #include "matrix.h"
+#include "world.h"
+#include "mesh.h"
+#include "texture.h"
+#include "pixels.h"
+#include "residency.h"
+#include "pipelines.h"
+#include "visibility.h"
+#include "upload.h"
+#include "simulation.h"
+#include "jobs.h"
+#include "drawlist.h"
+#include "trisort.h"
+#include "gputimer.h"
+#include "resolution.h"
+#include "bench.h"
+#include "profile.h"
 
 #define BTTN_YES 0
 #define BTTN_NO  1
@@ -42,53 +59,321 @@ static int ShowYesNoMessageBox(SDL_Window *window, int defaultbttn, const char *
 	return bttnid;
 }
 
-typedef struct tagCAMERA
+typedef struct tagFRAMETIMER
 {
-	float heading;
-	float xpos, zpos;
-	float yrot;
-	float walkbias, walkbiasangle;
-	float lookupdown;
-	float z;
-} CAMERA;
+	Uint64 start;      // Start of the current reporting interval
+	Uint64 drawticks;  // Time spent recording & submitting draw commands during the interval
+	Uint64 sortticks;  // Of that, time spent sorting translucent triangles
+	Uint64 latencyns;  // Time from sampling input to presenting the frames showing it during the interval
+	unsigned frames;
+	bool instancing;   // Prop drawing mode timed, changing it starts a new interval
+	Uint64 lastpresent; // SDL_GetTicksNS when the last frame was presented
+} FRAMETIMER;
+
+typedef struct tagBENCHRUN
+{
+	const char *pathfile;        // Camera path replayed by --bench, NULL when running interactively
+	const char *outfile;         // File the report is written to, stdout when NULL
+	CAMERAPATH path;
+	BENCH stats;
+	int frame;                   // Frames handed to the renderer so far, including the warm-up
+	SDL_GPUPresentMode presentmode;
+} BENCHRUN;
+
+/*  --bench-overdraw draws the scene adding one per shaded fragment into a count     *
+ *  texture instead of shading it, then copies the counts back to sum them. Each     *
+ *  frame in flight has its own copy, summed once the upload ring has waited for     *
+ *  the frame that made it, so counting never stalls on the GPU.                     */
+typedef struct tagOVERDRAW
+{
+	bool enabled;
+	SDL_GPUTexture *texture;     // R8 count of the fragments shaded in each pixel, saturating at 255
+	Uint32 width, height;
+	SDL_GPUTransferBuffer *readbacks[UPLOAD_FRAMES];  // One per upload frame, copied into as it's drawn
+	Uint32 readbacksizes[UPLOAD_FRAMES];  // Capacity of each
+	Uint32 counted[UPLOAD_FRAMES];        // Pixels copied into each by the frame in flight, 0 for none
+	int countedframes[UPLOAD_FRAMES];     // Benchmark frame number of each copy
+} OVERDRAW;
+
+/*  Everything needed to draw one frame, captured on the main thread so the render   *
+ *  thread never reads state that input & simulation are changing                    */
+typedef struct tagFRAME
+{
+	CAMERA camera;
+	mat4f projmtx;
+	bool blend, instancing;
+	unsigned filter;
+	Uint32 width, height;        // Window size in pixels
+	Uint64 inputns;              // SDL_GetTicksNS when the input this frame shows was sampled
+	int benchframe;              // Benchmark frame number, -1 outside of benchmarks
+	bool quit;                   // Asks the render thread to return, nothing else is set
+} FRAME;
+
+// A frame the render thread has submitted, waiting on the main thread to present it
+typedef struct tagDRAWNFRAME
+{
+	int target;                  // Render target drawn to, -1 when drawn straight to the swapchain
+	Uint32 width, height;
+	bool instancing, instanced;  // Prop drawing mode asked for & used
+	int propdraws, numvisibleinstances;
+	RESIDENCYSTATS textures;     // Material texture streaming after the frame's update
+	Uint64 inputns;
+	int benchframe;
+	Uint64 drawticks;            // Recording & submitting the commands
+	Uint64 submitticks;          // Submitting the command buffer alone
+	float overdraw;              // Fragments shaded per pixel of an earlier frame counted now, -1 when none was
+	int overdrawframe;           // Benchmark frame number of the frame counted
+	bool blend;                  // The world was drawn translucent
+	TRISORTSTATS translucent;    // Sorting the translucent world triangles back to front
+	Uint64 sortticks;
+	SDL_GPUSampleCount samples;  // Multisampling drawn with
+	float gpums;                 // Average GPU milliseconds per frame the sample count was last picked from, -1 if none
+	float scale;                 // Fraction of the window's width & height drawn, width & height are after scaling
+	float percentilems;          // GPU frame time percentile the scale was last picked from, -1 if none
+} DRAWNFRAME;
+
+#define RENDER_TARGETS 3  // One being drawn, one drawn & waiting to be presented, one being presented
+
+/*  SDL only allows swapchain textures to be acquired on the window's thread and     *
+ *  command buffers to be submitted on the thread that acquired them, so the render  *
+ *  thread draws into its own targets and the main thread copies the newest drawn    *
+ *  one to the swapchain whenever a swapchain texture is free, without waiting. The  *
+ *  next frame is only pushed once the last one drawn is blitted.                    */
+typedef struct tagRENDERTHREAD
+{
+	bool disabled;               // --no-render-thread, draw on the main thread to compare latency
+	SDL_Thread *thread;          // NULL when frames are drawn on the main thread
+	SPSCQUEUE frames;            // FRAMEs to draw, main -> render
+	SPSCQUEUE drawn;             // DRAWNFRAMEs to present, render -> main
+	SPSCQUEUE freetargets;       // Render target indices free to draw into, main -> render
+	SDL_Semaphore *wake;         // Signalled with each frame pushed
+	SDL_Semaphore *done;         // Signalled with each frame drawn
+	SDL_Semaphore *released;     // Signalled with each render target freed
+	SDL_AtomicInt busy;          // Set while a frame is pushed & not yet drawn
+	SDL_GPUTextureFormat format; // Swapchain format, the pipelines draw to
+	SDL_GPUTexture *targets[RENDER_TARGETS];
+	Uint32 targetw[RENDER_TARGETS], targeth[RENDER_TARGETS];
+	bool holding;                // Main thread holds newest, drawn but waiting on a swapchain texture
+	DRAWNFRAME newest;
+} RENDERTHREAD;
+
+#define FRAMETIMER_INTERVAL_MS 2000.0  // How often average frame times are logged
+#define UPLOAD_RING_SIZE (1u << 20)    // Smallest per-frame capacity of the dynamic upload ring
+#define TEXTURE_BUDGET_MB 64           // Default --texture-budget, MiB of material texture mip levels resident
+#define TEXTURE_TAIL_SIZE 64           // Compiled texture levels up to this size load up front, finer ones stream
+#define SCENE_FAR_PLANE 100.0f         // Projection's far plane, the farthest distance front to back orders tell apart
+#define BLEND_OPACITY 0.5f             // Opacity of the translucent world, the original lesson's glColor4f alpha
 
-typedef struct tagVERTEX
+typedef struct tagBLOB
 {
-	float x, y, z;
-	float u, v;
-} VERTEX;
+	uint8_t *data;
+	size_t size;
+} BLOB;
 
-typedef struct tagTRIANGLE
+// Every shader binary any backend might load, read ahead on a worker thread before the device exists
+static const char *const shaderfiles[] =
+{
+	"Data/Shaders/Shader.metallib",
+	"Data/Shaders/Shader.vertex.spv",
+	"Data/Shaders/Shader.fragment.spv",
+	"Data/Shaders/Shader.instanced.vertex.spv",
+	"Data/Shaders/Shader.array.vertex.spv",
+	"Data/Shaders/Shader.array.fragment.spv",
+	"Data/Shaders/Shader.array.instanced.vertex.spv",
+	"Data/Shaders/Shader.packed.vertex.spv",
+	"Data/Shaders/Shader.packed.instanced.vertex.spv",
+	"Data/Shaders/Shader.array.packed.vertex.spv",
+	"Data/Shaders/Shader.array.packed.instanced.vertex.spv",
+	"Data/Shaders/Shader.depth.vertex.spv",
+	"Data/Shaders/Shader.depth.instanced.vertex.spv",
+	"Data/Shaders/Shader.depth.packed.vertex.spv",
+	"Data/Shaders/Shader.depth.packed.instanced.vertex.spv",
+	"Data/Shaders/Shader.depth.fragment.spv",
+	"Data/Shaders/Shader.overdraw.fragment.spv",
+	"Data/Shaders/Shader.vertex.dxb",
+	"Data/Shaders/Shader.fragment.dxb",
+	"Data/Shaders/Shader.instanced.vertex.dxb",
+	"Data/Shaders/Shader.array.vertex.dxb",
+	"Data/Shaders/Shader.array.fragment.dxb",
+	"Data/Shaders/Shader.array.instanced.vertex.dxb",
+	"Data/Shaders/Shader.packed.vertex.dxb",
+	"Data/Shaders/Shader.packed.instanced.vertex.dxb",
+	"Data/Shaders/Shader.array.packed.vertex.dxb",
+	"Data/Shaders/Shader.array.packed.instanced.vertex.dxb",
+	"Data/Shaders/Shader.depth.vertex.dxb",
+	"Data/Shaders/Shader.depth.instanced.vertex.dxb",
+	"Data/Shaders/Shader.depth.packed.vertex.dxb",
+	"Data/Shaders/Shader.depth.packed.instanced.vertex.dxb",
+	"Data/Shaders/Shader.depth.fragment.dxb",
+	"Data/Shaders/Shader.overdraw.fragment.dxb",
+	"Data/Shaders/Shader.vertex.fxb",
+	"Data/Shaders/Shader.fragment.fxb",
+	"Data/Shaders/Shader.instanced.vertex.fxb",
+	"Data/Shaders/Shader.array.vertex.fxb",
+	"Data/Shaders/Shader.array.fragment.fxb",
+	"Data/Shaders/Shader.array.instanced.vertex.fxb",
+	"Data/Shaders/Shader.packed.vertex.fxb",
+	"Data/Shaders/Shader.packed.instanced.vertex.fxb",
+	"Data/Shaders/Shader.array.packed.vertex.fxb",
+	"Data/Shaders/Shader.array.packed.instanced.vertex.fxb",
+	"Data/Shaders/Shader.depth.vertex.fxb",
+	"Data/Shaders/Shader.depth.instanced.vertex.fxb",
+	"Data/Shaders/Shader.depth.packed.vertex.fxb",
+	"Data/Shaders/Shader.depth.packed.instanced.vertex.fxb",
+	"Data/Shaders/Shader.depth.fragment.fxb",
+	"Data/Shaders/Shader.overdraw.fragment.fxb"
+};
+
+enum
+{
+	// Worker threads
+	PHASE_TEXTURE_READ,
+	PHASE_SHADER_READ,
+	PHASE_WORLD_LOAD,
+	// Main thread
+	PHASE_PROMPT,
+	PHASE_WINDOW,
+	PHASE_DEVICE,
+	PHASE_PIPELINES,
+	PHASE_TEXTURE_UPLOAD,
+	PHASE_WORLD_UPLOAD,
+	PHASE_FIRST_FRAME,
+	NUM_PHASES
+};
+
+static const char *const phasenames[NUM_PHASES] =
 {
-	VERTEX vertex[3];
-} TRIANGLE;
+	[PHASE_TEXTURE_READ]   = "Texture decode",
+	[PHASE_SHADER_READ]    = "Shader reads",
+	[PHASE_WORLD_LOAD]     = "World load",
+	[PHASE_PROMPT]         = "Fullscreen prompt",
+	[PHASE_WINDOW]         = "Window",
+	[PHASE_DEVICE]         = "GPU device",
+	[PHASE_PIPELINES]      = "Pipelines",
+	[PHASE_TEXTURE_UPLOAD] = "Texture upload",
+	[PHASE_WORLD_UPLOAD]   = "World upload",
+	[PHASE_FIRST_FRAME]    = "First frame"
+};
+
+typedef struct tagPHASE
+{
+	Uint64 begin, end;
+} PHASE;
 
-typedef struct tagSECTOR
+typedef struct tagSTARTUP
+{
+	Uint64 launch;               // SDL_AppInit entry, phases are logged relative to it
+	PHASE phases[NUM_PHASES];
+	bool logged;
+
+	JOB texturejob, shaderjob, worldjob;
+	SDL_Surface *textureimages[WORLD_MAX_MATERIALS];  // Decoded material images of one size, flipped on upload
+	Uint8 *textureblocks;        // Compiled material textures' tail levels one after another, NULL if any is missing
+	TEXTUREHEADER textureheader; // Format, size & mip levels shared by every compiled material texture
+	Uint32 texturefirst;         // Finest level in textureblocks, the tail level
+	int texturelayers;           // Materials in textureblocks or textureimages
+	BLOB shaderblobs[SDL_arraysize(shaderfiles)];
+	bool worldloaded;            // World, props & visibility are ready for upload
+	MESH worldmesh;              // Mesh read from the compiled world, or built from the text world without one
+	const void *meshdata;        // Vertices followed by indices, worldmesh's
+	Uint32 numvertices, numindices, indexsize;
+	bool packvertices;           // Pack the mesh vertices for the packed shaders, --packed-vertices
+	void *packeddata;            // Packed vertices followed by a copy of the indices, NULL if not packed
+} STARTUP;
+
+// Ids in the pipeline cache of the world pipelines drawing at one sample count, -1 when not registered
+typedef struct tagWORLDPIPELINES
 {
-	int numtriangles;
-	TRIANGLE *triangle;
-} SECTOR;
+	int pso, psoblend;
+	int psoinstanced;            // -1 when the instanced shader is missing
+	int psodepth, psodepthinstanced;      // Depth pre-pass, -1 without --depth-prepass
+	int psoshade, psoshadeinstanced;      // Shading after the pre-pass, only the nearest fragments pass
+} WORLDPIPELINES;
+
+#define MSAA_COUNTS 4                  // SDL_GPU_SAMPLECOUNT_1 to _8, samples per pixel are 1 << count
+#define MSAA_WINDOW_FRAMES 30          // GPU frame times averaged before the adaptive sample count is reconsidered
+#define MSAA_RAISE_FRACTION 0.6f       // Fraction of the budget the average must be under to raise it again
+
+/*  Multisampled color & depth, resolved into the target drawn to at the end of the  *
+ *  pass. With --msaa-budget the sample count drops whenever the GPU time per frame  *
+ *  averaged over a window is over budget, and rises again once it's well under.     */
+typedef struct tagMULTISAMPLE
+{
+	int samples;                 // --msaa, samples per pixel asked for
+	float budgetms;              // --msaa-budget, GPU milliseconds per frame, 0 keeps the sample count fixed
+	SDL_GPUSampleCount maxcount; // Most samples drawn with, what was asked for as far as the formats support
+	SDL_GPUSampleCount count;    // Samples drawn with, drawing thread only
+	SDL_GPUTexture *colortex;    // Multisampled color, NULL at SDL_GPU_SAMPLECOUNT_1
+	Uint32 width, height;
+	SDL_GPUSampleCount texcount; // Samples of colortex
+	float windowms;              // GPU milliseconds of the frames timed this window
+	int windowframes;
+	int settling;                // Frames still to be timed that were drawn at the previous count, not counted
+	float gpums;                 // Average GPU milliseconds per frame of the last window, -1 before the first
+} MULTISAMPLE;
 
 typedef struct tagAPPSTATE
 {
 	SDL_Window              *win;
 	SDL_GPUDevice           *dev;
-	SDL_GPUGraphicsPipeline *pso, *psoblend;
+	PIPELINECACHE pipelines;     // Every pipeline & shader, pipelines created on first use or warmed while loading
+	WORLDPIPELINES psos[MSAA_COUNTS];  // World pipelines for each sample count drawn with
 
 	const char *resdir;
 
 	bool fullscreen, blend;
+	bool instancing;             // Draw props with one instanced draw per prop instead of one per placement
+	bool depthprepass;           // Lay down depth from the position-only stream before shading, --depth-prepass
 
 	mat4f projmtx;               // Projection matrix
-	CAMERA camera;
+	CAMERA camera;               // Camera drawn, interpolated between simulation ticks
+	SIMULATION sim;              // Fixed rate simulation of the camera
 	unsigned filter;             // Filtered texture selection
 	unsigned depthtexw, depthtexh; // Width and height for the depth texture
+	SDL_GPUSampleCount depthtexcount;  // Samples per pixel of the depth texture
 	SDL_GPUTexture *depthtex;    // Texture used for depth testing
-	SDL_GPUTexture *texture;     // World texture
+	MULTISAMPLE msaa;            // Anti-aliasing, --msaa
+	RESOLUTIONSCALER resolution; // Fraction of the window's width & height drawn, --dynamic-resolution
+	SDL_GPUTexture *scaledtex;   // Drawn into below full size on the main thread, then blitted to the swapchain
+	Uint32 scaledtexw, scaledtexh;
+	GPUTIMER gputimer;           // GPU time of each frame, running while the sample count or resolution adapts
+	SDL_GPUTexture *texture;     // World material images, one layer each when texturearray
+	bool texturearray;           // Shaders select the layer, otherwise everything is drawn with material 0
+	TEXTUREHEADER textureheader; // Compiled material textures' format & full size, format 0 when decoded
+	Uint32 texturelayers;        // Layers in texture
+	float texcoorddensity;       // World's texture coordinate units per world unit, picks the level drawing needs
+	bool packedvertices;         // World mesh vertices are PACKEDVERTEX, dequantized with packboxes
+	PACKBOX packboxes[MESH_PACK_BOXES];  // Vertex shader dequantization uniform of the packed mesh
+	Uint64 texturebudget;        // Bytes the texture's resident mip levels may take
+	bool cpumips;                // Filter decoded images' mip levels on the workers instead of the GPU
+	RESIDENCY residency;         // Mip levels of texture streamed in as the camera needs them
 	SDL_GPUSampler *samplers[3]; // Filtered samplers
-	SDL_GPUBuffer *worldmesh;    // GPU world mesh
-
-	SECTOR sector1;
+	SDL_GPUBuffer *worldmesh;    // GPU world mesh vertices
+	SDL_GPUBuffer *worldindices; // GPU world mesh indices
+	SDL_GPUBuffer *worldpositions; // GPU world mesh positions alone for the depth pre-pass, NULL without one
+	SDL_GPUBuffer *sortedindices;  // Indices of the visible sector triangles back to front, drawn when blending
+	Uint32 numsortedindices;     // Indices in sortedindices as last uploaded
+	bool sortedstale;            // The last sorted order couldn't be uploaded, upload it even if unchanged
+	TRISORT trisort;             // Visible sector triangles ordered back to front for blending
+	SDL_GPUIndexElementSize indexelemsize;
+	SDL_GPUBuffer *propinstances;  // GPU model matrices of the visible prop placements, streamed each frame
+	mat4f *instancematrices;     // Prop placement model matrices, in world instance order
+	int *instancesectors;        // Sector containing each prop placement
+	int *visibleinstances;       // Placements in visible sectors this frame, grouped by prop
+	int *propvisible;            // Visible placements of each prop this frame
+	int *propfirstvisible;       // Index of each prop's first visible placement in the instance buffer
+	int numvisibleinstances;
+	UPLOADRING uploads;          // Per-frame dynamic uploads
+
+	WORLD world;                 // World sectors, portals & props
+	VISIBILITY vis;              // Per-frame portal visibility
+	DRAWBUILDER draws;           // Per-frame draws, prepared across the worker threads
+	FRAMETIMER frametimer;
+	JOBQUEUE jobs;               // Worker threads
+	STARTUP startup;             // Asset loading overlapped with window & device creation
+	BENCHRUN bench;              // Headless benchmark run
+	OVERDRAW overdraw;           // Shaded fragment counting, --bench-overdraw
+	RENDERTHREAD render;
 } APPSTATE;
 
 static char * resourcePath(const APPSTATE *restrict state, const char *restrict name)
@@ -119,72 +404,128 @@ static SDL_IOStream * fopenResource(const APPSTATE *restrict state, const char *
 	return f;
 }
 
-static char * fgetsIO(char *restrict s, int n, SDL_IOStream *restrict f)
+static BLOB ReadBlob(APPSTATE *state, const char *path)
 {
-	char *p = s;
-	for (--n; n > 0; --n)
+	SDL_IOStream *filein = fopenResource(state, path, "rb");
+	if (!filein)
+	{
+		return (BLOB){ NULL, 0U };
+	}
+
+	// Allocate a buffer of the size of the file
+	Sint64 size; Uint8 *data;
+	SDL_SeekIO(filein, 0, SDL_IO_SEEK_END);
+	if ((size = SDL_TellIO(filein)) <= 0 ||
+		!(data = SDL_malloc((size_t)size)))
+	{
+		SDL_CloseIO(filein);
+		return (BLOB){ NULL, 0U };
+	}
+	SDL_SeekIO(filein, 0, SDL_IO_SEEK_SET);
+
+	// Read the file contents into the buffer
+	const size_t read = SDL_ReadIO(filein, data, (size_t)size);
+	SDL_CloseIO(filein);
+	if (read != (size_t)size)
 	{
-		Sint8 c;
-		if (!SDL_ReadS8(f, &c))
-			break;
-		if (((*p++) = c) == '\n')
-			break;
+		SDL_free(data);
+		return (BLOB){ NULL, 0U };
 	}
-	(*p) = '\0';
-	return p != s ? s : NULL;
+
+	return (BLOB){ data, read };
 }
 
-static void readstr(SDL_IOStream *restrict f, char *restrict string)
+static double ElapsedMS(Uint64 start)
 {
-	do
-	{
-		fgetsIO(string, 255, f);
-	} while (string[0] == '/' || string[0] == '\n');
+	return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
 }
 
-static void SetupWorld(APPSTATE *state)
+// Each phase is only written by the one thread that runs it, phases are also profiler zones
+static void BeginPhase(APPSTATE *state, int phase)
 {
-	float x, y, z, u, v;
-	int numtriangles;
-	char oneline[255];
-	SDL_IOStream* filein = fopenResource(state, "Data/World.txt", "r");  // File to load world data from
+	PROFILE_BEGIN(phasenames[phase]);
+	state->startup.phases[phase].begin = SDL_GetPerformanceCounter();
+}
+
+static void EndPhase(APPSTATE *state, int phase)
+{
+	state->startup.phases[phase].end = SDL_GetPerformanceCounter();
+	PROFILE_END();
+}
 
-	readstr(filein, oneline);
-	SDL_sscanf(oneline, "NUMPOLLIES %d\n", &numtriangles);
+static bool SetupWorld(APPSTATE *state)
+{
+	const char *resname = "Data/World.txt";  // File to load world data from
+	const Uint64 start = SDL_GetPerformanceCounter();
 
-	state->sector1.triangle = SDL_malloc(sizeof(TRIANGLE) * numtriangles);
-	state->sector1.numtriangles = numtriangles;
-	for (int loop = 0; loop < numtriangles; loop++)
+	// Read the whole file in one go and parse it in place
+	BLOB text = ReadBlob(state, resname);
+	if (!text.data)
 	{
-		for (int vert = 0; vert < 3; vert++)
-		{
-			readstr(filein, oneline);
-			SDL_sscanf(oneline, "%f %f %f %f %f", &x, &y, &z, &u, &v);
-			state->sector1.triangle[loop].vertex[vert].x = x;
-			state->sector1.triangle[loop].vertex[vert].y = y;
-			state->sector1.triangle[loop].vertex[vert].z = z;
-			state->sector1.triangle[loop].vertex[vert].u = u;
-			state->sector1.triangle[loop].vertex[vert].v = v;
-		}
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read \"%s\": %s", resname, SDL_GetError());
+		return false;
 	}
-	SDL_CloseIO(filein);
+	const bool parsed = ParseWorld(&state->world, (const char *)text.data, text.size);
+	SDL_free(text.data);
+	if (!parsed)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load \"%s\": %s", resname, SDL_GetError());
+		return false;
+	}
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Parsed %d triangles in %d sectors from \"%s\" in %.3f ms",
+		state->world.numtriangles, state->world.numsectors, resname, ElapsedMS(start));
+	return true;
+}
+
+// Bytes of each vertex in the position-only stream, the position leading VERTEX or PACKEDVERTEX
+static Uint32 PositionSize(bool packed)
+{
+	return packed ? (Uint32)offsetof(PACKEDVERTEX, u) : (Uint32)offsetof(VERTEX, u);
 }
 
-static bool CreateWorldMesh(APPSTATE *state)
+/*  Create the world vertex & index buffers, copying the vertex data followed by the *
+ *  index data from src into a single transfer buffer. When positionsize isn't 0 the *
+ *  leading positionsize bytes of each vertex are also gathered into a position-only *
+ *  stream for the depth pre-pass, uploaded to its own vertex buffer.                */
+static bool CreateWorldMesh(APPSTATE *state, const Uint8 *src, Uint32 vertexsize, Uint32 positionsize,
+	Uint32 numvertices, Uint32 numindices, Uint32 indexsize)
 {
-	const int numtriangles = state->sector1.numtriangles;
-	const size_t stride = sizeof(VERTEX) * 3;
-	const Uint32 bufsize = stride * (Uint32)numtriangles;
+	// Sized in 64 bits, a big enough world would wrap the 32 bit sizes SDL takes
+	const Uint64 total = ((Uint64)vertexsize + positionsize) * numvertices + (Uint64)indexsize * numindices;
+	if (total > SDL_MAX_UINT32)
+	{
+		return SDL_SetError("World mesh too large to upload (%" SDL_PRIu64 " bytes)", total);
+	}
+	const Uint32 vtxsize = vertexsize * numvertices;
+	const Uint32 idxsize = indexsize * numindices;
+	const Uint32 possize = positionsize * numvertices;
+	const Uint32 bufsize = (Uint32)total;
 
-	// Create vertex data buffer
-	SDL_GPUBuffer *buf = SDL_CreateGPUBuffer(state->dev, &(SDL_GPUBufferCreateInfo)
+	// Create vertex & index data buffers
+	SDL_GPUBuffer *vtxbuf = SDL_CreateGPUBuffer(state->dev, &(SDL_GPUBufferCreateInfo)
 	{
 		.usage = SDL_GPU_BUFFERUSAGE_VERTEX,
-		.size = bufsize,
+		.size = vtxsize,
 		.props = 0
 	});
-	if (!buf)
+	SDL_GPUBuffer *idxbuf = SDL_CreateGPUBuffer(state->dev, &(SDL_GPUBufferCreateInfo)
 	{
+		.usage = SDL_GPU_BUFFERUSAGE_INDEX,
+		.size = idxsize,
+		.props = 0
+	});
+	SDL_GPUBuffer *posbuf = possize == 0 ? NULL : SDL_CreateGPUBuffer(state->dev, &(SDL_GPUBufferCreateInfo)
+	{
+		.usage = SDL_GPU_BUFFERUSAGE_VERTEX,
+		.size = possize,
+		.props = 0
+	});
+	if (!vtxbuf || !idxbuf || (possize > 0 && !posbuf))
+	{
+		SDL_ReleaseGPUBuffer(state->dev, posbuf);
+		SDL_ReleaseGPUBuffer(state->dev, idxbuf);
+		SDL_ReleaseGPUBuffer(state->dev, vtxbuf);
 		return false;
 	}
 
@@ -197,156 +538,487 @@ static bool CreateWorldMesh(APPSTATE *state)
 	});
 	if (!xferbuf)
 	{
-		SDL_ReleaseGPUBuffer(state->dev, buf);
+		SDL_ReleaseGPUBuffer(state->dev, posbuf);
+		SDL_ReleaseGPUBuffer(state->dev, idxbuf);
+		SDL_ReleaseGPUBuffer(state->dev, vtxbuf);
 		return false;
 	}
 
-	// Map transfer buffer and copy the vertex data
+	// Map transfer buffer and copy the mesh data into it, the positions gathered from the source vertices
 	Uint8 *map = SDL_MapGPUTransferBuffer(state->dev, xferbuf, false);
-	if (!map)
-	{
-		SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
-		SDL_ReleaseGPUBuffer(state->dev, buf);
-		return false;
-	}
-	for (int loop_m = 0; loop_m < numtriangles; loop_m++)
+	if (map)
 	{
-		SDL_memcpy(&map[stride * loop_m], state->sector1.triangle[loop_m].vertex, stride);
+		SDL_memcpy(map, src, vtxsize + idxsize);
+		Uint8 *positions = map + vtxsize + idxsize;
+		for (Uint32 i = 0; i < numvertices && positionsize > 0; ++i)
+		{
+			SDL_memcpy(positions + positionsize * i, src + vertexsize * i, positionsize);
+		}
+		SDL_UnmapGPUTransferBuffer(state->dev, xferbuf);
 	}
-	SDL_UnmapGPUTransferBuffer(state->dev, xferbuf);
-
-	// Upload the vertex data into the GPU buffer
-	SDL_GPUCommandBuffer *cmdbuf = SDL_AcquireGPUCommandBuffer(state->dev);
+	SDL_GPUCommandBuffer *cmdbuf = map ? SDL_AcquireGPUCommandBuffer(state->dev) : NULL;
 	if (!cmdbuf)
 	{
 		SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
-		SDL_ReleaseGPUBuffer(state->dev, buf);
+		SDL_ReleaseGPUBuffer(state->dev, posbuf);
+		SDL_ReleaseGPUBuffer(state->dev, idxbuf);
+		SDL_ReleaseGPUBuffer(state->dev, vtxbuf);
 		return false;
 	}
+
+	// Upload the vertex & index data into the GPU buffers
 	SDL_GPUCopyPass *pass = SDL_BeginGPUCopyPass(cmdbuf);
-	const SDL_GPUTransferBufferLocation source = { .transfer_buffer = xferbuf, .offset = 0 };
-	const SDL_GPUBufferRegion dest = { .buffer = buf, .offset = 0, .size = bufsize };
-	SDL_UploadToGPUBuffer(pass, &source, &dest, false);
+	SDL_UploadToGPUBuffer(pass,
+		&(SDL_GPUTransferBufferLocation){ .transfer_buffer = xferbuf, .offset = 0 },
+		&(SDL_GPUBufferRegion){ .buffer = vtxbuf, .offset = 0, .size = vtxsize }, false);
+	SDL_UploadToGPUBuffer(pass,
+		&(SDL_GPUTransferBufferLocation){ .transfer_buffer = xferbuf, .offset = vtxsize },
+		&(SDL_GPUBufferRegion){ .buffer = idxbuf, .offset = 0, .size = idxsize }, false);
+	if (posbuf)
+	{
+		SDL_UploadToGPUBuffer(pass,
+			&(SDL_GPUTransferBufferLocation){ .transfer_buffer = xferbuf, .offset = vtxsize + idxsize },
+			&(SDL_GPUBufferRegion){ .buffer = posbuf, .offset = 0, .size = possize }, false);
+	}
 	SDL_EndGPUCopyPass(pass);
 	SDL_SubmitGPUCommandBuffer(cmdbuf);
 	SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
 
-	state->worldmesh = buf;
+	state->worldmesh = vtxbuf;
+	state->worldindices = idxbuf;
+	state->worldpositions = posbuf;
+	state->indexelemsize = indexsize == 2 ? SDL_GPU_INDEXELEMENTSIZE_16BIT : SDL_GPU_INDEXELEMENTSIZE_32BIT;
 	return true;
 }
 
-typedef struct tagBLOB
+/*  Build each prop placement's model matrix (origin * yaw * scale) four at a time   *
+ *  with the batched matrix functions                                                */
+static bool MakeInstanceMatrices(const WORLD *world, mat4f *matrices)
 {
-	uint8_t *data;
-	size_t size;
-} BLOB;
+	const size_t count = (size_t)world->numinstances;
+	const size_t numblocks = MAT4_BLOCKS(count);
+	MAT4BLOCK *blocks = SDL_malloc(sizeof(MAT4BLOCK) * numblocks + sizeof(float) * 4 * count);
+	if (!blocks)
+	{
+		return false;
+	}
+	float *x = (float *)&blocks[numblocks], *y = x + count, *z = y + count, *yaw = z + count;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const INSTANCE *instance = &world->instances[i];
+		x[i] = instance->origin[0];
+		y[i] = instance->origin[1];
+		z[i] = instance->origin[2];
+		yaw[i] = instance->yaw;
+	}
 
-static BLOB ReadBlob(APPSTATE *state, const char *path)
+	static const mat4f identity = M4_IDENTITY;
+	for (size_t i = 0; i < numblocks; ++i)
+	{
+		for (int e = 0; e < 16; ++e)
+		{
+			for (int lane = 0; lane < MAT4_LANES; ++lane)
+			{
+				blocks[i].m[e][lane] = identity[e];
+			}
+		}
+	}
+	TranslateBatch(blocks, count, x, y, z);
+	RotateBatch(blocks, count, yaw, 0.0f, 1.0f, 0.0f);
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Scale the x, y & z basis columns
+		for (int e = 0; e < 12; ++e)
+		{
+			blocks[i / MAT4_LANES].m[e][i % MAT4_LANES] *= world->instances[i].scale;
+		}
+	}
+	UnpackMatrices(matrices, blocks, count);
+	SDL_free(blocks);
+	return true;
+}
+
+// Compute prop placement transforms and find their sectors, the visible ones are streamed to the GPU each frame
+static bool PrepareProps(APPSTATE *state)
 {
-	SDL_IOStream *filein = fopenResource(state, path, "rb");
-	if (!filein)
+	const WORLD *world = &state->world;
+	if (world->numinstances == 0)
 	{
-		return (BLOB){ NULL, 0U };
+		return true;
 	}
 
-	// Allocate a buffer of the size of the file
-	Sint64 size; Uint8 *data;
-	SDL_SeekIO(filein, 0, SDL_IO_SEEK_END);
-	if ((size = SDL_TellIO(filein)) <= 0 ||
-		!(data = SDL_malloc((size_t)size)))
+	const size_t count = (size_t)world->numinstances;
+	state->instancematrices = SDL_malloc(sizeof(mat4f) * count);
+	state->instancesectors = SDL_malloc(sizeof(int) * count);
+	state->visibleinstances = SDL_malloc(sizeof(int) * count);
+	state->propvisible = SDL_calloc((size_t)world->numprops, sizeof(int));
+	state->propfirstvisible = SDL_calloc((size_t)world->numprops, sizeof(int));
+	if (!state->instancematrices || !state->instancesectors || !state->visibleinstances || !state->propvisible ||
+		!state->propfirstvisible || !MakeInstanceMatrices(world, state->instancematrices))
 	{
-		SDL_CloseIO(filein);
-		return (BLOB){ NULL, 0U };
+		return false;
 	}
-	SDL_SeekIO(filein, 0, SDL_IO_SEEK_SET);
+	for (size_t i = 0; i < count; ++i)
+	{
+		state->instancesectors[i] = FindSector(world, world->instances[i].origin, -1);
+	}
+	return true;
+}
 
-	// Read the file contents into the buffer
-	const size_t read = SDL_ReadIO(filein, data, (size_t)size);
-	SDL_CloseIO(filein);
-	if (read != (size_t)size)
+static bool CreatePropBuffer(APPSTATE *state)
+{
+	const WORLD *world = &state->world;
+	if (world->numinstances == 0)
 	{
-		SDL_free(data);
-		return (BLOB){ NULL, 0U };
+		return true;
 	}
 
-	return (BLOB){ data, read };
+	state->propinstances = SDL_CreateGPUBuffer(state->dev, &(SDL_GPUBufferCreateInfo)
+	{
+		.usage = SDL_GPU_BUFFERUSAGE_VERTEX,
+		.size = (Uint32)sizeof(mat4f) * (Uint32)world->numinstances,
+		.props = 0
+	});
+	if (!state->propinstances)
+	{
+		return false;
+	}
+	SDL_SetGPUBufferName(state->dev, state->propinstances, "Prop Instances");
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Placed %d instances of %d props", world->numinstances, world->numprops);
+	if (state->psos[state->msaa.count].psoinstanced < 0)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Instanced shader unavailable, props will be drawn one at a time. "
+			"Shader.instanced.vertex & its variants come from Scripts/compile-shaders.py");
+	}
+	return true;
+}
+
+/*  Keep the sector triangles' centroids & indices for sorting them back to front    *
+ *  when blending, and create the index buffer the sorted triangles are streamed to. *
+ *  Props follow the sectors in the index buffer and are always drawn opaque.        */
+static bool CreateTriangleSort(APPSTATE *state, const MESH *mesh)
+{
+	const WORLD *world = &state->world;
+	Uint32 numtriangles = 0;
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		numtriangles = SDL_max(numtriangles, (world->sectors[i].firstindex + world->sectors[i].numindices) / 3);
+	}
+	if (!InitTriangleSort(&state->trisort, mesh, numtriangles))
+	{
+		return false;
+	}
+
+	state->sortedindices = SDL_CreateGPUBuffer(state->dev, &(SDL_GPUBufferCreateInfo)
+	{
+		.usage = SDL_GPU_BUFFERUSAGE_INDEX,
+		.size = mesh->indexsize * 3 * SDL_max(numtriangles, 1u),
+		.props = 0
+	});
+	if (!state->sortedindices)
+	{
+		return false;
+	}
+	SDL_SetGPUBufferName(state->dev, state->sortedindices, "Sorted Indices");
+	return true;
+}
+
+/*  Read the world on a worker thread, preferring the compiled world whose mesh data *
+ *  needs no processing, otherwise parsing the text world and building its mesh.     *
+ *  The mesh data is left in the startup state for LoadWorld to upload.              */
+static bool ReadWorld(APPSTATE *state)
+{
+	STARTUP *startup = &state->startup;
+	const char *binname = "Data/World.wbin";
+	Uint64 start = SDL_GetPerformanceCounter();
+	SDL_IOStream *wbin = fopenResource(state, binname, "rb");
+	if (wbin)
+	{
+		// Tables then the mesh straight from the file, without reading the whole file into memory first
+		WORLDHEADER header;
+		const bool loaded = ReadWorldBinary(wbin, &header, &state->world) &&
+			ReadWorldMesh(wbin, &header, &startup->worldmesh);
+		SDL_CloseIO(wbin);
+		if (loaded)
+		{
+			startup->meshdata = startup->worldmesh.vertices;
+			startup->numvertices = header.numvertices;
+			startup->numindices = header.numindices;
+			startup->indexsize = header.indexsize;
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+				"Loaded %u vertices & %u indices in %d sectors from \"%s\" in %.3f ms",
+				(unsigned)header.numvertices, (unsigned)header.numindices, state->world.numsectors,
+				binname, ElapsedMS(start));
+			return true;
+		}
+		FreeWorld(&state->world);
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to load \"%s\", falling back to text: %s",
+			binname, SDL_GetError());
+	}
+
+	if (!SetupWorld(state))
+	{
+		return false;
+	}
+
+	// Build an indexed mesh from the triangle soup
+	start = SDL_GetPerformanceCounter();
+	MESH *mesh = &startup->worldmesh;
+	MESHSTATS stats;
+	if (!BuildMesh(mesh, &state->world, &stats))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build world mesh: %s", SDL_GetError());
+		return false;
+	}
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Built world mesh in %.3f ms", ElapsedMS(start));
+	LogMeshStats("World mesh", mesh, &stats);
+	startup->meshdata = mesh->vertices;
+	startup->numvertices = mesh->numvertices;
+	startup->numindices = mesh->numindices;
+	startup->indexsize = mesh->indexsize;
+	return true;
+}
+
+/*  Quantize the world mesh's vertices for the packed shaders, keeping the float     *
+ *  vertices in case the packed shaders are missing. Failing to pack only leaves     *
+ *  the float vertices to draw with.                                                 */
+static bool PackWorldMesh(APPSTATE *state)
+{
+	STARTUP *startup = &state->startup;
+	if (!startup->packvertices)
+	{
+		return true;
+	}
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+	const MESH mesh =
+	{
+		.numvertices = startup->numvertices,
+		.numindices = startup->numindices,
+		.indexsize = startup->indexsize,
+		.vertices = (VERTEX *)startup->meshdata,
+		.indices = (Uint8 *)startup->meshdata + sizeof(VERTEX) * startup->numvertices
+	};
+	const size_t vertexbytes = sizeof(PACKEDVERTEX) * startup->numvertices;
+	const size_t indexbytes = (size_t)startup->indexsize * startup->numindices;
+	PACKSTATS stats;
+	startup->packeddata = SDL_malloc(vertexbytes + indexbytes);
+	if (!startup->packeddata || !PackMeshVertices(startup->packeddata, state->packboxes, &mesh, &state->world, &stats))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to pack the world mesh, drawing float vertices: %s",
+			SDL_GetError());
+		SDL_free(startup->packeddata);
+		startup->packeddata = NULL;
+		return true;
+	}
+	SDL_memcpy((Uint8 *)startup->packeddata + vertexbytes, mesh.indices, indexbytes);
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Packed world mesh in %.3f ms", ElapsedMS(start));
+	LogPackStats("World mesh", &stats);
+	return true;
+}
+
+// Upload the world mesh & create the prop instance buffer once the world job is done
+static bool LoadWorld(APPSTATE *state)
+{
+	STARTUP *startup = &state->startup;
+	WaitJob(&state->jobs, &startup->worldjob);
+	if (!startup->worldloaded)
+	{
+		return false;
+	}
+
+	BeginPhase(state, PHASE_WORLD_UPLOAD);
+	const Uint32 vertexsize = state->packedvertices ? (Uint32)sizeof(PACKEDVERTEX) : (Uint32)sizeof(VERTEX);
+	const Uint32 positionsize = state->depthprepass ? PositionSize(state->packedvertices) : 0;
+	const bool created = CreateWorldMesh(state, state->packedvertices ? startup->packeddata : startup->meshdata,
+		vertexsize, positionsize, startup->numvertices, startup->numindices, startup->indexsize);
+	const MESH mesh =
+	{
+		.numvertices = startup->numvertices,
+		.numindices = startup->numindices,
+		.indexsize = startup->indexsize,
+		.vertices = (VERTEX *)startup->meshdata,
+		.indices = (Uint8 *)startup->meshdata + sizeof(VERTEX) * startup->numvertices
+	};
+	state->texcoorddensity = MeshTexcoordDensity(&mesh);
+	const bool sortable = created && CreateTriangleSort(state, &mesh);
+	FreeMesh(&startup->worldmesh);
+	startup->meshdata = NULL;
+	SDL_free(startup->packeddata);
+	startup->packeddata = NULL;
+	const bool ready = sortable && CreatePropBuffer(state);
+	EndPhase(state, PHASE_WORLD_UPLOAD);
+	return ready;
 }
 
 static SDL_GPUShader * LoadShaderBlob(APPSTATE *state, const BLOB lib,
-	SDL_GPUShaderFormat format, const char *entrypoint, bool isfragment)
+	SDL_GPUShaderFormat format, const char *entrypoint, bool isfragment, bool packed)
 {
 	if (!lib.data)
 	{
 		return NULL;
 	}
 
-	// Create shader object
-	SDL_GPUShader *shader = SDL_CreateGPUShader(state->dev, &(SDL_GPUShaderCreateInfo)
+	// Create shader object, unless the same code & entry point already made one
+	SDL_GPUShader *shader = CachedShader(&state->pipelines, &(SDL_GPUShaderCreateInfo)
 	{
 		.num_samplers = isfragment ? 1 : 0,
 		.num_storage_textures = 0,
 		.num_storage_buffers = 0,
-		.num_uniform_buffers = isfragment ? 0 : 1,
+		.num_uniform_buffers = isfragment ? 0 : packed ? 2 : 1,  // Packed vertex shaders read the boxes too
 		.format = format,
 		.entrypoint = entrypoint,
 		.code = lib.data,
 		.code_size = lib.size,
 		.stage = isfragment ? SDL_GPU_SHADERSTAGE_FRAGMENT : SDL_GPU_SHADERSTAGE_VERTEX
 	});
+	if (!shader && format == SDL_GPU_SHADERFORMAT_METALLIB)
+	{
+		// A metallib built before the entry point was added still loads, it just lacks the function
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Metal library has no \"%s\", rebuild Data/Shaders with "
+			"Scripts/compile-shaders.py: %s", entrypoint, SDL_GetError());
+	}
 	return shader;
 }
 
-static SDL_GPUShader * LoadShader(APPSTATE *state, const char *path,
-	SDL_GPUShaderFormat format, const char *entrypoint, bool isfragment)
+// Shader binary read ahead by the shader job, empty if it couldn't be read
+static BLOB ShaderBlob(const APPSTATE *state, const char *path)
 {
-	BLOB lib = ReadBlob(state, path);
-	SDL_GPUShader *shader = LoadShaderBlob(state, lib, format, entrypoint, isfragment);
-	SDL_free(lib.data);
-	return shader;
+	for (unsigned i = 0; i < SDL_arraysize(shaderfiles); ++i)
+	{
+		if (SDL_strcmp(shaderfiles[i], path) == 0)
+		{
+			return state->startup.shaderblobs[i];
+		}
+	}
+	return (BLOB){ NULL, 0U };
 }
 
-static bool LoadShaders(APPSTATE *state, SDL_GPUShader **vertexshader, SDL_GPUShader **fragmentshader)
+static SDL_GPUShader * LoadShader(APPSTATE *state, const char *path,
+	SDL_GPUShaderFormat format, const char *entrypoint, bool isfragment, bool packed)
 {
-	SDL_GPUShader *vtxshader = NULL, *frgshader = NULL;
+	const BLOB blob = ShaderBlob(state, path);
+	if (!blob.data)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Shader binary \"%s\" is missing, rebuild Data/Shaders with "
+			"Scripts/compile-shaders.py", path);
+	}
+	return LoadShaderBlob(state, blob, format, entrypoint, isfragment, packed);
+}
 
+/*  The shader format to load for the device, the metallib or the file extension of  *
+ *  the per-file backends, SDL_GPU_SHADERFORMAT_INVALID when none of them is there   */
+static SDL_GPUShaderFormat PickShaderFormat(const APPSTATE *state, const char **extension)
+{
 	const SDL_GPUShaderFormat availableformats = SDL_GetGPUShaderFormats(state->dev);
-
+	*extension = NULL;
 	if (availableformats & SDL_GPU_SHADERFORMAT_METALLIB)  // Apple Metal
 	{
-		BLOB mtllib = ReadBlob(state, "Data/Shaders/Shader.metallib");
-		vtxshader = LoadShaderBlob(state, mtllib, SDL_GPU_SHADERFORMAT_METALLIB, "VertexMain", false);
-		frgshader = LoadShaderBlob(state, mtllib, SDL_GPU_SHADERFORMAT_METALLIB, "FragmentMain", true);
-		SDL_free(mtllib.data);
+		return SDL_GPU_SHADERFORMAT_METALLIB;
+	}
+	if (availableformats & SDL_GPU_SHADERFORMAT_SPIRV)  // Vulkan
+	{
+		*extension = "spv";
+		return SDL_GPU_SHADERFORMAT_SPIRV;
+	}
+	if (availableformats & SDL_GPU_SHADERFORMAT_DXIL)  // Direct3D 12 Shader Model 6.0
+	{
+		*extension = "dxb";
+		return SDL_GPU_SHADERFORMAT_DXIL;
 	}
-	else if (availableformats & SDL_GPU_SHADERFORMAT_SPIRV)  // Vulkan
+	if (availableformats & SDL_GPU_SHADERFORMAT_DXBC)  // Direct3D 12 Shader Model 5.1
 	{
-		vtxshader = LoadShader(state, "Data/Shaders/Shader.vertex.spv", SDL_GPU_SHADERFORMAT_SPIRV, "main", false);
-		frgshader = LoadShader(state, "Data/Shaders/Shader.fragment.spv", SDL_GPU_SHADERFORMAT_SPIRV, "main", true);
+		*extension = "fxb";
+		return SDL_GPU_SHADERFORMAT_DXBC;
 	}
-	else if (availableformats & SDL_GPU_SHADERFORMAT_DXIL)  // Direct3D 12 Shader Model 6.0
+	return SDL_GPU_SHADERFORMAT_INVALID;
+}
+
+/*  Load the world shaders and the instanced variant of the vertex shader, the       *
+ *  instanced shader is optional and set to NULL when it's missing. The texture      *
+ *  array variants sample the material layer given by each vertex, the packed        *
+ *  variants read PACKEDVERTEX & dequantize it with the packed mesh's boxes.         */
+static bool LoadShaders(APPSTATE *state, bool texturearray, bool packed, SDL_GPUShader **vertexshader,
+	SDL_GPUShader **fragmentshader, SDL_GPUShader **instancedshader)
+{
+	SDL_GPUShader *vtxshader = NULL, *frgshader = NULL, *instshader = NULL;
+
+	const char *variant = texturearray ? ".array" : "";
+	const char *vtxvariant = texturearray ? (packed ? ".array.packed" : ".array") : (packed ? ".packed" : "");
+	char vtxpath[64], frgpath[64], instpath[64];
+	const char *extension;
+	const SDL_GPUShaderFormat format = PickShaderFormat(state, &extension);
+	const char *vtxentry = format == SDL_GPU_SHADERFORMAT_SPIRV ? "main" : "VertexMain";
+	const char *frgentry = format == SDL_GPU_SHADERFORMAT_SPIRV ? "main" : "FragmentMain";
+
+	if (format == SDL_GPU_SHADERFORMAT_METALLIB)  // Apple Metal
 	{
-		vtxshader = LoadShader(state, "Data/Shaders/Shader.vertex.dxb", SDL_GPU_SHADERFORMAT_DXIL, "VertexMain", false);
-		frgshader = LoadShader(state, "Data/Shaders/Shader.fragment.dxb", SDL_GPU_SHADERFORMAT_DXIL, "FragmentMain", true);
+		const BLOB mtllib = ShaderBlob(state, "Data/Shaders/Shader.metallib");
+		static const char *const vtxentries[2][2] =
+		{
+			{ "VertexMain", "VertexPackedMain" },
+			{ "VertexArrayMain", "VertexArrayPackedMain" }
+		};
+		static const char *const instentries[2][2] =
+		{
+			{ "VertexInstancedMain", "VertexPackedInstancedMain" },
+			{ "VertexArrayInstancedMain", "VertexArrayPackedInstancedMain" }
+		};
+		vtxshader = LoadShaderBlob(state, mtllib, format, vtxentries[texturearray][packed], false, packed);
+		frgshader = LoadShaderBlob(state, mtllib, format, texturearray ? "FragmentArrayMain" : "FragmentMain", true,
+			false);
+		instshader = LoadShaderBlob(state, mtllib, format, instentries[texturearray][packed], false, packed);
 	}
-	else if (availableformats & SDL_GPU_SHADERFORMAT_DXBC)  // Direct3D 12 Shader Model 5.1
+
+	// Every other backend keeps each stage & variant in its own file
+	if (extension)
 	{
-		vtxshader = LoadShader(state, "Data/Shaders/Shader.vertex.fxb", SDL_GPU_SHADERFORMAT_DXBC, "VertexMain", false);
-		frgshader = LoadShader(state, "Data/Shaders/Shader.fragment.fxb", SDL_GPU_SHADERFORMAT_DXBC, "FragmentMain", true);
+		SDL_snprintf(vtxpath, sizeof(vtxpath), "Data/Shaders/Shader%s.vertex.%s", vtxvariant, extension);
+		SDL_snprintf(frgpath, sizeof(frgpath), "Data/Shaders/Shader%s.fragment.%s", variant, extension);
+		SDL_snprintf(instpath, sizeof(instpath), "Data/Shaders/Shader%s.instanced.vertex.%s", vtxvariant, extension);
+		vtxshader = LoadShader(state, vtxpath, format, vtxentry, false, packed);
+		frgshader = LoadShader(state, frgpath, format, frgentry, true, false);
+		instshader = LoadShader(state, instpath, format, vtxentry, false, packed);
 	}
 
 	if (!vtxshader || !frgshader)
 	{
-		if (vtxshader) SDL_ReleaseGPUShader(state->dev, vtxshader);
-		if (frgshader) SDL_ReleaseGPUShader(state->dev, frgshader);
-		return false;
+		return false;  // Whatever was created stays in the cache until quitting
 	}
 
 	*vertexshader = vtxshader;
 	*fragmentshader = frgshader;
+	*instancedshader = instshader;
 	return true;
 }
 
-static bool CreateDepthTexture(APPSTATE *state, unsigned width, unsigned height)
+/*  Load one of the shaders drawing something other than the shaded world, from its  *
+ *  own file named by variant or from mtlentry in the Metal library. NULL when it's  *
+ *  missing, the caller decides what to do without it.                               *
+ *  variant     - Name between "Shader." & the stage, "depth.packed" say             */
+static SDL_GPUShader * LoadPassShader(APPSTATE *state, const char *variant, const char *mtlentry,
+	bool isfragment, bool packed)
+{
+	const char *extension;
+	const SDL_GPUShaderFormat format = PickShaderFormat(state, &extension);
+	if (format == SDL_GPU_SHADERFORMAT_METALLIB)
+	{
+		return LoadShaderBlob(state, ShaderBlob(state, "Data/Shaders/Shader.metallib"), format, mtlentry,
+			isfragment, packed);
+	}
+	if (!extension)
+	{
+		return NULL;
+	}
+	char path[64];
+	SDL_snprintf(path, sizeof(path), "Data/Shaders/Shader.%s.%s.%s", variant, isfragment ? "fragment" : "vertex",
+		extension);
+	const char *entry = format == SDL_GPU_SHADERFORMAT_SPIRV ? "main" : isfragment ? "FragmentMain" : "VertexMain";
+	return LoadShader(state, path, format, entry, isfragment, packed);
+}
+
+static bool CreateDepthTexture(APPSTATE *state, unsigned width, unsigned height, SDL_GPUSampleCount samplecount)
 {
 	if (state->depthtex)
 	{
@@ -370,7 +1042,7 @@ static bool CreateDepthTexture(APPSTATE *state, unsigned width, unsigned height)
 		.height = height,
 		.layer_count_or_depth = 1,
 		.num_levels = 1,
-		.sample_count = SDL_GPU_SAMPLECOUNT_1,
+		.sample_count = samplecount,
 		.usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET,
 		.props = texprops
 	});
@@ -384,110 +1056,679 @@ static bool CreateDepthTexture(APPSTATE *state, unsigned width, unsigned height)
 	state->depthtex  = newtex;
 	state->depthtexw = width;
 	state->depthtexh = height;
+	state->depthtexcount = samplecount;
 	return true;
 }
 
-static SDL_GPUTexture * CreateTextureFromSurface(APPSTATE *state, const SDL_Surface *image, bool genmips)
+/*  Create a texture from numlayers images of the same size, a 2D array texture      *
+ *  with a layer each when array is set. The images are flipped & converted to RGBA  *
+ *  straight into the transfer buffer on the workers. When mips are filtered on the  *
+ *  CPU rather than generated on the GPU, every level is made in heap memory first   *
+ *  and copied in, so nothing is read back from the mapping.                         */
+static SDL_GPUTexture * CreateTextureFromImages(APPSTATE *state, SDL_Surface *const *images,
+	Uint32 numlayers, bool array, bool genmips)
 {
-	const int width = image->w, height = image->h, depth = 1;
-	const Uint32 datasize = 4 * width * height;
-
-	// Convert the input surface into RGBA
-	void *converted = SDL_malloc(datasize);
-	if (!SDL_ConvertPixels(width, height,
-		image->format, image->pixels, image->pitch,
-		SDL_PIXELFORMAT_ABGR8888, converted, 4 * width))
-	{
-		SDL_free(converted);
-		return NULL;
-	}
+	SDL_assert(numlayers > 0 && (array || numlayers == 1));
+	const int width = images[0]->w, height = images[0]->h, depth = 1;
 
 	SDL_GPUTextureUsageFlags usage = SDL_GPU_TEXTUREUSAGE_SAMPLER;
 	int levels = 1;
 	if (genmips)
 	{
-		usage |= SDL_GPU_TEXTUREUSAGE_COLOR_TARGET;
 		// Calculate the number of mipmap levels the texture should store
 		const int max = width > height ? width : height;
 		// AKA: for (int i = max; i > 1; ++levels, i /= 2);
 		// AKA: floor(log₂(max(𝑤,ℎ)) + 1
 		levels = SDL_MostSignificantBitIndex32(max) + 1;
 	}
+	const bool cpumips = genmips && state->cpumips;
+	if (genmips && !cpumips)
+	{
+		usage |= SDL_GPU_TEXTUREUSAGE_COLOR_TARGET;
+	}
+	// Every level of a layer is uploaded when filtered here, only the first when the GPU generates the rest
+	const int uploaded = cpumips ? levels : 1;
+	Uint32 layersize = 0;
+	for (int level = 0; level < uploaded; ++level)
+	{
+		layersize += 4u * (Uint32)SDL_max(width >> level, 1) * (Uint32)SDL_max(height >> level, 1);
+	}
+	const Uint32 datasize = layersize * numlayers;
 
 	SDL_GPUTexture *texture = SDL_CreateGPUTexture(state->dev, &(SDL_GPUTextureCreateInfo)
 	{
-		.type = SDL_GPU_TEXTURETYPE_2D,
+		.type = array ? SDL_GPU_TEXTURETYPE_2D_ARRAY : SDL_GPU_TEXTURETYPE_2D,
 		.format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
 		.width = width,
 		.height = height,
-		.layer_count_or_depth = 1,
+		.layer_count_or_depth = numlayers,
 		.num_levels = (Uint32)levels,
 		.usage = usage,
 	});
 
-	// Create and copy image data to a transfer buffer
+	// The mapping is write-combined and slow to read back, so filtered levels are made in two heap buffers
+	// taking turns as source & destination. The first is as big as the top level, the second the next one.
 	SDL_GPUTransferBuffer *xferbuf = SDL_CreateGPUTransferBuffer(state->dev, &(SDL_GPUTransferBufferCreateInfo)
 	{
 		.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
 		.size = datasize
 	});
-	void *map = SDL_MapGPUTransferBuffer(state->dev, xferbuf, false);
-	SDL_memcpy(map, converted, (size_t)datasize);
-	SDL_UnmapGPUTransferBuffer(state->dev, xferbuf);
+	const size_t topsize = 4 * (size_t)width * (size_t)height;
+	const size_t nextsize = 4 * (size_t)SDL_max(width >> 1, 1) * (size_t)SDL_max(height >> 1, 1);
+	Uint8 *scratch = uploaded > 1 ? SDL_malloc(topsize + nextsize) : NULL;
+	Uint8 *map = xferbuf && (uploaded == 1 || scratch) ? SDL_MapGPUTransferBuffer(state->dev, xferbuf, false) : NULL;
+	bool converted = map != NULL;
+	for (Uint32 layer = 0; converted && layer < numlayers; ++layer)
+	{
+		Uint8 *pixels = map + (size_t)layer * layersize;
+		if (!scratch)
+		{
+			converted = ConvertImageRGBA(&state->jobs, pixels, images[layer], true);
+			continue;
+		}
+		Uint8 *above = scratch, *below = scratch + topsize;
+		converted = ConvertImageRGBA(&state->jobs, above, images[layer], true);
+		for (int level = 0; converted && level < uploaded; ++level)
+		{
+			const int levelw = SDL_max(width >> level, 1), levelh = SDL_max(height >> level, 1);
+			if (level > 0)
+			{
+				converted = DownsampleRGBA(&state->jobs, below, above, SDL_max(width >> (level - 1), 1),
+					SDL_max(height >> (level - 1), 1));
+				Uint8 *swap = above;
+				above = below;
+				below = swap;
+			}
+			SDL_memcpy(pixels, above, 4 * (size_t)levelw * levelh);
+			pixels += 4 * levelw * levelh;
+		}
+	}
+	if (map)
+	{
+		SDL_UnmapGPUTransferBuffer(state->dev, xferbuf);
+	}
+	SDL_free(scratch);
+	SDL_GPUCommandBuffer *cmdbuf = texture && converted ? SDL_AcquireGPUCommandBuffer(state->dev) : NULL;
+	if (!cmdbuf)
+	{
+		SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
+		SDL_ReleaseGPUTexture(state->dev, texture);
+		return NULL;
+	}
 
-	// Upload the transfer data to the GPU resources
-	SDL_GPUCommandBuffer *cmdbuf = SDL_AcquireGPUCommandBuffer(state->dev);
+	// Upload the transfer data to the GPU resources, a layer at a time
 	SDL_GPUCopyPass *pass = SDL_BeginGPUCopyPass(cmdbuf);
-	const SDL_GPUTextureTransferInfo source = { .transfer_buffer = xferbuf, .offset = 0 };
-	const SDL_GPUTextureRegion dest =
+	Uint32 offset = 0;
+	for (Uint32 layer = 0; layer < numlayers; ++layer)
 	{
-		.texture = texture,
-		.w = width,
-		.h = height,
-		.d = depth
-	};
-	SDL_UploadToGPUTexture(pass, &source, &dest, false);
+		for (int level = 0; level < uploaded; ++level)
+		{
+			const Uint32 levelw = (Uint32)SDL_max(width >> level, 1), levelh = (Uint32)SDL_max(height >> level, 1);
+			const SDL_GPUTextureTransferInfo source = { .transfer_buffer = xferbuf, .offset = offset };
+			const SDL_GPUTextureRegion dest =
+			{
+				.texture = texture,
+				.mip_level = (Uint32)level,
+				.layer = layer,
+				.w = levelw,
+				.h = levelh,
+				.d = depth
+			};
+			SDL_UploadToGPUTexture(pass, &source, &dest, false);
+			offset += 4 * levelw * levelh;
+		}
+	}
 	SDL_EndGPUCopyPass(pass);
 
-	if (genmips)
+	if (genmips && !cpumips)
 	{
 		SDL_GenerateMipmapsForGPUTexture(cmdbuf, texture);
 	}
 
 	SDL_SubmitGPUCommandBuffer(cmdbuf);
 	SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
-	SDL_free(converted);
 
 	return texture;
 }
 
-static bool LoadTexture(APPSTATE *state)
+static SDL_GPUTextureFormat BlockTextureFormat(Uint32 format)
 {
-	// Load & flip the bitmap
-	const char *resname = "Data/Mud.bmp";
-	char *path = resourcePath(state, resname);
-	if (!path)
+	switch (format)
+	{
+	case BLOCKFORMAT_BC1: return SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM;
+	case BLOCKFORMAT_BC3: return SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM;
+	default: return SDL_GPU_TEXTUREFORMAT_INVALID;
+	}
+}
+
+// Create an empty compiled material texture holding levels first to the last
+static SDL_GPUTexture * CreateBlockTexture(APPSTATE *state, const TEXTUREHEADER *header, Uint32 numlayers,
+	Uint32 first)
+{
+	return SDL_CreateGPUTexture(state->dev, &(SDL_GPUTextureCreateInfo)
+	{
+		.type = state->texturearray ? SDL_GPU_TEXTURETYPE_2D_ARRAY : SDL_GPU_TEXTURETYPE_2D,
+		.format = BlockTextureFormat(header->format),
+		.width = SDL_max(header->width >> first, 1u),
+		.height = SDL_max(header->height >> first, 1u),
+		.layer_count_or_depth = numlayers,
+		.num_levels = header->numlevels - first,
+		.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER
+	});
+}
+
+/*  Create a texture from compiled textures' levels first to the last, stored one    *
+ *  texture after another. The blocks are uploaded as they are, nothing is converted *
+ *  or generated.                                                                    */
+static SDL_GPUTexture * UploadBlockTexture(APPSTATE *state, const TEXTUREHEADER *header, const Uint8 *blocks,
+	Uint32 numlayers, Uint32 first)
+{
+	SDL_assert(numlayers > 0 && (state->texturearray || numlayers == 1));
+	Uint32 layersize = 0;
+	for (Uint32 level = first; level < header->numlevels; ++level)
+	{
+		layersize += BlockLevelSize(header->format, SDL_max(header->width >> level, 1u),
+			SDL_max(header->height >> level, 1u));
+	}
+	const Uint32 datasize = layersize * numlayers;
+
+	SDL_GPUTexture *texture = CreateBlockTexture(state, header, numlayers, first);
+	SDL_GPUTransferBuffer *xferbuf = SDL_CreateGPUTransferBuffer(state->dev, &(SDL_GPUTransferBufferCreateInfo)
+	{
+		.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+		.size = datasize
+	});
+	void *map = xferbuf ? SDL_MapGPUTransferBuffer(state->dev, xferbuf, false) : NULL;
+	SDL_GPUCommandBuffer *cmdbuf = texture && map ? SDL_AcquireGPUCommandBuffer(state->dev) : NULL;
+	if (map)
+	{
+		SDL_memcpy(map, blocks, (size_t)datasize);
+		SDL_UnmapGPUTransferBuffer(state->dev, xferbuf);
+	}
+	if (!cmdbuf)
+	{
+		SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
+		SDL_ReleaseGPUTexture(state->dev, texture);
+		return NULL;
+	}
+
+	// Upload every mip level of every layer, in the order they're stored
+	SDL_GPUCopyPass *pass = SDL_BeginGPUCopyPass(cmdbuf);
+	Uint32 offset = 0;
+	for (Uint32 layer = 0; layer < numlayers; ++layer)
+	{
+		for (Uint32 level = first; level < header->numlevels; ++level)
+		{
+			const Uint32 width = SDL_max(header->width >> level, 1u), height = SDL_max(header->height >> level, 1u);
+			const SDL_GPUTextureTransferInfo source = { .transfer_buffer = xferbuf, .offset = offset };
+			const SDL_GPUTextureRegion dest =
+			{
+				.texture = texture,
+				.mip_level = level - first,
+				.layer = layer,
+				.w = width,
+				.h = height,
+				.d = 1
+			};
+			SDL_UploadToGPUTexture(pass, &source, &dest, false);
+			offset += BlockLevelSize(header->format, width, height);
+		}
+	}
+	SDL_EndGPUCopyPass(pass);
+	SDL_SubmitGPUCommandBuffer(cmdbuf);
+	SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
+
+	return texture;
+}
+
+/*  Residency backend: recreate the material texture with levels first to the last   *
+ *  on the frame's command buffer, copying the levels it already holds over and      *
+ *  uploading the newly read finest level when streaming in                          */
+static bool ResizeMaterialTexture(void *data, void *context, int texture, int first, int oldfirst,
+	const void *texels)
+{
+	(void)texture;  // The material texture is the only one
+	APPSTATE *state = data;
+	SDL_GPUCommandBuffer *cmdbuf = context;
+	const TEXTUREHEADER *header = &state->textureheader;
+	const Uint32 numlayers = state->texturelayers;
+	const Uint32 levelsize = BlockLevelSize(header->format, SDL_max(header->width >> first, 1u),
+		SDL_max(header->height >> first, 1u));
+
+	SDL_GPUTexture *resized = CreateBlockTexture(state, header, numlayers, (Uint32)first);
+	SDL_GPUTransferBuffer *xferbuf = resized && texels ?
+		SDL_CreateGPUTransferBuffer(state->dev, &(SDL_GPUTransferBufferCreateInfo)
+		{
+			.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+			.size = levelsize * numlayers
+		}) : NULL;
+	void *map = xferbuf ? SDL_MapGPUTransferBuffer(state->dev, xferbuf, false) : NULL;
+	if (!resized || (texels && !map))
 	{
+		SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
+		SDL_ReleaseGPUTexture(state->dev, resized);
 		return false;
 	}
+	if (map)
+	{
+		SDL_memcpy(map, texels, (size_t)levelsize * numlayers);
+		SDL_UnmapGPUTransferBuffer(state->dev, xferbuf);
+	}
+
+	// Keep the levels both textures hold, then upload the new finest level of each layer
+	SDL_GPUCopyPass *pass = SDL_BeginGPUCopyPass(cmdbuf);
+	for (Uint32 level = (Uint32)SDL_max(first, oldfirst); level < header->numlevels; ++level)
+	{
+		for (Uint32 layer = 0; layer < numlayers; ++layer)
+		{
+			const SDL_GPUTextureLocation source =
+			{
+				.texture = state->texture,
+				.mip_level = level - (Uint32)oldfirst,
+				.layer = layer
+			};
+			const SDL_GPUTextureLocation dest =
+			{
+				.texture = resized,
+				.mip_level = level - (Uint32)first,
+				.layer = layer
+			};
+			SDL_CopyGPUTextureToTexture(pass, &source, &dest,
+				SDL_max(header->width >> level, 1u), SDL_max(header->height >> level, 1u), 1, false);
+		}
+	}
+	for (Uint32 layer = 0; xferbuf && layer < numlayers; ++layer)
+	{
+		const SDL_GPUTextureTransferInfo source = { .transfer_buffer = xferbuf, .offset = layer * levelsize };
+		const SDL_GPUTextureRegion dest =
+		{
+			.texture = resized,
+			.mip_level = 0,
+			.layer = layer,
+			.w = SDL_max(header->width >> first, 1u),
+			.h = SDL_max(header->height >> first, 1u),
+			.d = 1
+		};
+		SDL_UploadToGPUTexture(pass, &source, &dest, false);
+	}
+	SDL_EndGPUCopyPass(pass);
+	SDL_ReleaseGPUTransferBuffer(state->dev, xferbuf);
+
+	// Released once the GPU is done with the frames still drawing with it
+	SDL_ReleaseGPUTexture(state->dev, state->texture);
+	state->texture = resized;
+	SDL_SetGPUTextureName(state->dev, state->texture, numlayers > 1 ? "Materials" : "Material 0");
+	return true;
+}
+
+#define TEXTURE_RESOURCE "Data/Mud.bmp"  // Texture of worlds that declare no materials
+
+/*  Load an image on a worker thread. It's flipped & converted to RGBA as it's       *
+ *  uploaded, only formats that can't be converted there directly are converted now. */
+static SDL_Surface * ReadTextureImage(APPSTATE *state, const char *name)
+{
+	char *path = resourcePath(state, name);
+	if (!path)
+	{
+		return NULL;
+	}
 	SDL_Surface *TextureImage = SDL_LoadBMP(path);
 	SDL_free(path);
-	if (!TextureImage || !SDL_FlipSurface(TextureImage, SDL_FLIP_VERTICAL))
+	if (TextureImage && !CanConvertRGBA(TextureImage->format))
 	{
+		SDL_Surface *converted = SDL_ConvertSurface(TextureImage, SDL_PIXELFORMAT_ABGR8888);
 		SDL_DestroySurface(TextureImage);
+		TextureImage = converted;
+	}
+	return TextureImage;
+}
+
+/*  Read every material image of the world in material order. Images are scaled to   *
+ *  the size of the first so each can be a layer of the same texture array.          */
+static bool ReadMaterialImages(APPSTATE *state, SDL_Surface **images, int *numlayers)
+{
+	const WORLD *world = &state->world;
+	const int count = SDL_max(world->nummaterials, 1);
+	for (int i = 0; i < count; ++i)
+	{
+		const char *name = world->nummaterials ? world->materials[i].image : TEXTURE_RESOURCE;
+		SDL_Surface *image = ReadTextureImage(state, name);
+		if (image && i > 0 && (image->w != images[0]->w || image->h != images[0]->h))
+		{
+			SDL_Surface *scaled = SDL_ScaleSurface(image, images[0]->w, images[0]->h, SDL_SCALEMODE_LINEAR);
+			SDL_DestroySurface(image);
+			image = scaled;
+		}
+		if (!(images[i] = image))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load material %d \"%s\": %s",
+				i, name, SDL_GetError());
+			for (int loaded = 0; loaded < i; ++loaded)
+			{
+				SDL_DestroySurface(images[loaded]);
+				images[loaded] = NULL;
+			}
+			return false;
+		}
+	}
+	*numlayers = count;
+	return true;
+}
+
+// Release the decoded material images that weren't uploaded
+static void FreeMaterialImages(STARTUP *startup)
+{
+	for (int i = 0; i < WORLD_MAX_MATERIALS; ++i)
+	{
+		SDL_DestroySurface(startup->textureimages[i]);
+		startup->textureimages[i] = NULL;
+	}
+}
+
+/*  Open a material's compiled texture (.btex), stored next to its image, with the   *
+ *  header read & the stream left at the first level. NULL if it's missing, or with  *
+ *  a warning if it's invalid or its format or size differs from match's.            */
+static SDL_IOStream * OpenMaterialBlocks(const APPSTATE *state, int material, const TEXTUREHEADER *match,
+	TEXTUREHEADER *header)
+{
+	// Swap the image's extension for .btex
+	const WORLD *world = &state->world;
+	const char *name = world->nummaterials ? world->materials[material].image : TEXTURE_RESOURCE;
+	const char *extension = SDL_strrchr(name, '.');
+	if (!extension || SDL_strchr(extension, '/'))
+	{
+		extension = name + SDL_strlen(name);
+	}
+	char path[WORLD_MATERIAL_PATH + 8];
+	SDL_snprintf(path, sizeof(path), "%.*s.btex", (int)(extension - name), name);
+
+	SDL_IOStream *in = fopenResource(state, path, "rb");
+	if (!in)
+	{
+		return NULL;
+	}
+	bool valid = ReadBlockTexture(in, header);
+	if (valid && match &&
+		(header->format != match->format || header->width != match->width || header->height != match->height))
+	{
+		valid = SDL_SetError("Format or size differs from the first material");
+	}
+	if (!valid)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to load \"%s\": %s", path, SDL_GetError());
+		SDL_CloseIO(in);
+		return NULL;
+	}
+	return in;
+}
+
+// First mip level no larger than TEXTURE_TAIL_SIZE, the levels loaded up front
+static Uint32 TextureTailLevel(const TEXTUREHEADER *header)
+{
+	const int largest = SDL_MostSignificantBitIndex32(SDL_max(header->width, header->height));
+	return (Uint32)SDL_max(largest - SDL_MostSignificantBitIndex32(TEXTURE_TAIL_SIZE), 0);
+}
+
+/*  Read the low mip levels, from the tail level down, of every material's compiled  *
+ *  texture one after another into a single allocation. Finer levels are streamed    *
+ *  in as drawing needs them. Returns NULL if any is missing or invalid, the images  *
+ *  are decoded instead.                                                             */
+static Uint8 * ReadMaterialBlocks(APPSTATE *state, TEXTUREHEADER *header, int *numlayers, Uint32 *first)
+{
+	const int count = SDL_max(state->world.nummaterials, 1);
+	Uint8 *blocks = NULL;
+	Uint64 offset = 0, layersize = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		TEXTUREHEADER layer;
+		SDL_IOStream *in = OpenMaterialBlocks(state, i, blocks ? header : NULL, &layer);
+		if (in && !blocks)
+		{
+			*header = layer;
+			*first = TextureTailLevel(&layer);
+			offset = BlockLevelOffset(&layer, *first);
+			layersize = BlockTextureSize(&layer) - offset;
+			blocks = layersize * (Uint64)count <= SDL_MAX_UINT32 ? SDL_malloc((size_t)(layersize * count)) : NULL;
+		}
+		const bool read = in && blocks && SDL_SeekIO(in, (Sint64)offset, SDL_IO_SEEK_CUR) >= 0 &&
+			SDL_ReadIO(in, blocks + layersize * i, (size_t)layersize) == layersize;
+		if (in)
+		{
+			SDL_CloseIO(in);
+		}
+		if (!read)
+		{
+			if (in)
+			{
+				SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to read material %d's levels: %s", i, SDL_GetError());
+			}
+			SDL_free(blocks);
+			return NULL;
+		}
+	}
+	*numlayers = count;
+	return blocks;
+}
+
+// Residency backend: read a level of every layer's compiled texture one after another, on a worker
+static bool ReadMaterialLevel(void *data, int texture, int level, void *dst, Uint32 size)
+{
+	(void)texture;  // The material texture is the only one
+	const APPSTATE *state = data;
+	const Uint32 layersize = size / state->texturelayers;
+	for (Uint32 layer = 0; layer < state->texturelayers; ++layer)
+	{
+		TEXTUREHEADER header;
+		SDL_IOStream *in = OpenMaterialBlocks(state, (int)layer, &state->textureheader, &header);
+		const bool read = in &&
+			SDL_SeekIO(in, (Sint64)BlockLevelOffset(&header, (Uint32)level), SDL_IO_SEEK_CUR) >= 0 &&
+			SDL_ReadIO(in, (Uint8 *)dst + (size_t)layersize * layer, layersize) == layersize;
+		if (in)
+		{
+			SDL_CloseIO(in);
+		}
+		if (!read)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool LoadTexture(APPSTATE *state)
+{
+	// Wait for the material textures to be read, they're only known once the world is
+	STARTUP *startup = &state->startup;
+	WaitJob(&state->jobs, &startup->worldjob);
+	WaitJob(&state->jobs, &startup->texturejob);
+
+	BeginPhase(state, PHASE_TEXTURE_UPLOAD);
+	const SDL_GPUTextureType type = state->texturearray ? SDL_GPU_TEXTURETYPE_2D_ARRAY : SDL_GPU_TEXTURETYPE_2D;
+	const Uint32 blockformat = startup->textureheader.format;
+	if (startup->textureblocks &&
+		!SDL_GPUTextureSupportsFormat(state->dev, BlockTextureFormat(blockformat), type, SDL_GPU_TEXTUREUSAGE_SAMPLER))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "BC%u textures unsupported, decoding the images instead",
+			(unsigned)blockformat);
+		SDL_free(startup->textureblocks);
+		startup->textureblocks = NULL;
+		ReadMaterialImages(state, startup->textureimages, &startup->texturelayers);
+	}
+	if (!startup->textureblocks && !startup->textureimages[0])
+	{
+		EndPhase(state, PHASE_TEXTURE_UPLOAD);
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load the world's material images");
 		return false;
 	}
 
-	// Create texture
-	state->texture = CreateTextureFromSurface(state, TextureImage, true);
-	SDL_SetGPUTextureName(state->dev, state->texture, resname);
+	// Create texture, without texture array shaders only the first material can be drawn
+	int numlayers = startup->texturelayers;
+	if (!state->texturearray && numlayers > 1)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Texture array shaders unavailable, drawing all %d materials "
+			"with the first. Shader.array.* come from Scripts/compile-shaders.py", numlayers);
+		numlayers = 1;
+	}
+	Uint32 levelsizes[RESIDENCY_MAX_LEVELS];
+	int numlevels = 0, first = 0;
+	if (startup->textureblocks)
+	{
+		const TEXTUREHEADER *header = &startup->textureheader;
+		state->texture = UploadBlockTexture(state, header, startup->textureblocks, (Uint32)numlayers,
+			startup->texturefirst);
+		state->textureheader = *header;
+		numlevels = (int)header->numlevels;
+		first = (int)startup->texturefirst;
+		for (int level = 0; level < numlevels; ++level)
+		{
+			levelsizes[level] = (Uint32)numlayers * BlockLevelSize(header->format,
+				SDL_max(header->width >> level, 1u), SDL_max(header->height >> level, 1u));
+		}
+	}
+	else
+	{
+		const SDL_Surface *image = startup->textureimages[0];
+		state->texture = CreateTextureFromImages(state, startup->textureimages, (Uint32)numlayers,
+			state->texturearray, true);
+
+		// Every level is uploaded or generated at once, nothing to stream
+		numlevels = SDL_MostSignificantBitIndex32((Uint32)SDL_max(image->w, image->h)) + 1;
+		for (int level = 0; level < numlevels; ++level)
+		{
+			levelsizes[level] = (Uint32)numlayers * 4u *
+				(Uint32)SDL_max(image->w >> level, 1) * (Uint32)SDL_max(image->h >> level, 1);
+		}
+	}
+	SDL_SetGPUTextureName(state->dev, state->texture, numlayers > 1 ? "Materials" : "Material 0");
+	EndPhase(state, PHASE_TEXTURE_UPLOAD);
+
+	// Track the levels resident against the budget, compiled textures stream finer levels in from the tail
+	state->texturelayers = (Uint32)numlayers;
+	const RESIDENCYBACKEND backend = { state, ReadMaterialLevel, ResizeMaterialTexture };
+	if (state->texture &&
+		(!InitResidency(&state->residency, &backend, &state->jobs, 1, state->texturebudget) ||
+		AddResidentTexture(&state->residency, numlevels, levelsizes, first) < 0))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Not streaming textures: %s", SDL_GetError());
+	}
 
-	// Free temporary surface
-	SDL_DestroySurface(TextureImage);
+	// Free temporary images & blocks
+	FreeMaterialImages(startup);
+	SDL_free(startup->textureblocks);
+	startup->textureblocks = NULL;
 
 	return state->texture != NULL;
 }
 
+static void TextureJob(void *data)
+{
+	APPSTATE *state = data;
+	STARTUP *startup = &state->startup;
+	BeginPhase(state, PHASE_TEXTURE_READ);
+	startup->textureblocks = ReadMaterialBlocks(state, &startup->textureheader, &startup->texturelayers,
+		&startup->texturefirst);
+	if (!startup->textureblocks)
+	{
+		ReadMaterialImages(state, startup->textureimages, &startup->texturelayers);
+	}
+	EndPhase(state, PHASE_TEXTURE_READ);
+}
+
+static void ShaderJob(void *data)
+{
+	APPSTATE *state = data;
+	BeginPhase(state, PHASE_SHADER_READ);
+	for (unsigned i = 0; i < SDL_arraysize(shaderfiles); ++i)
+	{
+		state->startup.shaderblobs[i] = ReadBlob(state, shaderfiles[i]);
+	}
+	EndPhase(state, PHASE_SHADER_READ);
+}
+
+static void WorldJob(void *data)
+{
+	APPSTATE *state = data;
+	BeginPhase(state, PHASE_WORLD_LOAD);
+	state->startup.worldloaded = ReadWorld(state) && PackWorldMesh(state) && PrepareProps(state) &&
+		InitVisibility(&state->vis, &state->world);
+	EndPhase(state, PHASE_WORLD_LOAD);
+
+	// The world lists the material images to decode
+	PushJob(&state->jobs, &state->startup.texturejob, TextureJob, state);
+}
+
+static void FreeShaderBlobs(APPSTATE *state)
+{
+	for (unsigned i = 0; i < SDL_arraysize(shaderfiles); ++i)
+	{
+		SDL_free(state->startup.shaderblobs[i].data);
+		state->startup.shaderblobs[i] = (BLOB){ NULL, 0U };
+	}
+}
+
+/*  Start reading assets on the worker threads, only their GPU uploads need to wait  *
+ *  for the device. The world job starts the texture job once it knows the world's   *
+ *  materials.                                                                       */
+static void StartLoading(APPSTATE *state)
+{
+	STARTUP *startup = &state->startup;
+	PushJob(&state->jobs, &startup->worldjob, WorldJob, state);
+	PushJob(&state->jobs, &startup->shaderjob, ShaderJob, state);
+}
+
+// Wait for any loading still in flight and release whatever it produced that wasn't uploaded
+static void FinishLoading(APPSTATE *state)
+{
+	STARTUP *startup = &state->startup;
+	WaitJob(&state->jobs, &startup->worldjob);
+	WaitJob(&state->jobs, &startup->texturejob);
+	WaitJob(&state->jobs, &startup->shaderjob);
+	FreeMaterialImages(startup);
+	SDL_free(startup->textureblocks);
+	startup->textureblocks = NULL;
+	FreeShaderBlobs(state);
+	FreeMesh(&startup->worldmesh);
+	SDL_free(startup->packeddata);
+	startup->packeddata = NULL;
+}
+
+// Log how pipelines were created & looked up so far
+static void LogPipelines(APPSTATE *state, const char *when)
+{
+	PIPELINESTATS stats;
+	GetPipelineStats(&state->pipelines, &stats);
+	if (stats.created + stats.failed == 0)
+	{
+		return;
+	}
+	const double toms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%s: %u pipelines created (%u warmed, %u failed) in %.2f ms, "
+		"slowest %.2f ms, %u lookups hit, %u missed, %u shaders for %u requests", when, stats.created, stats.warmed,
+		stats.failed, (double)stats.createticks * toms, (double)stats.slowestticks * toms, stats.hits, stats.misses,
+		stats.shaders, stats.shaders + stats.shaderhits);
+}
+
+// Log when each startup phase ran relative to launch, once the first frame is done
+static void LogStartup(APPSTATE *state)
+{
+	const STARTUP *startup = &state->startup;
+	const double toms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+	for (int i = 0; i < NUM_PHASES; ++i)
+	{
+		const PHASE *phase = &startup->phases[i];
+		if (phase->end == 0)
+		{
+			continue;
+		}
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Startup: %-17s %8.2f -> %8.2f ms (%s thread)", phasenames[i],
+			(double)(phase->begin - startup->launch) * toms, (double)(phase->end - startup->launch) * toms,
+			i < PHASE_PROMPT ? "worker" : "main");
+	}
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Startup: First frame after %.2f ms with %d worker threads",
+		(double)(startup->phases[PHASE_FIRST_FRAME].end - startup->launch) * toms, state->jobs.numthreads);
+	LogPipelines(state, "Startup");
+}
+
 static bool CreateGPUSamplers(APPSTATE *state)
 {
 	const SDL_GPUSamplerCreateInfo params[3] =
@@ -526,209 +1767,1503 @@ static bool CreateGPUSamplers(APPSTATE *state)
 		}
 		state->samplers[i] = sampler;
 	}
-
+
+	return true;
+}
+
+/*  Recalculate projection matrix         *
+ *  width   - Width of the framebuffer    *
+ *  height  - Height of the framebuffer   */
+static void ReSizeScene(APPSTATE *state, int width, int height)
+{
+	if (height == 0)                                    // Prevent division-by-zero by ensuring height is non-zero
+	{
+		height = 1;
+	}
+
+	const float aspect = (float)width / (float)height;        // Calculate aspect ratio
+	MakePerspective(state->projmtx, 45.0f, aspect, 0.1f, SCENE_FAR_PLANE);  // Setup perspective matrix
+}
+
+// What a world pipeline draws, MakePipeline sets the depth & color state from it
+enum
+{
+	WORLDPASS_OPAQUE,            // Shaded, depth tested & written
+	WORLDPASS_BLEND,             // Shaded translucent back to front, depth tested against the opaque but not written
+	WORLDPASS_DEPTH,             // Pre-pass writing depth from the position-only stream, no color
+	WORLDPASS_SHADE              // Shaded after the pre-pass, only the nearest fragments pass & nothing's written
+};
+
+/*  Register a world pipeline in the cache, it's only created when first used or     *
+ *  warmed. With --bench-overdraw every pass but the depth pre-pass adds one per     *
+ *  fragment into the R8 count texture instead.                                      *
+ *  samplecount - Samples per pixel of the color & depth targets it draws to         */
+static int MakePipeline(APPSTATE *state, SDL_GPUShader *vtxshader, SDL_GPUShader *frgshader, int worldpass,
+	bool instanced, SDL_GPUSampleCount samplecount)
+{
+	// Over blending, the texture is opaque so the opacity is the blend constant, BLEND_OPACITY. Unlike the
+	// original lesson's additive blending the result depends on the order, hence sorting back to front
+	const SDL_GPUColorTargetBlendState blendstate =
+	{
+		.enable_blend = true,
+		.color_blend_op = SDL_GPU_BLENDOP_ADD,
+		.alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+		.src_color_blendfactor = SDL_GPU_BLENDFACTOR_CONSTANT_COLOR,
+		.dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_CONSTANT_COLOR,
+		.src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_CONSTANT_COLOR,
+		.dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_CONSTANT_COLOR
+	};
+	const SDL_GPUColorTargetBlendState noblend = { .enable_blend = false };
+	const SDL_GPUColorTargetBlendState countstate =
+	{
+		.enable_blend = true,
+		.color_blend_op = SDL_GPU_BLENDOP_ADD,
+		.alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+		.src_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+		.dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+		.src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+		.dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE
+	};
+	const SDL_GPUColorTargetBlendState nowrite =
+	{
+		.enable_blend = false,
+		.enable_color_write_mask = true  // Masked to nothing, the pre-pass writes depth alone
+	};
+
+	const bool packed = state->packedvertices;
+	const SDL_GPUVertexAttribute vtxattribs[6] =
+	{
+		{
+			.location = 0,
+			.buffer_slot = 0,
+			.format = packed ? SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM : SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+			.offset = packed ? offsetof(PACKEDVERTEX, x) : offsetof(VERTEX, x)  // Packed w holds the box & layer
+		},
+		{
+			.location = 1,
+			.buffer_slot = 0,
+			.format = packed ? SDL_GPU_VERTEXELEMENTFORMAT_HALF2 :
+				state->texturearray ? SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3 : SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+			.offset = packed ? offsetof(PACKEDVERTEX, u) : offsetof(VERTEX, u)  // u, v then the material layer
+		},
+		// Per-instance model matrix for instanced pipelines, one column per attribute
+		{ .location = 2, .buffer_slot = 1, .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, .offset = 0 },
+		{ .location = 3, .buffer_slot = 1, .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, .offset = 4 * sizeof(float) },
+		{ .location = 4, .buffer_slot = 1, .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, .offset = 8 * sizeof(float) },
+		{ .location = 5, .buffer_slot = 1, .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, .offset = 12 * sizeof(float) }
+	};
+	// The pre-pass reads its position from the position-only stream, then the model matrix
+	const bool depthonly = worldpass == WORLDPASS_DEPTH;
+	const SDL_GPUVertexAttribute depthattribs[5] = { vtxattribs[0], vtxattribs[2], vtxattribs[3], vtxattribs[4],
+		vtxattribs[5] };
+	const SDL_GPUVertexBufferDescription vtxbuffers[2] =
+	{
+		{
+			.slot = 0,
+			.pitch = depthonly ? PositionSize(packed) : packed ? sizeof(PACKEDVERTEX) : sizeof(VERTEX),
+			.input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX
+		},
+		{
+			.slot = 1,
+			.pitch = sizeof(mat4f),
+			.input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE
+		}
+	};
+
+	const bool depthwrite = worldpass == WORLDPASS_OPAQUE || depthonly;
+	const SDL_GPUColorTargetBlendState *targetblend = depthonly ? &nowrite :
+		state->overdraw.enabled ? &countstate : worldpass == WORLDPASS_BLEND ? &blendstate : &noblend;
+
+	const SDL_GPUGraphicsPipelineCreateInfo info =
+	{
+		.vertex_shader = vtxshader,
+		.fragment_shader = frgshader,
+		.primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+		.vertex_input_state =
+		{
+			.num_vertex_buffers = instanced ? 2 : 1,
+			.vertex_buffer_descriptions = vtxbuffers,
+			.num_vertex_attributes = (instanced ? 6 : 2) - depthonly,
+			.vertex_attributes = depthonly ? depthattribs : vtxattribs
+		},
+		.rasterizer_state =
+		{
+			.fill_mode = SDL_GPU_FILLMODE_FILL,
+			.cull_mode = SDL_GPU_CULLMODE_NONE,
+			.front_face = SDL_GPU_FRONTFACE_COUNTER_CLOCKWISE  // Right-handed coordinates
+		},
+		.multisample_state =
+		{
+			.sample_count = samplecount
+		},
+		.depth_stencil_state =
+		{
+			// Pass if pixel depth value tests less than the depth buffer value, or after the pre-pass
+			// equal to the depth it laid down. Translucent surfaces are hidden by opaque ones in front
+			// of them but don't hide what's drawn after them.
+			.compare_op = worldpass == WORLDPASS_SHADE ? SDL_GPU_COMPAREOP_LESS_OR_EQUAL : SDL_GPU_COMPAREOP_LESS,
+			.enable_depth_test = true,                     // Enable depth testing
+			.enable_depth_write = depthwrite
+		},
+		.target_info =
+		{
+			.num_color_targets = 1,
+			.color_target_descriptions = &(SDL_GPUColorTargetDescription)
+			{
+				.format = state->overdraw.enabled ? SDL_GPU_TEXTUREFORMAT_R8_UNORM :
+					SDL_GetGPUSwapchainTextureFormat(state->dev, state->win),
+				.blend_state = *targetblend  // Set the blending function for translucency
+			},
+			.depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D16_UNORM,
+			.has_depth_stencil_target = true
+		}
+	};
+	return AddPipeline(&state->pipelines, &info);
+}
+
+/*  Load the most capable shaders there are, texture arrays first and then packed    *
+ *  vertices when the world mesh was packed. The packed mesh is made by the world    *
+ *  job, so asking for it waits for the world here.                                  */
+static bool PickShaders(APPSTATE *state, SDL_GPUShader **vertexshader,
+	SDL_GPUShader **fragmentshader, SDL_GPUShader **instancedshader)
+{
+	STARTUP *startup = &state->startup;
+	if (startup->packvertices)
+	{
+		WaitJob(&state->jobs, &startup->worldjob);
+	}
+	const bool packable = startup->packeddata != NULL;
+	for (int texturearray = 1; texturearray >= 0; --texturearray)
+	{
+		for (int packed = packable; packed >= 0; --packed)
+		{
+			if (LoadShaders(state, texturearray, packed, vertexshader, fragmentshader, instancedshader))
+			{
+				state->texturearray = texturearray;
+				state->packedvertices = packed;
+				if (packable && !packed)
+				{
+					SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Packed vertex shaders unavailable, drawing float "
+						"vertices. Shader.*packed.vertex come from Scripts/compile-shaders.py");
+				}
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/*  Register the depth pre-pass & the shading after it at a sample count, for props  *
+ *  too when they're instanced. False when a depth-only shader is missing or a       *
+ *  pipeline can't be registered, the scene is then drawn without the pre-pass.      */
+static bool MakePrepassPipelines(APPSTATE *state, SDL_GPUShader *vtxshader, SDL_GPUShader *frgshader,
+	SDL_GPUShader *instshader, SDL_GPUSampleCount samplecount)
+{
+	const bool packed = state->packedvertices;
+	SDL_GPUShader *depthshader = LoadPassShader(state, packed ? "depth.packed" : "depth",
+		packed ? "VertexDepthPackedMain" : "VertexDepthMain", false, packed);
+	SDL_GPUShader *depthinstshader = LoadPassShader(state, packed ? "depth.packed.instanced" : "depth.instanced",
+		packed ? "VertexDepthPackedInstancedMain" : "VertexDepthInstancedMain", false, packed);
+	SDL_GPUShader *depthfrgshader = LoadPassShader(state, "depth", "FragmentDepthMain", true, false);
+	if (!depthshader || !depthfrgshader || (instshader && !depthinstshader))
+	{
+		return false;
+	}
+	WORLDPIPELINES *psos = &state->psos[samplecount];
+	psos->psodepth = MakePipeline(state, depthshader, depthfrgshader, WORLDPASS_DEPTH, false, samplecount);
+	psos->psoshade = MakePipeline(state, vtxshader, frgshader, WORLDPASS_SHADE, false, samplecount);
+	if (instshader)
+	{
+		psos->psodepthinstanced = MakePipeline(state, depthinstshader, depthfrgshader, WORLDPASS_DEPTH, true,
+			samplecount);
+		psos->psoshadeinstanced = MakePipeline(state, instshader, frgshader, WORLDPASS_SHADE, true, samplecount);
+	}
+	return psos->psodepth >= 0 && psos->psoshade >= 0 &&
+		(!instshader || (psos->psodepthinstanced >= 0 && psos->psoshadeinstanced >= 0));
+}
+
+/*  Most samples per pixel to draw with, the --msaa count as far as both the         *
+ *  swapchain's color format & the depth format support it. Counting overdraw draws  *
+ *  single sampled into its R8 texture.                                              */
+static void PickSampleCount(APPSTATE *state)
+{
+	MULTISAMPLE *msaa = &state->msaa;
+	int count = SDL_GPU_SAMPLECOUNT_1;
+	while (count < SDL_GPU_SAMPLECOUNT_8 && (2 << count) <= msaa->samples)
+	{
+		++count;
+	}
+	if (count > SDL_GPU_SAMPLECOUNT_1 && state->overdraw.enabled)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Overdraw is counted without multisampling, ignoring --msaa");
+		count = SDL_GPU_SAMPLECOUNT_1;
+	}
+	const SDL_GPUTextureFormat format = SDL_GetGPUSwapchainTextureFormat(state->dev, state->win);
+	while (count > SDL_GPU_SAMPLECOUNT_1 &&
+		(!SDL_GPUTextureSupportsSampleCount(state->dev, format, (SDL_GPUSampleCount)count) ||
+		!SDL_GPUTextureSupportsSampleCount(state->dev, SDL_GPU_TEXTUREFORMAT_D16_UNORM, (SDL_GPUSampleCount)count)))
+	{
+		--count;
+	}
+	if ((1 << count) < msaa->samples && !state->overdraw.enabled)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%dx MSAA unsupported, drawing with %dx", msaa->samples, 1 << count);
+	}
+	msaa->maxcount = msaa->count = (SDL_GPUSampleCount)count;
+}
+
+static bool InitGPU(APPSTATE *state)
+{
+	// Pipelines come first, the texture is only an array when the shaders can sample one
+	WaitJob(&state->jobs, &state->startup.shaderjob);
+	BeginPhase(state, PHASE_PIPELINES);
+	if (!InitPipelineCache(&state->pipelines, state->dev, &state->jobs))
+	{
+		return false;
+	}
+	SDL_GPUShader *vtxshader, *frgshader, *instshader;
+	if (!PickShaders(state, &vtxshader, &frgshader, &instshader))  // Load shaders
+	{
+		return false;
+	}
+
+	// Counting overdraw swaps shading for adding one per fragment
+	if (state->overdraw.enabled)
+	{
+		SDL_GPUShader *countshader = LoadPassShader(state, "overdraw", "FragmentOverdrawMain", true, false);
+		if (countshader)
+		{
+			frgshader = countshader;
+		}
+		else
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Overdraw shader unavailable, shaded fragments won't be "
+				"counted. Shader.overdraw.fragment comes from Scripts/compile-shaders.py");
+			state->overdraw.enabled = false;
+		}
+	}
+
+	// MSL 1.1 can't mark positions invariant, so the pre-pass depth may not match the shading pass's and
+	// LESS_OR_EQUAL would let pixels through it
+	const char *extension;
+	if (state->depthprepass && PickShaderFormat(state, &extension) == SDL_GPU_SHADERFORMAT_METALLIB)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Depth pre-pass isn't invariant on Metal, drawing without one");
+		state->depthprepass = false;
+	}
+
+	// Only registered here, the workers create them while the texture & world upload. Adapting the sample
+	// count registers every count it may drop to.
+	MULTISAMPLE *msaa = &state->msaa;
+	PickSampleCount(state);
+	const int mincount = msaa->budgetms > 0.0f ? SDL_GPU_SAMPLECOUNT_1 : (int)msaa->maxcount;
+	for (int count = mincount; count <= (int)msaa->maxcount; ++count)
+	{
+		WORLDPIPELINES *psos = &state->psos[count];
+		psos->pso = MakePipeline(state, vtxshader, frgshader, WORLDPASS_OPAQUE, false, (SDL_GPUSampleCount)count);
+		psos->psoblend = MakePipeline(state, vtxshader, frgshader, WORLDPASS_BLEND, false, (SDL_GPUSampleCount)count);
+		if (instshader)
+		{
+			psos->psoinstanced = MakePipeline(state, instshader, frgshader, WORLDPASS_OPAQUE, true,
+				(SDL_GPUSampleCount)count);
+		}
+		if (psos->pso < 0 || psos->psoblend < 0)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to register pipelines: %s", SDL_GetError());
+			return false;
+		}
+		if (state->depthprepass &&
+			!MakePrepassPipelines(state, vtxshader, frgshader, instshader, (SDL_GPUSampleCount)count))
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Depth pre-pass shaders unavailable, drawing without one. "
+				"Shader.depth.* come from Scripts/compile-shaders.py");
+			state->depthprepass = false;
+		}
+	}
+	WarmPipelines(&state->pipelines);
+	FreeShaderBlobs(state);
+	EndPhase(state, PHASE_PIPELINES);
+
+	if (!LoadTexture(state))                          // Load texture
+	{
+		return false;
+	}
+	if (!CreateGPUSamplers(state))                    // Create texture samplers
+	{
+		return false;
+	}
+
+	unsigned backbufw, backbufh;
+	SDL_GetWindowSizeInPixels(state->win, (int *)&backbufw, (int *)&backbufh);
+	if (!CreateDepthTexture(state, backbufw, backbufh, msaa->count))
+	{
+		return false;
+	}
+
+	if (!LoadWorld(state))
+	{
+		return false;
+	}
+
+	// Dynamic data is streamed through a ring big enough for every prop placement's matrix & every sector
+	// triangle's sorted indices
+	const Uint32 propbytes = (Uint32)sizeof(mat4f) * (Uint32)state->world.numinstances;
+	const Uint32 sortedbytes = state->trisort.indexsize * 3 * state->trisort.numtriangles;
+	if (!InitUploadRing(&state->uploads, state->dev, SDL_max(UPLOAD_RING_SIZE, propbytes + sortedbytes + 16)))
+	{
+		return false;
+	}
+
+	// The first frame needs the opaque pipelines, wait for them here so failing to create one fails startup.
+	// The blended ones are left to their first use, and lower sample counts' to the count dropping to them.
+	WORLDPIPELINES *psos = &state->psos[msaa->count];
+	if (!GetPipeline(&state->pipelines, psos->pso))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateGPUGraphicsPipeline(): %s", SDL_GetError());
+		return false;
+	}
+	if (psos->psoinstanced >= 0 && !GetPipeline(&state->pipelines, psos->psoinstanced))
+	{
+		// Props fall back to one draw per placement
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Instanced pipeline unavailable, props will be drawn one at a time");
+		for (int count = 0; count < MSAA_COUNTS; ++count)
+		{
+			state->psos[count].psoinstanced = -1;
+		}
+	}
+	if (state->depthprepass && (!GetPipeline(&state->pipelines, psos->psodepth) ||
+		!GetPipeline(&state->pipelines, psos->psoshade) || (psos->psoinstanced >= 0 &&
+		(!GetPipeline(&state->pipelines, psos->psodepthinstanced) ||
+		!GetPipeline(&state->pipelines, psos->psoshadeinstanced)))))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Depth pre-pass pipelines unavailable, drawing without one: %s",
+			SDL_GetError());
+		state->depthprepass = false;
+	}
+
+	// Adapting the sample count or the resolution times every frame on the GPU
+	const bool adaptsamples = msaa->budgetms > 0.0f && msaa->maxcount > SDL_GPU_SAMPLECOUNT_1;
+	if ((adaptsamples || state->resolution.budgetms > 0.0f) && !StartGPUTimer(&state->gputimer, state->dev))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Can't time GPU frames, drawing at a fixed %dx MSAA & scale: %s",
+			1 << msaa->count, SDL_GetError());
+	}
+	return true;
+}
+
+// Stream the model matrices of props in visible sectors to the instance buffer, grouped by prop
+static void GatherVisibleProps(APPSTATE *state, bool instanced)
+{
+	const WORLD *world = &state->world;
+	int numvisible = 0;
+	for (int i = 0; i < world->numprops; ++i)
+	{
+		const PROP *prop = &world->props[i];
+		const int first = numvisible;
+		for (int j = prop->firstinstance; j < prop->firstinstance + prop->numinstances; ++j)
+		{
+			if (SectorVisible(&state->vis, state->instancesectors[j]))
+			{
+				state->visibleinstances[numvisible++] = j;
+			}
+		}
+		state->propvisible[i] = numvisible - first;
+		state->propfirstvisible[i] = first;
+	}
+	state->numvisibleinstances = numvisible;
+	if (numvisible == 0 || !instanced)
+	{
+		return;
+	}
+
+	mat4f *matrices = AllocUpload(&state->uploads, state->propinstances, 0,
+		(Uint32)sizeof(mat4f) * (Uint32)numvisible, 16, true);
+	if (!matrices)
+	{
+		SDL_memset(state->propvisible, 0, sizeof(int) * (size_t)world->numprops);
+		state->numvisibleinstances = 0;
+		return;
+	}
+	for (int i = 0; i < numvisible; ++i)
+	{
+		SDL_memcpy(matrices[i], state->instancematrices[state->visibleinstances[i]], sizeof(mat4f));
+	}
+}
+
+// Binding states of the scene's draws, batches are recorded in this order
+enum
+{
+	DRAWSTATE_WORLD,             // World pipeline, also draws props one placement at a time
+	DRAWSTATE_INSTANCED          // Instanced prop pipeline reading the instance buffer
+};
+
+typedef struct tagSCENEDRAWS
+{
+	const APPSTATE *state;
+	const float *viewproj;
+	const float *eye;
+	bool instanced;
+	int numranges;               // Items are the visible world ranges unless blending, then props or placements
+} SCENEDRAWS;
+
+/*  Prepare the opaque draws of scene items first to end - 1 on a worker: the        *
+ *  visible world ranges, then either one instanced draw per prop reading model      *
+ *  matrices from the instance buffer, or one draw per placement with the model      *
+ *  matrix folded into the view & projection uniform to compare against. Ranges are  *
+ *  ordered by the distance to their sector and placements by the distance to their  *
+ *  origin, instanced props draw every placement at once and stay in index buffer    *
+ *  order.                                                                           */
+static void BuildSceneDraws(void *data, int first, int end, DRAWLIST *list)
+{
+	const SCENEDRAWS *scene = data;
+	const APPSTATE *state = scene->state;
+	const WORLD *world = &state->world;
+	for (int i = first; i < end; ++i)
+	{
+		if (i < scene->numranges)
+		{
+			const DRAWRANGE *range = &state->vis.ranges[i];
+			const Uint64 order = FrontToBackOrder(state->vis.rangedistances[i], SCENE_FAR_PLANE, range->firstindex);
+			AddDraw(list, DRAWKEY(DRAWSTATE_WORLD, order), range->firstindex, range->numindices, 0, 1, NULL);
+		}
+		else if (scene->instanced)
+		{
+			const int p = i - scene->numranges;
+			const PROP *prop = &world->props[p];
+			if (state->propvisible[p] > 0)
+			{
+				AddDraw(list, DRAWKEY(DRAWSTATE_INSTANCED, prop->firstindex), prop->firstindex, prop->numindices,
+					(Uint32)state->propfirstvisible[p], (Uint32)state->propvisible[p], NULL);
+			}
+		}
+		else
+		{
+			const int instance = state->visibleinstances[i - scene->numranges];
+			const PROP *prop = &world->props[world->instances[instance].prop];
+			const float *origin = &state->instancematrices[instance][12];
+			const float dx = origin[0] - scene->eye[0], dy = origin[1] - scene->eye[1], dz = origin[2] - scene->eye[2];
+			const float distance = SDL_sqrtf(dx * dx + dy * dy + dz * dz);
+			const Uint64 order = FrontToBackOrder(distance, SCENE_FAR_PLANE, prop->firstindex);
+			mat4f mvp;
+			MulMatrices(mvp, scene->viewproj, state->instancematrices[instance]);
+			AddDraw(list, DRAWKEY(DRAWSTATE_WORLD, order), prop->firstindex, prop->numindices, 0, 1, mvp);
+		}
+	}
+}
+
+/*  Pipeline drawing one of the WORLDPASS_* passes of the world, or of props when    *
+ *  instanced, at the sample count drawn with. Created now if neither a worker nor   *
+ *  an earlier frame has. Only the world's sorted triangles blend, falling back to   *
+ *  the opaque pipeline when their own couldn't be created. The others were created  *
+ *  before the first frame or before the sample count changed to theirs.             */
+static SDL_GPUGraphicsPipeline * WorldPipeline(APPSTATE *state, int worldpass, bool instanced)
+{
+	const WORLDPIPELINES *psos = &state->psos[state->msaa.count];
+	if (worldpass == WORLDPASS_DEPTH || worldpass == WORLDPASS_SHADE)
+	{
+		const int id = worldpass == WORLDPASS_DEPTH ? (instanced ? psos->psodepthinstanced : psos->psodepth) :
+			(instanced ? psos->psoshadeinstanced : psos->psoshade);
+		return GetPipeline(&state->pipelines, id);
+	}
+	SDL_GPUGraphicsPipeline *pipeline = worldpass == WORLDPASS_BLEND && !instanced ?
+		GetPipeline(&state->pipelines, psos->psoblend) : NULL;
+	return pipeline ? pipeline : GetPipeline(&state->pipelines, instanced ? psos->psoinstanced : psos->pso);
+}
+
+/*  Record the prepared batches for one pass over the scene, binding each state &    *
+ *  pushing each uniform only when it changes. The pass's matrix is left pushed for  *
+ *  whatever is recorded next.                                                       */
+static void RecordDraws(APPSTATE *state, int worldpass, SDL_GPUCommandBuffer *cmdbuf, SDL_GPURenderPass *pass,
+	const mat4f viewproj)
+{
+	Uint32 bound = DRAWSTATE_WORLD;  // Bound with the pass
+	const float *pushed = viewproj;
+	for (int i = 0; i < state->draws.numbatches; ++i)
+	{
+		const DRAWBATCH *batch = &state->draws.batches[i];
+		if (batch->state != bound)
+		{
+			if (batch->state == DRAWSTATE_INSTANCED)
+			{
+				SDL_BindGPUGraphicsPipeline(pass, WorldPipeline(state, worldpass, true));
+				SDL_BindGPUVertexBuffers(pass, 1, &(SDL_GPUBufferBinding)
+				{
+					.buffer = state->propinstances, .offset = 0
+				}, 1);
+			}
+			else
+			{
+				SDL_BindGPUGraphicsPipeline(pass, WorldPipeline(state, worldpass, false));
+			}
+			bound = batch->state;
+		}
+		const float *uniform = batch->uniform ? batch->uniform : viewproj;
+		if (uniform != pushed)
+		{
+			SDL_PushGPUVertexUniformData(cmdbuf, 0, uniform, sizeof(mat4f));
+			pushed = uniform;
+		}
+		SDL_DrawGPUIndexedPrimitives(pass, batch->numindices, batch->numinstances, batch->firstindex, 0,
+			batch->firstinstance);
+	}
+	if (pushed != viewproj)
+	{
+		SDL_PushGPUVertexUniformData(cmdbuf, 0, viewproj, sizeof(mat4f));
+	}
+}
+
+/*  Finest material texture level the nearest visible sector needs, about a texel    *
+ *  per pixel at the sector's closest point to the eye                               */
+static int WantedTextureLevel(const APPSTATE *state, const FRAME *frame, const float eye[3], Uint32 height)
+{
+	const VISIBILITY *vis = &state->vis;
+	if (vis->numvisible == 0)
+	{
+		return RESIDENCY_MAX_LEVELS;  // Outside the world, the tail will do
+	}
+	float nearest = SDL_MAX_SINT32;
+	for (int i = 0; i < vis->numvisible; ++i)
+	{
+		const SECTOR *sector = &state->world.sectors[vis->visible[i]];
+		float distsq = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float outside = SDL_max(sector->mins[axis] - eye[axis], 0.0f) +
+				SDL_max(eye[axis] - sector->maxs[axis], 0.0f);
+			distsq += outside * outside;
+		}
+		nearest = SDL_min(nearest, distsq);
+	}
+
+	// Each level halves the texels a pixel covers
+	const TEXTUREHEADER *header = &state->textureheader;
+	const float pixelsperunit = 0.5f * (float)height * frame->projmtx[5];  // At a distance of one unit
+	const float texelsperunit = state->texcoorddensity * (float)SDL_max(header->width, header->height);
+	float texelsperpixel = texelsperunit * SDL_sqrtf(nearest) / pixelsperunit;
+	int level = 0;
+	for (; texelsperpixel >= 2.0f && level < RESIDENCY_MAX_LEVELS; texelsperpixel *= 0.5f)
+	{
+		++level;
+	}
+	return level;
+}
+
+// (Re)create the overdraw count texture at the size drawn, it's blitted to the target drawn into
+static bool SizeOverdrawTexture(APPSTATE *state, Uint32 width, Uint32 height)
+{
+	OVERDRAW *overdraw = &state->overdraw;
+	if (overdraw->texture && overdraw->width == width && overdraw->height == height)
+	{
+		return true;
+	}
+	SDL_ReleaseGPUTexture(state->dev, overdraw->texture);
+	overdraw->texture = SDL_CreateGPUTexture(state->dev, &(SDL_GPUTextureCreateInfo)
+	{
+		.type = SDL_GPU_TEXTURETYPE_2D,
+		.format = SDL_GPU_TEXTUREFORMAT_R8_UNORM,
+		.width = width,
+		.height = height,
+		.layer_count_or_depth = 1,
+		.num_levels = 1,
+		.sample_count = SDL_GPU_SAMPLECOUNT_1,
+		.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER
+	});
+	if (!overdraw->texture)
+	{
+		return false;
+	}
+	SDL_SetGPUTextureName(state->dev, overdraw->texture, "Overdraw Texture");
+	overdraw->width = width;
+	overdraw->height = height;
+	return true;
+}
+
+// (Re)create the texture drawn into below the target's size, it's blitted up to the target
+static bool SizeScaledTexture(APPSTATE *state, Uint32 width, Uint32 height)
+{
+	if (state->scaledtex && state->scaledtexw == width && state->scaledtexh == height)
+	{
+		return true;
+	}
+	SDL_ReleaseGPUTexture(state->dev, state->scaledtex);
+	state->scaledtex = SDL_CreateGPUTexture(state->dev, &(SDL_GPUTextureCreateInfo)
+	{
+		.type = SDL_GPU_TEXTURETYPE_2D,
+		.format = SDL_GetGPUSwapchainTextureFormat(state->dev, state->win),
+		.width = width,
+		.height = height,
+		.layer_count_or_depth = 1,
+		.num_levels = 1,
+		.sample_count = SDL_GPU_SAMPLECOUNT_1,
+		.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER  // Blits sample their source
+	});
+	if (!state->scaledtex)
+	{
+		return false;
+	}
+	SDL_SetGPUTextureName(state->dev, state->scaledtex, "Scaled Texture");
+	state->scaledtexw = width;
+	state->scaledtexh = height;
+	return true;
+}
+
+// (Re)create the multisampled color texture at the size & sample count drawn, it's resolved into the target
+static bool SizeMultisampleTexture(APPSTATE *state, Uint32 width, Uint32 height)
+{
+	MULTISAMPLE *msaa = &state->msaa;
+	if (msaa->colortex && msaa->width == width && msaa->height == height && msaa->texcount == msaa->count)
+	{
+		return true;
+	}
+	SDL_ReleaseGPUTexture(state->dev, msaa->colortex);
+	msaa->colortex = SDL_CreateGPUTexture(state->dev, &(SDL_GPUTextureCreateInfo)
+	{
+		.type = SDL_GPU_TEXTURETYPE_2D,
+		.format = SDL_GetGPUSwapchainTextureFormat(state->dev, state->win),
+		.width = width,
+		.height = height,
+		.layer_count_or_depth = 1,
+		.num_levels = 1,
+		.sample_count = msaa->count,
+		.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET
+	});
+	if (!msaa->colortex)
+	{
+		return false;
+	}
+	SDL_SetGPUTextureName(state->dev, msaa->colortex, "Multisample Texture");
+	msaa->width = width;
+	msaa->height = height;
+	msaa->texcount = msaa->count;
+	return true;
+}
+
+// Whether every pipeline drawing opaque at a sample count could be created, creating them if nothing has yet
+static bool SampleCountReady(APPSTATE *state, SDL_GPUSampleCount count)
+{
+	const WORLDPIPELINES *psos = &state->psos[count];
+	const bool instanced = psos->psoinstanced >= 0;
+	if (!GetPipeline(&state->pipelines, psos->pso) ||
+		(instanced && !GetPipeline(&state->pipelines, psos->psoinstanced)))
+	{
+		return false;
+	}
+	return !state->depthprepass || (GetPipeline(&state->pipelines, psos->psodepth) &&
+		GetPipeline(&state->pipelines, psos->psoshade) && (!instanced ||
+		(GetPipeline(&state->pipelines, psos->psodepthinstanced) &&
+		GetPipeline(&state->pipelines, psos->psoshadeinstanced))));
+}
+
+/*  Add a frame's GPU time to the average, and once a window of them has been timed  *
+ *  drop the sample count a step if the average is over budget, or raise it a step   *
+ *  if it's well under. Returns whether the count changed.                           */
+static bool AdaptSampleCount(APPSTATE *state, float ms)
+{
+	MULTISAMPLE *msaa = &state->msaa;
+	if (msaa->settling > 0)
+	{
+		--msaa->settling;
+		return false;
+	}
+	msaa->windowms += ms;
+	if (++msaa->windowframes < MSAA_WINDOW_FRAMES)
+	{
+		return false;
+	}
+
+	msaa->gpums = msaa->windowms / (float)msaa->windowframes;
+	msaa->windowms = 0.0f;
+	msaa->windowframes = 0;
+	int count = msaa->count;
+	if (msaa->gpums > msaa->budgetms && count > SDL_GPU_SAMPLECOUNT_1)
+	{
+		--count;
+	}
+	else if (msaa->gpums < msaa->budgetms * MSAA_RAISE_FRACTION && count < (int)msaa->maxcount)
+	{
+		++count;
+	}
+	if (count == (int)msaa->count || !SampleCountReady(state, (SDL_GPUSampleCount)count))
+	{
+		return false;
+	}
+	msaa->count = (SDL_GPUSampleCount)count;
+	return true;
+}
+
+/*  Pass the GPU time of every frame timed since the last call on to the sample      *
+ *  count & the resolution scale. Changing either changes what frames cost, so both  *
+ *  then start over, leaving out the frames still in flight. Drawing thread only.    */
+static void AdaptToGPUTime(APPSTATE *state)
+{
+	MULTISAMPLE *msaa = &state->msaa;
+	RESOLUTIONSCALER *resolution = &state->resolution;
+	float ms;
+	while (PopGPUFrameTime(&state->gputimer, &ms))
+	{
+		const bool sampleschanged = msaa->budgetms > 0.0f && AdaptSampleCount(state, ms);
+		const bool scalechanged = resolution->budgetms > 0.0f && AddResolutionFrame(resolution, ms);
+		if (sampleschanged || scalechanged)
+		{
+			msaa->windowms = 0.0f;
+			msaa->windowframes = 0;
+			msaa->settling = state->gputimer.inflight;
+			ClearResolutionWindow(resolution, state->gputimer.inflight);
+		}
+	}
+}
+
+/*  Sum the counts copied the last time this upload frame's transfer buffer was      *
+ *  used, BeginUploadFrame has waited for that frame's fence, which CopyOverdraw     *
+ *  made sure it took. Returns the fragments shaded per pixel, -1 when nothing was   *
+ *  copied.                                                                          */
+static float ReadOverdraw(APPSTATE *state, int *benchframe)
+{
+	OVERDRAW *overdraw = &state->overdraw;
+	const unsigned frame = state->uploads.frame;
+	const Uint32 pixels = overdraw->counted[frame];
+	const Uint8 *counts = pixels > 0 ? SDL_MapGPUTransferBuffer(state->dev, overdraw->readbacks[frame], false) : NULL;
+	overdraw->counted[frame] = 0;
+	if (!counts)
+	{
+		return -1.0f;
+	}
+	Uint64 shaded = 0;
+	for (Uint32 i = 0; i < pixels; ++i)
+	{
+		shaded += counts[i];
+	}
+	SDL_UnmapGPUTransferBuffer(state->dev, overdraw->readbacks[frame]);
+	*benchframe = overdraw->countedframes[frame];
+	return (float)((double)shaded / (double)pixels);
+}
+
+/*  Copy the counts of the frame just drawn into this upload frame's transfer buffer *
+ *  for ReadOverdraw to sum, then show them in the target drawn into                 */
+static void CopyOverdraw(APPSTATE *state, SDL_GPUCommandBuffer *cmdbuf, SDL_GPUTexture *colortex,
+	Uint32 width, Uint32 height, int benchframe)
+{
+	OVERDRAW *overdraw = &state->overdraw;
+	const unsigned frame = state->uploads.frame;
+	const Uint32 size = width * height;
+	if (overdraw->readbacksizes[frame] < size)
+	{
+		SDL_ReleaseGPUTransferBuffer(state->dev, overdraw->readbacks[frame]);
+		overdraw->readbacks[frame] = SDL_CreateGPUTransferBuffer(state->dev, &(SDL_GPUTransferBufferCreateInfo)
+		{
+			.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD,
+			.size = size,
+			.props = 0
+		});
+		overdraw->readbacksizes[frame] = overdraw->readbacks[frame] ? size : 0;
+	}
+	if (overdraw->readbacks[frame])
+	{
+		SDL_GPUCopyPass *pass = SDL_BeginGPUCopyPass(cmdbuf);
+		SDL_DownloadFromGPUTexture(pass,
+			&(SDL_GPUTextureRegion){ .texture = overdraw->texture, .w = width, .h = height, .d = 1 },
+			&(SDL_GPUTextureTransferInfo)
+			{
+				.transfer_buffer = overdraw->readbacks[frame],
+				.offset = 0,
+				.pixels_per_row = width,
+				.rows_per_layer = height
+			});
+		SDL_EndGPUCopyPass(pass);
+		// Read once the ring is back on this frame, so the frame is fenced even when it uploads nothing
+		FenceUploadFrame(&state->uploads);
+		overdraw->counted[frame] = size;
+		overdraw->countedframes[frame] = benchframe;
+	}
+
+	// One shaded fragment is 1/255 red, so the picture is faint
+	SDL_BlitGPUTexture(cmdbuf, &(SDL_GPUBlitInfo)
+	{
+		.source = { .texture = overdraw->texture, .w = width, .h = height },
+		.destination = { .texture = colortex, .w = width, .h = height },
+		.load_op = SDL_GPU_LOADOP_DONT_CARE,
+		.filter = SDL_GPU_FILTER_NEAREST
+	});
+}
+
+/*  Sort the visible sector triangles back to front for blending, streaming their    *
+ *  indices when the order changed or the last changed order couldn't be uploaded.   *
+ *  The sorted indices keep the last order that was uploaded until then.             */
+static void SortTranslucent(APPSTATE *state, const mat4f viewproj)
+{
+	PROFILE_BEGIN("Sort translucent");
+	TRISORT *sort = &state->trisort;
+	SortTriangles(sort, state->vis.ranges, state->vis.numranges, viewproj);
+	if (sort->stats.changed || state->sortedstale)
+	{
+		const Uint32 numindices = 3 * sort->count;
+		void *indices = numindices == 0 ? NULL :
+			AllocUpload(&state->uploads, state->sortedindices, 0, sort->indexsize * numindices, 4, true);
+		if (indices)
+		{
+			WriteSortedIndices(sort, indices);
+		}
+		state->sortedstale = numindices > 0 && !indices;
+		if (!state->sortedstale)
+		{
+			state->numsortedindices = numindices;
+		}
+	}
+	PROFILE_END();
+}
+
+/*  Record & submit a frame, on the render thread when there is one                  *
+ *  colortex        - Swapchain texture or render target to draw into                *
+ *  drawwidth       - Size drawn at, below the target's it's drawn into the scaled   *
+ *  drawheight        texture & blitted up to the target                             *
+ *  drawn           - Receives the frame's timings for the main thread to present    */
+static void DrawScene(APPSTATE *state, const FRAME *frame, SDL_GPUCommandBuffer *cmdbuf,
+	SDL_GPUTexture *colortex, Uint32 targetw, Uint32 targeth, Uint32 drawwidth, Uint32 drawheight,
+	DRAWNFRAME *drawn)
+{
+	MULTISAMPLE *msaa = &state->msaa;
+	SDL_GPUTexture *drawtex = colortex;
+	if (drawwidth != targetw || drawheight != targeth)
+	{
+		if (SizeScaledTexture(state, drawwidth, drawheight))
+		{
+			drawtex = state->scaledtex;
+		}
+		else
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Drawing at full size: %s", SDL_GetError());
+			drawwidth = targetw;
+			drawheight = targeth;
+		}
+	}
+	const bool instanced = frame->instancing && state->psos[msaa->count].psoinstanced >= 0;
+	const Uint64 recordstart = SDL_GetPerformanceCounter();
+	BeginUploadFrame(&state->uploads);
+	int overdrawframe = -1;
+	const float overdraw = state->overdraw.enabled ? ReadOverdraw(state, &overdrawframe) : -1.0f;
+
+	const float xtrans = -frame->camera.xpos;
+	const float ztrans = -frame->camera.zpos;
+	const float ytrans = -frame->camera.walkbias - 0.25f;
+	const float sceneroty = 360.0f - frame->camera.yrot;
+
+	mat4f modelview = M4_IDENTITY;
+	Rotate(modelview, frame->camera.lookupdown, 1.0f, 0.0f, 0.0f);
+	Rotate(modelview, sceneroty, 0.0f, 1.0f, 0.0f);
+	Translate(modelview, xtrans, ytrans, ztrans);
+
+	mat4f viewproj;
+	MulMatrices(viewproj, frame->projmtx, modelview);
+	SDL_PushGPUVertexUniformData(cmdbuf, 0, &viewproj, sizeof(mat4f));
+	if (state->packedvertices)
+	{
+		SDL_PushGPUVertexUniformData(cmdbuf, 1, state->packboxes, sizeof(state->packboxes));
+	}
+
+	// Find the sectors visible through portals from the camera
+	const float eye[3] = { frame->camera.xpos, -ytrans, frame->camera.zpos };
+	PROFILE_BEGIN("Visibility");
+	ComputeVisibility(&state->vis, &state->world, viewproj, eye);
+	if (state->world.numinstances > 0)
+	{
+		GatherVisibleProps(state, instanced);
+	}
+	PROFILE_END();
+
+	// Ask for the material texture levels the nearest visible sector needs, then stream towards them
+	if (state->residency.numtextures > 0)
+	{
+		PROFILE_BEGIN("Texture streaming");
+		UseResidentTexture(&state->residency, 0, WantedTextureLevel(state, frame, eye, drawheight));
+		UpdateResidency(&state->residency, cmdbuf);
+		PROFILE_END();
+	}
+	const int numprops = state->numvisibleinstances == 0 ? 0 :
+		instanced ? state->world.numprops : state->numvisibleinstances;
+	SCENEDRAWS scene =
+	{
+		.state = state,
+		.viewproj = viewproj,
+		.eye = eye,
+		.instanced = instanced,
+		.numranges = frame->blend ? 0 : state->vis.numranges
+	};
+	if (!BuildDrawBatches(&state->draws, &state->jobs, scene.numranges + numprops, BuildSceneDraws, &scene))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Drawing an incomplete frame: %s", SDL_GetError());
+	}
+	const Uint64 sortstart = SDL_GetPerformanceCounter();
+	if (frame->blend)
+	{
+		SortTranslucent(state, viewproj);
+	}
+	const Uint64 sortticks = SDL_GetPerformanceCounter() - sortstart;
+	PROFILE_BEGIN("Flush uploads");
+	FlushUploads(&state->uploads, cmdbuf);
+	PROFILE_END();
+
+	if (!state->depthtex || state->depthtexw != drawwidth || state->depthtexh != drawheight ||
+		state->depthtexcount != msaa->count)
+	{
+		CreateDepthTexture(state, drawwidth, drawheight, msaa->count);
+	}
+	const bool countoverdraw = state->overdraw.enabled && SizeOverdrawTexture(state, drawwidth, drawheight);
+	const bool multisampled = msaa->count > SDL_GPU_SAMPLECOUNT_1;
+	if (multisampled)
+	{
+		SizeMultisampleTexture(state, drawwidth, drawheight);
+	}
+
+	// Multisampled color is resolved into the target at the end of the pass, its samples are never kept
+	SDL_GPUColorTargetInfo colorinfo;
+	SDL_zero(colorinfo);
+	colorinfo.texture = countoverdraw ? state->overdraw.texture : multisampled ? msaa->colortex : drawtex;
+	colorinfo.clear_color = (SDL_FColor){ 0.0f, 0.0f, 0.0f, 0.0f };  // Set the background clear color to black
+	colorinfo.load_op = SDL_GPU_LOADOP_CLEAR;
+	colorinfo.store_op = multisampled ? SDL_GPU_STOREOP_RESOLVE : SDL_GPU_STOREOP_STORE;
+	colorinfo.resolve_texture = multisampled ? drawtex : NULL;
+	colorinfo.cycle = multisampled;
+
+	SDL_GPUDepthStencilTargetInfo depthinfo;
+	SDL_zero(depthinfo);
+	depthinfo.texture = state->depthtex;
+	depthinfo.clear_depth = 1.0f;  // Ensure depth buffer clears to furthest value
+	depthinfo.load_op = SDL_GPU_LOADOP_CLEAR;
+	depthinfo.store_op = SDL_GPU_STOREOP_DONT_CARE;
+	depthinfo.stencil_load_op = SDL_GPU_LOADOP_DONT_CARE;
+	depthinfo.stencil_store_op = SDL_GPU_STOREOP_DONT_CARE;
+	depthinfo.cycle = true;
+
+	// Draw world & props, laying down depth from the position-only stream first when asked to so only the
+	// nearest surface of each pixel is shaded. When blending only the props are opaque, the world's triangles
+	// follow them back to front, hidden by the props in front of them without hiding anything themselves.
+	PROFILE_BEGIN("Record draws");
+	const bool prepass = state->depthprepass;
+	SDL_GPURenderPass* pass = SDL_BeginGPURenderPass(cmdbuf, &colorinfo, 1, &depthinfo);
+	SDL_BindGPUFragmentSamplers(pass, 0, &(SDL_GPUTextureSamplerBinding)
+	{
+		.texture = state->texture,
+		.sampler = state->samplers[frame->filter]
+	}, 1);
+	SDL_BindGPUIndexBuffer(pass, &(SDL_GPUBufferBinding)
+	{
+		.buffer = state->worldindices, .offset = 0
+	}, state->indexelemsize);
+	if (prepass)
+	{
+		SDL_BindGPUGraphicsPipeline(pass, WorldPipeline(state, WORLDPASS_DEPTH, false));
+		SDL_BindGPUVertexBuffers(pass, 0, &(SDL_GPUBufferBinding)
+		{
+			.buffer = state->worldpositions, .offset = 0
+		}, 1);
+		RecordDraws(state, WORLDPASS_DEPTH, cmdbuf, pass, viewproj);
+	}
+	const int worldpass = prepass ? WORLDPASS_SHADE : WORLDPASS_OPAQUE;
+	SDL_BindGPUGraphicsPipeline(pass, WorldPipeline(state, worldpass, false));
+	SDL_BindGPUVertexBuffers(pass, 0, &(SDL_GPUBufferBinding)
+	{
+		.buffer = state->worldmesh, .offset = 0
+	}, 1);
+	RecordDraws(state, worldpass, cmdbuf, pass, viewproj);
+	if (frame->blend && state->numsortedindices > 0)
+	{
+		SDL_BindGPUGraphicsPipeline(pass, WorldPipeline(state, WORLDPASS_BLEND, false));
+		SDL_SetGPUBlendConstants(pass, (SDL_FColor){ BLEND_OPACITY, BLEND_OPACITY, BLEND_OPACITY, BLEND_OPACITY });
+		SDL_BindGPUIndexBuffer(pass, &(SDL_GPUBufferBinding)
+		{
+			.buffer = state->sortedindices, .offset = 0
+		}, state->indexelemsize);
+		SDL_DrawGPUIndexedPrimitives(pass, state->numsortedindices, 1, 0, 0, 0);
+	}
+
+	SDL_EndGPURenderPass(pass);
+	if (countoverdraw)
+	{
+		CopyOverdraw(state, cmdbuf, drawtex, drawwidth, drawheight, frame->benchframe);
+	}
+	if (drawtex != colortex)
+	{
+		SDL_BlitGPUTexture(cmdbuf, &(SDL_GPUBlitInfo)
+		{
+			.source = { .texture = drawtex, .w = drawwidth, .h = drawheight },
+			.destination = { .texture = colortex, .w = targetw, .h = targeth },
+			.load_op = SDL_GPU_LOADOP_DONT_CARE,
+			.filter = SDL_GPU_FILTER_LINEAR
+		});
+	}
+	PROFILE_END();
+	PROFILE_BEGIN("Submit");
+	const Uint64 submitstart = SDL_GetPerformanceCounter();
+	if (!SubmitUploadFrame(&state->uploads, cmdbuf))
+	{
+		state->overdraw.counted[state->uploads.frame] = 0;  // Nothing will be downloaded, or fenced
+	}
+	const Uint64 recordend = SDL_GetPerformanceCounter();
+	TimeGPUFrame(&state->gputimer, submitstart);
+	PROFILE_END();
+
+	int propdraws = state->numvisibleinstances;
+	if (instanced)
+	{
+		propdraws = 0;
+		for (int i = 0; i < state->world.numprops; ++i)
+		{
+			propdraws += state->propvisible[i] > 0;
+		}
+	}
+	*drawn = (DRAWNFRAME)
+	{
+		.target = -1,
+		.width = drawwidth,
+		.height = drawheight,
+		.instancing = frame->instancing,
+		.instanced = instanced,
+		.propdraws = propdraws,
+		.numvisibleinstances = state->numvisibleinstances,
+		.textures = state->residency.stats,
+		.inputns = frame->inputns,
+		.benchframe = frame->benchframe,
+		.drawticks = recordend - recordstart,
+		.submitticks = recordend - submitstart,
+		.overdraw = overdraw,
+		.overdrawframe = overdrawframe,
+		.blend = frame->blend,
+		.translucent = state->trisort.stats,
+		.sortticks = sortticks,
+		.samples = msaa->count,
+		.gpums = msaa->gpums,
+		.scale = state->resolution.scale,
+		.percentilems = state->resolution.percentilems
+	};
+}
+
+static void ResetFrameTimer(FRAMETIMER *timer, bool instancing)
+{
+	*timer = (FRAMETIMER)
+	{
+		.start = SDL_GetPerformanceCounter(),
+		.drawticks = 0,
+		.sortticks = 0,
+		.latencyns = 0,
+		.frames = 0,
+		.instancing = instancing,
+		.lastpresent = timer->lastpresent
+	};
+}
+
+// Periodically log average frame times along with how props are being drawn, for comparing the two modes
+static void UpdateFrameTimer(APPSTATE *state, const DRAWNFRAME *drawn, Uint64 presentns)
+{
+	FRAMETIMER *timer = &state->frametimer;
+	if (drawn->instancing != timer->instancing)
+	{
+		// Frames already in flight were drawn the old way, time the new mode from here
+		ResetFrameTimer(timer, drawn->instancing);
+		return;
+	}
+	++timer->frames;
+	timer->drawticks += drawn->drawticks;
+	timer->sortticks += drawn->sortticks;
+	timer->latencyns += presentns - drawn->inputns;
+	const double elapsed = ElapsedMS(timer->start);
+	if (elapsed < FRAMETIMER_INTERVAL_MS)
+	{
+		return;
+	}
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%.3f ms per frame, %.3f ms from input to present, %s thread drawing",
+		elapsed / timer->frames, (double)timer->latencyns / SDL_NS_PER_MS / timer->frames,
+		state->render.thread ? "render" : "main");
+	const WORLD *world = &state->world;
+	if (world->numinstances > 0)
+	{
+		const double drawms = (double)timer->drawticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+			"Props %s: %d draws for %d of %d instances, %.3f ms per frame, %.3f ms recording draws",
+			drawn->instanced ? "instanced" : "per placement", drawn->propdraws, drawn->numvisibleinstances,
+			world->numinstances, elapsed / timer->frames, drawms / timer->frames);
+	}
+	const RESIDENCYSTATS *textures = &drawn->textures;
+	if (textures->budget > 0)
+	{
+		const double mib = 1.0 / (1 << 20);
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+			"Textures: %.2f of %.2f MiB resident, %d levels pending, %u streamed in, %u evicted, %u failed",
+			(double)textures->residentbytes * mib, (double)textures->budget * mib, textures->pending,
+			textures->streamed, textures->evicted, textures->failed);
+	}
+	if (drawn->overdraw >= 0.0f)
+	{
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Overdraw: %.2f fragments shaded per pixel%s",
+			drawn->overdraw, state->depthprepass ? " after the depth pre-pass" : "");
+	}
+	if (drawn->blend)
+	{
+		const TRISORTSTATS *sorted = &drawn->translucent;
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+			"Translucent: %u triangles in %u clusters ordered by their centers, %u sorted & %u waiting%s, "
+			"%.3f ms per frame sorting", sorted->triangles, sorted->clusters, sorted->resorted, sorted->pending,
+			sorted->turned ? " after turning" : "",
+			(double)timer->sortticks * 1000.0 / (double)SDL_GetPerformanceFrequency() / timer->frames);
+	}
+	const MULTISAMPLE *msaa = &state->msaa;
+	if (msaa->maxcount > SDL_GPU_SAMPLECOUNT_1 && drawn->gpums >= 0.0f)
+	{
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "MSAA: %dx of %dx, %.3f ms per frame on the GPU against %.3f ms",
+			1 << drawn->samples, 1 << msaa->maxcount, drawn->gpums, msaa->budgetms);
+	}
+	else if (msaa->maxcount > SDL_GPU_SAMPLECOUNT_1)
+	{
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "MSAA: %dx", 1 << drawn->samples);
+	}
+	const RESOLUTIONSCALER *resolution = &state->resolution;
+	if (resolution->budgetms > 0.0f)
+	{
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+			"Resolution: %ux%u, %.0f%% of the window, %d%% of frames under %.3f ms on the GPU against %.3f ms",
+			drawn->width, drawn->height, (double)drawn->scale * 100.0, RESOLUTION_PERCENTILE,
+			drawn->percentilems, resolution->budgetms);
+	}
+	ResetFrameTimer(timer, timer->instancing);
+}
+
+// Account for a frame once it has been handed to the swapchain, always on the main thread
+static void FramePresented(APPSTATE *state, const DRAWNFRAME *drawn)
+{
+	const Uint64 presentns = SDL_GetTicksNS();
+	if (!state->startup.logged)
+	{
+		EndPhase(state, PHASE_FIRST_FRAME);
+		LogStartup(state);
+		state->startup.logged = true;
+	}
+
+	FRAMETIMER *timer = &state->frametimer;
+	if (timer->lastpresent && drawn->benchframe > BENCH_WARMUP_FRAMES)
+	{
+		const double toms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+		AddBenchFrame(&state->bench.stats, (float)((double)(presentns - timer->lastpresent) / SDL_NS_PER_MS),
+			(float)((double)drawn->drawticks * toms), (float)((double)drawn->submitticks * toms),
+			(float)((double)(presentns - drawn->inputns) / SDL_NS_PER_MS));
+	}
+	if (drawn->overdraw >= 0.0f && drawn->overdrawframe > BENCH_WARMUP_FRAMES)
+	{
+		AddBenchOverdraw(&state->bench.stats, drawn->overdraw);
+	}
+	if (state->resolution.budgetms > 0.0f && drawn->benchframe > BENCH_WARMUP_FRAMES)
+	{
+		AddBenchScale(&state->bench.stats, drawn->scale);
+	}
+	timer->lastpresent = presentns;
+	UpdateFrameTimer(state, drawn, presentns);
+}
+
+// Draw straight into the swapchain on the main thread, waiting for a swapchain texture like the original lesson
+static bool DrawOnMainThread(APPSTATE *state, const FRAME *frame)
+{
+	SDL_GPUCommandBuffer *cmdbuf = SDL_AcquireGPUCommandBuffer(state->dev);
+	if (!cmdbuf)
+	{
+		return false;
+	}
+
+	SDL_GPUTexture *backbuftex = NULL;
+	Uint32 backbufw, backbufh;
+	PROFILE_BEGIN("Acquire swapchain");
+	const bool acquired = SDL_WaitAndAcquireGPUSwapchainTexture(cmdbuf, state->win,
+		&backbuftex, &backbufw, &backbufh) && backbuftex;
+	PROFILE_END();
+	if (!acquired)
+	{
+		SDL_CancelGPUCommandBuffer(cmdbuf);
+		return false;
+	}
+	DRAWNFRAME drawn;
+	PROFILE_BEGIN("Frame");
+	AdaptToGPUTime(state);
+	DrawScene(state, frame, cmdbuf, backbuftex, backbufw, backbufh,
+		ScaledExtent(&state->resolution, backbufw), ScaledExtent(&state->resolution, backbufh), &drawn);
+	PROFILE_END();
+	FramePresented(state, &drawn);
 	return true;
 }
 
-/*  Recalculate projection matrix         *
- *  width   - Width of the framebuffer    *
- *  height  - Height of the framebuffer   */
-static void ReSizeScene(APPSTATE *state, int width, int height)
+// (Re)create render target index at the window size, only called by the thread that currently owns the target
+static bool SizeRenderTarget(APPSTATE *state, int index, Uint32 width, Uint32 height)
 {
-	if (height == 0)                                    // Prevent division-by-zero by ensuring height is non-zero
+	RENDERTHREAD *render = &state->render;
+	if (render->targets[index] && render->targetw[index] == width && render->targeth[index] == height)
 	{
-		height = 1;
+		return true;
 	}
-
-	const float aspect = (float)width / (float)height;        // Calculate aspect ratio
-	MakePerspective(state->projmtx, 45.0f, aspect, 0.1f, 100.0f);  // Setup perspective matrix
+	SDL_ReleaseGPUTexture(state->dev, render->targets[index]);
+	render->targets[index] = SDL_CreateGPUTexture(state->dev, &(SDL_GPUTextureCreateInfo)
+	{
+		.type = SDL_GPU_TEXTURETYPE_2D,
+		.format = render->format,
+		.width = width,
+		.height = height,
+		.layer_count_or_depth = 1,
+		.num_levels = 1,
+		.sample_count = SDL_GPU_SAMPLECOUNT_1,
+		.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER  // Blits sample their source
+	});
+	if (!render->targets[index])
+	{
+		return false;
+	}
+	SDL_SetGPUTextureName(state->dev, render->targets[index], "Render Target");
+	render->targetw[index] = width;
+	render->targeth[index] = height;
+	return true;
 }
 
-static SDL_GPUGraphicsPipeline *MakePipeline(APPSTATE *state,
-	SDL_GPUShader *vtxshader, SDL_GPUShader *frgshader, bool blend)
+static int SDLCALL RenderThread(void *data)
 {
-	const SDL_GPUColorTargetBlendState blendstate =
-	{
-		.enable_blend = true,
-		.color_blend_op = SDL_GPU_BLENDOP_ADD,
-		.alpha_blend_op = SDL_GPU_BLENDOP_ADD,
-		.src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
-		.dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
-		.src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
-		.dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE
-	};
-	const SDL_GPUColorTargetBlendState noblend = { .enable_blend = false };
-
-	const SDL_GPUVertexAttribute vtxattribs[2] =
-	{
+	APPSTATE *state = data;
+	RENDERTHREAD *render = &state->render;
+	PROFILE_THREAD("Render");
+	int target = -1;  // Kept across frames when drawing fails
+	for (;;)
+	{
+		SDL_WaitSemaphore(render->wake);
+		FRAME frame;
+		if (!PopSPSC(&render->frames, &frame))
 		{
-			.location = 0,
-			.buffer_slot = 0,
-			.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-			.offset = offsetof(VERTEX, x)
-		},
+			continue;
+		}
+		if (frame.quit)
 		{
-			.location = 1,
-			.buffer_slot = 0,
-			.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-			.offset = offsetof(VERTEX, u)
+			return 0;
 		}
-	};
-
-	const bool hasdepthtest = blend ? false : true;
 
-	const SDL_GPUGraphicsPipelineCreateInfo info =
-	{
-		.vertex_shader = vtxshader,
-		.fragment_shader = frgshader,
-		.primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
-		.vertex_input_state =
+		// Never runs dry, see RENDER_TARGETS
+		while (target < 0 && !PopSPSC(&render->freetargets, &target))
 		{
-			.num_vertex_buffers = 1,
-			.vertex_buffer_descriptions = &(SDL_GPUVertexBufferDescription)
-			{
-				.slot = 0,
-				.pitch = sizeof(VERTEX),
-				.input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX
-			},
-			.num_vertex_attributes = SDL_arraysize(vtxattribs),
-			.vertex_attributes = vtxattribs
-		},
-		.rasterizer_state =
-		{
-			.fill_mode = SDL_GPU_FILLMODE_FILL,
-			.cull_mode = SDL_GPU_CULLMODE_NONE,
-			.front_face = SDL_GPU_FRONTFACE_COUNTER_CLOCKWISE  // Right-handed coordinates
-		},
-		.depth_stencil_state =
+			SDL_WaitSemaphore(render->released);
+		}
+		PROFILE_BEGIN("Frame");
+		// Scaled targets are drawn at the size they're at, presenting blits them up to the swapchain's
+		AdaptToGPUTime(state);
+		const Uint32 width = ScaledExtent(&state->resolution, frame.width);
+		const Uint32 height = ScaledExtent(&state->resolution, frame.height);
+		SDL_GPUCommandBuffer *cmdbuf = SDL_AcquireGPUCommandBuffer(state->dev);
+		if (cmdbuf && SizeRenderTarget(state, target, width, height))
 		{
-			.compare_op = SDL_GPU_COMPAREOP_LESS,  // Pass if pixel depth value tests less than the depth buffer value
-			.enable_depth_test = hasdepthtest,             // Enable depth testing
-			.enable_depth_write = hasdepthtest
-		},
-		.target_info =
+			DRAWNFRAME drawn;
+			DrawScene(state, &frame, cmdbuf, render->targets[target], width, height, width, height, &drawn);
+			drawn.target = target;
+			PushSPSC(&render->drawn, &drawn);  // Holds every target, so can't be full
+			target = -1;
+		}
+		else
 		{
-			.num_color_targets = 1,
-			.color_target_descriptions = &(SDL_GPUColorTargetDescription)
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to draw frame: %s", SDL_GetError());
+			if (cmdbuf)
 			{
-				.format = SDL_GetGPUSwapchainTextureFormat(state->dev, state->win),
-				.blend_state = blend ? blendstate : noblend  // Set the blending function for translucency
-			},
-			.depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D16_UNORM,
-			.has_depth_stencil_target = true
+				SDL_CancelGPUCommandBuffer(cmdbuf);
+			}
 		}
-	};
-	return SDL_CreateGPUGraphicsPipeline(state->dev, &info);
+		PROFILE_END();
+		SDL_SetAtomicInt(&render->busy, 0);
+		SDL_SignalSemaphore(render->done);
+	}
 }
 
-static bool InitGPU(APPSTATE *state)
+static void ReleaseRenderTarget(RENDERTHREAD *render, int target)
 {
-	if (!LoadTexture(state))                          // Load texture
+	PushSPSC(&render->freetargets, &target);
+	SDL_SignalSemaphore(render->released);
+}
+
+/*  Copy the newest frame the render thread has drawn to the swapchain, if there is  *
+ *  a swapchain texture free. Never waits for one so input is never held up by the   *
+ *  display. The next frame isn't handed to the render thread until this one is      *
+ *  blitted, so there's never more than one drawn frame waiting.                     */
+static bool PresentDrawnFrame(APPSTATE *state)
+{
+	RENDERTHREAD *render = &state->render;
+	DRAWNFRAME drawn;
+	while (PopSPSC(&render->drawn, &drawn))
+	{
+		if (render->holding)
+		{
+			ReleaseRenderTarget(render, render->newest.target);
+		}
+		render->newest = drawn;
+		render->holding = true;
+	}
+	if (!render->holding)
 	{
 		return false;
 	}
-	if (!CreateGPUSamplers(state))                    // Create texture samplers
+
+	SDL_GPUCommandBuffer *cmdbuf = SDL_AcquireGPUCommandBuffer(state->dev);
+	if (!cmdbuf)
 	{
 		return false;
 	}
-	SDL_GPUShader *vtxshader, *frgshader;
-	if (!LoadShaders(state, &vtxshader, &frgshader))  // Load shaders
+	SDL_GPUTexture *backbuftex = NULL;
+	Uint32 backbufw, backbufh;
+	PROFILE_BEGIN("Acquire swapchain");
+	const bool acquired = SDL_AcquireGPUSwapchainTexture(cmdbuf, state->win,
+		&backbuftex, &backbufw, &backbufh) && backbuftex;
+	PROFILE_END();
+	if (!acquired)
 	{
+		SDL_CancelGPUCommandBuffer(cmdbuf);
 		return false;
 	}
 
-	state->pso = MakePipeline(state, vtxshader, frgshader, false);
-	state->psoblend = MakePipeline(state, vtxshader, frgshader, true);
-	SDL_ReleaseGPUShader(state->dev, frgshader);
-	SDL_ReleaseGPUShader(state->dev, vtxshader);
-	if (!state->pso || !state->psoblend)
+	PROFILE_BEGIN("Present");
+	const DRAWNFRAME *newest = &render->newest;
+	SDL_BlitGPUTexture(cmdbuf, &(SDL_GPUBlitInfo)
 	{
-		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateGPUGraphicsPipeline(): %s", SDL_GetError());
-		return false;
+		.source = { .texture = render->targets[newest->target], .w = newest->width, .h = newest->height },
+		.destination = { .texture = backbuftex, .w = backbufw, .h = backbufh },
+		.load_op = SDL_GPU_LOADOP_DONT_CARE,
+		.filter = SDL_GPU_FILTER_LINEAR  // Scales drawing below full size, & while the window is being resized
+	});
+	const bool submitted = SDL_SubmitGPUCommandBuffer(cmdbuf);
+	PROFILE_END();
+	// Queue order keeps the blit ahead of anything the render thread draws into the target next
+	ReleaseRenderTarget(render, newest->target);
+	render->holding = false;
+	if (submitted)
+	{
+		FramePresented(state, newest);
 	}
+	return submitted;
+}
 
-	unsigned backbufw, backbufh;
-	SDL_GetWindowSizeInPixels(state->win, (int *)&backbufw, (int *)&backbufh);
-	if (!CreateDepthTexture(state, backbufw, backbufh))
+static void StopRenderThread(APPSTATE *state)
+{
+	RENDERTHREAD *render = &state->render;
+	if (render->thread)
+	{
+		// Frames already pushed are drawn first, so a benchmark's last frames are still timed
+		const FRAME quit = { .quit = true };
+		PushSPSC(&render->frames, &quit);
+		SDL_SignalSemaphore(render->wake);
+		SDL_WaitThread(render->thread, NULL);
+		render->thread = NULL;
+	}
+	for (int i = 0; i < RENDER_TARGETS; ++i)
 	{
-		return false;
+		if (render->targets[i])
+		{
+			SDL_ReleaseGPUTexture(state->dev, render->targets[i]);
+			render->targets[i] = NULL;
+		}
 	}
+	SDL_DestroySemaphore(render->released);
+	SDL_DestroySemaphore(render->done);
+	SDL_DestroySemaphore(render->wake);
+	render->released = render->done = render->wake = NULL;
+	FreeSPSCQueue(&render->freetargets);
+	FreeSPSCQueue(&render->drawn);
+	FreeSPSCQueue(&render->frames);
+	render->holding = false;
+}
 
-	SetupWorld(state);
-	if (!CreateWorldMesh(state))
+// Start drawing on a render thread, frames are drawn on the main thread instead if it can't be started
+static bool StartRenderThread(APPSTATE *state)
+{
+	RENDERTHREAD *render = &state->render;
+	render->format = SDL_GetGPUSwapchainTextureFormat(state->dev, state->win);
+	SDL_SetAtomicInt(&render->busy, 0);
+	// Room for a frame plus the quit request
+	if (!InitSPSCQueue(&render->frames, sizeof(FRAME), 2) ||
+		!InitSPSCQueue(&render->drawn, sizeof(DRAWNFRAME), RENDER_TARGETS) ||
+		!InitSPSCQueue(&render->freetargets, sizeof(int), RENDER_TARGETS) ||
+		!(render->wake = SDL_CreateSemaphore(0)) ||
+		!(render->done = SDL_CreateSemaphore(0)) ||
+		!(render->released = SDL_CreateSemaphore(0)))
+	{
+		StopRenderThread(state);
+		return false;
+	}
+	for (int i = 0; i < RENDER_TARGETS; ++i)
+	{
+		PushSPSC(&render->freetargets, &i);
+	}
+	if (!(render->thread = SDL_CreateThread(RenderThread, "Render", state)))
 	{
+		StopRenderThread(state);
 		return false;
 	}
-
 	return true;
 }
 
-static bool DrawScene(APPSTATE *state)
+// Read the camera path to replay and make room for timing every frame of it
+static bool LoadBench(APPSTATE *state)
 {
-	SDL_GPUCommandBuffer* cmdbuf = SDL_AcquireGPUCommandBuffer(state->dev);
-
-	SDL_GPUTexture* backbuftex = NULL;
-	Uint32 backbufw, backbufh;
-	if (!SDL_WaitAndAcquireGPUSwapchainTexture(cmdbuf, state->win, &backbuftex, &backbufw, &backbufh) || !backbuftex)
+	BENCHRUN *bench = &state->bench;
+	size_t size;
+	char *text = SDL_LoadFile(bench->pathfile, &size);
+	const bool parsed = text && ParseCameraPath(&bench->path, text, size);
+	SDL_free(text);
+	if (!parsed)
 	{
-		SDL_CancelGPUCommandBuffer(cmdbuf);
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load camera path \"%s\": %s",
+			bench->pathfile, SDL_GetError());
 		return false;
 	}
+	const int maxframes = (int)SDL_ceilf(CameraPathDuration(&bench->path) / BENCH_FRAME_STEP) + 2;
+	return InitBench(&bench->stats, maxframes);
+}
 
-	const float xtrans = -state->camera.xpos;
-	const float ztrans = -state->camera.zpos;
-	const float ytrans = -state->camera.walkbias - 0.25f;
-	const float sceneroty = 360.0f - state->camera.yrot;
-
-	mat4f modelview = M4_IDENTITY;
-	Rotate(modelview, state->camera.lookupdown, 1.0f, 0.0f, 0.0f);
-	Rotate(modelview, sceneroty, 0.0f, 1.0f, 0.0f);
-	Translate(modelview, xtrans, ytrans, ztrans);
-
-	mat4f viewproj;
-	MulMatrices(viewproj, state->projmtx, modelview);
-	SDL_PushGPUVertexUniformData(cmdbuf, 0, &viewproj, sizeof(mat4f));
-
-	if (!state->depthtex || state->depthtexw != backbufw || state->depthtexh != backbufh)
+/*  Move the camera along the path for the next frame, the path advances a fixed     *
+ *  step per frame so every run draws the same frames. Frames are timed as they are  *
+ *  presented. Returns false once the end of the path has been drawn.                */
+static bool StepBench(APPSTATE *state)
+{
+	BENCHRUN *bench = &state->bench;
+	const float time = (float)SDL_max(bench->frame - BENCH_WARMUP_FRAMES, 0) * BENCH_FRAME_STEP;
+	if (time > CameraPathDuration(&bench->path))
 	{
-		CreateDepthTexture(state, backbufw, backbufh);
+		return false;
 	}
+	CAMERAKEY key;
+	SampleCameraPath(&bench->path, time, &key);
+	state->camera.xpos = key.xpos;
+	state->camera.zpos = key.zpos;
+	state->camera.heading = state->camera.yrot = key.heading;
+	state->camera.lookupdown = key.lookupdown;
+	return true;
+}
 
-	SDL_GPUColorTargetInfo colorinfo;
-	SDL_zero(colorinfo);
-	colorinfo.texture = backbuftex;
-	colorinfo.clear_color = (SDL_FColor){ 0.0f, 0.0f, 0.0f, 0.0f };  // Set the background clear color to black
-	colorinfo.load_op = SDL_GPU_LOADOP_CLEAR;
-	colorinfo.store_op = SDL_GPU_STOREOP_STORE;
-
-	SDL_GPUDepthStencilTargetInfo depthinfo;
-	SDL_zero(depthinfo);
-	depthinfo.texture = state->depthtex;
-	depthinfo.clear_depth = 1.0f;  // Ensure depth buffer clears to furthest value
-	depthinfo.load_op = SDL_GPU_LOADOP_CLEAR;
-	depthinfo.store_op = SDL_GPU_STOREOP_DONT_CARE;
-	depthinfo.stencil_load_op = SDL_GPU_LOADOP_DONT_CARE;
-	depthinfo.stencil_store_op = SDL_GPU_STOREOP_DONT_CARE;
-	depthinfo.cycle = true;
-
-	// Draw world
-	SDL_GPURenderPass* pass = SDL_BeginGPURenderPass(cmdbuf, &colorinfo, 1, &depthinfo);
-	SDL_BindGPUGraphicsPipeline(pass, state->blend ? state->psoblend : state->pso);
-	SDL_BindGPUFragmentSamplers(pass, 0, &(SDL_GPUTextureSamplerBinding)
+// Write the benchmark report to the --bench-out file, or to stdout for scripts to capture
+static void WriteBench(APPSTATE *state)
+{
+	BENCHRUN *bench = &state->bench;
+	static const char *const presentmodes[] =
 	{
-		.texture = state->texture,
-		.sampler = state->samplers[state->filter]
-	}, 1);
-	const Uint32 numvertices = 3u * state->sector1.numtriangles;
-	SDL_BindGPUVertexBuffers(pass, 0, &(SDL_GPUBufferBinding)
+		[SDL_GPU_PRESENTMODE_VSYNC]     = "vsync",
+		[SDL_GPU_PRESENTMODE_IMMEDIATE] = "immediate",
+		[SDL_GPU_PRESENTMODE_MAILBOX]   = "mailbox"
+	};
+	int width = 0, height = 0;
+	SDL_GetWindowSizeInPixels(state->win, &width, &height);
+
+	SDL_IOStream *out = bench->outfile ? SDL_IOFromFile(bench->outfile, "w") : SDL_IOFromDynamicMem();
+	bool written = out && WriteBenchReport(out, &bench->stats, bench->pathfile, SDL_GetGPUDeviceDriver(state->dev),
+		presentmodes[bench->presentmode], !state->render.disabled, width, height);
+	if (written && !bench->outfile)
+	{
+		const char *report = SDL_GetPointerProperty(SDL_GetIOProperties(out),
+			SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+		const size_t size = (size_t)SDL_TellIO(out);
+		written = report && fwrite(report, 1, size, stdout) == size && fflush(stdout) == 0;
+	}
+	if (out && !SDL_CloseIO(out))
 	{
-		.buffer = state->worldmesh, .offset = 0
-	}, 1);
-	SDL_DrawGPUPrimitives(pass, numvertices, 1, 0, 0);
-
-	SDL_EndGPURenderPass(pass);
-	SDL_SubmitGPUCommandBuffer(cmdbuf);
-	return true;
+		written = false;
+	}
+	if (!written)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write benchmark report: %s", SDL_GetError());
+	}
 }
 
 static void KillGPUWindow(APPSTATE *state)
@@ -752,6 +3287,16 @@ static void KillGPUWindow(APPSTATE *state)
 	state->win = NULL;
 }
 
+// Benchmark runs may have nobody to close a message box, log the error instead
+static void ShowError(const APPSTATE *state, const char *message)
+{
+	if (state->bench.pathfile)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s %s", message, SDL_GetError());
+		return;
+	}
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "ERROR", message, NULL);
+}
 
 /*  This code creates our SDL window, parameters are:                       *
  *  title           - Title to appear at the top of the window              *
@@ -762,10 +3307,11 @@ static bool CreateGPUWindow(APPSTATE *state, char *title, int width, int height,
 {
 	state->fullscreen = fullscreenflag;
 
+	BeginPhase(state, PHASE_WINDOW);
 	if (!(state->win = SDL_CreateWindow(title, width, height,
 		SDL_WINDOW_HIDDEN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY)))
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "ERROR", "Window Creation Error.", NULL);
+		ShowError(state, "Window Creation Error.");
 		return false;
 	}
 
@@ -787,28 +3333,52 @@ static bool CreateGPUWindow(APPSTATE *state, char *title, int width, int height,
 		}
 	}
 
+	EndPhase(state, PHASE_WINDOW);
+
+	BeginPhase(state, PHASE_DEVICE);
 	const SDL_GPUShaderFormat supportedformats =
 		SDL_GPU_SHADERFORMAT_METALLIB | SDL_GPU_SHADERFORMAT_SPIRV |
 		SDL_GPU_SHADERFORMAT_DXIL | SDL_GPU_SHADERFORMAT_DXBC;
 	if (!(state->dev = SDL_CreateGPUDevice(supportedformats, true, NULL)))  // Create rendering device
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "ERROR", "Can't Create A GPU Rendering Context.", NULL);
+		ShowError(state, "Can't Create A GPU Rendering Context.");
 		return false;
 	}
 
 	if (!SDL_ClaimWindowForGPUDevice(state->dev, state->win))  // Attach GPU device to window
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "ERROR", "Can't Activate The GPU Rendering Context.", NULL);
+		ShowError(state, "Can't Activate The GPU Rendering Context.");
 		return false;
 	}
 
 	SDL_ShowWindow(state->win);
-	SDL_SetGPUSwapchainParameters(state->dev, state->win, SDL_GPU_SWAPCHAINCOMPOSITION_SDR, SDL_GPU_PRESENTMODE_VSYNC);  // Enable VSync
+	state->bench.presentmode = SDL_GPU_PRESENTMODE_VSYNC;  // Enable VSync
+	if (state->bench.pathfile)
+	{
+		// Don't let the display's refresh rate cap benchmark frame rates
+		const SDL_GPUPresentMode modes[] = { SDL_GPU_PRESENTMODE_IMMEDIATE, SDL_GPU_PRESENTMODE_MAILBOX };
+		for (int i = (int)SDL_arraysize(modes) - 1; i >= 0; --i)
+		{
+			if (SDL_WindowSupportsGPUPresentMode(state->dev, state->win, modes[i]))
+			{
+				state->bench.presentmode = modes[i];
+			}
+		}
+		if (state->bench.presentmode == SDL_GPU_PRESENTMODE_VSYNC)
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Benchmarking with VSync, immediate presentation unsupported");
+		}
+	}
+	SDL_SetGPUSwapchainParameters(state->dev, state->win, SDL_GPU_SWAPCHAINCOMPOSITION_SDR, state->bench.presentmode);
+	EndPhase(state, PHASE_DEVICE);
 	ReSizeScene(state, width, height);                   // Set up our viewport and perspective
 
-	if (!InitGPU(state))                                    // Initialize the scene
+	PROFILE_BEGIN("InitGPU");
+	const bool initialised = InitGPU(state);               // Initialize the scene
+	PROFILE_END();
+	if (!initialised)
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "ERROR", "Initialization Failed.", NULL);
+		ShowError(state, "Initialization Failed.");
 		return false;
 	}
 
@@ -834,6 +3404,15 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 			{
 			case SDLK_B:                                          // B = Toggle blending
 				state->blend = !state->blend;
+				if (state->blend)
+				{
+					SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+						"Translucent world, roughly back to front: clusters by their centers, then their triangles");
+				}
+				break;
+
+			case SDLK_I:                                          // I = Toggle instanced prop drawing
+				state->instancing = !state->instancing;
 				break;
 
 			case SDLK_F:                                          // F = Cycle texture filtering
@@ -870,87 +3449,174 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 	return SDL_APP_CONTINUE;
 }
 
-SDL_AppResult SDL_AppIterate(void *appstate)
+/*  Sample input, step the simulation or benchmark path and capture what the next    *
+ *  frame will draw. Returns false once a benchmark has finished.                    */
+static bool CaptureFrame(APPSTATE *state, FRAME *frame)
 {
-	APPSTATE *state = appstate;
-	if (!DrawScene(state))             // Draw the scene
-	{
-		return SDL_APP_CONTINUE;
-	}
-
-	// Handle keyboard input
-	const bool *keys = SDL_GetKeyboardState(NULL);
-
-	if (keys[SDL_SCANCODE_PAGEUP])
+	if (state->bench.pathfile)
 	{
-		state->camera.z -= 0.02f;
+		if (!StepBench(state))  // Follow the benchmark path until it ends
+		{
+			return false;
+		}
 	}
-
-	if (keys[SDL_SCANCODE_PAGEDOWN])
+	else
 	{
-		state->camera.z += 0.02f;
+		// Handle keyboard input, movement happens in fixed ticks so its speed doesn't depend on the frame rate
+		const bool *keys = SDL_GetKeyboardState(NULL);
+		const CAMERAINPUT input =
+		{
+			.forward = keys[SDL_SCANCODE_UP],
+			.back = keys[SDL_SCANCODE_DOWN],
+			.turnleft = keys[SDL_SCANCODE_LEFT],
+			.turnright = keys[SDL_SCANCODE_RIGHT],
+			.lookup = keys[SDL_SCANCODE_PAGEUP],
+			.lookdown = keys[SDL_SCANCODE_PAGEDOWN]
+		};
+		UpdateSimulation(&state->sim, SDL_GetTicksNS(), &input);
+		InterpolateCamera(&state->sim, &state->camera);
 	}
 
-	const float piover180 = 0.0174532925f;
+	int width = 0, height = 0;
+	SDL_GetWindowSizeInPixels(state->win, &width, &height);
+	*frame = (FRAME)
+	{
+		.camera = state->camera,
+		.blend = state->blend,
+		.instancing = state->instancing,
+		.filter = state->filter,
+		.width = (Uint32)width,
+		.height = (Uint32)height,
+		.inputns = SDL_GetTicksNS(),
+		.benchframe = state->bench.pathfile ? state->bench.frame : -1,
+		.quit = false
+	};
+	SDL_memcpy(frame->projmtx, state->projmtx, sizeof(mat4f));
+	return true;
+}
 
-	if (keys[SDL_SCANCODE_UP])
+SDL_AppResult SDL_AppIterate(void *appstate)
+{
+	APPSTATE *state = appstate;
+	RENDERTHREAD *render = &state->render;
+	// Read before presenting, a frame drawn by then was pushed before busy cleared & is picked up below
+	const bool busy = render->thread && SDL_GetAtomicInt(&render->busy);
+	const bool presented = render->thread && PresentDrawnFrame(state);
+	if (busy)
 	{
-		state->camera.xpos -= SDL_sinf(state->camera.heading * piover180) * 0.05f;
-		state->camera.zpos -= SDL_cosf(state->camera.heading * piover180) * 0.05f;
-		if (state->camera.walkbiasangle >= 359.0f)
+		if (!presented)
 		{
-			state->camera.walkbiasangle = 0.0f;
+			SDL_WaitSemaphoreTimeout(render->done, 1);  // Rather than spin until the render thread is done
 		}
-		else
-		{
-			state->camera.walkbiasangle += 10;
-		}
-		state->camera.walkbias = SDL_sinf(state->camera.walkbiasangle * piover180) / 20.0f;
+		return SDL_APP_CONTINUE;
 	}
-
-	if (keys[SDL_SCANCODE_DOWN])
+	if (render->holding)
 	{
-		state->camera.xpos += SDL_sinf(state->camera.heading * piover180) * 0.05f;
-		state->camera.zpos += SDL_cosf(state->camera.heading * piover180) * 0.05f;
-		if (state->camera.walkbiasangle <= 1.0f)
-		{
-			state->camera.walkbiasangle = 359.0f;
-		}
-		else
-		{
-			state->camera.walkbiasangle -= 10;
-		}
-		state->camera.walkbias = SDL_sinf(state->camera.walkbiasangle * piover180) / 20.0f;
+		// The render thread stays at most a frame ahead of the display, so under VSYNC it doesn't draw
+		// frames that would be dropped before a swapchain texture is free for them
+		SDL_DelayNS(SDL_NS_PER_MS);
+		return SDL_APP_CONTINUE;
 	}
 
-	if (keys[SDL_SCANCODE_RIGHT])
+	FRAME frame;
+	if (!CaptureFrame(state, &frame))
+	{
+		return SDL_APP_SUCCESS;
+	}
+	if (frame.width == 0 || frame.height == 0)  // Minimized
 	{
-		state->camera.heading -= 1.0f;
-		state->camera.yrot = state->camera.heading;
+		SDL_DelayNS(SDL_NS_PER_MS);
+		return SDL_APP_CONTINUE;
 	}
-
-	if (keys[SDL_SCANCODE_LEFT])
+	if (state->startup.phases[PHASE_FIRST_FRAME].begin == 0)
 	{
-		state->camera.heading += 1.0f;
-		state->camera.yrot = state->camera.heading;
+		BeginPhase(state, PHASE_FIRST_FRAME);
 	}
-
-	if (keys[SDL_SCANCODE_PAGEUP])
+	if (render->thread)
 	{
-		state->camera.lookupdown -= 1.0f;
+		SDL_SetAtomicInt(&render->busy, 1);
+		PushSPSC(&render->frames, &frame);
+		SDL_SignalSemaphore(render->wake);
 	}
-
-	if (keys[SDL_SCANCODE_PAGEDOWN])
+	else if (!DrawOnMainThread(state, &frame))  // Draw the scene
 	{
-		state->camera.lookupdown += 1.0f;
+		return SDL_APP_CONTINUE;
+	}
+	if (state->bench.pathfile)
+	{
+		++state->bench.frame;
 	}
-
 	return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
-	(void)argc; (void)argv;  // Unused parameters
+	// --bench <path-file> replays a camera path without any prompts, then reports frame timings as JSON
+	const char *benchpath = NULL, *benchout = NULL;
+	bool norenderthread = false;  // Draw on the main thread as the original lesson does
+	int texturebudget = TEXTURE_BUDGET_MB;
+	bool cpumips = false;         // Let the GPU generate decoded textures' mip levels
+	bool packvertices = false;    // Draw the world mesh's float vertices
+	bool depthprepass = false;    // Shade as the world is drawn, without laying down depth first
+	bool countoverdraw = false;   // Shade the scene rather than counting its fragments
+	int msaasamples = 1;          // Draw without multisampling
+	float msaabudget = 0.0f;      // Keep the sample count fixed
+	float resolutionbudget = 0.0f;  // Always draw at the window's size
+	for (int i = 1; i < argc; ++i)
+	{
+		if (SDL_strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+		{
+			benchpath = argv[++i];
+		}
+		else if (SDL_strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc)
+		{
+			benchout = argv[++i];
+		}
+		else if (SDL_strcmp(argv[i], "--no-render-thread") == 0)
+		{
+			norenderthread = true;
+		}
+		else if (SDL_strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc && SDL_atoi(argv[i + 1]) > 0)
+		{
+			texturebudget = SDL_atoi(argv[++i]);
+		}
+		else if (SDL_strcmp(argv[i], "--cpu-mips") == 0)
+		{
+			cpumips = true;
+		}
+		else if (SDL_strcmp(argv[i], "--packed-vertices") == 0)
+		{
+			packvertices = true;
+		}
+		else if (SDL_strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			depthprepass = true;
+		}
+		else if (SDL_strcmp(argv[i], "--bench-overdraw") == 0)
+		{
+			countoverdraw = true;
+		}
+		else if (SDL_strcmp(argv[i], "--msaa") == 0 && i + 1 < argc && SDL_atoi(argv[i + 1]) > 0)
+		{
+			msaasamples = SDL_atoi(argv[++i]);
+		}
+		else if (SDL_strcmp(argv[i], "--msaa-budget") == 0 && i + 1 < argc && SDL_atof(argv[i + 1]) > 0.0)
+		{
+			msaabudget = (float)SDL_atof(argv[++i]);
+		}
+		else if (SDL_strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc && SDL_atof(argv[i + 1]) > 0.0)
+		{
+			resolutionbudget = (float)SDL_atof(argv[++i]);
+		}
+		else
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Ignoring argument \"%s\", usage: %s "
+				"[--bench <path-file> [--bench-out <json-file>]] [--no-render-thread] [--texture-budget <MiB>] "
+				"[--cpu-mips] [--packed-vertices] [--depth-prepass] [--bench-overdraw] [--msaa <1|2|4|8>] "
+				"[--msaa-budget <ms>] [--dynamic-resolution <ms>]",
+				argv[i], argv[0]);
+		}
+	}
 
 	if (!SDL_Init(SDL_INIT_VIDEO))
 	{
@@ -966,12 +3632,14 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 	{
 		.win = NULL,
 		.dev = NULL,
-		.pso = NULL,
+		.pipelines = { .numpipelines = 0 },
 
 		.resdir = SDL_GetBasePath(),
 
 		.fullscreen = false,
 		.blend = false,  // Blending off
+		.instancing = true,
+		.depthprepass = depthprepass,
 
 		.projmtx = M4_IDENTITY,
 		.camera = (CAMERA)
@@ -989,46 +3657,152 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 		.filter = 0,
 		.depthtexw = 0,
 		.depthtexh = 0,
+		.depthtexcount = SDL_GPU_SAMPLECOUNT_1,
 		.depthtex = NULL,
+		.msaa = { .samples = msaasamples, .budgetms = msaabudget, .gpums = -1.0f },
+		.scaledtex = NULL,
+		.scaledtexw = 0,
+		.scaledtexh = 0,
 		.texture = NULL,
+		.texturearray = false,
+		.textureheader = { 0 },
+		.texturelayers = 0,
+		.texcoorddensity = 0.0f,
+		.packedvertices = false,
+		.packboxes = { { { 0.0f } } },
+		.texturebudget = (Uint64)texturebudget << 20,
+		.cpumips = cpumips,
+		.residency = { .numtextures = 0 },
 		.samplers = { NULL, NULL, NULL },
 		.worldmesh = NULL,
-		.sector1 = (SECTOR){ .numtriangles = 0, .triangle = NULL }
+		.worldindices = NULL,
+		.worldpositions = NULL,
+		.sortedindices = NULL,
+		.numsortedindices = 0,
+		.sortedstale = false,
+		.indexelemsize = SDL_GPU_INDEXELEMENTSIZE_16BIT,
+		.propinstances = NULL,
+		.instancematrices = NULL,
+		.instancesectors = NULL,
+		.visibleinstances = NULL,
+		.propvisible = NULL,
+		.propfirstvisible = NULL,
+		.numvisibleinstances = 0,
+		.uploads = { 0 },
+		.world = { 0 },
+		.vis = { 0 },
+		.trisort = { 0 },
+		.frametimer = { 0 },
+		.startup = { .launch = SDL_GetPerformanceCounter(), .packvertices = packvertices },
+		.bench = { .pathfile = benchpath, .outfile = benchout, .presentmode = SDL_GPU_PRESENTMODE_VSYNC },
+		.render = { .disabled = norenderthread },
+		.overdraw = { .enabled = countoverdraw }
 	};
+	for (int count = 0; count < MSAA_COUNTS; ++count)
+	{
+		state->psos[count] = (WORLDPIPELINES)
+		{
+			.pso = -1,
+			.psoblend = -1,
+			.psoinstanced = -1,
+			.psodepth = -1,
+			.psodepthinstanced = -1,
+			.psoshade = -1,
+			.psoshadeinstanced = -1
+		};
+	}
+	InitResolutionScaler(&state->resolution, resolutionbudget);
+	InitSimulation(&state->sim, &state->camera);
+	if (state->bench.pathfile && !LoadBench(state))
+	{
+		return SDL_APP_FAILURE;
+	}
+
+	// Start loading assets in the background while the window & device are created
+	PROFILE_THREAD("Main");
+	if (!InitJobQueue(&state->jobs, 0))
+	{
+		return SDL_APP_FAILURE;
+	}
+	StartLoading(state);
 
-	// Ask the user if they would like to start in fullscreen or windowed mode
-	const int bttnid = ShowYesNoMessageBox(state->win, BTTN_NO, "Start FullScreen?",
-		"Would You Like To Run In Fullscreen Mode?");
+	// Ask the user if they would like to start in fullscreen or windowed mode, benchmarks always run windowed
+	bool wantfullscreen = false;
+	if (!state->bench.pathfile)
+	{
+		BeginPhase(state, PHASE_PROMPT);
+		const int bttnid = ShowYesNoMessageBox(state->win, BTTN_NO, "Start FullScreen?",
+			"Would You Like To Run In Fullscreen Mode?");
+		EndPhase(state, PHASE_PROMPT);
+		wantfullscreen = (bttnid == BTTN_YES);
+	}
 
 	// Create our SDL window
-	const bool wantfullscreen = (bttnid == BTTN_YES);
 	if (!CreateGPUWindow(state, "Lionel Brits & NeHe's 3D World Tutorial", 640, 480, wantfullscreen))
 	{
 		return SDL_APP_FAILURE;
 	}
 
+	ResetFrameTimer(&state->frametimer, state->instancing);
+
+	// Input & simulation stay on this thread, drawing moves to its own
+	if (!state->render.disabled && !StartRenderThread(state))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Drawing on the main thread, no render thread: %s", SDL_GetError());
+		state->render.disabled = true;
+	}
 	return SDL_APP_CONTINUE;
 }
 
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
-	(void)result;  // Unused parameters
-
 	if (appstate)
 	{
 		APPSTATE *state = appstate;
-		SDL_free(state->sector1.triangle);
+		StopRenderThread(state);  // Draws any frame still pushed, before the benchmark report
+		StopGPUTimer(&state->gputimer);
+		if (state->bench.pathfile && state->dev && result == SDL_APP_SUCCESS)
+		{
+			WriteBench(state);
+		}
+		FreeBench(&state->bench.stats);
+		FreeCameraPath(&state->bench.path);
+		FinishLoading(state);
+		FreeResidency(&state->residency);  // Waits for levels still being read
+		LogPipelines(state, "Exit");
+		FreePipelineCache(&state->pipelines);  // Waits for pipelines still being warmed
+		FreeJobQueue(&state->jobs);
+		PROFILE_WRITE(PROFILE_TRACE_FILE);  // Every worker has been joined
+		FreeDrawBuilder(&state->draws);
+		FreeVisibility(&state->vis);
+		FreeTriangleSort(&state->trisort);
+		FreeWorld(&state->world);
+		SDL_free(state->propfirstvisible);
+		SDL_free(state->propvisible);
+		SDL_free(state->visibleinstances);
+		SDL_free(state->instancesectors);
+		SDL_free(state->instancematrices);
 		if (state->dev)
 		{
+			FreeUploadRing(&state->uploads);
+			SDL_ReleaseGPUBuffer(state->dev, state->propinstances);
+			SDL_ReleaseGPUBuffer(state->dev, state->sortedindices);
+			SDL_ReleaseGPUBuffer(state->dev, state->worldpositions);
+			SDL_ReleaseGPUBuffer(state->dev, state->worldindices);
 			SDL_ReleaseGPUBuffer(state->dev, state->worldmesh);
+			for (int i = 0; i < UPLOAD_FRAMES; ++i)
+			{
+				SDL_ReleaseGPUTransferBuffer(state->dev, state->overdraw.readbacks[i]);
+			}
+			SDL_ReleaseGPUTexture(state->dev, state->overdraw.texture);
 			SDL_ReleaseGPUTexture(state->dev, state->depthtex);
+			SDL_ReleaseGPUTexture(state->dev, state->msaa.colortex);
+			SDL_ReleaseGPUTexture(state->dev, state->scaledtex);
 			for (int i = SDL_arraysize(state->samplers); --i > 0;)
 			{
 				SDL_ReleaseGPUSampler(state->dev, state->samplers[i]);
 			}
 			SDL_ReleaseGPUTexture(state->dev, state->texture);
-			SDL_ReleaseGPUGraphicsPipeline(state->dev, state->psoblend);
-			SDL_ReleaseGPUGraphicsPipeline(state->dev, state->pso);
 		}
 		KillGPUWindow(state);
 		SDL_free(state);
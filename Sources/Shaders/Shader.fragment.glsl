@@ -1,12 +1,35 @@
 #version 450
 
+#if defined(DEPTH_ONLY)
+// The depth pre-pass writes depth alone, color writes are masked off
+void main()
+{
+}
+#elif defined(OVERDRAW)
+layout(location = 0) out vec4 o_color;
+
+// --bench-overdraw adds each shaded fragment into an R8 count
+void main()
+{
+	o_color = vec4(1.0 / 255.0, 0.0, 0.0, 0.0);
+}
+#else
+#ifdef TEXTURE_ARRAY
+layout(location = 0) in vec3 v_texcoord;  // u, v & material layer
+#else
 layout(location = 0) in vec2 v_texcoord;
+#endif
 
 layout(location = 0) out vec4 o_color;
 
+#ifdef TEXTURE_ARRAY
+layout(set = 2, binding = 0) uniform sampler2DArray u_texture;
+#else
 layout(set = 2, binding = 0) uniform sampler2D u_texture;
+#endif
 
 void main()
 {
 	o_color = texture(u_texture, v_texcoord);
 }
+#endif
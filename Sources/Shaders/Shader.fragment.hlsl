@@ -1,13 +1,34 @@
+#if defined(DEPTH_ONLY)
+// The depth pre-pass writes depth alone, color writes are masked off
+void FragmentMain()
+{
+}
+#elif defined(OVERDRAW)
+// --bench-overdraw adds each shaded fragment into an R8 count
+float4 FragmentMain() : SV_Target0
+{
+	return float4(1.0 / 255.0, 0.0, 0.0, 0.0);
+}
+#else
+#ifdef TEXTURE_ARRAY
+Texture2DArray<half4> Texture : register(t0, space2);
+#else
 Texture2D<half4> Texture : register(t0, space2);
+#endif
 SamplerState Sampler : register(s0, space2);
 
 struct FragmentInput
 {
 	float4 position : SV_Position;
+#ifdef TEXTURE_ARRAY
+	float3 texcoord : TEXCOORD0;  // u, v & material layer
+#else
 	float2 texcoord : TEXCOORD0;
+#endif
 };
 
 half4 FragmentMain(FragmentInput input) : SV_Target0
 {
 	return Texture.Sample(Sampler, input.texcoord);
 }
+#endif
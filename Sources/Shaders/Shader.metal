@@ -7,11 +7,101 @@ struct VertexInput
 	float2 texcoord [[attribute(1)]];
 };
 
+struct InstancedVertexInput
+{
+	float3 position [[attribute(0)]];
+	float2 texcoord [[attribute(1)]];
+	float4 model0 [[attribute(2)]];  // Per-instance model matrix columns
+	float4 model1 [[attribute(3)]];
+	float4 model2 [[attribute(4)]];
+	float4 model3 [[attribute(5)]];
+};
+
+// Texture array variants, the texture coordinate carries the material layer as a third component
+struct VertexArrayInput
+{
+	float3 position [[attribute(0)]];
+	float3 texcoord [[attribute(1)]];
+};
+
+struct InstancedVertexArrayInput
+{
+	float3 position [[attribute(0)]];
+	float3 texcoord [[attribute(1)]];
+	float4 model0 [[attribute(2)]];
+	float4 model1 [[attribute(3)]];
+	float4 model2 [[attribute(4)]];
+	float4 model3 [[attribute(5)]];
+};
+
+// Packed variants, the position is a SHORT4_NORM within its box with the box & material layer in w
+struct PackedVertexInput
+{
+	float4 position [[attribute(0)]];
+	float2 texcoord [[attribute(1)]];
+};
+
+struct InstancedPackedVertexInput
+{
+	float4 position [[attribute(0)]];
+	float2 texcoord [[attribute(1)]];
+	float4 model0 [[attribute(2)]];
+	float4 model1 [[attribute(3)]];
+	float4 model2 [[attribute(4)]];
+	float4 model3 [[attribute(5)]];
+};
+
+// Depth-only variants read the position-only stream, float or the packed SHORT4_NORM with the box in w
+struct DepthVertexInput
+{
+	float3 position [[attribute(0)]];
+};
+
+struct InstancedDepthVertexInput
+{
+	float3 position [[attribute(0)]];
+	float4 model0 [[attribute(2)]];
+	float4 model1 [[attribute(3)]];
+	float4 model2 [[attribute(4)]];
+	float4 model3 [[attribute(5)]];
+};
+
+struct PackedDepthVertexInput
+{
+	float4 position [[attribute(0)]];
+};
+
+struct InstancedPackedDepthVertexInput
+{
+	float4 position [[attribute(0)]];
+	float4 model0 [[attribute(2)]];
+	float4 model1 [[attribute(3)]];
+	float4 model2 [[attribute(4)]];
+	float4 model3 [[attribute(5)]];
+};
+
 struct VertexUniform
 {
 	metal::float4x4 viewproj;
 };
 
+struct PackUniform
+{
+	float4 boxes[64];  // Center xyz & scale of each box, MESH_PACK_BOXES
+};
+
+// Box << 8 | material layer
+static int PackedTag(float4 position)
+{
+	return int(metal::rint(position.w * 32767.0f));
+}
+
+static float4 UnpackPosition(float4 position, constant PackUniform& p)
+{
+	const float4 box = p.boxes[PackedTag(position) >> 8];
+	return float4(box.xyz + position.xyz * box.w, 1.0);
+}
+
 struct Vertex2Fragment
 {
 	float4 position [[position]];
@@ -28,6 +118,137 @@ vertex Vertex2Fragment VertexMain(
 	return out;
 }
 
+vertex Vertex2Fragment VertexInstancedMain(
+	InstancedVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]])
+{
+	const metal::float4x4 model(in.model0, in.model1, in.model2, in.model3);
+	Vertex2Fragment out;
+	out.position = u.viewproj * (model * float4(in.position, 1.0));
+	out.texcoord = in.texcoord;
+	return out;
+}
+
+struct Vertex2FragmentArray
+{
+	float4 position [[position]];
+	float3 texcoord;
+};
+
+vertex Vertex2FragmentArray VertexArrayMain(
+	VertexArrayInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]])
+{
+	Vertex2FragmentArray out;
+	out.position = u.viewproj * float4(in.position, 1.0);
+	out.texcoord = in.texcoord;
+	return out;
+}
+
+vertex Vertex2FragmentArray VertexArrayInstancedMain(
+	InstancedVertexArrayInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]])
+{
+	const metal::float4x4 model(in.model0, in.model1, in.model2, in.model3);
+	Vertex2FragmentArray out;
+	out.position = u.viewproj * (model * float4(in.position, 1.0));
+	out.texcoord = in.texcoord;
+	return out;
+}
+
+vertex Vertex2Fragment VertexPackedMain(
+	PackedVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]],
+	constant PackUniform& p [[buffer(1)]])
+{
+	Vertex2Fragment out;
+	out.position = u.viewproj * UnpackPosition(in.position, p);
+	out.texcoord = in.texcoord;
+	return out;
+}
+
+vertex Vertex2Fragment VertexPackedInstancedMain(
+	InstancedPackedVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]],
+	constant PackUniform& p [[buffer(1)]])
+{
+	const metal::float4x4 model(in.model0, in.model1, in.model2, in.model3);
+	Vertex2Fragment out;
+	out.position = u.viewproj * (model * UnpackPosition(in.position, p));
+	out.texcoord = in.texcoord;
+	return out;
+}
+
+vertex Vertex2FragmentArray VertexArrayPackedMain(
+	PackedVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]],
+	constant PackUniform& p [[buffer(1)]])
+{
+	Vertex2FragmentArray out;
+	out.position = u.viewproj * UnpackPosition(in.position, p);
+	out.texcoord = float3(in.texcoord, float(PackedTag(in.position) & 255));
+	return out;
+}
+
+vertex Vertex2FragmentArray VertexArrayPackedInstancedMain(
+	InstancedPackedVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]],
+	constant PackUniform& p [[buffer(1)]])
+{
+	const metal::float4x4 model(in.model0, in.model1, in.model2, in.model3);
+	Vertex2FragmentArray out;
+	out.position = u.viewproj * (model * UnpackPosition(in.position, p));
+	out.texcoord = float3(in.texcoord, float(PackedTag(in.position) & 255));
+	return out;
+}
+
+// The depth pre-pass computes positions with the same expressions as the shading entry points, but
+// MSL 1.1 has no invariant qualifier to make sure of it. Lesson10 keeps the pre-pass off on Metal.
+struct DepthVertex2Fragment
+{
+	float4 position [[position]];
+};
+
+vertex DepthVertex2Fragment VertexDepthMain(
+	DepthVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]])
+{
+	DepthVertex2Fragment out;
+	out.position = u.viewproj * float4(in.position, 1.0);
+	return out;
+}
+
+vertex DepthVertex2Fragment VertexDepthInstancedMain(
+	InstancedDepthVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]])
+{
+	const metal::float4x4 model(in.model0, in.model1, in.model2, in.model3);
+	DepthVertex2Fragment out;
+	out.position = u.viewproj * (model * float4(in.position, 1.0));
+	return out;
+}
+
+vertex DepthVertex2Fragment VertexDepthPackedMain(
+	PackedDepthVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]],
+	constant PackUniform& p [[buffer(1)]])
+{
+	DepthVertex2Fragment out;
+	out.position = u.viewproj * UnpackPosition(in.position, p);
+	return out;
+}
+
+vertex DepthVertex2Fragment VertexDepthPackedInstancedMain(
+	InstancedPackedDepthVertexInput in [[stage_in]],
+	constant VertexUniform& u [[buffer(0)]],
+	constant PackUniform& p [[buffer(1)]])
+{
+	const metal::float4x4 model(in.model0, in.model1, in.model2, in.model3);
+	DepthVertex2Fragment out;
+	out.position = u.viewproj * (model * UnpackPosition(in.position, p));
+	return out;
+}
+
 fragment half4 FragmentMain(
 	Vertex2Fragment in [[stage_in]],
 	metal::texture2d<half, metal::access::sample> texture [[texture(0)]],
@@ -35,3 +256,25 @@ fragment half4 FragmentMain(
 {
 	return texture.sample(sampler, in.texcoord);
 }
+
+fragment half4 FragmentArrayMain(
+	Vertex2FragmentArray in [[stage_in]],
+	metal::texture2d_array<half, metal::access::sample> texture [[texture(0)]],
+	metal::sampler sampler [[sampler(0)]])
+{
+	// Clamp the layer as Vulkan & Direct3D do, Metal leaves out of range layers undefined
+	const float last = float(texture.get_array_size() - 1);
+	const uint layer = uint(metal::clamp(metal::rint(in.texcoord.z), 0.0f, last));
+	return texture.sample(sampler, in.texcoord.xy, layer);
+}
+
+// The depth pre-pass writes depth alone, color writes are masked off
+fragment void FragmentDepthMain()
+{
+}
+
+// --bench-overdraw adds each shaded fragment into an R8 count
+fragment half4 FragmentOverdrawMain(float4 position [[position]])
+{
+	return half4(1.0h / 255.0h, 0.0h, 0.0h, 0.0h);
+}
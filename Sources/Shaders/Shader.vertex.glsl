@@ -1,17 +1,68 @@
 #version 450
 
+#ifdef PACKED
+layout(location = 0) in vec4 i_position;  // Steps from the box center & box << 8 | material layer, all SNORM
+#ifndef DEPTH_ONLY
+layout(location = 1) in vec2 i_texcoord;
+#endif
+#else
 layout(location = 0) in vec3 i_position;
+#ifdef DEPTH_ONLY
+// The depth pre-pass reads the position-only stream
+#elif defined(TEXTURE_ARRAY)
+layout(location = 1) in vec3 i_texcoord;  // u, v & material layer
+#else
 layout(location = 1) in vec2 i_texcoord;
+#endif
+#endif
+#ifdef INSTANCED
+layout(location = 2) in mat4 i_model;  // Per-instance model matrix, one column per location 2-5
+#endif
 
+#ifndef DEPTH_ONLY
+#ifdef TEXTURE_ARRAY
+layout(location = 0) out vec3 v_texcoord;
+#else
 layout(location = 0) out vec2 v_texcoord;
+#endif
+#endif
+
+invariant gl_Position;  // Bit for bit the same in the depth pre-pass & the shading after it
 
 layout(set = 1, binding = 0) uniform UBO
 {
     mat4 u_viewproj;
 };
 
+#ifdef PACKED
+layout(set = 1, binding = 1) uniform PackUBO
+{
+    vec4 u_boxes[64];  // Center xyz & scale of each box, MESH_PACK_BOXES
+};
+#endif
+
 void main()
 {
+#ifdef PACKED
+	int tag = int(round(i_position.w * 32767.0));
+	vec4 box = u_boxes[tag >> 8];
+	vec3 position = box.xyz + i_position.xyz * box.w;
+#ifndef DEPTH_ONLY
+#ifdef TEXTURE_ARRAY
+	v_texcoord  = vec3(i_texcoord, float(tag & 255));
+#else
+	v_texcoord  = i_texcoord;
+#endif
+#endif
+#else
+	vec3 position = i_position;
+#ifndef DEPTH_ONLY
 	v_texcoord  = i_texcoord;
-	gl_Position = u_viewproj * vec4(i_position, 1.0);
+#endif
+#endif
+#ifdef INSTANCED
+	gl_Position = u_viewproj * (i_model * vec4(position, 1.0));
+#else
+	gl_Position = u_viewproj * vec4(position, 1.0);
+#endif
 }
@@ -1,7 +1,26 @@
 struct VertexInput
 {
+#ifdef PACKED
+	float4 position : TEXCOORD0;  // Steps from the box center & box << 8 | material layer, all SNORM
+#ifndef DEPTH_ONLY
+	float2 texcoord : TEXCOORD1;
+#endif
+#else
 	float3 position : TEXCOORD0;
+#ifdef DEPTH_ONLY
+	// The depth pre-pass reads the position-only stream
+#elif defined(TEXTURE_ARRAY)
+	float3 texcoord : TEXCOORD1;  // u, v & material layer
+#else
 	float2 texcoord : TEXCOORD1;
+#endif
+#endif
+#ifdef INSTANCED
+	float4 model0 : TEXCOORD2;  // Per-instance model matrix columns
+	float4 model1 : TEXCOORD3;
+	float4 model2 : TEXCOORD4;
+	float4 model3 : TEXCOORD5;
+#endif
 };
 
 cbuffer VertexUniform : register(b0, space1)
@@ -9,16 +28,52 @@ cbuffer VertexUniform : register(b0, space1)
 	float4x4 viewproj : packoffset(c0);
 };
 
+#ifdef PACKED
+cbuffer PackUniform : register(b1, space1)
+{
+	float4 boxes[64] : packoffset(c0);  // Center xyz & scale of each box, MESH_PACK_BOXES
+};
+#endif
+
 struct VertexOutput
 {
-	float4 position : SV_Position;
+	precise float4 position : SV_Position;  // Bit for bit the same in the depth pre-pass & the shading after it
+#ifndef DEPTH_ONLY
+#ifdef TEXTURE_ARRAY
+	float3 texcoord : TEXCOORD0;
+#else
 	float2 texcoord : TEXCOORD0;
+#endif
+#endif
 };
 
 VertexOutput VertexMain(VertexInput input)
 {
 	VertexOutput output;
-	output.position = mul(viewproj, float4(input.position, 1.0));
+#ifdef PACKED
+	const int tag = int(round(input.position.w * 32767.0));
+	const float4 box = boxes[tag >> 8];
+	const float3 position = box.xyz + input.position.xyz * box.w;
+#ifndef DEPTH_ONLY
+#ifdef TEXTURE_ARRAY
+	output.texcoord = float3(input.texcoord, float(tag & 255));
+#else
+	output.texcoord = input.texcoord;
+#endif
+#endif
+#else
+	const float3 position = input.position;
+#ifndef DEPTH_ONLY
 	output.texcoord = input.texcoord;
+#endif
+#endif
+#ifdef INSTANCED
+	// Sum the columns directly, the float4x4 constructor takes rows
+	const float4 world = input.model0 * position.x + input.model1 * position.y +
+		input.model2 * position.z + input.model3;
+	output.position = mul(viewproj, world);
+#else
+	output.position = mul(viewproj, float4(position, 1.0));
+#endif
 	return output;
 }
@@ -0,0 +1,25 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <SDL3/SDL_log.h>
+
+/*  Assertions shared by the tests run by CTest. A failed CHECK logs where it failed *
+ *  and carries on, so one run reports every failure, and CheckResult turns the      *
+ *  count into the test's exit code.                                                 */
+static int checkfailures;
+
+#define CHECK(cond) ((cond) ? (void)0 : (void)(++checkfailures, \
+	SDL_LogError(SDL_LOG_CATEGORY_TEST, "%s:%d: CHECK(%s) failed", __FILE__, __LINE__, #cond)))
+
+static inline int CheckResult(const char *name)
+{
+	if (checkfailures > 0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_TEST, "%s: %d checks failed", name, checkfailures);
+		return 1;
+	}
+	SDL_Log("%s: passed", name);
+	return 0;
+}
+
+#endif//CHECK_H
@@ -0,0 +1,156 @@
+/*
+ *  matrixtest - Check the matrix functions against their scalar reference versions
+ *  Usage: matrixtest
+ *
+ *  Multiplies, rotates and translates random matrices with the SIMD and scalar
+ *  versions, and the batch versions against the single matrix ones, and fails if any
+ *  element is further than MATRIX_MAX_ULPS apart.
+ */
+
+#include <SDL3/SDL.h>
+#include "../matrix.h"
+#include "check.h"
+
+#define NUM_MATRICES    1024  // Random inputs checked for each function
+#define MATRIX_MAX_ULPS 4     // Allowed distance from the scalar result, relative to the matrix's largest element
+
+typedef struct tagINPUT
+{
+	mat4f lhs[NUM_MATRICES], rhs[NUM_MATRICES], out[NUM_MATRICES];
+	float angle[NUM_MATRICES], axis[NUM_MATRICES][3];
+	float offset[3][NUM_MATRICES];
+	MAT4BLOCK blocks[MAT4_BLOCKS(NUM_MATRICES)];
+} INPUT;
+
+static float RandomRange(Uint64 *seed, float lo, float hi)
+{
+	return lo + SDL_randf_r(seed) * (hi - lo);
+}
+
+static void RandomMatrix(mat4f m, Uint64 *seed)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		m[i] = RandomRange(seed, -10.f, 10.f);
+	}
+}
+
+static Sint64 OrderedBits(float f)
+{
+	Sint32 bits;
+	SDL_memcpy(&bits, &f, sizeof(bits));
+	return bits < 0 ? (Sint64)SDL_MIN_SINT32 - bits : bits;
+}
+
+// Compare in units in the last place, elements near zero are measured against the largest element instead
+static bool NearlyEqual(const mat4f a, const mat4f b, Sint64 *worst)
+{
+	float scale = 0.f;
+	for (int i = 0; i < 16; ++i)
+	{
+		scale = SDL_max(scale, SDL_fabsf(b[i]));
+	}
+	const float ulp = scale * SDL_FLT_EPSILON;
+	bool equal = true;
+	for (int i = 0; i < 16; ++i)
+	{
+		Sint64 distance = OrderedBits(a[i]) - OrderedBits(b[i]);
+		distance = distance < 0 ? -distance : distance;
+		if (ulp > 0.f)
+		{
+			distance = SDL_min(distance, (Sint64)(SDL_fabsf(a[i] - b[i]) / ulp));
+		}
+		*worst = SDL_max(*worst, distance);
+		equal = equal && distance <= MATRIX_MAX_ULPS;
+	}
+	return equal;
+}
+
+static void TestScalar(const INPUT *in)
+{
+	Sint64 worst[3] = { 0, 0, 0 };
+	for (int i = 0; i < NUM_MATRICES; ++i)
+	{
+		const float *axis = in->axis[i];
+		mat4f simd, scalar;
+		MulMatrices(simd, in->lhs[i], in->rhs[i]);
+		MulMatricesScalar(scalar, in->lhs[i], in->rhs[i]);
+		CHECK(NearlyEqual(simd, scalar, &worst[0]));
+
+		SDL_memcpy(simd, in->lhs[i], sizeof(mat4f));
+		SDL_memcpy(scalar, in->lhs[i], sizeof(mat4f));
+		Rotate(simd, in->angle[i], axis[0], axis[1], axis[2]);
+		RotateScalar(scalar, in->angle[i], axis[0], axis[1], axis[2]);
+		CHECK(NearlyEqual(simd, scalar, &worst[1]));
+
+		Translate(simd, axis[0], axis[1], axis[2]);
+		TranslateScalar(scalar, axis[0], axis[1], axis[2]);
+		CHECK(NearlyEqual(simd, scalar, &worst[2]));
+	}
+	SDL_Log("Worst distance from scalar: multiply %d ULP, rotate %d ULP, translate %d ULP (limit %d)",
+		(int)worst[0], (int)worst[1], (int)worst[2], MATRIX_MAX_ULPS);
+}
+
+// Batches against single matrix calls, the rotation axis is shared across a batch
+static void TestBatch(INPUT *in)
+{
+	Sint64 worst[3] = { 0, 0, 0 };
+	const float *axis = in->axis[0];
+	PackMatrices(in->blocks, (const mat4f *)in->rhs, NUM_MATRICES);
+	MulMatricesBatch(in->blocks, in->lhs[0], in->blocks, NUM_MATRICES);
+	UnpackMatrices(in->out, in->blocks, NUM_MATRICES);
+	for (int i = 0; i < NUM_MATRICES; ++i)
+	{
+		mat4f single;
+		MulMatrices(single, in->lhs[0], in->rhs[i]);
+		CHECK(NearlyEqual(in->out[i], single, &worst[0]));
+	}
+	PackMatrices(in->blocks, (const mat4f *)in->lhs, NUM_MATRICES);
+	RotateBatch(in->blocks, NUM_MATRICES, in->angle, axis[0], axis[1], axis[2]);
+	UnpackMatrices(in->out, in->blocks, NUM_MATRICES);
+	for (int i = 0; i < NUM_MATRICES; ++i)
+	{
+		mat4f single;
+		SDL_memcpy(single, in->lhs[i], sizeof(mat4f));
+		Rotate(single, in->angle[i], axis[0], axis[1], axis[2]);
+		CHECK(NearlyEqual(in->out[i], single, &worst[1]));
+	}
+	PackMatrices(in->blocks, (const mat4f *)in->lhs, NUM_MATRICES);
+	TranslateBatch(in->blocks, NUM_MATRICES, in->offset[0], in->offset[1], in->offset[2]);
+	UnpackMatrices(in->out, in->blocks, NUM_MATRICES);
+	for (int i = 0; i < NUM_MATRICES; ++i)
+	{
+		mat4f single;
+		SDL_memcpy(single, in->lhs[i], sizeof(mat4f));
+		Translate(single, in->offset[0][i], in->offset[1][i], in->offset[2][i]);
+		CHECK(NearlyEqual(in->out[i], single, &worst[2]));
+	}
+	SDL_Log("Worst distance from single: multiply %d ULP, rotate %d ULP, translate %d ULP (limit %d)",
+		(int)worst[0], (int)worst[1], (int)worst[2], MATRIX_MAX_ULPS);
+}
+
+int main(void)
+{
+	INPUT *in = SDL_malloc(sizeof(INPUT));
+	if (!in)
+	{
+		return 1;
+	}
+	Uint64 seed = 10;
+	for (int i = 0; i < NUM_MATRICES; ++i)
+	{
+		RandomMatrix(in->lhs[i], &seed);
+		RandomMatrix(in->rhs[i], &seed);
+		in->angle[i] = RandomRange(&seed, -360.f, 360.f);
+		for (int k = 0; k < 3; ++k)
+		{
+			in->axis[i][k] = RandomRange(&seed, -1.f, 1.f);
+			in->offset[k][i] = RandomRange(&seed, -10.f, 10.f);
+		}
+	}
+	TestScalar(in);
+	TestBatch(in);
+
+	SDL_free(in);
+	return CheckResult("matrixtest");
+}
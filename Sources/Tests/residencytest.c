@@ -0,0 +1,247 @@
+/*
+ *  residencytest - Check the texture streaming policy against a mock backend
+ *  Usage: residencytest
+ *
+ *  Drives the residency tracking frame by frame without a device or workers, the
+ *  mock backend records every level read and every texture resize. Checks levels are
+ *  streamed in one at a time down to the level asked for, evicted least recently
+ *  used first when something else needs the room or the budget drops, never below
+ *  a texture's tail, and that a failed read waits before being retried.
+ */
+
+#include <SDL3/SDL.h>
+#include "../residency.h"
+#include "check.h"
+
+#define MAX_CALLS 64
+
+typedef struct tagMOCKCALL
+{
+	int texture, first, oldfirst;  // Level read is first, oldfirst unused
+	bool texels;
+} MOCKCALL;
+
+typedef struct tagMOCKBACKEND
+{
+	int numreads, numresizes;
+	MOCKCALL reads[MAX_CALLS], resizes[MAX_CALLS];
+	bool failread;                 // Fail every read while set
+	bool badtexels;                // Set when a resize was given texels of another level
+} MOCKBACKEND;
+
+static Uint8 Texel(int texture, int level)
+{
+	return (Uint8)(texture * 16 + level);
+}
+
+static bool MockRead(void *data, int texture, int level, void *dst, Uint32 size)
+{
+	MOCKBACKEND *mock = data;
+	if (mock->numreads < MAX_CALLS)
+	{
+		mock->reads[mock->numreads++] = (MOCKCALL){ .texture = texture, .first = level, .texels = true };
+	}
+	if (mock->failread)
+	{
+		return false;
+	}
+	SDL_memset(dst, Texel(texture, level), size);
+	return true;
+}
+
+static bool MockResize(void *data, void *context, int texture, int first, int oldfirst, const void *texels)
+{
+	MOCKBACKEND *mock = data;
+	(void)context;
+	if (mock->numresizes < MAX_CALLS)
+	{
+		mock->resizes[mock->numresizes++] =
+			(MOCKCALL){ .texture = texture, .first = first, .oldfirst = oldfirst, .texels = texels != NULL };
+	}
+	if (texels && *(const Uint8 *)texels != Texel(texture, first))
+	{
+		mock->badtexels = true;
+	}
+	return true;
+}
+
+static bool Init(RESIDENCY *res, MOCKBACKEND *mock, Uint64 budget)
+{
+	const RESIDENCYBACKEND backend = { mock, MockRead, MockResize };
+	SDL_zerop(mock);
+	return InitResidency(res, &backend, NULL, 8, budget);
+}
+
+static bool Resized(const MOCKBACKEND *mock, int call, int texture, int first, int oldfirst, bool texels)
+{
+	const MOCKCALL *c = &mock->resizes[call];
+	return call < mock->numresizes && c->texture == texture && c->first == first && c->oldfirst == oldfirst &&
+		c->texels == texels;
+}
+
+// Streams in one level a frame down to the one asked for, then drops back down to the tail as the budget falls
+static void TestPromoteDemote(void)
+{
+	static const Uint32 sizes[4] = { 64, 16, 4, 1 };
+	RESIDENCY res;
+	MOCKBACKEND mock;
+	CHECK(Init(&res, &mock, 1000));
+	const int t = AddResidentTexture(&res, 4, sizes, 2);
+	CHECK(t == 0);
+	CHECK(res.stats.residentbytes == 5);
+
+	for (int frame = 0; frame < 4; ++frame)
+	{
+		UseResidentTexture(&res, t, -3);  // Clamped to level 0
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(res.textures[t].first == 0);
+	CHECK(res.stats.residentbytes == 85);
+	CHECK(res.stats.streamed == 2 && res.stats.streamedbytes == 80);
+	CHECK(mock.numreads == 2 && mock.reads[0].first == 1 && mock.reads[1].first == 0);
+	CHECK(mock.numresizes == 2);
+	CHECK(Resized(&mock, 0, t, 1, 2, true));
+	CHECK(Resized(&mock, 1, t, 0, 1, true));
+	CHECK(!mock.badtexels);
+
+	// Levels nobody asks for stay cached while they fit
+	for (int frame = 0; frame < 4; ++frame)
+	{
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(res.textures[t].first == 0);
+	CHECK(mock.numresizes == 2);
+
+	SetResidencyBudget(&res, 21);
+	UpdateResidency(&res, NULL);
+	CHECK(res.textures[t].first == 1);
+	CHECK(Resized(&mock, 2, t, 1, 0, false));
+	SetResidencyBudget(&res, 0);
+	UpdateResidency(&res, NULL);
+	CHECK(res.textures[t].first == 2);
+	CHECK(Resized(&mock, 3, t, 2, 1, false));
+	CHECK(mock.numresizes == 4);
+	CHECK(res.stats.residentbytes == 5);
+	CHECK(res.stats.evicted == 2 && res.stats.evictedbytes == 80);
+	FreeResidency(&res);
+}
+
+// Makes room for a level by evicting the least recently used surplus level, and drops asked for levels last
+static void TestEvictionOrder(void)
+{
+	static const Uint32 sizes[3] = { 64, 16, 4 };
+	RESIDENCY res;
+	MOCKBACKEND mock;
+	CHECK(Init(&res, &mock, 44));
+	const int a = AddResidentTexture(&res, 3, sizes, 2);
+	const int b = AddResidentTexture(&res, 3, sizes, 2);
+	const int c = AddResidentTexture(&res, 3, sizes, 2);
+
+	// A then B stream in level 1, filling the budget
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		UseResidentTexture(&res, a, 1);
+		UpdateResidency(&res, NULL);
+	}
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		UseResidentTexture(&res, b, 1);
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(res.textures[a].first == 1 && res.textures[b].first == 1);
+	CHECK(res.stats.residentbytes == 44);
+	CHECK(mock.numresizes == 2);
+
+	// C asks for level 1, A was used longest ago so its level makes room
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		UseResidentTexture(&res, c, 1);
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(mock.numresizes == 4);
+	CHECK(Resized(&mock, 2, a, 2, 1, false));
+	CHECK(Resized(&mock, 3, c, 1, 2, true));
+	CHECK(res.textures[a].first == 2 && res.textures[b].first == 1 && res.textures[c].first == 1);
+	CHECK(res.stats.residentbytes == 44);
+
+	// Nothing surplus to evict, a level C still asks for isn't read
+	UseResidentTexture(&res, b, 1);
+	UseResidentTexture(&res, c, 0);
+	UpdateResidency(&res, NULL);
+	CHECK(res.stats.pending == 0);
+	CHECK(mock.numreads == 3);
+
+	// Lowering the budget evicts B, used before C, then C though it's still asked for, never below the tail
+	UseResidentTexture(&res, c, 1);
+	SetResidencyBudget(&res, 0);
+	UpdateResidency(&res, NULL);
+	CHECK(mock.numresizes == 6);
+	CHECK(Resized(&mock, 4, b, 2, 1, false));
+	CHECK(Resized(&mock, 5, c, 2, 1, false));
+	CHECK(res.stats.residentbytes == 12);
+	FreeResidency(&res);
+}
+
+// Between textures last used the same frame the larger level goes first
+static void TestEvictLargest(void)
+{
+	static const Uint32 small[2] = { 50, 10 }, large[2] = { 100, 10 };
+	RESIDENCY res;
+	MOCKBACKEND mock;
+	CHECK(Init(&res, &mock, 1000));
+	const int s = AddResidentTexture(&res, 2, small, 1);
+	const int l = AddResidentTexture(&res, 2, large, 1);
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		UseResidentTexture(&res, s, 0);
+		UseResidentTexture(&res, l, 0);
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(res.textures[s].first == 0 && res.textures[l].first == 0);
+
+	SetResidencyBudget(&res, 100);
+	UpdateResidency(&res, NULL);
+	CHECK(res.textures[s].first == 0 && res.textures[l].first == 1);
+	CHECK(res.stats.residentbytes == 70);
+	FreeResidency(&res);
+}
+
+// A level that failed to read is left alone for RESIDENCY_RETRY_FRAMES
+static void TestFailedRead(void)
+{
+	static const Uint32 sizes[2] = { 16, 4 };
+	RESIDENCY res;
+	MOCKBACKEND mock;
+	CHECK(Init(&res, &mock, 1000));
+	const int t = AddResidentTexture(&res, 2, sizes, 1);
+	mock.failread = true;
+	UseResidentTexture(&res, t, 0);
+	UpdateResidency(&res, NULL);
+	mock.failread = false;
+	for (int frame = 0; frame < RESIDENCY_RETRY_FRAMES; ++frame)
+	{
+		UseResidentTexture(&res, t, 0);
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(res.stats.failed == 1);
+	CHECK(mock.numreads == 1);
+	CHECK(res.textures[t].first == 1);
+
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		UseResidentTexture(&res, t, 0);
+		UpdateResidency(&res, NULL);
+	}
+	CHECK(mock.numreads == 2);
+	CHECK(res.textures[t].first == 0);
+	FreeResidency(&res);
+}
+
+int main(void)
+{
+	TestPromoteDemote();
+	TestEvictionOrder();
+	TestEvictLargest();
+	TestFailedRead();
+	return CheckResult("residencytest");
+}
@@ -0,0 +1,143 @@
+/*
+ *  simulationtest - Check the fixed tick simulation is deterministic
+ *  Usage: simulationtest
+ *
+ *  Runs the same span of time through UpdateSimulation split into updates of
+ *  different lengths and checks every split ends in the same state as ticking it
+ *  directly, then checks stalls are clamped to SIM_MAX_TICKS and InterpolateCamera
+ *  at either end of a tick.
+ */
+
+#include <SDL3/SDL.h>
+#include "../simulation.h"
+#include "check.h"
+
+#define START_NS  1000000000ull  // Clock at the first update, UpdateSimulation takes 0 as never updated
+#define NUM_TICKS 600            // Ticks simulated by each split
+
+static const CAMERA startcamera = { .heading = 30.f, .xpos = 1.f, .zpos = -2.f, .yrot = 30.f, .z = 0.5f };
+static const CAMERAINPUT walking = { .forward = true, .turnleft = true, .lookup = true };
+
+static bool SameCamera(const CAMERA *a, const CAMERA *b)
+{
+	return SDL_memcmp(a, b, sizeof(CAMERA)) == 0;
+}
+
+static bool NearCamera(const CAMERA *a, const CAMERA *b, float epsilon)
+{
+	const float *fa = &a->heading, *fb = &b->heading;
+	for (int i = 0; i < (int)(sizeof(CAMERA) / sizeof(float)); ++i)
+	{
+		if (SDL_fabsf(fa[i] - fb[i]) > epsilon)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Advance the clock by steps of at most maxstep, drawn from the seed when it isn't 0
+static void RunSplit(SIMULATION *sim, Uint64 maxstep, Uint64 seed)
+{
+	const Uint64 endns = START_NS + NUM_TICKS * SIM_TICK_NS;
+	InitSimulation(sim, &startcamera);
+	CHECK(UpdateSimulation(sim, START_NS, &walking) == 0);
+	int ticks = 0;
+	for (Uint64 now = START_NS; now < endns; )
+	{
+		const Uint64 step = seed ? 1 + (Uint64)SDL_rand_r(&seed, (Sint32)maxstep) : maxstep;
+		now = SDL_min(now + step, endns);
+		ticks += UpdateSimulation(sim, now, &walking);
+	}
+	CHECK(ticks == NUM_TICKS);
+}
+
+static void TestSplits(void)
+{
+	SIMULATION direct;
+	InitSimulation(&direct, &startcamera);
+	for (int i = 0; i < NUM_TICKS; ++i)
+	{
+		TickSimulation(&direct, &walking);
+	}
+
+	// One tick at a time, a frame at 144 Hz, 1 ms, the longest update that isn't clamped, and random lengths
+	const Uint64 steps[] = {
+		SIM_TICK_NS, SDL_NS_PER_SECOND / 144, SDL_NS_PER_MS, SIM_MAX_TICKS * SIM_TICK_NS, SIM_TICK_NS * 3 };
+	const Uint64 seeds[] = { 0, 0, 0, 0, 10 };
+	for (int i = 0; i < (int)SDL_arraysize(steps); ++i)
+	{
+		SIMULATION sim;
+		RunSplit(&sim, steps[i], seeds[i]);
+		CHECK(sim.ticks == direct.ticks);
+		CHECK(sim.accumulator == 0);
+		CHECK(SameCamera(&sim.camera, &direct.camera));
+		CHECK(SameCamera(&sim.prevcamera, &direct.prevcamera));
+	}
+}
+
+static void TestClamp(void)
+{
+	SIMULATION sim;
+	InitSimulation(&sim, &startcamera);
+	CHECK(UpdateSimulation(&sim, START_NS, &walking) == 0);
+
+	// A stall many ticks long only runs SIM_MAX_TICKS, and leaves nothing behind to catch up on
+	Uint64 now = START_NS + 100 * SIM_TICK_NS;
+	CHECK(UpdateSimulation(&sim, now, &walking) == SIM_MAX_TICKS);
+	CHECK(sim.ticks == SIM_MAX_TICKS);
+	CHECK(sim.accumulator == 0);
+
+	// Just short of SIM_MAX_TICKS isn't clamped, and carries the partial tick over
+	now += SIM_TICK_NS - 1;
+	CHECK(UpdateSimulation(&sim, now, &walking) == 0);
+	now += (SIM_MAX_TICKS - 1) * SIM_TICK_NS;
+	CHECK(UpdateSimulation(&sim, now, &walking) == SIM_MAX_TICKS - 1);
+	CHECK(sim.accumulator == SIM_TICK_NS - 1);
+
+	// Past it the partial tick is dropped along with the rest of the stall
+	now += SIM_MAX_TICKS * SIM_TICK_NS;
+	CHECK(UpdateSimulation(&sim, now, &walking) == SIM_MAX_TICKS);
+	CHECK(sim.accumulator == 0);
+
+	// The clock going backwards restarts timing without ticking
+	CHECK(UpdateSimulation(&sim, START_NS, &walking) == 0);
+	CHECK(sim.lastns == START_NS);
+	CHECK(sim.ticks == 3 * SIM_MAX_TICKS - 1);
+}
+
+static void TestInterpolate(void)
+{
+	SIMULATION sim;
+	InitSimulation(&sim, &startcamera);
+	CHECK(UpdateSimulation(&sim, START_NS, &walking) == 0);
+	CHECK(UpdateSimulation(&sim, START_NS + 2 * SIM_TICK_NS, &walking) == 2);
+	CHECK(!SameCamera(&sim.prevcamera, &sim.camera));
+
+	// On a tick boundary the drawn camera is the previous tick's, walkbiasangle is always the latest
+	CAMERA camera, expected = sim.prevcamera;
+	expected.walkbiasangle = sim.camera.walkbiasangle;
+	InterpolateCamera(&sim, &camera);
+	CHECK(SameCamera(&camera, &expected));
+
+	// Halfway into the next tick it is halfway between the two
+	CHECK(UpdateSimulation(&sim, START_NS + 2 * SIM_TICK_NS + SIM_TICK_NS / 2, &walking) == 0);
+	InterpolateCamera(&sim, &camera);
+	CHECK(SDL_fabsf(camera.xpos - (sim.prevcamera.xpos + sim.camera.xpos) / 2) < 1e-5f);
+	CHECK(SDL_fabsf(camera.heading - (sim.prevcamera.heading + sim.camera.heading) / 2) < 1e-5f);
+
+	// Just short of the next tick it has all but reached the latest tick
+	CHECK(UpdateSimulation(&sim, START_NS + 3 * SIM_TICK_NS - 1, &walking) == 0);
+	InterpolateCamera(&sim, &camera);
+	CHECK(camera.walkbiasangle == sim.camera.walkbiasangle);
+	CHECK(NearCamera(&camera, &sim.camera, 1e-5f));
+	CHECK(!NearCamera(&camera, &sim.prevcamera, 1e-5f));
+}
+
+int main(void)
+{
+	TestSplits();
+	TestClamp();
+	TestInterpolate();
+	return CheckResult("simulationtest");
+}
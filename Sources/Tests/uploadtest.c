@@ -0,0 +1,313 @@
+/*
+ *  uploadtest - Check the upload ring's sub-allocation, fencing & reuse without a GPU
+ *  Usage: uploadtest
+ *
+ *  upload.c is compiled into the test with its GPU calls redirected to a mock device
+ *  that keeps transfer buffers in memory, carries out copies as they're recorded and
+ *  notes which fences were waited on, so the ring can be run frame by frame and
+ *  checked for mapping a buffer the GPU might still be reading.
+ */
+
+#include <SDL3/SDL.h>
+#include "../upload.h"
+#include "check.h"
+
+#define MOCK_MAX_FENCES 64
+#define TEST_CAPACITY   256   // Bytes in each of the ring's transfer buffers
+
+typedef struct tagMOCKBUFFER
+{
+	Uint8 *data;
+	Uint32 size;
+	bool mapped;
+} MOCKBUFFER;
+
+typedef struct tagMOCKFENCE
+{
+	const MOCKBUFFER *buffer;    // Transfer buffer copied from by the fenced submit, NULL if none
+	bool waited, released;
+} MOCKFENCE;
+
+typedef struct tagMOCKGPU
+{
+	MOCKBUFFER buffers[UPLOAD_FRAMES];
+	int numbuffers;
+	MOCKFENCE fences[MOCK_MAX_FENCES];
+	int numfences;
+	const MOCKBUFFER *copiedfrom;  // Transfer buffer of the copies recorded since the last submit
+	int copies, submits, fencedsubmits;
+	int unsafemaps;              // Buffers mapped while a fence on their last copies hadn't been waited on
+} MOCKGPU;
+
+static MOCKGPU gpu;
+
+static SDL_GPUTransferBuffer *MockCreateGPUTransferBuffer(SDL_GPUDevice *dev,
+	const SDL_GPUTransferBufferCreateInfo *info)
+{
+	(void)dev;
+	if (gpu.numbuffers == UPLOAD_FRAMES)
+	{
+		return NULL;
+	}
+	MOCKBUFFER *buffer = &gpu.buffers[gpu.numbuffers++];
+	buffer->data = SDL_calloc(1, info->size);
+	buffer->size = info->size;
+	return (SDL_GPUTransferBuffer *)buffer;
+}
+
+static void MockReleaseGPUTransferBuffer(SDL_GPUDevice *dev, SDL_GPUTransferBuffer *transferbuffer)
+{
+	(void)dev;
+	MOCKBUFFER *buffer = (MOCKBUFFER *)transferbuffer;
+	if (buffer)
+	{
+		SDL_free(buffer->data);
+		buffer->data = NULL;
+	}
+}
+
+static void *MockMapGPUTransferBuffer(SDL_GPUDevice *dev, SDL_GPUTransferBuffer *transferbuffer, bool cycle)
+{
+	(void)dev;
+	(void)cycle;
+	MOCKBUFFER *buffer = (MOCKBUFFER *)transferbuffer;
+	for (int i = 0; i < gpu.numfences; ++i)
+	{
+		gpu.unsafemaps += gpu.fences[i].buffer == buffer && !gpu.fences[i].waited;
+	}
+	CHECK(!buffer->mapped);
+	buffer->mapped = true;
+	return buffer->data;
+}
+
+static void MockUnmapGPUTransferBuffer(SDL_GPUDevice *dev, SDL_GPUTransferBuffer *transferbuffer)
+{
+	(void)dev;
+	MOCKBUFFER *buffer = (MOCKBUFFER *)transferbuffer;
+	CHECK(buffer->mapped);
+	buffer->mapped = false;
+}
+
+static SDL_GPUCopyPass *MockBeginGPUCopyPass(SDL_GPUCommandBuffer *cmdbuf)
+{
+	return (SDL_GPUCopyPass *)cmdbuf;
+}
+
+// Carries the copy out at once, the destination "GPU buffer" is plain memory
+static void MockUploadToGPUBuffer(SDL_GPUCopyPass *pass, const SDL_GPUTransferBufferLocation *source,
+	const SDL_GPUBufferRegion *destination, bool cycle)
+{
+	(void)pass;
+	(void)cycle;
+	const MOCKBUFFER *buffer = (const MOCKBUFFER *)source->transfer_buffer;
+	CHECK(!buffer->mapped);
+	CHECK(source->offset + destination->size <= buffer->size);
+	SDL_memcpy((Uint8 *)destination->buffer + destination->offset, buffer->data + source->offset, destination->size);
+	gpu.copiedfrom = buffer;
+	++gpu.copies;
+}
+
+static void MockEndGPUCopyPass(SDL_GPUCopyPass *pass)
+{
+	(void)pass;
+}
+
+static bool MockSubmitGPUCommandBuffer(SDL_GPUCommandBuffer *cmdbuf)
+{
+	(void)cmdbuf;
+	gpu.copiedfrom = NULL;
+	++gpu.submits;
+	return true;
+}
+
+static SDL_GPUFence *MockSubmitGPUCommandBufferAndAcquireFence(SDL_GPUCommandBuffer *cmdbuf)
+{
+	(void)cmdbuf;
+	if (gpu.numfences == MOCK_MAX_FENCES)
+	{
+		return NULL;
+	}
+	MOCKFENCE *fence = &gpu.fences[gpu.numfences++];
+	fence->buffer = gpu.copiedfrom;
+	gpu.copiedfrom = NULL;
+	++gpu.submits;
+	++gpu.fencedsubmits;
+	return (SDL_GPUFence *)fence;
+}
+
+static bool MockWaitForGPUFences(SDL_GPUDevice *dev, bool waitall, SDL_GPUFence *const *fences, Uint32 numfences)
+{
+	(void)dev;
+	(void)waitall;
+	for (Uint32 i = 0; i < numfences; ++i)
+	{
+		MOCKFENCE *fence = (MOCKFENCE *)fences[i];
+		CHECK(!fence->released);
+		fence->waited = true;
+	}
+	return true;
+}
+
+static void MockReleaseGPUFence(SDL_GPUDevice *dev, SDL_GPUFence *gpufence)
+{
+	(void)dev;
+	MOCKFENCE *fence = (MOCKFENCE *)gpufence;
+	CHECK(!fence->released);
+	fence->released = true;
+}
+
+#define SDL_CreateGPUTransferBuffer MockCreateGPUTransferBuffer
+#define SDL_ReleaseGPUTransferBuffer MockReleaseGPUTransferBuffer
+#define SDL_MapGPUTransferBuffer MockMapGPUTransferBuffer
+#define SDL_UnmapGPUTransferBuffer MockUnmapGPUTransferBuffer
+#define SDL_BeginGPUCopyPass MockBeginGPUCopyPass
+#define SDL_UploadToGPUBuffer MockUploadToGPUBuffer
+#define SDL_EndGPUCopyPass MockEndGPUCopyPass
+#define SDL_SubmitGPUCommandBuffer MockSubmitGPUCommandBuffer
+#define SDL_SubmitGPUCommandBufferAndAcquireFence MockSubmitGPUCommandBufferAndAcquireFence
+#define SDL_WaitForGPUFences MockWaitForGPUFences
+#define SDL_ReleaseGPUFence MockReleaseGPUFence
+#include "../upload.c"
+
+static SDL_GPUDevice *const mockdev = (SDL_GPUDevice *)&gpu;
+static SDL_GPUCommandBuffer *const mockcmdbuf = (SDL_GPUCommandBuffer *)&gpu;
+
+static void TestSubAllocate(void)
+{
+	Uint32 used = 0;
+	CHECK(SubAllocate(&used, 64, 3, 1) == 0 && used == 3);
+	CHECK(SubAllocate(&used, 64, 8, 16) == 16 && used == 24);
+	CHECK(SubAllocate(&used, 64, 4, 4) == 24 && used == 28);
+	CHECK(SubAllocate(&used, 64, 36, 4) == 28 && used == 64);
+	CHECK(SubAllocate(&used, 64, 1, 1) == UPLOAD_FULL && used == 64);
+
+	// Alignment padding can push a small request past the end, it's added up in 64 bits so it can't wrap
+	used = 57;
+	CHECK(SubAllocate(&used, 64, 1, 8) == UPLOAD_FULL && used == 57);
+	used = SDL_MAX_UINT32 - 2;
+	CHECK(SubAllocate(&used, SDL_MAX_UINT32, 1, 16) == UPLOAD_FULL && used == SDL_MAX_UINT32 - 2);
+}
+
+static void TestAlignmentAndFull(void)
+{
+	SDL_zero(gpu);
+	UPLOADRING ring;
+	CHECK(InitUploadRing(&ring, mockdev, TEST_CAPACITY));
+	Uint8 dest[2 * TEST_CAPACITY] = { 0 };
+
+	BeginUploadFrame(&ring);
+	Uint8 *a = AllocUpload(&ring, (SDL_GPUBuffer *)dest, 0, 3, 1, true);
+	Uint8 *b = AllocUpload(&ring, (SDL_GPUBuffer *)dest, 16, 16, 16, false);
+	CHECK(a && b && b - a == 16 && ((b - gpu.buffers[ring.frame].data) & 15) == 0);
+	CHECK(ring.numcopies == 2 && ring.copies[0].cycle && !ring.copies[1].cycle);
+
+	// A request that doesn't fit fails without disturbing what was allocated, what does fit still succeeds
+	const Uint32 used = ring.used;
+	CHECK(!AllocUpload(&ring, (SDL_GPUBuffer *)dest, 0, TEST_CAPACITY - used + 1, 1, false));
+	CHECK(SDL_strstr(SDL_GetError(), "full") != NULL);
+	CHECK(ring.used == used && ring.numcopies == 2);
+	Uint8 *c = AllocUpload(&ring, (SDL_GPUBuffer *)dest, 64, TEST_CAPACITY - used, 1, false);
+	CHECK(c && ring.used == TEST_CAPACITY && ring.peak == TEST_CAPACITY);
+
+	if (a && b && c)
+	{
+		SDL_memcpy(a, "abc", 3);
+		SDL_memset(b, 0x5A, 16);
+		SDL_memset(c, 0xC3, TEST_CAPACITY - used);
+	}
+	FlushUploads(&ring, mockcmdbuf);
+	CHECK(gpu.copies == 3);
+	CHECK(SDL_memcmp(dest, "abc", 3) == 0 && dest[16] == 0x5A && dest[31] == 0x5A && dest[64] == 0xC3);
+	CHECK(SubmitUploadFrame(&ring, mockcmdbuf));
+	CHECK(gpu.fencedsubmits == 1);
+	FreeUploadRing(&ring);
+	CHECK(gpu.fences[0].waited && gpu.fences[0].released);
+}
+
+// Frames go round the buffers in order, and each is only mapped again once its last frame's fence was waited on
+static void TestWraparound(void)
+{
+	SDL_zero(gpu);
+	UPLOADRING ring;
+	CHECK(InitUploadRing(&ring, mockdev, TEST_CAPACITY));
+	Uint8 dest[4 * UPLOAD_FRAMES] = { 0 };
+
+	const int numframes = 4 * UPLOAD_FRAMES + 1;
+	for (int frame = 0; frame < numframes; ++frame)
+	{
+		BeginUploadFrame(&ring);
+		CHECK(ring.frame == (unsigned)(frame % UPLOAD_FRAMES));
+		CHECK(ring.used == 0 && ring.numcopies == 0);
+		Uint8 *data = AllocUpload(&ring, (SDL_GPUBuffer *)dest, 4 * ring.frame, 4, 4, true);
+		CHECK(data == gpu.buffers[ring.frame].data);
+		if (data)
+		{
+			SDL_memset(data, frame, 4);
+		}
+		FlushUploads(&ring, mockcmdbuf);
+		CHECK(dest[4 * ring.frame] == (Uint8)frame);
+		CHECK(SubmitUploadFrame(&ring, mockcmdbuf));
+		CHECK(ring.fences[ring.frame] != NULL);
+	}
+	CHECK(gpu.fencedsubmits == numframes);
+	CHECK(gpu.unsafemaps == 0);
+
+	// The frames still in flight are the ones whose fences haven't been waited on yet
+	for (int i = 0; i < gpu.numfences; ++i)
+	{
+		CHECK(gpu.fences[i].waited == (i < gpu.numfences - UPLOAD_FRAMES));
+	}
+	FreeUploadRing(&ring);
+	for (int i = 0; i < gpu.numfences; ++i)
+	{
+		CHECK(gpu.fences[i].waited && gpu.fences[i].released);
+	}
+}
+
+// Only frames that uploaded something or asked for it take a fence, a frame asking is waited on when its turn comes
+static void TestFencing(void)
+{
+	SDL_zero(gpu);
+	UPLOADRING ring;
+	CHECK(InitUploadRing(&ring, mockdev, TEST_CAPACITY));
+
+	BeginUploadFrame(&ring);
+	FlushUploads(&ring, mockcmdbuf);
+	CHECK(SubmitUploadFrame(&ring, mockcmdbuf));
+	CHECK(ring.fences[ring.frame] == NULL && gpu.submits == 1 && gpu.fencedsubmits == 0);
+
+	// Nothing uploaded, but something recorded with the frame, a download say, is read when it comes round
+	BeginUploadFrame(&ring);
+	const unsigned fencedframe = ring.frame;
+	FenceUploadFrame(&ring);
+	FlushUploads(&ring, mockcmdbuf);
+	CHECK(SubmitUploadFrame(&ring, mockcmdbuf));
+	CHECK(ring.fences[fencedframe] != NULL && gpu.fencedsubmits == 1);
+	const MOCKFENCE *fence = (const MOCKFENCE *)ring.fences[fencedframe];
+
+	// Asking doesn't carry over to later frames
+	for (int i = 1; i < UPLOAD_FRAMES; ++i)
+	{
+		BeginUploadFrame(&ring);
+		FlushUploads(&ring, mockcmdbuf);
+		CHECK(SubmitUploadFrame(&ring, mockcmdbuf));
+		CHECK(ring.fences[ring.frame] == NULL);
+	}
+	CHECK(fence && !fence->waited);
+	BeginUploadFrame(&ring);
+	CHECK(ring.frame == fencedframe && ring.fences[fencedframe] == NULL);
+	CHECK(fence && fence->waited && fence->released);
+	FlushUploads(&ring, mockcmdbuf);
+	CHECK(SubmitUploadFrame(&ring, mockcmdbuf));
+	CHECK(gpu.submits == UPLOAD_FRAMES + 2 && gpu.fencedsubmits == 1);
+	FreeUploadRing(&ring);
+}
+
+int main(void)
+{
+	TestSubAllocate();
+	TestAlignmentAndFull();
+	TestWraparound();
+	TestFencing();
+	return CheckResult("uploadtest");
+}
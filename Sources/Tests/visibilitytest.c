@@ -0,0 +1,387 @@
+/*
+ *  visibilitytest - Check portal visibility on a generated maze against a brute-force reference
+ *  Usage: visibilitytest
+ *
+ *  Generates a 1000 room maze as Scripts/generate-world.py --sectors does, one sector
+ *  per room joined by doorway portals along a random spanning tree, and loads it the
+ *  way the game loads World.txt. From cameras spread through the maze it then casts
+ *  a ray through every pixel of a small screen, walking from room to room through
+ *  the doorways each ray passes, and checks ComputeVisibility reaches every room a
+ *  ray reached, and not too many more. It also logs the triangles in the visible
+ *  ranges and how long each ComputeVisibility pass took, on average and at worst.
+ */
+
+#include <SDL3/SDL.h>
+#include "../world.h"
+#include "../mesh.h"
+#include "../visibility.h"
+#include "check.h"
+
+#define ROOMS_X 40            // Maze is 40 x 25 rooms
+#define ROOMS_Z 25
+#define NUM_ROOMS (ROOMS_X * ROOMS_Z)
+#define ROOM_SIZE 6.f
+#define ROOM_HEIGHT 1.f
+#define DOOR_WIDTH 1.5f
+#define CAMERA_STEP 13        // Test cameras in every 13th room
+#define NUM_HEADINGS 8        // Cameras in each tested room look along 8 headings
+#define RAYS_X 128            // Rays cast for each camera
+#define RAYS_Y 96
+#define FOVY 45.f
+#define ASPECT (4.f / 3.f)
+#define MAX_EXTRA_PERCENT 25  // Most rooms reached by portals over those reached by rays
+
+typedef struct tagTEXT
+{
+	char *data;
+	size_t size, capacity;
+} TEXT;
+
+typedef struct tagTALLY
+{
+	int cameras, numrays, numextra, mostrays;
+	Uint64 numtriangles, mosttriangles;  // Triangles in the visible ranges
+	Uint64 passticks, worstticks;        // ComputeVisibility time in performance counter ticks
+} TALLY;
+
+static int roomportals[NUM_ROOMS][4];  // Portals out of each room, -1 past the last
+
+static bool Append(TEXT *text, const char *fmt, ...)
+{
+	char line[128];
+	va_list ap;
+	va_start(ap, fmt);
+	const int length = SDL_vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	if (length < 0 || (size_t)length >= sizeof(line))
+	{
+		return SDL_SetError("Line too long");
+	}
+	if (text->size + (size_t)length > text->capacity)
+	{
+		const size_t capacity = SDL_max(text->capacity * 2, 1 << 16);
+		char *data = SDL_realloc(text->data, capacity);
+		if (!data)
+		{
+			return false;
+		}
+		text->data = data;
+		text->capacity = capacity;
+	}
+	SDL_memcpy(text->data + text->size, line, (size_t)length);
+	text->size += (size_t)length;
+	return true;
+}
+
+static bool AppendQuad(TEXT *text, const float corners[4][3])
+{
+	static const int order[6] = { 0, 1, 2, 0, 3, 2 };
+	bool ok = true;
+	for (int i = 0; i < 6; ++i)
+	{
+		const float *c = corners[order[i]];
+		ok = ok && Append(text, "%.2f %.2f %.2f %.2f %.2f\n", c[0], c[1], c[2], c[0] + c[2], c[1]);
+	}
+	return ok;
+}
+
+// Carve a random spanning tree through the grid, doors[room][0] joins room to +x, doors[room][1] to +z
+static void CarveMaze(bool doors[NUM_ROOMS][2])
+{
+	static int stack[NUM_ROOMS];
+	bool visited[NUM_ROOMS] = { false };
+	Uint64 seed = 10;
+	int top = 0;
+	stack[top++] = 0;
+	visited[0] = true;
+	SDL_memset(doors, 0, sizeof(bool[NUM_ROOMS][2]));
+	while (top > 0)
+	{
+		const int room = stack[top - 1], x = room % ROOMS_X, z = room / ROOMS_X;
+		int neighbours[4], count = 0;
+		const int candidates[4] = { x > 0 ? room - 1 : -1, x < ROOMS_X - 1 ? room + 1 : -1,
+			z > 0 ? room - ROOMS_X : -1, z < ROOMS_Z - 1 ? room + ROOMS_X : -1 };
+		for (int i = 0; i < 4; ++i)
+		{
+			if (candidates[i] >= 0 && !visited[candidates[i]])
+			{
+				neighbours[count++] = candidates[i];
+			}
+		}
+		if (count == 0)
+		{
+			--top;
+			continue;
+		}
+		const int next = neighbours[SDL_rand_r(&seed, count)];
+		visited[next] = true;
+		doors[SDL_min(room, next)][SDL_abs(next - room) == 1 ? 0 : 1] = true;
+		stack[top++] = next;
+	}
+}
+
+// Write the maze in World.txt syntax, walls of each room with a doorway cut where the maze joins rooms
+static bool WriteMaze(TEXT *text, bool doors[NUM_ROOMS][2])
+{
+	const float side = (ROOM_SIZE - DOOR_WIDTH) / 2;
+	bool ok = true;
+	for (int room = 0; room < NUM_ROOMS && ok; ++room)
+	{
+		const int gx = room % ROOMS_X, gz = room / ROOMS_X;
+		const float x0 = gx * ROOM_SIZE, z0 = gz * ROOM_SIZE, x1 = x0 + ROOM_SIZE, z1 = z0 + ROOM_SIZE;
+		const bool open[4] = {
+			gx > 0 && doors[room - 1][0], doors[room][0],
+			gz > 0 && doors[room - ROOMS_X][1], doors[room][1] };
+		const float walls[4][4] = { { x0, z0, x0, z1 }, { x1, z0, x1, z1 }, { x0, z0, x1, z0 }, { x0, z1, x1, z1 } };
+		const int numquads = 2 + 4 + open[0] + open[1] + open[2] + open[3];
+		ok = Append(text, "// Sector %d\nNUMPOLLIES %d\n", room, numquads * 2);
+
+		const float floor[4][3] = { { x0, 0, z0 }, { x0, 0, z1 }, { x1, 0, z1 }, { x1, 0, z0 } };
+		const float ceiling[4][3] = {
+			{ x0, ROOM_HEIGHT, z0 }, { x0, ROOM_HEIGHT, z1 }, { x1, ROOM_HEIGHT, z1 }, { x1, ROOM_HEIGHT, z0 } };
+		ok = ok && AppendQuad(text, floor) && AppendQuad(text, ceiling);
+		for (int i = 0; i < 4 && ok; ++i)
+		{
+			const float ax = walls[i][0], az = walls[i][1], bx = walls[i][2], bz = walls[i][3];
+			const float dx = (bx - ax) / ROOM_SIZE, dz = (bz - az) / ROOM_SIZE;
+			const float spans[2][4] = {
+				{ ax, az, open[i] ? ax + dx * side : bx, open[i] ? az + dz * side : bz },
+				{ bx - dx * side, bz - dz * side, bx, bz } };
+			for (int j = 0; j < (open[i] ? 2 : 1) && ok; ++j)
+			{
+				const float *s = spans[j];
+				const float wall[4][3] = {
+					{ s[0], ROOM_HEIGHT, s[1] }, { s[0], 0, s[1] }, { s[2], 0, s[3] }, { s[2], ROOM_HEIGHT, s[3] } };
+				ok = AppendQuad(text, wall);
+			}
+		}
+	}
+	for (int room = 0; room < NUM_ROOMS && ok; ++room)
+	{
+		const int gx = room % ROOMS_X, gz = room / ROOMS_X;
+		const float x = gx * ROOM_SIZE, z = gz * ROOM_SIZE;
+		if (doors[room][0])
+		{
+			const float px = x + ROOM_SIZE, pz0 = z + side, pz1 = z + ROOM_SIZE - side;
+			ok = Append(text, "PORTAL %d %d\n", room, room + 1) &&
+				Append(text, "%.2f 0.00 %.2f\n%.2f %.2f %.2f\n", px, pz0, px, ROOM_HEIGHT, pz0) &&
+				Append(text, "%.2f %.2f %.2f\n%.2f 0.00 %.2f\n", px, ROOM_HEIGHT, pz1, px, pz1);
+		}
+		if (doors[room][1] && ok)
+		{
+			const float pz = z + ROOM_SIZE, px0 = x + side, px1 = x + ROOM_SIZE - side;
+			ok = Append(text, "PORTAL %d %d\n", room, room + ROOMS_X) &&
+				Append(text, "%.2f 0.00 %.2f\n%.2f %.2f %.2f\n", px0, pz, px0, ROOM_HEIGHT, pz) &&
+				Append(text, "%.2f %.2f %.2f\n%.2f 0.00 %.2f\n", px1, ROOM_HEIGHT, pz, px1, pz);
+		}
+	}
+	return ok;
+}
+
+// Whether a point on a sector's wall lies strictly inside a portal, with slack only across the wall's plane
+static bool InsidePortal(const PORTAL *portal, const float p[3])
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		float lo = portal->corners[0][k], hi = lo;
+		for (int i = 1; i < 4; ++i)
+		{
+			lo = SDL_min(lo, portal->corners[i][k]);
+			hi = SDL_max(hi, portal->corners[i][k]);
+		}
+		const bool inside = hi - lo < 1e-4f ? SDL_fabsf(p[k] - lo) < 1e-3f : p[k] > lo + 1e-4f && p[k] < hi - 1e-4f;
+		if (!inside)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Walk a ray from the eye through the sector boxes, passing from one to the next through portals
+static void CastRay(const WORLD *world, const float eye[3], const float dir[3], int sector, bool *reached)
+{
+	int fromportal = -1;
+	for (int depth = 0; ; ++depth)
+	{
+		reached[sector] = true;
+		if (depth >= MAX_PORTAL_DEPTH)
+		{
+			return;
+		}
+
+		// Leave the sector's box where the ray's last slab ends
+		const SECTOR *s = &world->sectors[sector];
+		float t = SDL_FLT_MAX;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (dir[k] != 0.f)
+			{
+				t = SDL_min(t, ((dir[k] > 0.f ? s->maxs[k] : s->mins[k]) - eye[k]) / dir[k]);
+			}
+		}
+		const float p[3] = { eye[0] + dir[0] * t, eye[1] + dir[1] * t, eye[2] + dir[2] * t };
+
+		int next = -1;
+		for (int j = 0; j < 4 && roomportals[sector][j] >= 0 && next < 0; ++j)
+		{
+			const int i = roomportals[sector][j];
+			const PORTAL *portal = &world->portals[i];
+			if (i != fromportal && InsidePortal(portal, p))
+			{
+				next = portal->sectors[0] == sector ? portal->sectors[1] : portal->sectors[0];
+				fromportal = i;
+			}
+		}
+		if (next < 0)
+		{
+			return;
+		}
+		sector = next;
+	}
+}
+
+static void TestCamera(VISIBILITY *vis, const WORLD *world, int room, float heading, bool *reached, TALLY *tally)
+{
+	const int gx = room % ROOMS_X, gz = room / ROOMS_X;
+	const float eye[3] = { (gx + 0.5f) * ROOM_SIZE + 1.1f, 0.25f, (gz + 0.5f) * ROOM_SIZE - 0.7f };
+	mat4f proj, view = M4_IDENTITY, viewproj;
+	MakePerspective(proj, FOVY, ASPECT, 0.1f, 100.f);
+	Rotate(view, 360.f - heading, 0.f, 1.f, 0.f);
+	Translate(view, -eye[0], -eye[1], -eye[2]);
+	MulMatrices(viewproj, proj, view);
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+	ComputeVisibility(vis, world, viewproj, eye);
+	const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+	Uint64 triangles = 0;
+	for (int i = 0; i < vis->numranges; ++i)
+	{
+		triangles += vis->ranges[i].numindices / 3;
+	}
+	++tally->cameras;
+	tally->numtriangles += triangles;
+	tally->mosttriangles = SDL_max(tally->mosttriangles, triangles);
+	tally->passticks += ticks;
+	tally->worstticks = SDL_max(tally->worstticks, ticks);
+	CHECK(vis->camerasector == room);
+	if (vis->camerasector != room)
+	{
+		return;
+	}
+	CHECK(SectorVisible(vis, room));
+
+	// Cast a ray through the centre of each pixel, turning its camera space direction back into world space
+	SDL_memset(reached, 0, sizeof(bool) * (size_t)world->numsectors);
+	const float tany = SDL_tanf(FOVY * SDL_PI_F / 360.f), tanx = tany * ASPECT;
+	for (int y = 0; y < RAYS_Y; ++y)
+	{
+		for (int x = 0; x < RAYS_X; ++x)
+		{
+			const float cam[3] = {
+				((x + 0.5f) / RAYS_X * 2.f - 1.f) * tanx, ((y + 0.5f) / RAYS_Y * 2.f - 1.f) * tany, -1.f };
+			float dir[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				dir[k] = view[k * 4] * cam[0] + view[k * 4 + 1] * cam[1] + view[k * 4 + 2] * cam[2];
+			}
+			CastRay(world, eye, dir, room, reached);
+		}
+	}
+
+	int rays = 0, extra = 0;
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		if (reached[i])
+		{
+			++rays;
+			if (!SectorVisible(vis, i))
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_TEST, "Room %d heading %.0f: room %d hit by a ray but not visible",
+					room, heading, i);
+			}
+			CHECK(SectorVisible(vis, i));
+		}
+		else
+		{
+			extra += SectorVisible(vis, i);
+		}
+	}
+	CHECK(vis->numvisible >= rays);
+	tally->numrays += rays;
+	tally->mostrays = SDL_max(tally->mostrays, rays);
+	tally->numextra += extra;
+}
+
+int main(void)
+{
+	static bool doors[NUM_ROOMS][2];
+	CarveMaze(doors);
+	TEXT text = { NULL, 0, 0 };
+	if (!WriteMaze(&text, doors))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_TEST, "Failed to generate the maze: %s", SDL_GetError());
+		SDL_free(text.data);
+		return 1;
+	}
+
+	WORLD world;
+	MESH mesh;
+	MESHSTATS stats;
+	VISIBILITY vis;
+	const bool parsed = ParseWorld(&world, text.data, text.size);
+	SDL_free(text.data);
+	if (!parsed)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_TEST, "Failed to parse the maze: %s", SDL_GetError());
+		return 1;
+	}
+	if (!BuildMesh(&mesh, &world, &stats) || !InitVisibility(&vis, &world))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_TEST, "Failed to build the maze: %s", SDL_GetError());
+		FreeWorld(&world);
+		return 1;
+	}
+	CHECK(world.numsectors == NUM_ROOMS);
+	CHECK(world.numportals == NUM_ROOMS - 1);
+
+	SDL_memset(roomportals, -1, sizeof(roomportals));
+	for (int i = 0; i < world.numportals; ++i)
+	{
+		for (int j = 0; j < 2; ++j)
+		{
+			int *slot = roomportals[world.portals[i].sectors[j]];
+			while (*slot >= 0)
+			{
+				++slot;
+			}
+			*slot = i;
+		}
+	}
+
+	bool *reached = SDL_malloc(sizeof(bool) * (size_t)world.numsectors);
+	TALLY tally = { 0 };
+	for (int room = 0; room < NUM_ROOMS && reached; room += CAMERA_STEP)
+	{
+		for (int i = 0; i < NUM_HEADINGS; ++i)
+		{
+			TestCamera(&vis, &world, room, i * 360.f / NUM_HEADINGS, reached, &tally);
+		}
+	}
+	CHECK(reached != NULL);
+	CHECK(tally.numextra * 100 <= tally.numrays * MAX_EXTRA_PERCENT);
+	CHECK(tally.mostrays >= 4);  // Some camera has to look down a chain of doorways for the walk to be tested
+	const int cameras = SDL_max(tally.cameras, 1);
+	const double ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+	SDL_Log("%d cameras: %.2f rooms reached by rays on average and %d at most, portals reached %.2f more",
+		tally.cameras, (double)tally.numrays / cameras, tally.mostrays, (double)tally.numextra / cameras);
+	SDL_Log("Visible triangles %.0f on average & %u at most of %u, pass time %.3f ms on average & %.3f ms at worst",
+		(double)tally.numtriangles / cameras, (unsigned)tally.mosttriangles, (unsigned)(mesh.numindices / 3),
+		(double)tally.passticks * ms / cameras, (double)tally.worstticks * ms);
+
+	SDL_free(reached);
+	FreeVisibility(&vis);
+	FreeMesh(&mesh);
+	FreeWorld(&world);
+	return CheckResult("visibilitytest");
+}
@@ -0,0 +1,178 @@
+/*
+ *  worldtest - Check the compiled world loads exactly as the text world it came from
+ *  Usage: worldtest <World.txt> <World.wbin>
+ *
+ *  Parses & builds the mesh of the text world as the game does without a compiled
+ *  world, reads the compiled world as the game does with one, and compares the two
+ *  meshes byte for byte along with every table the game draws from.
+ */
+
+#include <SDL3/SDL.h>
+#include "../world.h"
+#include "../mesh.h"
+#include "check.h"
+
+static bool LoadText(const char *path, WORLD *world, MESH *mesh)
+{
+	size_t size;
+	char *text = SDL_LoadFile(path, &size);
+	if (!text)
+	{
+		return false;
+	}
+	const bool parsed = ParseWorld(world, text, size);
+	SDL_free(text);
+	if (!parsed)
+	{
+		return false;
+	}
+	MESHSTATS stats;
+	if (!BuildMesh(mesh, world, &stats))
+	{
+		FreeWorld(world);
+		return false;
+	}
+	return true;
+}
+
+static bool LoadBinary(const char *path, WORLD *world, MESH *mesh)
+{
+	SDL_IOStream *in = SDL_IOFromFile(path, "rb");
+	if (!in)
+	{
+		return false;
+	}
+	WORLDHEADER header;
+	bool loaded = ReadWorldBinary(in, &header, world);
+	if (loaded && !ReadWorldMesh(in, &header, mesh))
+	{
+		FreeWorld(world);
+		loaded = false;
+	}
+	SDL_CloseIO(in);
+	return loaded;
+}
+
+static void CompareWorlds(const WORLD *text, const MESH *textmesh, const WORLD *binary, const MESH *binarymesh)
+{
+	CHECK(textmesh->numvertices == binarymesh->numvertices);
+	CHECK(textmesh->numindices == binarymesh->numindices);
+	CHECK(textmesh->indexsize == binarymesh->indexsize);
+	if (textmesh->numvertices == binarymesh->numvertices && textmesh->numindices == binarymesh->numindices &&
+		textmesh->indexsize == binarymesh->indexsize)
+	{
+		const size_t size = sizeof(VERTEX) * textmesh->numvertices + (size_t)textmesh->indexsize * textmesh->numindices;
+		CHECK(SDL_memcmp(textmesh->vertices, binarymesh->vertices, size) == 0);
+	}
+
+	CHECK(text->numsectors == binary->numsectors);
+	for (int i = 0; i < SDL_min(text->numsectors, binary->numsectors); ++i)
+	{
+		const SECTOR *a = &text->sectors[i], *b = &binary->sectors[i];
+		CHECK(a->numtriangles == b->numtriangles);
+		CHECK(a->firstindex == b->firstindex && a->numindices == b->numindices);
+		CHECK(SDL_memcmp(a->mins, b->mins, sizeof(a->mins)) == 0 && SDL_memcmp(a->maxs, b->maxs, sizeof(a->maxs)) == 0);
+		CHECK(a->bvhroot == b->bvhroot);
+	}
+	CHECK(text->numportals == binary->numportals);
+	CHECK(text->numportals != binary->numportals ||
+		SDL_memcmp(text->portals, binary->portals, sizeof(PORTAL) * (size_t)text->numportals) == 0);
+	CHECK(text->numnodes == binary->numnodes);
+	CHECK(text->numnodes != binary->numnodes ||
+		SDL_memcmp(text->nodes, binary->nodes, sizeof(BVHNODE) * (size_t)text->numnodes) == 0);
+
+	CHECK(text->numprops == binary->numprops);
+	for (int i = 0; i < SDL_min(text->numprops, binary->numprops); ++i)
+	{
+		const PROP *a = &text->props[i], *b = &binary->props[i];
+		CHECK(a->numtriangles == b->numtriangles);
+		CHECK(a->firstindex == b->firstindex && a->numindices == b->numindices);
+		CHECK(a->firstinstance == b->firstinstance && a->numinstances == b->numinstances);
+	}
+	CHECK(text->numinstances == binary->numinstances);
+	CHECK(text->numinstances != binary->numinstances ||
+		SDL_memcmp(text->instances, binary->instances, sizeof(INSTANCE) * (size_t)text->numinstances) == 0);
+	CHECK(text->nummaterials == binary->nummaterials);
+	for (int i = 0; i < SDL_min(text->nummaterials, binary->nummaterials); ++i)
+	{
+		CHECK(SDL_strcmp(text->materials[i].image, binary->materials[i].image) == 0);
+	}
+}
+
+static void CheckCorruptIndex(const WORLD *world, MESH *mesh)
+{
+	// Point the last index one past the vertex array, the compiled mesh must then be refused
+	SDL_IOStream *io = SDL_IOFromDynamicMem();
+	if (!io || !mesh->numindices)
+	{
+		CHECK(io != NULL);
+		SDL_CloseIO(io);
+		return;
+	}
+	void *last = (Uint8 *)mesh->indices + (size_t)mesh->indexsize * (mesh->numindices - 1);
+	Uint32 saved = 0;
+	SDL_memcpy(&saved, last, mesh->indexsize);
+	if (mesh->indexsize == sizeof(Uint16))
+	{
+		*(Uint16 *)last = (Uint16)mesh->numvertices;
+	}
+	else
+	{
+		*(Uint32 *)last = mesh->numvertices;
+	}
+	const bool written = WriteWorldBinary(io, world, mesh);
+	SDL_memcpy(last, &saved, mesh->indexsize);
+	CHECK(written);
+
+	WORLD corrupt;
+	MESH corruptmesh;
+	WORLDHEADER header;
+	CHECK(SDL_SeekIO(io, 0, SDL_IO_SEEK_SET) == 0);
+	const bool loaded = ReadWorldBinary(io, &header, &corrupt);
+	CHECK(loaded);
+	if (loaded)
+	{
+		const bool meshloaded = ReadWorldMesh(io, &header, &corruptmesh);
+		CHECK(!meshloaded);
+		if (meshloaded)
+		{
+			FreeMesh(&corruptmesh);
+		}
+		FreeWorld(&corrupt);
+	}
+	SDL_CloseIO(io);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		SDL_Log("Usage: %s <World.txt> <World.wbin>", argc > 0 ? argv[0] : "worldtest");
+		return 1;
+	}
+
+	WORLD text, binary;
+	MESH textmesh, binarymesh;
+	if (!LoadText(argv[1], &text, &textmesh))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_TEST, "Failed to load \"%s\": %s", argv[1], SDL_GetError());
+		return 1;
+	}
+	if (!LoadBinary(argv[2], &binary, &binarymesh))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_TEST, "Failed to load \"%s\": %s", argv[2], SDL_GetError());
+		FreeMesh(&textmesh);
+		FreeWorld(&text);
+		return 1;
+	}
+	SDL_Log("Comparing %u vertices & %u indices in %d sectors", (unsigned)textmesh.numvertices,
+		(unsigned)textmesh.numindices, text.numsectors);
+	CompareWorlds(&text, &textmesh, &binary, &binarymesh);
+	CheckCorruptIndex(&text, &textmesh);
+
+	FreeMesh(&binarymesh);
+	FreeWorld(&binary);
+	FreeMesh(&textmesh);
+	FreeWorld(&text);
+	return CheckResult("worldtest");
+}
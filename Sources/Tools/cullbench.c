@@ -0,0 +1,132 @@
+/*
+ *  cullbench - Measure BVH frustum culling throughput on a synthetic scene
+ *  Usage: cullbench [triangles] [views]
+ *
+ *  Scatters small triangles over a square field, builds the world mesh & BVH as the
+ *  game does, then culls the field from random camera positions with the game's
+ *  projection and reports nodes tested per microsecond.
+ */
+
+#include <SDL3/SDL.h>
+#include "../world.h"
+#include "../mesh.h"
+#include "../bvh.h"
+
+#define FIELD_DENSITY 1.f   // Triangles per square unit of the field
+#define FIELD_HEIGHT  4.f
+
+static bool MakeField(WORLD *world, int numtriangles, Uint64 *seed)
+{
+	SDL_zerop(world);
+	world->sectors = SDL_calloc(1, sizeof(SECTOR));
+	world->triangles = SDL_malloc(sizeof(TRIANGLE) * (size_t)numtriangles);
+	if (!world->sectors || !world->triangles)
+	{
+		FreeWorld(world);
+		return false;
+	}
+	world->numsectors = 1;
+	world->numtriangles = world->sectors->numtriangles = numtriangles;
+	world->sectors->triangle = world->triangles;
+	world->sectors->bvhroot = -1;
+
+	const float side = SDL_sqrtf((float)numtriangles / FIELD_DENSITY);
+	for (int i = 0; i < numtriangles; ++i)
+	{
+		const float x = SDL_randf_r(seed) * side, y = SDL_randf_r(seed) * FIELD_HEIGHT;
+		const float z = SDL_randf_r(seed) * side;
+		for (int k = 0; k < 3; ++k)
+		{
+			world->triangles[i].vertex[k] = (VERTEX)
+			{
+				.x = x + SDL_randf_r(seed) - 0.5f,
+				.y = y + SDL_randf_r(seed) - 0.5f,
+				.z = z + SDL_randf_r(seed) - 0.5f,
+				.u = SDL_randf_r(seed),
+				.v = SDL_randf_r(seed)
+			};
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	const int numtriangles = argc > 1 ? SDL_atoi(argv[1]) : 1000000;
+	const int numviews = argc > 2 ? SDL_atoi(argv[2]) : 1000;
+	if (numtriangles <= 0 || numviews <= 0)
+	{
+		SDL_Log("Usage: %s [triangles] [views]", argc > 0 ? argv[0] : "cullbench");
+		return 1;
+	}
+
+	Uint64 seed = 10;
+	WORLD world;
+	MESH mesh;
+	if (!MakeField(&world, numtriangles, &seed))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to generate scene: %s", SDL_GetError());
+		return 1;
+	}
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (!BuildMesh(&mesh, &world, NULL))
+	{
+		FreeWorld(&world);
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build mesh: %s", SDL_GetError());
+		return 1;
+	}
+	const double buildms = (double)(SDL_GetPerformanceCounter() - start) * 1e3 / (double)SDL_GetPerformanceFrequency();
+	FreeMesh(&mesh);
+
+	int numleaves = 0;
+	for (int i = 0; i < world.numnodes; ++i)
+	{
+		for (int j = 0; j < BVH_WIDTH; ++j)
+		{
+			numleaves += world.nodes[i].child[j] == BVH_LEAF;
+		}
+	}
+	SDL_Log("%d triangles, %d nodes, %d leaves, built in %.1f ms", numtriangles, world.numnodes, numleaves, buildms);
+
+	DRAWRANGE *ranges = SDL_malloc(sizeof(DRAWRANGE) * ((size_t)numleaves + 1));
+	if (!ranges)
+	{
+		FreeWorld(&world);
+		return 1;
+	}
+	mat4f proj;
+	MakePerspective(proj, 45.0f, 16.f / 9.f, 0.1f, 100.0f);
+	const float side = SDL_sqrtf((float)numtriangles / FIELD_DENSITY);
+
+	Uint64 nodes = 0, triangles = 0, draws = 0, ticks = 0;
+	for (int i = 0; i < numviews; ++i)
+	{
+		mat4f view = M4_IDENTITY, viewproj;
+		Rotate(view, SDL_randf_r(&seed) * 30.f - 15.f, 1.f, 0.f, 0.f);
+		Rotate(view, SDL_randf_r(&seed) * 360.f, 0.f, 1.f, 0.f);
+		Translate(view, -SDL_randf_r(&seed) * side, -FIELD_HEIGHT * 0.5f, -SDL_randf_r(&seed) * side);
+		MulMatrices(viewproj, proj, view);
+
+		FRUSTUM frustum;
+		int numranges = 0;
+		start = SDL_GetPerformanceCounter();
+		MakeFrustum(&frustum, viewproj, NULL);
+		nodes += CullSector(&world, &world.sectors[0], &frustum, ranges, &numranges);
+		ticks += SDL_GetPerformanceCounter() - start;
+
+		draws += (Uint64)numranges;
+		for (int j = 0; j < numranges; ++j)
+		{
+			triangles += ranges[j].numindices / 3;
+		}
+	}
+
+	const double us = (double)ticks * 1e6 / (double)SDL_GetPerformanceFrequency();
+	SDL_Log("%d views: %.1f us per cull, %.1f nodes per us, %.0f nodes, %.0f triangles in %.1f draws per view",
+		numviews, us / numviews, (double)nodes / us, (double)nodes / numviews,
+		(double)triangles / numviews, (double)draws / numviews);
+
+	SDL_free(ranges);
+	FreeWorld(&world);
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ *  drawbench - Measure how preparing draws scales across worker threads
+ *  Usage: drawbench [ranges] [iterations] [percent-with-matrix]
+ *
+ *  Builds a synthetic scene of draw ranges spread over a handful of binding states,
+ *  some of them carrying their own model matrix that is multiplied by the view &
+ *  projection as the game does for props drawn one placement at a time, then builds
+ *  & merges its draws with 1 to N threads. Every thread count must produce exactly
+ *  the batches the single threaded build does.
+ */
+
+#include <SDL3/SDL.h>
+#include "../drawlist.h"
+
+#define SCENE_STATES   8    // Binding states the ranges are spread over
+#define SCENE_CONTIGUOUS 2  // One in this many ranges continues the previous range's indices
+
+typedef struct tagSCENERANGE
+{
+	Uint32 state, firstindex, numindices;
+	int matrix;               // Index into the scene's model matrices, -1 for none
+} SCENERANGE;
+
+typedef struct tagSCENE
+{
+	int numranges;
+	SCENERANGE *ranges;
+	mat4f *models;
+	mat4f viewproj;
+} SCENE;
+
+static void BuildDraws(void *data, int first, int end, DRAWLIST *list)
+{
+	const SCENE *scene = data;
+	for (int i = first; i < end; ++i)
+	{
+		const SCENERANGE *range = &scene->ranges[i];
+		if (range->matrix >= 0)
+		{
+			mat4f mvp;
+			MulMatrices(mvp, scene->viewproj, scene->models[range->matrix]);
+			AddDraw(list, DRAWKEY(range->state, range->firstindex), range->firstindex, range->numindices, 0, 1, mvp);
+		}
+		else
+		{
+			AddDraw(list, DRAWKEY(range->state, range->firstindex), range->firstindex, range->numindices, 0, 1, NULL);
+		}
+	}
+}
+
+static bool MakeScene(SCENE *scene, int numranges, int matrixpercent, Uint64 *seed)
+{
+	SDL_zerop(scene);
+	scene->ranges = SDL_malloc(sizeof(SCENERANGE) * (size_t)numranges);
+	scene->models = SDL_malloc(sizeof(mat4f) * (size_t)numranges);
+	if (!scene->ranges || !scene->models)
+	{
+		return false;
+	}
+	scene->numranges = numranges;
+	MakePerspective(scene->viewproj, 45.0f, 16.f / 9.f, 0.1f, 100.0f);
+
+	Uint32 index = 0;
+	for (int i = 0; i < numranges; ++i)
+	{
+		SCENERANGE *range = &scene->ranges[i];
+		range->numindices = 3 * (1 + SDL_rand_r(seed, 64));
+		if (SDL_rand_r(seed, SCENE_CONTIGUOUS) != 0)
+		{
+			index += 3 * (Uint32)SDL_rand_r(seed, 256);
+		}
+		range->firstindex = index;
+		range->state = (Uint32)SDL_rand_r(seed, SCENE_STATES);
+		index += range->numindices;
+
+		range->matrix = SDL_rand_r(seed, 100) < matrixpercent ? i : -1;
+		mat4f model = M4_IDENTITY;
+		Rotate(model, SDL_randf_r(seed) * 360.f, 0.f, 1.f, 0.f);
+		Translate(model, SDL_randf_r(seed) * 100.f, 0.f, SDL_randf_r(seed) * 100.f);
+		SDL_memcpy(scene->models[i], model, sizeof(mat4f));
+	}
+
+	// Ranges come in no particular order, as a scene traversal would produce them
+	for (int i = numranges - 1; i > 0; --i)
+	{
+		const int j = SDL_rand_r(seed, i + 1);
+		const SCENERANGE swap = scene->ranges[i];
+		scene->ranges[i] = scene->ranges[j];
+		scene->ranges[j] = swap;
+	}
+	return true;
+}
+
+static void FreeScene(SCENE *scene)
+{
+	SDL_free(scene->models);
+	SDL_free(scene->ranges);
+	SDL_zerop(scene);
+}
+
+static bool SameBatches(const DRAWBUILDER *a, const DRAWBUILDER *b)
+{
+	if (a->numbatches != b->numbatches || a->numstates != b->numstates)
+	{
+		return false;
+	}
+	for (int i = 0; i < a->numbatches; ++i)
+	{
+		const DRAWBATCH *x = &a->batches[i], *y = &b->batches[i];
+		if (x->state != y->state || x->firstindex != y->firstindex || x->numindices != y->numindices ||
+			x->firstinstance != y->firstinstance || x->numinstances != y->numinstances ||
+			!x->uniform != !y->uniform || (x->uniform && SDL_memcmp(x->uniform, y->uniform, sizeof(mat4f)) != 0))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	const int numranges = argc > 1 ? SDL_atoi(argv[1]) : 100000;
+	const int iterations = argc > 2 ? SDL_atoi(argv[2]) : 100;
+	const int matrixpercent = argc > 3 ? SDL_atoi(argv[3]) : 25;
+	if (numranges <= 0 || iterations <= 0 || matrixpercent < 0 || matrixpercent > 100)
+	{
+		SDL_Log("Usage: %s [ranges] [iterations] [percent-with-matrix]", argc > 0 ? argv[0] : "drawbench");
+		return 1;
+	}
+
+	Uint64 seed = 15;
+	SCENE scene;
+	DRAWBUILDER reference = { 0 }, builder = { 0 };
+	if (!MakeScene(&scene, numranges, matrixpercent, &seed) ||
+		!BuildDrawBatches(&reference, NULL, scene.numranges, BuildDraws, &scene))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build scene: %s", SDL_GetError());
+		FreeScene(&scene);
+		return 1;
+	}
+	SDL_Log("%d ranges, %d%% with a matrix: %d batches, %d state changes", numranges, matrixpercent,
+		reference.numbatches, reference.numstates);
+
+	const int maxthreads = SDL_clamp(SDL_GetNumLogicalCPUCores(), 1, JOBS_MAX_THREADS + 1);
+	double singlems = 0.0;
+	bool same = true;
+	for (int numthreads = 1; numthreads <= maxthreads; ++numthreads)
+	{
+		// The calling thread builds a chunk too, so N threads is N - 1 workers
+		JOBQUEUE jobs;
+		const bool useworkers = numthreads > 1;
+		if (useworkers && !InitJobQueue(&jobs, numthreads - 1))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to start workers: %s", SDL_GetError());
+			break;
+		}
+		if (useworkers && jobs.numthreads != numthreads - 1)
+		{
+			FreeJobQueue(&jobs);
+			break;
+		}
+
+		BuildDrawBatches(&builder, useworkers ? &jobs : NULL, scene.numranges, BuildDraws, &scene);  // Warm up
+		Uint64 best = SDL_MAX_UINT64, total = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			const Uint64 start = SDL_GetPerformanceCounter();
+			BuildDrawBatches(&builder, useworkers ? &jobs : NULL, scene.numranges, BuildDraws, &scene);
+			const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+			best = SDL_min(best, ticks);
+			total += ticks;
+		}
+		if (useworkers)
+		{
+			FreeJobQueue(&jobs);
+		}
+
+		const bool matches = SameBatches(&reference, &builder);
+		same = same && matches;
+		const double toms = 1e3 / (double)SDL_GetPerformanceFrequency();
+		const double meanms = (double)total * toms / iterations;
+		if (numthreads == 1)
+		{
+			singlems = meanms;
+		}
+		SDL_Log("%2d threads: %7.3f ms mean, %7.3f ms best, %5.2fx, %d lists%s", numthreads, meanms,
+			(double)best * toms, singlems / meanms, builder.numlists, matches ? "" : ", BATCHES DIFFER");
+	}
+
+	FreeDrawBuilder(&builder);
+	FreeDrawBuilder(&reference);
+	FreeScene(&scene);
+	if (!same)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Threaded builds differ from the single threaded build");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ *  loadbench - Time loading a text world against the original lesson's loader
+ *  Usage: loadbench <World.txt> [runs]
+ *
+ *  The original loader read the file a byte at a time with SDL_ReadS8 and parsed
+ *  every line with SDL_sscanf. It's kept here as it was, reading a single sector, so
+ *  give it a world from Scripts/generate-world.py without --sectors or props. Both
+ *  loaders run the given number of times, the fastest run of each is reported, and
+ *  their triangles must match.
+ */
+
+#include <SDL3/SDL.h>
+#include "../world.h"
+
+// Original loader, a line at a time skipping comments & blank lines
+static char *fgetsIO(char *restrict s, int n, SDL_IOStream *restrict f)
+{
+	char *p = s;
+	for (--n; n > 0; --n)
+	{
+		Sint8 c;
+		if (!SDL_ReadS8(f, &c))
+		{
+			break;
+		}
+		if (((*p++) = c) == '\n')
+		{
+			break;
+		}
+	}
+	(*p) = '\0';
+	return p != s ? s : NULL;
+}
+
+static void readstr(SDL_IOStream *restrict f, char *restrict string)
+{
+	do
+	{
+		fgetsIO(string, 255, f);
+	} while (string[0] == '/' || string[0] == '\n');
+}
+
+static bool LoadPerLine(const char *path, SECTOR *sector)
+{
+	float x, y, z, u, v;
+	int numtriangles = 0;
+	char oneline[255];
+	SDL_IOStream *filein = SDL_IOFromFile(path, "r");
+	if (!filein)
+	{
+		return false;
+	}
+
+	readstr(filein, oneline);
+	SDL_sscanf(oneline, "NUMPOLLIES %d\n", &numtriangles);
+
+	sector->triangle = SDL_malloc(sizeof(TRIANGLE) * (size_t)SDL_max(numtriangles, 1));
+	sector->numtriangles = numtriangles;
+	if (!sector->triangle)
+	{
+		SDL_CloseIO(filein);
+		return false;
+	}
+	for (int loop = 0; loop < numtriangles; loop++)
+	{
+		for (int vert = 0; vert < 3; vert++)
+		{
+			readstr(filein, oneline);
+			SDL_sscanf(oneline, "%f %f %f %f %f", &x, &y, &z, &u, &v);
+			sector->triangle[loop].vertex[vert] = (VERTEX){ .x = x, .y = y, .z = z, .u = u, .v = v };
+		}
+	}
+	SDL_CloseIO(filein);
+	return true;
+}
+
+// Current loader, the whole file read at once and tokenized in place
+static bool LoadWhole(const char *path, WORLD *world)
+{
+	size_t size;
+	char *text = SDL_LoadFile(path, &size);
+	if (!text)
+	{
+		return false;
+	}
+	const bool parsed = ParseWorld(world, text, size);
+	SDL_free(text);
+	return parsed;
+}
+
+static bool SameTriangles(const SECTOR *a, const SECTOR *b)
+{
+	if (a->numtriangles != b->numtriangles)
+	{
+		return false;
+	}
+	for (int i = 0; i < a->numtriangles; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			const VERTEX *va = &a->triangle[i].vertex[j], *vb = &b->triangle[i].vertex[j];
+			if (va->x != vb->x || va->y != vb->y || va->z != vb->z || va->u != vb->u || va->v != vb->v)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static double Seconds(Uint64 start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char *argv[])
+{
+	const int runs = argc > 2 ? SDL_atoi(argv[2]) : 3;
+	if (argc < 2 || argc > 3 || runs <= 0)
+	{
+		SDL_Log("Usage: %s <World.txt> [runs]", argc > 0 ? argv[0] : "loadbench");
+		return 1;
+	}
+
+	double perline = SDL_MAX_SINT32, whole = SDL_MAX_SINT32;
+	bool same = true;
+	for (int i = 0; i < runs; ++i)
+	{
+		SECTOR old = { 0 };
+		Uint64 start = SDL_GetPerformanceCounter();
+		if (!LoadPerLine(argv[1], &old))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Per-line loader failed: %s", SDL_GetError());
+			return 1;
+		}
+		perline = SDL_min(perline, Seconds(start));
+
+		WORLD world;
+		start = SDL_GetPerformanceCounter();
+		if (!LoadWhole(argv[1], &world))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ParseWorld failed: %s", SDL_GetError());
+			SDL_free(old.triangle);
+			return 1;
+		}
+		whole = SDL_min(whole, Seconds(start));
+
+		same = same && world.numsectors == 1 && SameTriangles(&old, &world.sectors[0]);
+		if (i == 0)
+		{
+			SDL_Log("%d triangles, %d sectors", old.numtriangles, world.numsectors);
+		}
+		FreeWorld(&world);
+		SDL_free(old.triangle);
+	}
+	if (!same)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Loaders disagree, is the world a single sector?");
+		return 1;
+	}
+	SDL_Log("Per-line SDL_ReadS8 + SDL_sscanf %9.2f ms", perline * 1e3);
+	SDL_Log("Single read + ParseWorld         %9.2f ms (%.1fx)", whole * 1e3, perline / whole);
+	return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ *  matrix_bench - Time the matrix functions against their scalar reference versions
+ *  Usage: matrix_bench [calls]
+ *
+ *  Each function is timed against its scalar version on random inputs, and the batch
+ *  functions against a loop of single matrix calls for 1k, 10k and 100k matrices.
+ *  matrixtest checks the results agree, run it with ctest.
+ */
+
+#include <SDL3/SDL.h>
+#include "../matrix.h"
+
+#define NUM_MATRICES    1024  // Working set cycled through by the timed loops
+
+typedef struct tagINPUT
+{
+	mat4f lhs[NUM_MATRICES], rhs[NUM_MATRICES], out[NUM_MATRICES];
+	float angle[NUM_MATRICES], axis[NUM_MATRICES][3];
+} INPUT;
+
+static float RandomRange(Uint64 *seed, float lo, float hi)
+{
+	return lo + SDL_randf_r(seed) * (hi - lo);
+}
+
+static void RandomMatrix(mat4f m, Uint64 *seed)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		m[i] = RandomRange(seed, -10.f, 10.f);
+	}
+}
+
+static double Seconds(Uint64 start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+// Transform count model matrices as props would each frame, one matrix at a time and in batches
+static bool BenchBatch(int count, int calls, const mat4f viewproj, Uint64 *seed)
+{
+	const int repeats = SDL_max(calls / count, 1);
+	mat4f *models = SDL_malloc(sizeof(mat4f) * (size_t)count * 2);
+	MAT4BLOCK *blocks = SDL_malloc(sizeof(MAT4BLOCK) * MAT4_BLOCKS((size_t)count) * 2);
+	float *params = SDL_malloc(sizeof(float) * (size_t)count * 4);
+	if (!models || !blocks || !params)
+	{
+		SDL_free(params);
+		SDL_free(blocks);
+		SDL_free(models);
+		return false;
+	}
+	mat4f *out = models + count;
+	MAT4BLOCK *outblocks = blocks + MAT4_BLOCKS((size_t)count);
+	float *angles = params, *x = params + count, *y = x + count, *z = y + count;
+	for (int i = 0; i < count; ++i)
+	{
+		RandomMatrix(models[i], seed);
+		angles[i] = RandomRange(seed, -1.f, 1.f);
+		x[i] = RandomRange(seed, -0.1f, 0.1f);
+		y[i] = RandomRange(seed, -0.1f, 0.1f);
+		z[i] = RandomRange(seed, -0.1f, 0.1f);
+	}
+	PackMatrices(blocks, (const mat4f *)models, (size_t)count);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int r = 0; r < repeats; ++r)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			MulMatrices(out[i], viewproj, models[i]);
+		}
+	}
+	const double mulsingle = Seconds(start);
+	start = SDL_GetPerformanceCounter();
+	for (int r = 0; r < repeats; ++r)
+	{
+		MulMatricesBatch(outblocks, viewproj, blocks, (size_t)count);
+	}
+	const double mulbatch = Seconds(start);
+
+	start = SDL_GetPerformanceCounter();
+	for (int r = 0; r < repeats; ++r)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			Rotate(models[i], angles[i], 0.f, 1.f, 0.f);
+			Translate(models[i], x[i], y[i], z[i]);
+		}
+	}
+	const double movesingle = Seconds(start);
+	start = SDL_GetPerformanceCounter();
+	for (int r = 0; r < repeats; ++r)
+	{
+		RotateBatch(blocks, (size_t)count, angles, 0.f, 1.f, 0.f);
+		TranslateBatch(blocks, (size_t)count, x, y, z);
+	}
+	const double movebatch = Seconds(start);
+
+	const double total = (double)repeats * count * 1e-6;
+	SDL_Log("%6d matrices: viewproj * model %7.1f M/s single, %7.1f M/s batch (%.2fx); "
+		"rotate + translate %6.1f M/s single, %6.1f M/s batch (%.2fx)", count,
+		total / mulsingle, total / mulbatch, mulsingle / mulbatch,
+		total / movesingle, total / movebatch, movesingle / movebatch);
+
+	SDL_free(params);
+	SDL_free(blocks);
+	SDL_free(models);
+	return true;
+}
+
+static void Report(const char *name, int calls, double simd, double scalar)
+{
+	SDL_Log("%-9s %6.2f ns/call (%7.1f M/s), scalar %6.2f ns/call (%7.1f M/s), %.2fx",
+		name, simd * 1e9 / calls, calls / simd * 1e-6, scalar * 1e9 / calls, calls / scalar * 1e-6, scalar / simd);
+}
+
+int main(int argc, char *argv[])
+{
+	const int calls = argc > 1 ? SDL_atoi(argv[1]) : 10000000;
+	if (calls <= 0)
+	{
+		SDL_Log("Usage: %s [calls]", argc > 0 ? argv[0] : "matrix_bench");
+		return 1;
+	}
+
+	INPUT *in = SDL_malloc(sizeof(INPUT));
+	if (!in)
+	{
+		return 1;
+	}
+	Uint64 seed = 10;
+	for (int i = 0; i < NUM_MATRICES; ++i)
+	{
+		RandomMatrix(in->lhs[i], &seed);
+		RandomMatrix(in->rhs[i], &seed);
+		in->angle[i] = RandomRange(&seed, -360.f, 360.f);
+		for (int k = 0; k < 3; ++k)
+		{
+			in->axis[i][k] = RandomRange(&seed, -1.f, 1.f);
+		}
+	}
+
+	double simd, scalar;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < calls; ++i)
+	{
+		const int j = i & (NUM_MATRICES - 1);
+		MulMatrices(in->out[j], in->lhs[j], in->rhs[(j * 7) & (NUM_MATRICES - 1)]);
+	}
+	simd = Seconds(start);
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < calls; ++i)
+	{
+		const int j = i & (NUM_MATRICES - 1);
+		MulMatricesScalar(in->out[j], in->lhs[j], in->rhs[(j * 7) & (NUM_MATRICES - 1)]);
+	}
+	scalar = Seconds(start);
+	Report("Multiply", calls, simd, scalar);
+
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < calls; ++i)
+	{
+		const int j = i & (NUM_MATRICES - 1);
+		Rotate(in->out[j], in->angle[j], in->axis[j][0], in->axis[j][1], in->axis[j][2]);
+	}
+	simd = Seconds(start);
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < calls; ++i)
+	{
+		const int j = i & (NUM_MATRICES - 1);
+		RotateScalar(in->out[j], in->angle[j], in->axis[j][0], in->axis[j][1], in->axis[j][2]);
+	}
+	scalar = Seconds(start);
+	Report("Rotate", calls, simd, scalar);
+
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < calls; ++i)
+	{
+		const int j = i & (NUM_MATRICES - 1);
+		Translate(in->out[j], in->axis[j][0], in->axis[j][1], in->axis[j][2]);
+	}
+	simd = Seconds(start);
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < calls; ++i)
+	{
+		const int j = i & (NUM_MATRICES - 1);
+		TranslateScalar(in->out[j], in->axis[j][0], in->axis[j][1], in->axis[j][2]);
+	}
+	scalar = Seconds(start);
+	Report("Translate", calls, simd, scalar);
+
+	static const int batchsizes[] = { 1000, 10000, 100000 };
+	for (int i = 0; i < (int)SDL_arraysize(batchsizes); ++i)
+	{
+		if (!BenchBatch(batchsizes[i], calls, in->lhs[0], &seed))
+		{
+			SDL_free(in);
+			return 1;
+		}
+	}
+
+	SDL_free(in);
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ *  meshpack - Report the quantization error of packing each level's world mesh vertices
+ *  Usage: meshpack <World.txt|World.wbin>...
+ *
+ *  Packs every level's mesh the way --packed-vertices does at load time and logs the
+ *  boxes used, the lattice step and the largest position & texcoord error against the
+ *  float vertices. Text worlds are built into a mesh first, compiled worlds are packed
+ *  as stored. Fails when any level can't be read or packed.
+ */
+
+#include <SDL3/SDL.h>
+#include "../world.h"
+#include "../mesh.h"
+
+// Read a compiled world's tables and mesh, the mesh is released with FreeMesh
+static bool ReadCompiledLevel(const char *path, WORLD *world, MESH *mesh)
+{
+	SDL_IOStream *in = SDL_IOFromFile(path, "rb");
+	WORLDHEADER header;
+	if (!in || !ReadWorldBinary(in, &header, world))
+	{
+		SDL_CloseIO(in);
+		return false;
+	}
+	const size_t vertexbytes = sizeof(VERTEX) * header.numvertices;
+	const size_t datasize = vertexbytes + (size_t)header.indexsize * header.numindices;
+	VERTEX *vertices = SDL_malloc(datasize);
+	const bool read = vertices && SDL_ReadIO(in, vertices, datasize) == datasize;
+	SDL_CloseIO(in);
+	if (!read)
+	{
+		SDL_free(vertices);
+		FreeWorld(world);
+		return vertices ? SDL_SetError("Mesh data truncated") : false;
+	}
+	*mesh = (MESH)
+	{
+		.numvertices = header.numvertices,
+		.numindices = header.numindices,
+		.indexsize = header.indexsize,
+		.vertices = vertices,
+		.indices = (Uint8 *)vertices + vertexbytes
+	};
+	return true;
+}
+
+// Parse a text world and build its mesh the way the game does without a compiled world
+static bool BuildTextLevel(const char *path, WORLD *world, MESH *mesh)
+{
+	size_t textsize;
+	char *text = SDL_LoadFile(path, &textsize);
+	if (!text)
+	{
+		return false;
+	}
+	const bool parsed = ParseWorld(world, text, textsize);
+	SDL_free(text);
+	if (!parsed)
+	{
+		return false;
+	}
+	if (!BuildMesh(mesh, world, NULL))
+	{
+		FreeWorld(world);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		SDL_Log("Usage: %s <World.txt|World.wbin>...", argc > 0 ? argv[0] : "meshpack");
+		return 1;
+	}
+
+	int failed = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *path = argv[i];
+		const size_t length = SDL_strlen(path);
+		const bool compiled = length >= 5 && SDL_strcasecmp(path + length - 5, ".wbin") == 0;
+		WORLD world;
+		MESH mesh;
+		if (!(compiled ? ReadCompiledLevel(path, &world, &mesh) : BuildTextLevel(path, &world, &mesh)))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load \"%s\": %s", path, SDL_GetError());
+			++failed;
+			continue;
+		}
+
+		PACKEDVERTEX *packed = SDL_malloc(sizeof(PACKEDVERTEX) * (mesh.numvertices > 0 ? mesh.numvertices : 1));
+		PACKBOX boxes[MESH_PACK_BOXES];
+		PACKSTATS stats;
+		if (packed && PackMeshVertices(packed, boxes, &mesh, &world, &stats))
+		{
+			LogPackStats(path, &stats);
+		}
+		else
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to pack \"%s\": %s", path, SDL_GetError());
+			++failed;
+		}
+		SDL_free(packed);
+		FreeMesh(&mesh);
+		FreeWorld(&world);
+	}
+	return failed > 0 ? 1 : 0;
+}
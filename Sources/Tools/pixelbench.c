@@ -0,0 +1,178 @@
+/*
+ *  pixelbench - Measure texture loading's pixel conversion & mip generation throughput
+ *  Usage: pixelbench [size] [iterations]
+ *
+ *  Converts a synthetic size x size BGR24 image, the format SDL_LoadBMP gives for the
+ *  game's textures, to flipped RGBA the way the loader used to: flip the surface in
+ *  place, convert into a temporary buffer, then copy that into the upload buffer. The
+ *  fused conversion writing straight into the upload buffer is then timed with 1 to N
+ *  threads, followed by the whole mip chain generated on the CPU against its scalar
+ *  reference. Every thread count must give exactly the reference's pixels.
+ *
+ *  It runs without a GPU, so the "upload buffer" is heap memory, not a mapped
+ *  transfer buffer. That matches how the loader filters mips, in cached scratch
+ *  buffers, but the times leave out copying into write-combined memory.
+ */
+
+#include <SDL3/SDL.h>
+#include "../pixels.h"
+
+// Pseudo random texels, smooth enough for the mips to differ from plain noise
+static SDL_Surface * MakeImage(int size)
+{
+	SDL_Surface *image = SDL_CreateSurface(size, size, SDL_PIXELFORMAT_BGR24);
+	if (!image)
+	{
+		return NULL;
+	}
+	Uint64 seed = 19;
+	for (int y = 0; y < size; ++y)
+	{
+		Uint8 *row = (Uint8 *)image->pixels + (size_t)image->pitch * y;
+		for (int x = 0; x < 3 * size; ++x)
+		{
+			row[x] = (Uint8)((x ^ y) + SDL_rand_r(&seed, 32));
+		}
+	}
+	return image;
+}
+
+// Bytes of every level of a size x size RGBA8 image
+static size_t MipChainSize(int size)
+{
+	size_t bytes = 0;
+	for (int level = size; level > 0; level /= 2)
+	{
+		bytes += 4 * (size_t)level * (size_t)level;
+	}
+	return bytes;
+}
+
+static bool MakeMipChain(JOBQUEUE *jobs, bool simd, Uint8 *chain, int size)
+{
+	for (int level = size; level > 1; level /= 2)
+	{
+		Uint8 *next = chain + 4 * (size_t)level * (size_t)level;
+		if (!(simd ? DownsampleRGBA(jobs, next, chain, level, level) : DownsampleRGBAScalar(next, chain, level, level)))
+		{
+			return false;
+		}
+		chain = next;
+	}
+	return true;
+}
+
+// The loader before fusing: flip in place, convert to a temporary buffer & copy that to the upload buffer
+static bool ConvertSeparately(SDL_Surface *image, Uint8 *upload)
+{
+	const size_t size = 4 * (size_t)image->w * (size_t)image->h;
+	void *converted = SDL_malloc(size);
+	const bool done = converted && SDL_FlipSurface(image, SDL_FLIP_VERTICAL) &&
+		SDL_ConvertPixels(image->w, image->h, image->format, image->pixels, image->pitch,
+			SDL_PIXELFORMAT_ABGR8888, converted, 4 * image->w);
+	if (done)
+	{
+		SDL_memcpy(upload, converted, size);
+	}
+	SDL_free(converted);
+	return done;
+}
+
+static double Milliseconds(Uint64 ticks)
+{
+	return (double)ticks * 1e3 / (double)SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char *argv[])
+{
+	const int size = argc > 1 ? SDL_atoi(argv[1]) : 8192;
+	const int iterations = argc > 2 ? SDL_atoi(argv[2]) : 5;
+	if (size <= 0 || size > 16384 || iterations <= 0)
+	{
+		SDL_Log("Usage: %s [size] [iterations]", argc > 0 ? argv[0] : "pixelbench");
+		return 1;
+	}
+
+	const size_t chainsize = MipChainSize(size);
+	SDL_Surface *image = MakeImage(size);
+	Uint8 *reference = SDL_malloc(chainsize), *upload = SDL_malloc(chainsize);
+	if (!image || !reference || !upload)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate a %dx%d image", size, size);
+		SDL_DestroySurface(image);
+		SDL_free(reference);
+		SDL_free(upload);
+		return 1;
+	}
+	const double megapixels = (double)size * size / 1e6;
+	SDL_Log("Timing against heap memory, copies into a mapped transfer buffer aren't included");
+
+	// The separate passes give the reference level 0, the surface is flipped back after every run
+	bool same = ConvertSeparately(image, reference) && SDL_FlipSurface(image, SDL_FLIP_VERTICAL);
+	Uint64 best = SDL_MAX_UINT64;
+	for (int i = 0; same && i < iterations; ++i)
+	{
+		const Uint64 start = SDL_GetPerformanceCounter();
+		same = ConvertSeparately(image, upload);
+		best = SDL_min(best, SDL_GetPerformanceCounter() - start);
+		SDL_FlipSurface(image, SDL_FLIP_VERTICAL);
+	}
+	const double separatems = Milliseconds(best);
+	SDL_Log("%dx%d BGR24, separate flip, convert & copy: %8.2f ms best, %7.1f MPixels/s", size, size,
+		separatems, megapixels / separatems * 1e3);
+
+	const Uint64 scalarstart = SDL_GetPerformanceCounter();
+	same = same && MakeMipChain(NULL, false, reference, size);
+	const double scalarms = Milliseconds(SDL_GetPerformanceCounter() - scalarstart);
+	SDL_Log("Scalar mip chain: %8.2f ms", scalarms);
+
+	const int maxthreads = SDL_clamp(SDL_GetNumLogicalCPUCores(), 1, JOBS_MAX_THREADS + 1);
+	for (int numthreads = 1; same && numthreads <= maxthreads; ++numthreads)
+	{
+		// The calling thread converts a band too, so N threads is N - 1 workers
+		JOBQUEUE jobs;
+		const bool useworkers = numthreads > 1;
+		if (useworkers && !InitJobQueue(&jobs, numthreads - 1))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to start workers: %s", SDL_GetError());
+			break;
+		}
+		if (useworkers && jobs.numthreads != numthreads - 1)
+		{
+			FreeJobQueue(&jobs);
+			break;
+		}
+		Uint64 convert = SDL_MAX_UINT64, mips = SDL_MAX_UINT64;
+		for (int i = 0; same && i < iterations; ++i)
+		{
+			SDL_memset(upload, 0, chainsize);
+			const Uint64 start = SDL_GetPerformanceCounter();
+			same = ConvertImageRGBA(useworkers ? &jobs : NULL, upload, image, true);
+			const Uint64 converted = SDL_GetPerformanceCounter();
+			same = same && MakeMipChain(useworkers ? &jobs : NULL, true, upload, size);
+			const Uint64 end = SDL_GetPerformanceCounter();
+			convert = SDL_min(convert, converted - start);
+			mips = SDL_min(mips, end - converted);
+		}
+		if (useworkers)
+		{
+			FreeJobQueue(&jobs);
+		}
+
+		const bool matches = same && SDL_memcmp(upload, reference, chainsize) == 0;
+		same = matches;
+		SDL_Log("%2d threads: fused convert %7.2f ms %5.2fx, SIMD mips %7.2f ms %5.2fx%s", numthreads,
+			Milliseconds(convert), separatems / Milliseconds(convert), Milliseconds(mips),
+			scalarms / Milliseconds(mips), matches ? "" : ", PIXELS DIFFER");
+	}
+
+	SDL_DestroySurface(image);
+	SDL_free(reference);
+	SDL_free(upload);
+	if (!same)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Converted or filtered pixels differ from the reference");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ *  sortbench - Measure sorting translucent triangles back to front as the camera moves
+ *  Usage: sortbench [triangles] [frames]
+ *
+ *  Scatters triangles over a grid of cells, one index range per cell, then walks a
+ *  camera through it the way the game does: straight ahead, turning, then standing
+ *  still. Each frame the cells in front of the camera are sorted incrementally from
+ *  the last frame's order, and with an exact radix sort of every visible triangle
+ *  for comparison. Every frame's order must hold each visible triangle once with
+ *  each cluster's together, and how far triangles are drawn behind nearer ones,
+ *  within a cluster & overall, is reported. Clusters are only ordered by their
+ *  centers, so the overall figure doesn't go to 0 however long the camera stands.
+ *  Writing the sorted indices, which the game does whenever the order changes, is
+ *  timed apart from sorting.
+ */
+
+#include <SDL3/SDL.h>
+#include "../trisort.h"
+
+#define CELL_TRIANGLES 64      // Triangles per cell, about a BVH leaf
+#define FAR_DEPTH      100.0f  // Far plane, the game's, the field is twice as wide
+#define WALK_FRAMES    90      // Frames of each lap walking straight ahead, then turning, then standing
+#define TURN_FRAMES    45
+#define STAND_FRAMES   30
+
+enum
+{
+	FRAME_STANDING,            // Neither moved nor turned
+	FRAME_WALKING,             // Moved without turning
+	FRAME_TURNING,
+	NUM_FRAME_KINDS
+};
+
+static const char *framekinds[NUM_FRAME_KINDS] = { "Standing", "Walking", "Turning" };
+
+typedef struct tagFIELD
+{
+	MESH mesh;
+	int side;                  // Cells along each edge of the grid
+	float cellsize;            // World units across a cell
+	int numcells;
+	DRAWRANGE *ranges;         // Visible cells this frame
+	int numranges;
+	Uint32 *seen;              // Frame each triangle was last found in the order, for checking
+	Uint32 *clusterseen;       // Frame each cluster was last found in the order
+	Uint32 *indices;           // Sorted indices written out
+	Uint64 *exact, *scratch;   // Exact order of the visible triangles & its radix sort buffer
+} FIELD;
+
+typedef struct tagMISORDER
+{
+	float cluster;             // Furthest a triangle is drawn behind a nearer one of its cluster, in world units
+	float overall;             // Furthest a triangle is drawn behind any nearer one
+} MISORDER;
+
+static bool MakeField(FIELD *field, Uint32 numtriangles)
+{
+	SDL_zerop(field);
+	field->side = (int)SDL_ceil(SDL_sqrt((double)numtriangles / CELL_TRIANGLES));
+	field->numcells = field->side * field->side;
+	field->cellsize = 2.0f * FAR_DEPTH / (float)field->side;
+	const Uint32 count = (Uint32)field->numcells * CELL_TRIANGLES;
+	field->mesh.numvertices = 3 * count;
+	field->mesh.numindices = 3 * count;
+	field->mesh.indexsize = 4;
+	field->mesh.vertices = SDL_malloc((sizeof(VERTEX) + sizeof(Uint32)) * 3 * (size_t)count);
+	field->ranges = SDL_malloc(sizeof(DRAWRANGE) * (size_t)field->numcells);
+	field->seen = SDL_calloc(count, sizeof(Uint32));
+	field->clusterseen = SDL_calloc((count + TRISORT_CLUSTER - 1) / TRISORT_CLUSTER, sizeof(Uint32));
+	field->indices = SDL_malloc(sizeof(Uint32) * 3 * (size_t)count);
+	field->exact = SDL_malloc(sizeof(Uint64) * count);
+	field->scratch = SDL_malloc(sizeof(Uint64) * count);
+	if (!field->mesh.vertices || !field->ranges || !field->seen || !field->clusterseen || !field->indices ||
+		!field->exact || !field->scratch)
+	{
+		return false;
+	}
+	field->mesh.indices = &field->mesh.vertices[3 * count];
+
+	// Small triangles at random within each cell, in cell order like the leaves of a sector
+	Uint64 seed = 23;
+	Uint32 *indices = field->mesh.indices;
+	for (Uint32 t = 0; t < count; ++t)
+	{
+		const int cell = (int)(t / CELL_TRIANGLES);
+		const float x = ((float)(cell % field->side) + SDL_randf_r(&seed)) * field->cellsize;
+		const float z = ((float)(cell / field->side) + SDL_randf_r(&seed)) * field->cellsize;
+		const float y = SDL_randf_r(&seed) * 2.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			field->mesh.vertices[3 * t + i] = (VERTEX)
+			{
+				.x = x + SDL_randf_r(&seed) * 0.25f, .y = y + (float)i * 0.25f, .z = z + SDL_randf_r(&seed) * 0.25f
+			};
+			indices[3 * t + i] = 3 * t + (Uint32)i;
+		}
+	}
+	return true;
+}
+
+static void FreeField(FIELD *field)
+{
+	SDL_free(field->scratch);
+	SDL_free(field->exact);
+	SDL_free(field->indices);
+	SDL_free(field->clusterseen);
+	SDL_free(field->seen);
+	SDL_free(field->ranges);
+	SDL_free(field->mesh.vertices);
+}
+
+// Cells within the far plane in front of the camera, roughly what culling leaves
+static void FindVisibleCells(FIELD *field, const float eye[3], float yaw)
+{
+	const float fx = -SDL_sinf(yaw * SDL_PI_F / 180.0f), fz = -SDL_cosf(yaw * SDL_PI_F / 180.0f);
+	field->numranges = 0;
+	for (int cell = 0; cell < field->numcells; ++cell)
+	{
+		const float dx = ((float)(cell % field->side) + 0.5f) * field->cellsize - eye[0];
+		const float dz = ((float)(cell / field->side) + 0.5f) * field->cellsize - eye[2];
+		const float ahead = dx * fx + dz * fz;
+		if (ahead > -field->cellsize && ahead < FAR_DEPTH && SDL_fabsf(dx * fz - dz * fx) < ahead + field->cellsize)
+		{
+			field->ranges[field->numranges++] = (DRAWRANGE)
+			{
+				.firstindex = (Uint32)cell * CELL_TRIANGLES * 3, .numindices = CELL_TRIANGLES * 3
+			};
+		}
+	}
+}
+
+// Exact stable sort of every visible triangle by the same keys the sort uses, returns how many
+static Uint32 SortExact(FIELD *field, const TRISORT *sort, const mat4f viewproj)
+{
+	const float scale = (float)((1u << TRISORT_KEY_BITS) - 1) / (2.0f * sort->radius);
+	Uint32 count = 0;
+	for (int i = 0; i < field->numranges; ++i)
+	{
+		const Uint32 first = field->ranges[i].firstindex / 3, end = first + field->ranges[i].numindices / 3;
+		for (Uint32 t = first; t < end; ++t)
+		{
+			const float *c = sort->centroids[t];
+			const float depth = viewproj[3] * c[0] + viewproj[7] * c[1] + viewproj[11] * c[2];
+			const Uint32 key = (Uint32)SDL_clamp((sort->radius - depth) * scale, 0.0f, (float)0xFFFF);
+			field->exact[count++] = (Uint64)key << 32 | t;
+		}
+	}
+	for (int shift = 32; shift < 48; shift += 8)
+	{
+		Uint32 offsets[256] = { 0 };
+		for (Uint32 i = 0; i < count; ++i)
+		{
+			++offsets[(field->exact[i] >> shift) & 0xFF];
+		}
+		for (Uint32 i = 0, sum = 0; i < 256; ++i)
+		{
+			const Uint32 n = offsets[i];
+			offsets[i] = sum;
+			sum += n;
+		}
+		for (Uint32 i = 0; i < count; ++i)
+		{
+			field->scratch[offsets[(field->exact[i] >> shift) & 0xFF]++] = field->exact[i];
+		}
+		Uint64 *swap = field->exact;
+		field->exact = field->scratch;
+		field->scratch = swap;
+	}
+	return count;
+}
+
+/*  Whether the sorted indices written hold every visible triangle once with each cluster's  *
+ *  in one run, and how far they are from back to front                              */
+static bool CheckOrder(FIELD *field, const TRISORT *sort, const mat4f viewproj, Uint32 frame, MISORDER *misorder)
+{
+	Uint32 expected = 0;
+	for (int i = 0; i < field->numranges; ++i)
+	{
+		expected += field->ranges[i].numindices / 3;
+	}
+	if (sort->count != expected)
+	{
+		return false;
+	}
+
+	// Each triangle has its own vertices, so its first index gives it away
+	float nearest = SDL_MAX_SINT32, clusternearest = SDL_MAX_SINT32;
+	for (Uint32 i = 0; i < sort->count; ++i)
+	{
+		const Uint32 t = field->indices[3 * i] / 3, cluster = t / TRISORT_CLUSTER;
+		const bool samecluster = i > 0 && field->indices[3 * i - 3] / 3 / TRISORT_CLUSTER == cluster;
+		if (field->seen[t] == frame || (!samecluster && field->clusterseen[cluster] == frame))
+		{
+			return false;
+		}
+		field->seen[t] = frame;
+		field->clusterseen[cluster] = frame;
+
+		// View depth, a triangle further than one already drawn is drawn over something nearer
+		const float *c = sort->centroids[t];
+		const float depth = viewproj[3] * c[0] + viewproj[7] * c[1] + viewproj[11] * c[2];
+		clusternearest = samecluster ? SDL_min(clusternearest, depth) : depth;
+		nearest = SDL_min(nearest, depth);
+		misorder->cluster = SDL_max(misorder->cluster, depth - clusternearest);
+		misorder->overall = SDL_max(misorder->overall, depth - nearest);
+	}
+	return true;
+}
+
+static double Milliseconds(Uint64 ticks)
+{
+	return (double)ticks * 1e3 / (double)SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char *argv[])
+{
+	const int numtriangles = argc > 1 ? SDL_atoi(argv[1]) : 1000000;
+	const int numframes = argc > 2 ? SDL_atoi(argv[2]) : 600;
+	if (numtriangles <= 0 || numframes <= 0)
+	{
+		SDL_Log("Usage: %s [triangles] [frames]", argc > 0 ? argv[0] : "sortbench");
+		return 1;
+	}
+
+	FIELD field;
+	TRISORT incremental;
+	SDL_zero(incremental);
+	if (!MakeField(&field, (Uint32)numtriangles) ||
+		!InitTriangleSort(&incremental, &field.mesh, field.mesh.numindices / 3))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to make %d triangles: %s", numtriangles, SDL_GetError());
+		FreeTriangleSort(&incremental);
+		FreeField(&field);
+		return 1;
+	}
+
+	mat4f proj;
+	MakePerspective(proj, 45.0f, 16.f / 9.f, 0.1f, FAR_DEPTH);
+	float eye[3] = { FAR_DEPTH, 1.0f, FAR_DEPTH }, yaw = 0.0f;
+	Uint64 ticks[NUM_FRAME_KINDS] = { 0 }, slowest[NUM_FRAME_KINDS] = { 0 }, exactticks = 0, writeticks = 0;
+	int frames[NUM_FRAME_KINDS] = { 0 };
+	Uint64 triangles = 0, resorted = 0, pending = 0;
+	MISORDER misorder = { 0 };
+	bool same = true;
+	for (int frame = 0; frame < numframes && same; ++frame)
+	{
+		// Laps of walking a square, bobbing as the game's camera does
+		const int step = frame % (WALK_FRAMES + TURN_FRAMES + STAND_FRAMES);
+		int kind = FRAME_STANDING;
+		if (step < WALK_FRAMES)
+		{
+			eye[0] -= SDL_sinf(yaw * SDL_PI_F / 180.0f) * 0.1f;
+			eye[2] -= SDL_cosf(yaw * SDL_PI_F / 180.0f) * 0.1f;
+			eye[1] = 1.0f + SDL_sinf((float)step * 0.3f) * 0.05f;
+			kind = FRAME_WALKING;
+		}
+		else if (step < WALK_FRAMES + TURN_FRAMES)
+		{
+			yaw += 2.0f;
+			kind = FRAME_TURNING;
+		}
+		mat4f view = M4_IDENTITY, viewproj;
+		Rotate(view, 360.0f - yaw, 0.0f, 1.0f, 0.0f);
+		Translate(view, -eye[0], -eye[1], -eye[2]);
+		MulMatrices(viewproj, proj, view);
+		FindVisibleCells(&field, eye, yaw);
+
+		const Uint64 start = SDL_GetPerformanceCounter();
+		SortTriangles(&incremental, field.ranges, field.numranges, viewproj);
+		const Uint64 sortticks = SDL_GetPerformanceCounter() - start;
+		WriteSortedIndices(&incremental, field.indices);
+		const Uint64 written = SDL_GetPerformanceCounter();
+		same = CheckOrder(&field, &incremental, viewproj, (Uint32)frame + 1, &misorder);
+
+		const Uint64 exactstart = SDL_GetPerformanceCounter();
+		same = same && SortExact(&field, &incremental, viewproj) == incremental.count;
+		exactticks += SDL_GetPerformanceCounter() - exactstart;
+
+		// Every cluster is new on the first frame either way
+		if (frame > 0)
+		{
+			writeticks += written - start - sortticks;
+			ticks[kind] += sortticks;
+			slowest[kind] = SDL_max(slowest[kind], sortticks);
+			++frames[kind];
+			triangles += incremental.stats.triangles;
+			resorted += incremental.stats.resorted;
+			pending += incremental.stats.pending;
+		}
+	}
+
+	const int timed = SDL_max(numframes - 1, 1);
+	SDL_Log("%d triangles in %d cells, %.0f visible per frame", field.numcells * CELL_TRIANGLES, field.numcells,
+		(double)triangles / timed);
+	SDL_Log("Clusters sorted again %.0f & waiting %.0f per frame", (double)resorted / timed, (double)pending / timed);
+	SDL_Log("Drawn behind a nearer triangle at worst %.2f units within a cluster, %.2f overall",
+		(double)misorder.cluster, (double)misorder.overall);
+	SDL_Log("Exact sort:   %7.3f ms per frame", Milliseconds(exactticks) / numframes);
+	SDL_Log("Writing:      %7.3f ms per frame, every visible triangle's indices", Milliseconds(writeticks) / timed);
+	for (int i = 0; i < NUM_FRAME_KINDS; ++i)
+	{
+		SDL_Log("%-12s %7.3f ms per frame, %7.3f ms slowest, %d frames", framekinds[i],
+			frames[i] > 0 ? Milliseconds(ticks[i]) / frames[i] : 0.0, Milliseconds(slowest[i]), frames[i]);
+	}
+
+	FreeTriangleSort(&incremental);
+	FreeField(&field);
+	if (!same)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+			"A frame's order is missing triangles or splits a cluster's triangles up");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,451 @@
+/*
+ *  texc - Compile an image into the block compressed .btex format with its full mip chain
+ *  Usage: texc [--bc1 | --bc3] <image.bmp> <image.btex>
+ *
+ *  Mip levels are box filtered in linear light, then every level is encoded to BC1,
+ *  or BC3 when the image has any alpha (either can be forced). The error of the
+ *  encoded levels against the filtered ones is logged so encoder changes can be
+ *  judged.
+ */
+
+#include <SDL3/SDL.h>
+#include "../texture.h"
+
+typedef struct tagCOLOR
+{
+	Uint8 r, g, b, a;
+} COLOR;
+
+typedef struct tagLEVEL
+{
+	int width, height;
+	COLOR *pixels;
+} LEVEL;
+
+static float ToLinear(Uint8 value)
+{
+	const float c = value / 255.f;
+	return c <= 0.04045f ? c / 12.92f : SDL_powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static Uint8 FromLinear(float c)
+{
+	const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * SDL_powf(c, 1.f / 2.4f) - 0.055f;
+	return (Uint8)SDL_clamp((int)(s * 255.f + 0.5f), 0, 255);
+}
+
+// Average each 2x2 pixel square of the level above, odd edges repeat their last row or column
+static bool MakeMipLevel(LEVEL *level, const LEVEL *above)
+{
+	level->width = SDL_max(above->width / 2, 1);
+	level->height = SDL_max(above->height / 2, 1);
+	level->pixels = SDL_malloc(sizeof(COLOR) * (size_t)level->width * (size_t)level->height);
+	if (!level->pixels)
+	{
+		return false;
+	}
+	for (int y = 0; y < level->height; ++y)
+	{
+		const int y0 = SDL_min(y * 2, above->height - 1), y1 = SDL_min(y * 2 + 1, above->height - 1);
+		for (int x = 0; x < level->width; ++x)
+		{
+			const int x0 = SDL_min(x * 2, above->width - 1), x1 = SDL_min(x * 2 + 1, above->width - 1);
+			const COLOR *quad[4] =
+			{
+				&above->pixels[y0 * above->width + x0], &above->pixels[y0 * above->width + x1],
+				&above->pixels[y1 * above->width + x0], &above->pixels[y1 * above->width + x1]
+			};
+			float r = 0.f, g = 0.f, b = 0.f;
+			int a = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				r += ToLinear(quad[i]->r);
+				g += ToLinear(quad[i]->g);
+				b += ToLinear(quad[i]->b);
+				a += quad[i]->a;
+			}
+			level->pixels[y * level->width + x] = (COLOR){ FromLinear(r / 4.f), FromLinear(g / 4.f),
+				FromLinear(b / 4.f), (Uint8)((a + 2) / 4) };
+		}
+	}
+	return true;
+}
+
+static Uint16 Pack565(float r, float g, float b)
+{
+	const int r5 = SDL_clamp((int)(r * 31.f / 255.f + 0.5f), 0, 31);
+	const int g6 = SDL_clamp((int)(g * 63.f / 255.f + 0.5f), 0, 63);
+	const int b5 = SDL_clamp((int)(b * 31.f / 255.f + 0.5f), 0, 31);
+	return (Uint16)(r5 << 11 | g6 << 5 | b5);
+}
+
+static COLOR Unpack565(Uint16 c)
+{
+	const int r5 = c >> 11, g6 = (c >> 5) & 63, b5 = c & 31;
+	return (COLOR){ (Uint8)(r5 << 3 | r5 >> 2), (Uint8)(g6 << 2 | g6 >> 4), (Uint8)(b5 << 3 | b5 >> 2), 255 };
+}
+
+static COLOR Mix(COLOR a, COLOR b, int wa, int wb)
+{
+	const int sum = wa + wb;
+	return (COLOR){ (Uint8)((a.r * wa + b.r * wb) / sum), (Uint8)((a.g * wa + b.g * wb) / sum),
+		(Uint8)((a.b * wa + b.b * wb) / sum), 255 };
+}
+
+// The four colours a BC1 colour block can pick from, index 3 is transparent black in 3 colour mode
+static void ColorPalette(COLOR palette[4], Uint16 c0, Uint16 c1, bool bc1)
+{
+	palette[0] = Unpack565(c0);
+	palette[1] = Unpack565(c1);
+	if (c0 > c1 || !bc1)
+	{
+		palette[2] = Mix(palette[0], palette[1], 2, 1);
+		palette[3] = Mix(palette[0], palette[1], 1, 2);
+	}
+	else
+	{
+		palette[2] = Mix(palette[0], palette[1], 1, 1);
+		palette[3] = (COLOR){ 0, 0, 0, 0 };
+	}
+}
+
+static int ColorDistance(COLOR a, COLOR b)
+{
+	const int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+	return dr * dr + dg * dg + db * db;
+}
+
+/*  Encode the colours of a 4x4 block, the endpoints are the extent of the pixels    *
+ *  along their principal axis. BC1 blocks with pixels under half alpha switch to 3  *
+ *  colour mode so those pixels can be transparent.                                  */
+static void EncodeColorBlock(Uint8 *out, const COLOR block[16], bool bc1)
+{
+	float mean[3] = { 0.f, 0.f, 0.f };
+	bool transparent = false;
+	for (int i = 0; i < 16; ++i)
+	{
+		mean[0] += block[i].r / 16.f;
+		mean[1] += block[i].g / 16.f;
+		mean[2] += block[i].b / 16.f;
+		transparent = transparent || (bc1 && block[i].a < 128);
+	}
+	float cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };  // xx, xy, xz, yy, yz, zz
+	for (int i = 0; i < 16; ++i)
+	{
+		const float d[3] = { block[i].r - mean[0], block[i].g - mean[1], block[i].b - mean[2] };
+		cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+	}
+
+	// Power iteration for the principal axis
+	float axis[3] = { 1.f, 1.f, 1.f };
+	for (int iter = 0; iter < 8; ++iter)
+	{
+		const float next[3] =
+		{
+			cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+		};
+		const float length = SDL_sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			axis[k] = next[k] / length;
+		}
+	}
+	float tmin = SDL_FLT_MAX, tmax = -SDL_FLT_MAX;
+	for (int i = 0; i < 16; ++i)
+	{
+		if (transparent && block[i].a < 128)
+		{
+			continue;
+		}
+		const float t = (block[i].r - mean[0]) * axis[0] + (block[i].g - mean[1]) * axis[1] +
+			(block[i].b - mean[2]) * axis[2];
+		tmin = SDL_min(tmin, t);
+		tmax = SDL_max(tmax, t);
+	}
+	if (tmin > tmax)
+	{
+		tmin = tmax = 0.f;  // Every pixel is transparent
+	}
+	Uint16 c0 = Pack565(mean[0] + axis[0] * tmax, mean[1] + axis[1] * tmax, mean[2] + axis[2] * tmax);
+	Uint16 c1 = Pack565(mean[0] + axis[0] * tmin, mean[1] + axis[1] * tmin, mean[2] + axis[2] * tmin);
+
+	// 4 colour mode needs c0 > c1, 3 colour mode c0 <= c1
+	if ((!transparent && c0 < c1) || (transparent && c0 > c1))
+	{
+		const Uint16 swap = c0;
+		c0 = c1;
+		c1 = swap;
+	}
+	COLOR palette[4];
+	ColorPalette(palette, c0, c1, bc1);
+	const int numcolors = transparent ? 3 : (c0 == c1 ? 1 : 4);
+
+	Uint32 indices = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		int best = 0;
+		if (transparent && block[i].a < 128)
+		{
+			best = 3;
+		}
+		else
+		{
+			for (int k = 1; k < numcolors; ++k)
+			{
+				if (ColorDistance(block[i], palette[k]) < ColorDistance(block[i], palette[best]))
+				{
+					best = k;
+				}
+			}
+		}
+		indices |= (Uint32)best << (2 * i);
+	}
+	out[0] = (Uint8)c0; out[1] = (Uint8)(c0 >> 8);
+	out[2] = (Uint8)c1; out[3] = (Uint8)(c1 >> 8);
+	for (int k = 0; k < 4; ++k)
+	{
+		out[4 + k] = (Uint8)(indices >> (8 * k));
+	}
+}
+
+// The eight alphas a BC3 alpha block can pick from
+static void AlphaPalette(Uint8 palette[8], Uint8 a0, Uint8 a1)
+{
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+	{
+		for (int k = 1; k < 7; ++k)
+		{
+			palette[k + 1] = (Uint8)(((7 - k) * a0 + k * a1) / 7);
+		}
+	}
+	else
+	{
+		for (int k = 1; k < 5; ++k)
+		{
+			palette[k + 1] = (Uint8)(((5 - k) * a0 + k * a1) / 5);
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static void EncodeAlphaBlock(Uint8 *out, const COLOR block[16])
+{
+	Uint8 a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; ++i)
+	{
+		a0 = SDL_max(a0, block[i].a);
+		a1 = SDL_min(a1, block[i].a);
+	}
+	Uint8 palette[8];
+	AlphaPalette(palette, a0, a1);
+	Uint64 indices = 0;
+	for (int i = 0; i < 16 && a0 > a1; ++i)
+	{
+		int best = 0;
+		for (int k = 1; k < 8; ++k)
+		{
+			if (SDL_abs(block[i].a - palette[k]) < SDL_abs(block[i].a - palette[best]))
+			{
+				best = k;
+			}
+		}
+		indices |= (Uint64)best << (3 * i);
+	}
+	out[0] = a0;
+	out[1] = a1;
+	for (int k = 0; k < 6; ++k)
+	{
+		out[2 + k] = (Uint8)(indices >> (8 * k));
+	}
+}
+
+static void DecodeBlock(COLOR block[16], const Uint8 *in, BLOCKFORMAT format)
+{
+	const bool bc1 = format == BLOCKFORMAT_BC1;
+	Uint8 alphas[8];
+	Uint64 alphaindices = 0;
+	if (!bc1)
+	{
+		AlphaPalette(alphas, in[0], in[1]);
+		for (int k = 0; k < 6; ++k)
+		{
+			alphaindices |= (Uint64)in[2 + k] << (8 * k);
+		}
+		in += 8;
+	}
+	COLOR palette[4];
+	ColorPalette(palette, (Uint16)(in[0] | in[1] << 8), (Uint16)(in[2] | in[3] << 8), bc1);
+	const Uint32 indices = (Uint32)in[4] | (Uint32)in[5] << 8 | (Uint32)in[6] << 16 | (Uint32)in[7] << 24;
+	for (int i = 0; i < 16; ++i)
+	{
+		block[i] = palette[(indices >> (2 * i)) & 3];
+		if (!bc1)
+		{
+			block[i].a = alphas[(alphaindices >> (3 * i)) & 7];
+		}
+	}
+}
+
+// Gather a 4x4 block, pixels past the edge of levels smaller than a block repeat the last ones
+static void FetchBlock(COLOR block[16], const LEVEL *level, int bx, int by)
+{
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x)
+		{
+			const int px = SDL_min(bx * 4 + x, level->width - 1), py = SDL_min(by * 4 + y, level->height - 1);
+			block[y * 4 + x] = level->pixels[py * level->width + px];
+		}
+	}
+}
+
+/*  Encode a level into out, adding the squared error of every encoded pixel & the   *
+ *  number of pixels compared to the running totals                                  */
+static void EncodeLevel(Uint8 *out, const LEVEL *level, BLOCKFORMAT format, double *sqerror, Uint64 *numpixels)
+{
+	const int blocksx = (level->width + 3) / 4, blocksy = (level->height + 3) / 4;
+	const Uint32 blocksize = BlockSize(format);
+	for (int by = 0; by < blocksy; ++by)
+	{
+		for (int bx = 0; bx < blocksx; ++bx, out += blocksize)
+		{
+			COLOR block[16], decoded[16];
+			FetchBlock(block, level, bx, by);
+			if (format == BLOCKFORMAT_BC3)
+			{
+				EncodeAlphaBlock(out, block);
+			}
+			EncodeColorBlock(format == BLOCKFORMAT_BC3 ? out + 8 : out, block, format == BLOCKFORMAT_BC1);
+
+			DecodeBlock(decoded, out, format);
+			for (int i = 0; i < 16; ++i)
+			{
+				// BC1 alpha is a cut off, the colour of a pixel cut out doesn't matter
+				if (format == BLOCKFORMAT_BC1 && block[i].a < 128 && decoded[i].a == 0)
+				{
+					continue;
+				}
+				const int da = block[i].a - decoded[i].a;
+				*sqerror += ColorDistance(block[i], decoded[i]) + da * da;
+			}
+			*numpixels += 16;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int arg = 1;
+	BLOCKFORMAT format = 0;
+	if (arg < argc && SDL_strcmp(argv[arg], "--bc1") == 0)
+	{
+		format = BLOCKFORMAT_BC1;
+		++arg;
+	}
+	else if (arg < argc && SDL_strcmp(argv[arg], "--bc3") == 0)
+	{
+		format = BLOCKFORMAT_BC3;
+		++arg;
+	}
+	if (argc - arg != 2)
+	{
+		SDL_Log("Usage: %s [--bc1 | --bc3] <image.bmp> <image.btex>", argc > 0 ? argv[0] : "texc");
+		return 1;
+	}
+	const char *inpath = argv[arg], *outpath = argv[arg + 1];
+
+	// Same orientation & byte order as the runtime's decoded images
+	SDL_Surface *image = SDL_LoadBMP(inpath);
+	SDL_Surface *rgba = image && SDL_FlipSurface(image, SDL_FLIP_VERTICAL) ?
+		SDL_ConvertSurface(image, SDL_PIXELFORMAT_ABGR8888) : NULL;
+	SDL_DestroySurface(image);
+	if (!rgba)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read \"%s\": %s", inpath, SDL_GetError());
+		return 1;
+	}
+	if ((Uint32)SDL_max(rgba->w, rgba->h) > TEXTURE_MAX_SIZE)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is larger than %u pixels", inpath, TEXTURE_MAX_SIZE);
+		SDL_DestroySurface(rgba);
+		return 1;
+	}
+
+	TEXTUREHEADER header =
+	{
+		.magic = TEXTURE_BINARY_MAGIC,
+		.version = TEXTURE_BINARY_VERSION,
+		.width = (Uint32)rgba->w,
+		.height = (Uint32)rgba->h,
+		.numlevels = (Uint32)SDL_MostSignificantBitIndex32((Uint32)SDL_max(rgba->w, rgba->h)) + 1
+	};
+	LEVEL levels[TEXTURE_MAX_LEVELS] = { 0 };
+	levels[0] = (LEVEL){ rgba->w, rgba->h, SDL_malloc(sizeof(COLOR) * (size_t)rgba->w * (size_t)rgba->h) };
+	bool ok = levels[0].pixels && SDL_ConvertPixels(rgba->w, rgba->h, rgba->format, rgba->pixels, rgba->pitch,
+		SDL_PIXELFORMAT_ABGR8888, levels[0].pixels, rgba->w * (int)sizeof(COLOR));
+	SDL_DestroySurface(rgba);
+	for (Uint32 i = 1; ok && i < header.numlevels; ++i)
+	{
+		ok = MakeMipLevel(&levels[i], &levels[i - 1]);
+	}
+
+	if (format == 0)
+	{
+		// Keep BC1's half size unless some pixel needs more than 1-bit alpha
+		format = BLOCKFORMAT_BC1;
+		for (int i = 0; ok && i < levels[0].width * levels[0].height; ++i)
+		{
+			if (levels[0].pixels[i].a != 255)
+			{
+				format = BLOCKFORMAT_BC3;
+				break;
+			}
+		}
+	}
+	header.format = (Uint16)format;
+
+	const Uint64 datasize = BlockTextureSize(&header);
+	Uint8 *data = ok ? SDL_malloc((size_t)datasize) : NULL;
+	double sqerror = 0.0;
+	Uint64 numpixels = 0, offset = 0, rgbabytes = 0;
+	for (Uint32 i = 0; data && i < header.numlevels; ++i)
+	{
+		EncodeLevel(data + offset, &levels[i], format, &sqerror, &numpixels);
+		offset += BlockLevelSize(format, (Uint32)levels[i].width, (Uint32)levels[i].height);
+		rgbabytes += sizeof(COLOR) * (Uint64)levels[i].width * (Uint64)levels[i].height;
+	}
+	for (Uint32 i = 0; i < header.numlevels; ++i)
+	{
+		SDL_free(levels[i].pixels);
+	}
+
+	SDL_IOStream *fileout = data ? SDL_IOFromFile(outpath, "wb") : NULL;
+	bool written = fileout && WriteBlockTexture(fileout, &header, data);
+	if (fileout && !SDL_CloseIO(fileout))
+	{
+		written = false;
+	}
+	SDL_free(data);
+	if (!written)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write \"%s\": %s", outpath, SDL_GetError());
+		return 1;
+	}
+
+	const double rmse = SDL_sqrt(sqerror / (4.0 * (double)numpixels));
+	SDL_Log("%s: %ux%u, %u levels, BC%d, %llu bytes (%.1fx smaller than RGBA8), RMSE %.2f, PSNR %.2f dB",
+		inpath, (unsigned)header.width, (unsigned)header.height, (unsigned)header.numlevels, (int)format,
+		(unsigned long long)datasize, (double)rgbabytes / (double)datasize,
+		rmse, rmse > 0.0 ? 20.0 * SDL_log10(255.0 / rmse) : 99.0);
+	return 0;
+}
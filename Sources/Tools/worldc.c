@@ -0,0 +1,60 @@
+/*
+ *  worldc - Compile a World.txt style text world into the binary .wbin format
+ *  Usage: worldc <World.txt> <World.wbin>
+ */
+
+#include <SDL3/SDL.h>
+#include "../world.h"
+#include "../mesh.h"
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		SDL_Log("Usage: %s <World.txt> <World.wbin>", argc > 0 ? argv[0] : "worldc");
+		return 1;
+	}
+	const char *inpath = argv[1], *outpath = argv[2];
+
+	size_t textsize;
+	char *text = SDL_LoadFile(inpath, &textsize);
+	if (!text)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read \"%s\": %s", inpath, SDL_GetError());
+		return 1;
+	}
+	WORLD world;
+	const bool parsed = ParseWorld(&world, text, textsize);
+	SDL_free(text);
+	if (!parsed)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to parse \"%s\": %s", inpath, SDL_GetError());
+		return 1;
+	}
+
+	MESH mesh;
+	MESHSTATS stats;
+	if (!BuildMesh(&mesh, &world, &stats))
+	{
+		FreeWorld(&world);
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build mesh for \"%s\": %s", inpath, SDL_GetError());
+		return 1;
+	}
+	LogMeshStats(inpath, &mesh, &stats);
+
+	SDL_IOStream *fileout = SDL_IOFromFile(outpath, "wb");
+	bool written = fileout && WriteWorldBinary(fileout, &world, &mesh);
+	if (fileout && !SDL_CloseIO(fileout))
+	{
+		written = false;
+	}
+	FreeMesh(&mesh);
+	FreeWorld(&world);
+	if (!written)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write \"%s\": %s", outpath, SDL_GetError());
+		return 1;
+	}
+
+	return 0;
+}
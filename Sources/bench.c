@@ -0,0 +1,271 @@
+#include "bench.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_iostream.h>
+
+// Parse the five values of a key line, the line must hold nothing else
+static bool ParseKey(const char *line, CAMERAKEY *key)
+{
+	float *values[5] = { &key->time, &key->xpos, &key->zpos, &key->heading, &key->lookupdown };
+	const char *s = line;
+	for (int i = 0; i <= 5; ++i)
+	{
+		// SDL_strtod would skip newlines too, keep it on this line
+		while (*s == ' ' || *s == '\t' || *s == '\r')
+		{
+			++s;
+		}
+		if (i == 5 || *s == '\n' || *s == '\0')
+		{
+			return i == 5 && (*s == '\n' || *s == '\0');
+		}
+		char *end;
+		const double value = SDL_strtod(s, &end);
+		if (end == s)
+		{
+			return false;
+		}
+		*values[i] = (float)value;
+		s = end;
+	}
+	return false;
+}
+
+bool ParseCameraPath(CAMERAPATH *path, const char *text, size_t size)
+{
+	SDL_zerop(path);
+
+	// Null terminate a copy so the numbers can be read with SDL_strtod
+	char *copy = SDL_malloc(size + 1);
+	int maxkeys = 1;
+	for (size_t i = 0; i < size; ++i)
+	{
+		maxkeys += text[i] == '\n';
+	}
+	path->keys = SDL_malloc(sizeof(CAMERAKEY) * (size_t)maxkeys);
+	if (!copy || !path->keys)
+	{
+		SDL_free(copy);
+		FreeCameraPath(path);
+		return false;
+	}
+	SDL_memcpy(copy, text, size);
+	copy[size] = '\0';
+
+	int line = 1;
+	for (char *s = copy; *s; ++line)
+	{
+		char *next = SDL_strchr(s, '\n');
+		next = next ? next + 1 : s + SDL_strlen(s);
+		while (*s == ' ' || *s == '\t' || *s == '\r')
+		{
+			++s;
+		}
+		if (*s != '\n' && *s != '\0' && *s != '/')
+		{
+			CAMERAKEY *key = &path->keys[path->numkeys];
+			if (!ParseKey(s, key))
+			{
+				SDL_free(copy);
+				FreeCameraPath(path);
+				return SDL_SetError("Line %d: expected \"time xpos zpos heading lookupdown\"", line);
+			}
+			if (path->numkeys > 0 && key->time <= key[-1].time)
+			{
+				SDL_free(copy);
+				FreeCameraPath(path);
+				return SDL_SetError("Line %d: key times must increase", line);
+			}
+			++path->numkeys;
+		}
+		s = next;
+	}
+	SDL_free(copy);
+
+	if (path->numkeys < 2)
+	{
+		FreeCameraPath(path);
+		return SDL_SetError("Camera path needs at least 2 keys");
+	}
+	return true;
+}
+
+void FreeCameraPath(CAMERAPATH *path)
+{
+	SDL_free(path->keys);
+	SDL_zerop(path);
+}
+
+static float CatmullRom(float p0, float p1, float p2, float p3, float t)
+{
+	return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t * t +
+		(3.0f * p1 - p0 - 3.0f * p2 + p3) * t * t * t);
+}
+
+void SampleCameraPath(const CAMERAPATH *path, float time, CAMERAKEY *key)
+{
+	const CAMERAKEY *keys = path->keys;
+	const int last = path->numkeys - 1;
+	if (time <= keys[0].time || time >= keys[last].time)
+	{
+		*key = keys[time <= keys[0].time ? 0 : last];
+		return;
+	}
+
+	// Find the segment holding time, the end keys are repeated to give the spline its outer control points
+	int i = 0;
+	while (keys[i + 1].time <= time)
+	{
+		++i;
+	}
+	const CAMERAKEY *k0 = &keys[SDL_max(i - 1, 0)], *k1 = &keys[i];
+	const CAMERAKEY *k2 = &keys[i + 1], *k3 = &keys[SDL_min(i + 2, last)];
+	const float t = (time - k1->time) / (k2->time - k1->time);
+	*key = (CAMERAKEY)
+	{
+		.time = time,
+		.xpos = CatmullRom(k0->xpos, k1->xpos, k2->xpos, k3->xpos, t),
+		.zpos = CatmullRom(k0->zpos, k1->zpos, k2->zpos, k3->zpos, t),
+		.heading = CatmullRom(k0->heading, k1->heading, k2->heading, k3->heading, t),
+		.lookupdown = CatmullRom(k0->lookupdown, k1->lookupdown, k2->lookupdown, k3->lookupdown, t)
+	};
+}
+
+bool InitBench(BENCH *bench, int maxframes)
+{
+	SDL_zerop(bench);
+	const size_t size = sizeof(float) * (size_t)SDL_max(maxframes, 1);
+	bench->framems = SDL_malloc(size);
+	bench->cpums = SDL_malloc(size);
+	bench->submitms = SDL_malloc(size);
+	bench->latencyms = SDL_malloc(size);
+	bench->overdraw = SDL_malloc(size);
+	bench->scale = SDL_malloc(size);
+	if (!bench->framems || !bench->cpums || !bench->submitms || !bench->latencyms || !bench->overdraw ||
+		!bench->scale)
+	{
+		FreeBench(bench);
+		return false;
+	}
+	bench->maxframes = maxframes;
+	return true;
+}
+
+void FreeBench(BENCH *bench)
+{
+	SDL_free(bench->scale);
+	SDL_free(bench->overdraw);
+	SDL_free(bench->latencyms);
+	SDL_free(bench->submitms);
+	SDL_free(bench->cpums);
+	SDL_free(bench->framems);
+	SDL_zerop(bench);
+}
+
+void AddBenchFrame(BENCH *bench, float framems, float cpums, float submitms, float latencyms)
+{
+	if (bench->numframes < bench->maxframes)
+	{
+		bench->framems[bench->numframes] = framems;
+		bench->cpums[bench->numframes] = cpums;
+		bench->submitms[bench->numframes] = submitms;
+		bench->latencyms[bench->numframes] = latencyms;
+		++bench->numframes;
+	}
+}
+
+void AddBenchOverdraw(BENCH *bench, float shadedperpixel)
+{
+	if (bench->numoverdraw < bench->maxframes)
+	{
+		bench->overdraw[bench->numoverdraw++] = shadedperpixel;
+	}
+}
+
+void AddBenchScale(BENCH *bench, float scale)
+{
+	if (bench->numscale < bench->maxframes)
+	{
+		bench->scale[bench->numscale++] = scale;
+	}
+}
+
+float Percentile(const float *sorted, int count, float p)
+{
+	if (count <= 0)
+	{
+		return 0.0f;
+	}
+	const int rank = (int)SDL_ceilf(p / 100.0f * (float)count);
+	return sorted[SDL_clamp(rank, 1, count) - 1];
+}
+
+static int SDLCALL CompareFloats(const void *a, const void *b)
+{
+	const float x = *(const float *)a, y = *(const float *)b;
+	return (x > y) - (x < y);
+}
+
+static bool WriteTimings(SDL_IOStream *out, const char *name, float *values, int count, bool last)
+{
+	double sum = 0.0;
+	for (int i = 0; i < count; ++i)
+	{
+		sum += values[i];
+	}
+	SDL_qsort(values, (size_t)count, sizeof(float), CompareFloats);
+	return SDL_IOprintf(out,
+		"  \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+		name, count > 0 ? sum / count : 0.0, count > 0 ? values[0] : 0.0f,
+		Percentile(values, count, 50.0f), Percentile(values, count, 95.0f), Percentile(values, count, 99.0f),
+		count > 0 ? values[count - 1] : 0.0f, last ? "" : ",") > 0;
+}
+
+// Write a JSON string, escaping what JSON requires (Windows paths are full of backslashes)
+static bool WriteString(SDL_IOStream *out, const char *s)
+{
+	bool ok = SDL_WriteU8(out, '"');
+	for (; *s && ok; ++s)
+	{
+		const unsigned char c = (unsigned char)*s;
+		if (c == '"' || c == '\\')
+		{
+			ok = SDL_WriteU8(out, '\\') && SDL_WriteU8(out, c);
+		}
+		else if (c < 0x20)
+		{
+			ok = SDL_IOprintf(out, "\\u%04x", (unsigned)c) > 0;
+		}
+		else
+		{
+			ok = SDL_WriteU8(out, c);
+		}
+	}
+	return ok && SDL_WriteU8(out, '"');
+}
+
+bool WriteBenchReport(SDL_IOStream *out, BENCH *bench, const char *pathfile, const char *driver,
+	const char *presentmode, bool renderthread, int width, int height)
+{
+	double duration = 0.0;
+	for (int i = 0; i < bench->numframes; ++i)
+	{
+		duration += bench->framems[i];
+	}
+	return SDL_IOprintf(out, "{\n  \"path\": ") > 0 && WriteString(out, pathfile) &&
+		SDL_IOprintf(out, ",\n  \"driver\": ") > 0 && WriteString(out, driver) &&
+		SDL_IOprintf(out, ",\n  \"present_mode\": ") > 0 && WriteString(out, presentmode) &&
+		SDL_IOprintf(out, ",\n  \"render_thread\": %s", renderthread ? "true" : "false") > 0 &&
+		SDL_IOprintf(out, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n  \"duration_ms\": %.3f,\n",
+			width, height, bench->numframes, duration) > 0 &&
+		WriteTimings(out, "frame_ms", bench->framems, bench->numframes, false) &&
+		WriteTimings(out, "cpu_ms", bench->cpums, bench->numframes, false) &&
+		WriteTimings(out, "submit_ms", bench->submitms, bench->numframes, false) &&
+		WriteTimings(out, "latency_ms", bench->latencyms, bench->numframes,
+			bench->numoverdraw == 0 && bench->numscale == 0) &&
+		(bench->numoverdraw == 0 ||
+			WriteTimings(out, "shaded_per_pixel", bench->overdraw, bench->numoverdraw, bench->numscale == 0)) &&
+		(bench->numscale == 0 ||
+			WriteTimings(out, "resolution_scale", bench->scale, bench->numscale, true)) &&
+		SDL_IOprintf(out, "}\n") > 0;
+}
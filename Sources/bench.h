@@ -0,0 +1,71 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define BENCH_FRAME_STEP    (1.0f / 60.0f)  // Path time advanced per frame, independent of how fast frames render
+#define BENCH_WARMUP_FRAMES 30              // Frames drawn at the start of the path before timing begins
+
+typedef struct tagCAMERAKEY
+{
+	float time;                // Seconds from the start of the path
+	float xpos, zpos;
+	float heading;             // Degrees, not wrapped so a turn through 360 interpolates the short way
+	float lookupdown;
+} CAMERAKEY;
+
+typedef struct tagCAMERAPATH
+{
+	int numkeys;
+	CAMERAKEY *keys;           // Sorted by time
+} CAMERAPATH;
+
+typedef struct tagBENCH
+{
+	int numframes, maxframes;
+	float *framems;            // Time between consecutive frames being presented
+	float *cpums;              // Time recording & submitting the frame's commands
+	float *submitms;           // Time spent in the command buffer submit
+	float *latencyms;          // Time from sampling the frame's input to presenting it
+	int numoverdraw;           // Frames whose shaded fragments were counted, --bench-overdraw
+	float *overdraw;           // Fragments shaded per pixel of each counted frame
+	int numscale;              // Frames drawn with --dynamic-resolution
+	float *scale;              // Fraction of the window's width & height each was drawn at
+} BENCH;
+
+/*  Parse a camera path, one "time xpos zpos heading lookupdown" key per line with   *
+ *  times increasing. Blank lines and lines starting with '/' are skipped as in the  *
+ *  world file. Release the path with FreeCameraPath, on failure the error is set.   */
+bool ParseCameraPath(CAMERAPATH *path, const char *text, size_t size);
+void FreeCameraPath(CAMERAPATH *path);
+
+/*  Catmull-Rom interpolate the path at time, clamped to its first & last keys       */
+void SampleCameraPath(const CAMERAPATH *path, float time, CAMERAKEY *key);
+
+static inline float CameraPathDuration(const CAMERAPATH *path)
+{
+	return path->numkeys > 0 ? path->keys[path->numkeys - 1].time : 0.0f;
+}
+
+/*  Allocate room for the timings of up to maxframes frames                          */
+bool InitBench(BENCH *bench, int maxframes);
+void FreeBench(BENCH *bench);
+void AddBenchFrame(BENCH *bench, float framems, float cpums, float submitms, float latencyms);
+
+/*  Record a frame's fragments shaded per pixel, counted a few frames after it was   *
+ *  drawn so the counts are kept apart from the timings                              */
+void AddBenchOverdraw(BENCH *bench, float shadedperpixel);
+void AddBenchScale(BENCH *bench, float scale);
+
+/*  Nearest rank percentile, p from 0 to 100, of count values sorted ascending       */
+float Percentile(const float *sorted, int count, float p);
+
+/*  Write the mean, min, max and 50th, 95th & 99th percentile of each timing as a    *
+ *  JSON object, along with what was benchmarked and the fragments shaded per pixel  *
+ *  when they were counted. Sorts the recorded timings.                              */
+struct SDL_IOStream;
+bool WriteBenchReport(struct SDL_IOStream *out, BENCH *bench, const char *pathfile, const char *driver,
+	const char *presentmode, bool renderthread, int width, int height);
+
+#endif//BENCH_H
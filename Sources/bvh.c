@@ -0,0 +1,406 @@
+#include "bvh.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_intrin.h>
+
+#define BVH_STACK_SIZE (BVH_MAX_DEPTH * (BVH_WIDTH - 1) + BVH_WIDTH)
+
+SDL_COMPILE_TIME_ASSERT(bvh_width, BVH_WIDTH == 4);
+
+typedef struct tagBVHBUILDER
+{
+	BVHNODE *nodes;
+	int numnodes, capacity;
+	int *order;              // Sector triangles, partitioned in place into leaf order
+	float (*boxes)[6];       // Bounds of each triangle as min x, y, z then max x, y, z
+	uint32_t firstindex;     // Start of the sector being built in the index buffer
+} BVHBUILDER;
+
+
+static inline float Centroid(const BVHBUILDER *b, int triangle, int axis)
+{
+	return b->boxes[triangle][axis] + b->boxes[triangle][axis + 3];
+}
+
+// Partially sort triangles so the k-th along an axis lands at k, with none greater before it
+static void SelectMedian(const BVHBUILDER *b, int *order, int count, int k, int axis)
+{
+	int lo = 0, hi = count - 1;
+	while (lo < hi)
+	{
+		const float pivot = Centroid(b, order[lo + (hi - lo) / 2], axis);
+		int i = lo, j = hi;
+		while (i <= j)
+		{
+			while (Centroid(b, order[i], axis) < pivot)
+			{
+				++i;
+			}
+			while (Centroid(b, order[j], axis) > pivot)
+			{
+				--j;
+			}
+			if (i <= j)
+			{
+				const int swap = order[i];
+				order[i++] = order[j];
+				order[j--] = swap;
+			}
+		}
+		if (k <= j)
+		{
+			hi = j;
+		}
+		else if (k >= i)
+		{
+			lo = i;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+// Split a run of triangles in half at the median centroid along its longest axis
+static int Split(BVHBUILDER *b, int begin, int end)
+{
+	float lo[3] = { SDL_FLT_MAX, SDL_FLT_MAX, SDL_FLT_MAX }, hi[3] = { -SDL_FLT_MAX, -SDL_FLT_MAX, -SDL_FLT_MAX };
+	for (int i = begin; i < end; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const float c = Centroid(b, b->order[i], k);
+			lo[k] = SDL_min(lo[k], c);
+			hi[k] = SDL_max(hi[k], c);
+		}
+	}
+	int axis = 0;
+	for (int k = 1; k < 3; ++k)
+	{
+		if (hi[k] - lo[k] > hi[axis] - lo[axis])
+		{
+			axis = k;
+		}
+	}
+	const int half = (end - begin) / 2;
+	SelectMedian(b, &b->order[begin], end - begin, half, axis);
+	return begin + half;
+}
+
+static int BuildNode(BVHBUILDER *b, int begin, int end, int depth)
+{
+	if (b->numnodes == b->capacity)
+	{
+		const int capacity = b->capacity ? b->capacity * 2 : 64;
+		BVHNODE *nodes = SDL_realloc(b->nodes, sizeof(BVHNODE) * (size_t)capacity);
+		if (!nodes)
+		{
+			return -1;
+		}
+		b->nodes = nodes;
+		b->capacity = capacity;
+	}
+	const int index = b->numnodes++;
+
+	// Two rounds of halving give up to four children, runs that already fit a leaf are left alone
+	int parts[BVH_WIDTH + 1] = { begin, end };
+	int numparts = 1;
+	for (int round = 0; round < 2; ++round)
+	{
+		for (int i = numparts - 1; i >= 0; --i)
+		{
+			if (parts[i + 1] - parts[i] > BVH_LEAF_TRIANGLES)
+			{
+				SDL_memmove(&parts[i + 2], &parts[i + 1], sizeof(int) * (size_t)(numparts - i));
+				parts[i + 1] = Split(b, parts[i], parts[i + 2]);
+				++numparts;
+			}
+		}
+	}
+
+	BVHNODE node;
+	for (int i = 0; i < BVH_WIDTH; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			node.bounds[k][i] = SDL_FLT_MAX;
+			node.bounds[k + 3][i] = -SDL_FLT_MAX;
+		}
+		node.child[i] = BVH_EMPTY;
+		node.firstindex[i] = node.numindices[i] = 0;
+		if (i >= numparts)
+		{
+			continue;
+		}
+
+		const int first = parts[i], count = parts[i + 1] - parts[i];
+		for (int t = first; t < first + count; ++t)
+		{
+			const float *box = b->boxes[b->order[t]];
+			for (int k = 0; k < 3; ++k)
+			{
+				node.bounds[k][i] = SDL_min(node.bounds[k][i], box[k]);
+				node.bounds[k + 3][i] = SDL_max(node.bounds[k + 3][i], box[k + 3]);
+			}
+		}
+		node.firstindex[i] = b->firstindex + 3u * (Uint32)first;
+		node.numindices[i] = 3u * (Uint32)count;
+		node.child[i] = BVH_LEAF;
+		if (count > BVH_LEAF_TRIANGLES && depth + 1 < BVH_MAX_DEPTH)
+		{
+			const int child = BuildNode(b, first, first + count, depth + 1);
+			if (child < 0)
+			{
+				return -1;
+			}
+			node.child[i] = child;
+		}
+	}
+	b->nodes[index] = node;
+	return index;
+}
+
+bool BuildWorldBVH(WORLD *world, Uint32 *indices, const VERTEX *vertices)
+{
+	int maxtriangles = 0;
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		maxtriangles = SDL_max(maxtriangles, world->sectors[i].numtriangles);
+	}
+	BVHBUILDER b = { 0 };
+	b.order = SDL_malloc(sizeof(int) * (size_t)maxtriangles);
+	b.boxes = SDL_malloc(sizeof(float[6]) * (size_t)maxtriangles);
+	Uint32 *scratch = SDL_malloc(sizeof(Uint32) * 3 * (size_t)maxtriangles);
+	bool built = b.order && b.boxes && scratch;
+
+	for (int i = 0; i < world->numsectors && built; ++i)
+	{
+		SECTOR *sector = &world->sectors[i];
+		sector->bvhroot = -1;
+		if (sector->numtriangles == 0)
+		{
+			continue;
+		}
+		Uint32 *triangles = &indices[sector->firstindex];
+		for (int t = 0; t < sector->numtriangles; ++t)
+		{
+			float *box = b.boxes[t];
+			for (int k = 0; k < 3; ++k)
+			{
+				box[k] = SDL_FLT_MAX;
+				box[k + 3] = -SDL_FLT_MAX;
+			}
+			for (int v = 0; v < 3; ++v)
+			{
+				const VERTEX *vertex = &vertices[triangles[t * 3 + v]];
+				const float pos[3] = { vertex->x, vertex->y, vertex->z };
+				for (int k = 0; k < 3; ++k)
+				{
+					box[k] = SDL_min(box[k], pos[k]);
+					box[k + 3] = SDL_max(box[k + 3], pos[k]);
+				}
+			}
+			b.order[t] = t;
+		}
+
+		b.firstindex = sector->firstindex;
+		sector->bvhroot = BuildNode(&b, 0, sector->numtriangles, 0);
+		built = sector->bvhroot >= 0;
+
+		// Rewrite the sector's triangles in leaf order
+		SDL_memcpy(scratch, triangles, sizeof(Uint32) * 3 * (size_t)sector->numtriangles);
+		for (int t = 0; t < sector->numtriangles && built; ++t)
+		{
+			SDL_memcpy(&triangles[t * 3], &scratch[b.order[t] * 3], sizeof(Uint32) * 3);
+		}
+	}
+
+	SDL_free(scratch);
+	SDL_free(b.boxes);
+	SDL_free(b.order);
+	if (!built)
+	{
+		SDL_free(b.nodes);
+		return false;
+	}
+	SDL_free(world->nodes);
+	world->nodes = b.nodes;
+	world->numnodes = b.numnodes;
+	return true;
+}
+
+void MakeFrustum(FRUSTUM *frustum, const mat4f viewproj, const float window[4])
+{
+	static const float fullscreen[4] = { -1.f, -1.f, 1.f, 1.f };
+	if (!window)
+	{
+		window = fullscreen;
+	}
+
+	// Clip space rows, a point is inside when -w <= x, y, z <= w (narrowed to the window for x & y)
+	float rows[4][4];
+	for (int row = 0; row < 4; ++row)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			rows[row][col] = viewproj[col * 4 + row];
+		}
+	}
+	for (int k = 0; k < 4; ++k)
+	{
+		frustum->planes[0][k] = rows[0][k] - window[0] * rows[3][k];  // Left
+		frustum->planes[1][k] = window[2] * rows[3][k] - rows[0][k];  // Right
+		frustum->planes[2][k] = rows[1][k] - window[1] * rows[3][k];  // Bottom
+		frustum->planes[3][k] = window[3] * rows[3][k] - rows[1][k];  // Top
+		frustum->planes[4][k] = rows[3][k] + rows[2][k];              // Near
+		frustum->planes[5][k] = rows[3][k] - rows[2][k];              // Far
+	}
+	for (int i = 0; i < 6; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const bool positive = frustum->planes[i][k] >= 0.f;
+			frustum->pvertex[i][k] = positive ? k + 3 : k;
+			frustum->nvertex[i][k] = positive ? k : k + 3;
+		}
+	}
+}
+
+// Test a node's four child boxes against the frustum, returns a mask of children not outside any plane
+static int TestChildren(const BVHNODE *node, const FRUSTUM *frustum, int *inside)
+{
+#if defined(SDL_SSE2_INTRINSICS)
+	const __m128 zero = _mm_setzero_ps();
+	__m128 outmask = zero, inmask = _mm_cmpeq_ps(zero, zero);
+	for (int i = 0; i < 6; ++i)
+	{
+		const float *plane = frustum->planes[i];
+		const int *pv = frustum->pvertex[i], *nv = frustum->nvertex[i];
+		const __m128 a = _mm_set1_ps(plane[0]), b = _mm_set1_ps(plane[1]);
+		const __m128 c = _mm_set1_ps(plane[2]), d = _mm_set1_ps(plane[3]);
+		const __m128 dpos = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(node->bounds[pv[0]])),
+				_mm_mul_ps(b, _mm_loadu_ps(node->bounds[pv[1]]))),
+			_mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(node->bounds[pv[2]])), d));
+		const __m128 dneg = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(node->bounds[nv[0]])),
+				_mm_mul_ps(b, _mm_loadu_ps(node->bounds[nv[1]]))),
+			_mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(node->bounds[nv[2]])), d));
+		outmask = _mm_or_ps(outmask, _mm_cmplt_ps(dpos, zero));
+		inmask = _mm_and_ps(inmask, _mm_cmpge_ps(dneg, zero));
+	}
+	*inside = _mm_movemask_ps(inmask);
+	return ~_mm_movemask_ps(outmask) & 0xF;
+#elif defined(SDL_NEON_INTRINSICS)
+	static const uint32_t lanebits[4] = { 1, 2, 4, 8 };
+	const float32x4_t zero = vdupq_n_f32(0.f);
+	uint32x4_t outmask = vdupq_n_u32(0), inmask = vdupq_n_u32(~0u);
+	for (int i = 0; i < 6; ++i)
+	{
+		const float *plane = frustum->planes[i];
+		const int *pv = frustum->pvertex[i], *nv = frustum->nvertex[i];
+		const float32x4_t d = vdupq_n_f32(plane[3]);
+		const float32x4_t dpos = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(d,
+			vld1q_f32(node->bounds[pv[0]]), plane[0]),
+			vld1q_f32(node->bounds[pv[1]]), plane[1]),
+			vld1q_f32(node->bounds[pv[2]]), plane[2]);
+		const float32x4_t dneg = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(d,
+			vld1q_f32(node->bounds[nv[0]]), plane[0]),
+			vld1q_f32(node->bounds[nv[1]]), plane[1]),
+			vld1q_f32(node->bounds[nv[2]]), plane[2]);
+		outmask = vorrq_u32(outmask, vcltq_f32(dpos, zero));
+		inmask = vandq_u32(inmask, vcgeq_f32(dneg, zero));
+	}
+	const uint32x4_t bits = vld1q_u32(lanebits);
+	const uint32x4_t out = vandq_u32(outmask, bits), in = vandq_u32(inmask, bits);
+	const uint32x2_t outpair = vorr_u32(vget_low_u32(out), vget_high_u32(out));
+	const uint32x2_t inpair = vorr_u32(vget_low_u32(in), vget_high_u32(in));
+	*inside = (int)(vget_lane_u32(inpair, 0) | vget_lane_u32(inpair, 1));
+	return ~(int)(vget_lane_u32(outpair, 0) | vget_lane_u32(outpair, 1)) & 0xF;
+#else
+	int visible = 0;
+	*inside = 0;
+	for (int j = 0; j < BVH_WIDTH; ++j)
+	{
+		bool out = false, in = true;
+		for (int i = 0; i < 6; ++i)
+		{
+			const float *plane = frustum->planes[i];
+			const int *pv = frustum->pvertex[i], *nv = frustum->nvertex[i];
+			const float dpos = (plane[0] * node->bounds[pv[0]][j] + plane[1] * node->bounds[pv[1]][j]) +
+				(plane[2] * node->bounds[pv[2]][j] + plane[3]);
+			const float dneg = (plane[0] * node->bounds[nv[0]][j] + plane[1] * node->bounds[nv[1]][j]) +
+				(plane[2] * node->bounds[nv[2]][j] + plane[3]);
+			out = out || dpos < 0.f;
+			in = in && dneg >= 0.f;
+		}
+		visible |= !out << j;
+		*inside |= in << j;
+	}
+	return visible;
+#endif
+}
+
+static void AppendRange(DRAWRANGE *ranges, int *numranges, Uint32 firstindex, Uint32 numindices)
+{
+	DRAWRANGE *last = *numranges ? &ranges[*numranges - 1] : NULL;
+	if (last && last->firstindex + last->numindices == firstindex)
+	{
+		last->numindices += numindices;
+	}
+	else
+	{
+		ranges[(*numranges)++] = (DRAWRANGE){ firstindex, numindices };
+	}
+}
+
+unsigned CullSector(const WORLD *world, const SECTOR *sector, const FRUSTUM *frustum,
+	DRAWRANGE *ranges, int *numranges)
+{
+	if (sector->numindices == 0)
+	{
+		return 0;
+	}
+	if (sector->bvhroot < 0)
+	{
+		AppendRange(ranges, numranges, sector->firstindex, sector->numindices);
+		return 0;
+	}
+
+	// Children are pushed in reverse so ranges come out in index buffer order, entries with
+	// no node are ranges already known to be visible
+	struct { int node; Uint32 firstindex, numindices; } stack[BVH_STACK_SIZE];
+	stack[0].node = sector->bvhroot;
+	stack[0].firstindex = sector->firstindex;
+	stack[0].numindices = sector->numindices;
+	int depth = 1;
+	unsigned tested = 0;
+	while (depth > 0)
+	{
+		const int entry = --depth;
+		if (stack[entry].node < 0)
+		{
+			AppendRange(ranges, numranges, stack[entry].firstindex, stack[entry].numindices);
+			continue;
+		}
+		const BVHNODE *node = &world->nodes[stack[entry].node];
+		++tested;
+
+		int inside;
+		const int visible = TestChildren(node, frustum, &inside);
+		for (int i = BVH_WIDTH - 1; i >= 0; --i)
+		{
+			if (!(visible & 1 << i) || node->numindices[i] == 0)
+			{
+				continue;
+			}
+			// Descend unless the child is a leaf, entirely inside, or too deep to fit on the stack
+			const bool descend = node->child[i] >= 0 && !(inside & 1 << i) &&
+				depth + BVH_WIDTH * 2 <= BVH_STACK_SIZE;
+			stack[depth].node = descend ? node->child[i] : -1;
+			stack[depth].firstindex = node->firstindex[i];
+			stack[depth++].numindices = node->numindices[i];
+		}
+	}
+	return tested;
+}
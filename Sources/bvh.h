@@ -0,0 +1,43 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "world.h"
+#include "matrix.h"
+
+#define BVH_LEAF_TRIANGLES 64  // Largest batch of triangles kept in a single leaf
+#define BVH_MAX_DEPTH      32  // Deepest level split during the build, also bounds the cull stack
+
+typedef struct tagDRAWRANGE
+{
+	uint32_t firstindex, numindices;
+} DRAWRANGE;
+
+typedef struct tagFRUSTUM
+{
+	float planes[6][4];   // a * x + b * y + c * z + d >= 0 inside each plane, not normalised
+	int pvertex[6][3];    // Bounds rows of the box corner furthest along each plane's normal
+	int nvertex[6][3];    // Bounds rows of the box corner furthest against each plane's normal
+} FRUSTUM;
+
+/*  Build a 4-wide bounding volume hierarchy for each sector of a world. Triangles   *
+ *  are split at the median centroid along the longest axis until batches of at most *
+ *  BVH_LEAF_TRIANGLES remain, and each sector's triangles are reordered so that     *
+ *  every leaf and every subtree covers one contiguous range of the index buffer.    *
+ *  Sector index ranges must already be set, the nodes are stored on the world.      *
+ *  indices     - Triangle list indices for the whole world, reordered in place      *
+ *  vertices    - Vertices referenced by indices                                     */
+bool BuildWorldBVH(WORLD *world, uint32_t *indices, const VERTEX *vertices);
+
+/*  Extract frustum planes from a combined view & projection matrix, optionally      *
+ *  narrowed to a rectangle of the screen.                                           *
+ *  window  - Normalised device coordinate rect as min x, min y, max x, max y, or NULL */
+void MakeFrustum(FRUSTUM *frustum, const mat4f viewproj, const float window[4]);
+
+/*  Cull a sector's hierarchy against a frustum, appending the index ranges of the   *
+ *  batches that may be visible in index buffer order and merging contiguous ones.   *
+ *  ranges must have room for one range per leaf in the sector.                      *
+ *  Returns the number of nodes tested.                                              */
+unsigned CullSector(const WORLD *world, const SECTOR *sector, const FRUSTUM *frustum,
+	DRAWRANGE *ranges, int *numranges);
+
+#endif//BVH_H
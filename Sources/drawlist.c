@@ -0,0 +1,285 @@
+#include "drawlist.h"
+#include "profile.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+
+// Double an array's capacity, NULL & the capacity unchanged when out of memory
+static void * Grow(void *array, int *max, size_t size)
+{
+	const int newmax = *max > 0 ? *max * 2 : 256;
+	void *grown = SDL_realloc(array, size * (size_t)newmax);
+	if (grown)
+	{
+		*max = newmax;
+	}
+	return grown;
+}
+
+void AddDraw(DRAWLIST *list, Uint64 key, Uint32 firstindex, Uint32 numindices,
+	Uint32 firstinstance, Uint32 numinstances, const mat4f uniform)
+{
+	if (list->numcmds == list->maxcmds)
+	{
+		DRAWCMD *cmds = Grow(list->cmds, &list->maxcmds, sizeof(DRAWCMD));
+		if (!cmds)
+		{
+			list->failed = true;
+			return;
+		}
+		list->cmds = cmds;
+	}
+	int index = -1;
+	if (uniform)
+	{
+		if (list->numuniforms == list->maxuniforms)
+		{
+			mat4f *uniforms = Grow(list->uniforms, &list->maxuniforms, sizeof(mat4f));
+			if (!uniforms)
+			{
+				list->failed = true;
+				return;
+			}
+			list->uniforms = uniforms;
+		}
+		index = list->numuniforms++;
+		SDL_memcpy(list->uniforms[index], uniform, sizeof(mat4f));
+	}
+	list->cmds[list->numcmds++] = (DRAWCMD)
+	{
+		.key = key,
+		.firstindex = firstindex,
+		.numindices = numindices,
+		.firstinstance = firstinstance,
+		.numinstances = numinstances,
+		.uniform = index
+	};
+}
+
+/*  LSD radix sort by key, one pass per byte. Bytes that are the same in every key   *
+ *  (most of them, the keys use few bits) are skipped. Returns the sorted array,     *
+ *  either cmds or scratch.                                                          */
+static DRAWCMD * RadixSortDraws(DRAWCMD *cmds, DRAWCMD *scratch, int count)
+{
+	Uint64 all = ~(Uint64)0, any = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		all &= cmds[i].key;
+		any |= cmds[i].key;
+	}
+	const Uint64 varies = all ^ any;
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		if (((varies >> shift) & 0xFF) == 0)
+		{
+			continue;
+		}
+		int offsets[256] = { 0 };
+		for (int i = 0; i < count; ++i)
+		{
+			++offsets[(cmds[i].key >> shift) & 0xFF];
+		}
+		for (int i = 0, sum = 0; i < 256; ++i)
+		{
+			const int n = offsets[i];
+			offsets[i] = sum;
+			sum += n;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			scratch[offsets[(cmds[i].key >> shift) & 0xFF]++] = cmds[i];
+		}
+		DRAWCMD *swap = cmds;
+		cmds = scratch;
+		scratch = swap;
+	}
+	return cmds;
+}
+
+// Whether next can be drawn by the same call as prev, extending its index range
+static bool Continues(Uint32 prevstate, Uint32 prevfirst, Uint32 prevcount, Uint32 previnstance, Uint32 previnstances,
+	Uint32 state, const DRAWCMD *next)
+{
+	return prevstate == state && prevfirst + prevcount == next->firstindex &&
+		previnstance == next->firstinstance && previnstances == next->numinstances;
+}
+
+// Sort a list by key and merge runs of draws that continue each other, draws with their own uniform stay apart
+static void SortDraws(DRAWLIST *list)
+{
+	bool sorted = true;
+	for (int i = 1; i < list->numcmds && sorted; ++i)
+	{
+		sorted = list->cmds[i - 1].key <= list->cmds[i].key;
+	}
+	if (!sorted)
+	{
+		// The scratch buffer keeps the same capacity as the draws, so the two can be swapped
+		if (list->maxscratch < list->maxcmds)
+		{
+			SDL_free(list->scratch);
+			list->maxscratch = 0;
+			if (!(list->scratch = SDL_malloc(sizeof(DRAWCMD) * (size_t)list->maxcmds)))
+			{
+				list->failed = true;
+				list->numcmds = 0;
+				return;
+			}
+			list->maxscratch = list->maxcmds;
+		}
+		DRAWCMD *cmds = RadixSortDraws(list->cmds, list->scratch, list->numcmds);
+		if (cmds != list->cmds)
+		{
+			const int maxcmds = list->maxcmds;
+			list->scratch = list->cmds;
+			list->cmds = cmds;
+			list->maxcmds = list->maxscratch;
+			list->maxscratch = maxcmds;
+		}
+	}
+
+	int count = 0;
+	for (int i = 0; i < list->numcmds; ++i)
+	{
+		const DRAWCMD *cmd = &list->cmds[i];
+		DRAWCMD *prev = count > 0 ? &list->cmds[count - 1] : NULL;
+		if (prev && prev->uniform < 0 && cmd->uniform < 0 && Continues(DRAWKEY_STATE(prev->key), prev->firstindex,
+			prev->numindices, prev->firstinstance, prev->numinstances, DRAWKEY_STATE(cmd->key), cmd))
+		{
+			prev->numindices += cmd->numindices;
+		}
+		else
+		{
+			list->cmds[count++] = *cmd;
+		}
+	}
+	list->numcmds = count;
+}
+
+static void BuildChunk(void *data)
+{
+	const DRAWCHUNK *chunk = data;
+	DRAWLIST *list = chunk->list;
+	list->numcmds = list->numuniforms = 0;
+	list->failed = false;
+	chunk->func(chunk->data, chunk->first, chunk->end, list);
+	SortDraws(list);
+}
+
+// Merge the sorted lists into batches, merging draws across lists the same way as within them
+static bool MergeDrawLists(DRAWBUILDER *builder)
+{
+	int total = 0;
+	bool failed = false;
+	for (int i = 0; i < builder->numlists; ++i)
+	{
+		total += builder->lists[i].numcmds;
+		failed |= builder->lists[i].failed;
+	}
+	builder->numcmds = total;
+	builder->numbatches = builder->numstates = 0;
+	if (total > builder->maxbatches)
+	{
+		DRAWBATCH *batches = SDL_realloc(builder->batches, sizeof(DRAWBATCH) * (size_t)total);
+		if (!batches)
+		{
+			return false;
+		}
+		builder->batches = batches;
+		builder->maxbatches = total;
+	}
+
+	int heads[JOBS_MAX_THREADS + 1] = { 0 };
+	for (int n = 0; n < total; ++n)
+	{
+		// Few lists, a linear scan for the smallest key beats a heap
+		const DRAWLIST *list = NULL;
+		int best = -1;
+		for (int i = 0; i < builder->numlists; ++i)
+		{
+			const DRAWLIST *other = &builder->lists[i];
+			if (heads[i] < other->numcmds && (best < 0 || other->cmds[heads[i]].key < list->cmds[heads[best]].key))
+			{
+				list = other;
+				best = i;
+			}
+		}
+		const DRAWCMD *cmd = &list->cmds[heads[best]++];
+		const Uint32 state = DRAWKEY_STATE(cmd->key);
+		DRAWBATCH *prev = builder->numbatches > 0 ? &builder->batches[builder->numbatches - 1] : NULL;
+		if (prev && !prev->uniform && cmd->uniform < 0 && Continues(prev->state, prev->firstindex, prev->numindices,
+			prev->firstinstance, prev->numinstances, state, cmd))
+		{
+			prev->numindices += cmd->numindices;
+			continue;
+		}
+		if (!prev || prev->state != state)
+		{
+			++builder->numstates;
+		}
+		builder->batches[builder->numbatches++] = (DRAWBATCH)
+		{
+			.state = state,
+			.firstindex = cmd->firstindex,
+			.numindices = cmd->numindices,
+			.firstinstance = cmd->firstinstance,
+			.numinstances = cmd->numinstances,
+			.uniform = cmd->uniform >= 0 ? list->uniforms[cmd->uniform] : NULL
+		};
+	}
+	return !failed;
+}
+
+bool BuildDrawBatches(DRAWBUILDER *builder, JOBQUEUE *jobs, int numitems, DRAWBUILDFUNC func, void *data)
+{
+	int numchunks = 1;
+	if (jobs && numitems >= 2 * DRAWLIST_MIN_JOB_ITEMS)
+	{
+		numchunks = SDL_min(jobs->numthreads + 1, numitems / DRAWLIST_MIN_JOB_ITEMS);
+	}
+
+	PROFILE_BEGIN("Build draws");
+	for (int i = 0; i < numchunks; ++i)
+	{
+		builder->chunks[i] = (DRAWCHUNK)
+		{
+			.func = func,
+			.data = data,
+			.first = (int)((Sint64)numitems * i / numchunks),
+			.end = (int)((Sint64)numitems * (i + 1) / numchunks),
+			.list = &builder->lists[i]
+		};
+	}
+	// The caller builds the first chunk itself rather than wait idle
+	for (int i = 1; i < numchunks; ++i)
+	{
+		PushJob(jobs, &builder->jobs[i - 1], BuildChunk, &builder->chunks[i]);
+	}
+	BuildChunk(&builder->chunks[0]);
+	for (int i = 1; i < numchunks; ++i)
+	{
+		WaitJob(jobs, &builder->jobs[i - 1]);
+	}
+	builder->numlists = numchunks;
+	PROFILE_END();
+
+	PROFILE_BEGIN("Merge draws");
+	const bool merged = MergeDrawLists(builder);
+	PROFILE_END();
+	if (!merged)
+	{
+		return SDL_SetError("Out of memory building draws");
+	}
+	return true;
+}
+
+void FreeDrawBuilder(DRAWBUILDER *builder)
+{
+	for (int i = 0; i < JOBS_MAX_THREADS + 1; ++i)
+	{
+		SDL_free(builder->lists[i].uniforms);
+		SDL_free(builder->lists[i].scratch);
+		SDL_free(builder->lists[i].cmds);
+	}
+	SDL_free(builder->batches);
+	SDL_zerop(builder);
+}
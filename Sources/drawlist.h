@@ -0,0 +1,99 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include "matrix.h"
+#include "jobs.h"
+
+#define DRAWLIST_MIN_JOB_ITEMS 4096  // Fewest items worth handing to a worker, smaller builds run on the caller
+
+/*  Draws are sorted by a 64-bit key: the binding state in the top 24 bits so each   *
+ *  state is bound once, then an order within the state (the first index, so ranges  *
+ *  that follow each other in the index buffer end up next to each other & merge).   */
+#define DRAWKEY_STATE_SHIFT 40
+#define DRAWKEY(state, order) (((Uint64)(state) << DRAWKEY_STATE_SHIFT) | ((Uint64)(order) & 0xFFFFFFFFFFull))
+#define DRAWKEY_STATE(key)    ((Uint32)((key) >> DRAWKEY_STATE_SHIFT))
+
+/*  Front to back orders put a depth bucket above the first index, nearer buckets    *
+ *  sort first and draws in one bucket still merge when their indices follow on.     */
+#define DRAWKEY_DEPTH_SHIFT   32
+#define DRAWKEY_DEPTH_BUCKETS 256
+
+/*  Order within a state drawing nearer draws first. Distances up to maxdistance are *
+ *  bucketed by their square root, finer near the eye where most of the screen is.   */
+static inline Uint64 FrontToBackOrder(float distance, float maxdistance, Uint32 firstindex)
+{
+	const float bucket = SDL_sqrtf(SDL_max(distance, 0.0f) / maxdistance) * (float)DRAWKEY_DEPTH_BUCKETS;
+	const Uint64 depth = (Uint64)SDL_min(bucket, (float)(DRAWKEY_DEPTH_BUCKETS - 1));
+	return (depth << DRAWKEY_DEPTH_SHIFT) | firstindex;
+}
+
+typedef struct tagDRAWCMD
+{
+	Uint64 key;
+	Uint32 firstindex, numindices;
+	Uint32 firstinstance, numinstances;
+	int uniform;               // Index into the list's matrices pushed before the draw, -1 to keep the pass's
+} DRAWCMD;
+
+// Draws prepared by one thread, only ever touched by that thread until the build is done
+typedef struct tagDRAWLIST
+{
+	int numcmds, maxcmds;
+	DRAWCMD *cmds;
+	int maxscratch;
+	DRAWCMD *scratch;          // Radix sort buffer, swapped with cmds when the sort ends in it
+	int numuniforms, maxuniforms;
+	mat4f *uniforms;
+	bool failed;               // An allocation failed and draws were dropped
+} DRAWLIST;
+
+// A merged draw ready to be recorded into a render pass
+typedef struct tagDRAWBATCH
+{
+	Uint32 state;              // Binding state, DRAWKEY_STATE of the draws merged
+	Uint32 firstindex, numindices;
+	Uint32 firstinstance, numinstances;
+	const float *uniform;      // Matrix to push before drawing, NULL to keep the pass's
+} DRAWBATCH;
+
+/*  Fill list with the draws of items first to end - 1 of whatever is being drawn,   *
+ *  called from several threads at once with disjoint ranges of items                */
+typedef void (*DRAWBUILDFUNC)(void *data, int first, int end, DRAWLIST *list);
+
+typedef struct tagDRAWCHUNK
+{
+	DRAWBUILDFUNC func;
+	void *data;
+	int first, end;
+	DRAWLIST *list;
+} DRAWCHUNK;
+
+typedef struct tagDRAWBUILDER
+{
+	int numlists;              // Lists filled by the last build, one per chunk of items
+	DRAWLIST lists[JOBS_MAX_THREADS + 1];
+	int numbatches, maxbatches;
+	DRAWBATCH *batches;        // Every list's draws merged in key order, valid until the next build
+	int numstates;             // State changes between the batches, counting the first bind
+	int numcmds;               // Draws the lists held before merging
+
+	// Internal
+	DRAWCHUNK chunks[JOBS_MAX_THREADS + 1];
+	JOB jobs[JOBS_MAX_THREADS];
+} DRAWBUILDER;
+
+/*  Append a draw to list, uniform is copied when not NULL. The draw is dropped and  *
+ *  list->failed set when out of memory.                                             */
+void AddDraw(DRAWLIST *list, Uint64 key, Uint32 firstindex, Uint32 numindices,
+	Uint32 firstinstance, Uint32 numinstances, const mat4f uniform);
+
+/*  Build the draws of numitems items, split into one chunk per worker plus one for  *
+ *  the caller when there are enough items (all on the caller when jobs is NULL).    *
+ *  Each chunk is radix sorted by key and draws of the same state that continue the  *
+ *  previous one's indices are merged, then the chunks are merged into batches on    *
+ *  the caller. Returns false if anything was dropped for lack of memory.            */
+bool BuildDrawBatches(DRAWBUILDER *builder, JOBQUEUE *jobs, int numitems, DRAWBUILDFUNC func, void *data);
+
+void FreeDrawBuilder(DRAWBUILDER *builder);
+
+#endif//DRAWLIST_H
@@ -0,0 +1,101 @@
+#include "gputimer.h"
+#include "profile.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_timer.h>
+
+typedef struct tagGPUTIMERFRAME
+{
+	SDL_GPUFence *fence;         // NULL asks the timer thread to return
+	Uint64 submitticks;
+} GPUTIMERFRAME;
+
+static int SDLCALL GPUTimerThread(void *data)
+{
+	GPUTIMER *timer = data;
+	PROFILE_THREAD("GPU timer");
+	Uint64 lastdone = 0;
+	for (;;)
+	{
+		SDL_WaitSemaphore(timer->wake);
+		GPUTIMERFRAME frame;
+		if (!PopSPSC(&timer->submitted, &frame))
+		{
+			continue;
+		}
+		if (!frame.fence)
+		{
+			return 0;
+		}
+		SDL_WaitForGPUFences(timer->dev, true, &frame.fence, 1);
+		const Uint64 done = SDL_GetPerformanceCounter();
+		SDL_ReleaseGPUFence(timer->dev, frame.fence);
+
+		// Queued behind the previous frame, the GPU only started on this one once that was done
+		const Uint64 start = SDL_max(frame.submitticks, lastdone);
+		const float ms = (float)((double)(done - SDL_min(start, done)) * 1e3 / (double)SDL_GetPerformanceFrequency());
+		lastdone = done;
+		PushSPSC(&timer->timed, &ms);  // Holds every frame in flight, so can't be full
+	}
+}
+
+bool StartGPUTimer(GPUTIMER *timer, SDL_GPUDevice *dev)
+{
+	SDL_zerop(timer);
+	timer->dev = dev;
+	// Room for every frame in flight plus the quit request
+	if (!InitSPSCQueue(&timer->submitted, sizeof(GPUTIMERFRAME), GPUTIMER_FRAMES + 1) ||
+		!InitSPSCQueue(&timer->timed, sizeof(float), GPUTIMER_FRAMES) ||
+		!(timer->wake = SDL_CreateSemaphore(0)) ||
+		!(timer->thread = SDL_CreateThread(GPUTimerThread, "GPU timer", timer)))
+	{
+		StopGPUTimer(timer);
+		return false;
+	}
+	return true;
+}
+
+void StopGPUTimer(GPUTIMER *timer)
+{
+	if (timer->thread)
+	{
+		const GPUTIMERFRAME quit = { .fence = NULL };
+		PushSPSC(&timer->submitted, &quit);
+		SDL_SignalSemaphore(timer->wake);
+		SDL_WaitThread(timer->thread, NULL);
+		timer->thread = NULL;
+	}
+	SDL_DestroySemaphore(timer->wake);
+	timer->wake = NULL;
+	FreeSPSCQueue(&timer->timed);
+	FreeSPSCQueue(&timer->submitted);
+	timer->inflight = 0;
+}
+
+void TimeGPUFrame(GPUTIMER *timer, Uint64 submitticks)
+{
+	if (!timer->thread || timer->inflight >= GPUTIMER_FRAMES)
+	{
+		return;
+	}
+	// Command buffers run in submission order, so this one's fence signals once the frame is done
+	SDL_GPUCommandBuffer *cmdbuf = SDL_AcquireGPUCommandBuffer(timer->dev);
+	SDL_GPUFence *fence = cmdbuf ? SDL_SubmitGPUCommandBufferAndAcquireFence(cmdbuf) : NULL;
+	if (!fence)
+	{
+		return;
+	}
+	const GPUTIMERFRAME frame = { .fence = fence, .submitticks = submitticks };
+	PushSPSC(&timer->submitted, &frame);
+	SDL_SignalSemaphore(timer->wake);
+	++timer->inflight;
+}
+
+bool PopGPUFrameTime(GPUTIMER *timer, float *ms)
+{
+	if (!timer->thread || !PopSPSC(&timer->timed, ms))
+	{
+		return false;
+	}
+	--timer->inflight;
+	return true;
+}
@@ -0,0 +1,40 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include "jobs.h"
+#include <SDL3/SDL_gpu.h>
+#include <SDL3/SDL_thread.h>
+
+#define GPUTIMER_FRAMES 4  // Frames timed at once, frames submitted while that many are in flight aren't timed
+
+/*  SDL GPU has no timestamp queries, so the GPU's time on each frame is measured    *
+ *  from the CPU: a thread waits on a fence submitted right after the frame and      *
+ *  notes when it signals. A frame's time runs from when the GPU could start on it,  *
+ *  its submit or the previous timed frame finishing, whichever is later, so it      *
+ *  includes anything else submitted in between, such as presenting.                 */
+typedef struct tagGPUTIMER
+{
+	SDL_GPUDevice *dev;
+	SDL_Thread *thread;          // NULL when frames aren't being timed
+	SPSCQUEUE submitted;         // Frames to wait on, submitting thread -> timer thread
+	SPSCQUEUE timed;             // Milliseconds each frame took, timer thread -> submitting thread
+	SDL_Semaphore *wake;         // Signalled with each frame pushed
+	int inflight;                // Pushed & not yet popped, submitting thread only
+} GPUTIMER;
+
+/*  Start the thread waiting on frames. Every other call is from one submitting      *
+ *  thread, which may change while nothing is being timed.                           */
+bool StartGPUTimer(GPUTIMER *timer, SDL_GPUDevice *dev);
+
+/*  Stop waiting, after the frames still in flight have finished                     */
+void StopGPUTimer(GPUTIMER *timer);
+
+/*  Time the frame just submitted, by submitting an empty command buffer after it.   *
+ *  Does nothing when the timer isn't running or GPUTIMER_FRAMES are in flight.      *
+ *  submitticks - Performance counter when the frame was submitted                  */
+void TimeGPUFrame(GPUTIMER *timer, Uint64 submitticks);
+
+/*  The oldest timed frame's GPU milliseconds, false when none has finished          */
+bool PopGPUFrameTime(GPUTIMER *timer, float *ms);
+
+#endif//GPUTIMER_H
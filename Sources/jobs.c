@@ -0,0 +1,208 @@
+#include "jobs.h"
+#include "profile.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_assert.h>
+#include <SDL3/SDL_cpuinfo.h>
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_thread.h>
+
+// Take the oldest queued job, NULL if the queue is empty
+static JOB * PopJob(JOBQUEUE *jobs, bool *quit)
+{
+	JOB *job = NULL;
+	SDL_LockMutex(jobs->lock);
+	if (quit)
+	{
+		*quit = jobs->quit;
+	}
+	if (jobs->count > 0)
+	{
+		job = jobs->queue[jobs->head];
+		jobs->head = (jobs->head + 1) % JOBS_QUEUE_SIZE;
+		--jobs->count;
+	}
+	SDL_UnlockMutex(jobs->lock);
+	return job;
+}
+
+static void RunJob(JOB *job)
+{
+	job->func(job->data);
+	SDL_SignalSemaphore(job->done);
+}
+
+static int SDLCALL WorkerThread(void *data)
+{
+	JOBQUEUE *jobs = data;
+	PROFILE_THREAD("Worker");
+	for (;;)
+	{
+		bool quit;
+		SDL_WaitSemaphore(jobs->pending);
+		JOB *job = PopJob(jobs, &quit);
+		if (job)
+		{
+			RunJob(job);
+		}
+		else if (quit)
+		{
+			return 0;
+		}
+	}
+}
+
+bool InitJobQueue(JOBQUEUE *jobs, int numthreads)
+{
+	SDL_zerop(jobs);
+	if (numthreads <= 0)
+	{
+		numthreads = SDL_GetNumLogicalCPUCores() - 1;
+	}
+	numthreads = SDL_clamp(numthreads, 0, JOBS_MAX_THREADS);
+
+	jobs->lock = SDL_CreateMutex();
+	jobs->pending = SDL_CreateSemaphore(0);
+	if (!jobs->lock || !jobs->pending)
+	{
+		FreeJobQueue(jobs);
+		return false;
+	}
+	for (int i = 0; i < numthreads; ++i)
+	{
+		char name[16];
+		SDL_snprintf(name, sizeof(name), "Worker %d", i);
+		if (!(jobs->threads[i] = SDL_CreateThread(WorkerThread, name, jobs)))
+		{
+			break;  // Run with the workers that did start
+		}
+		++jobs->numthreads;
+	}
+	return true;
+}
+
+void FreeJobQueue(JOBQUEUE *jobs)
+{
+	if (jobs->pending)
+	{
+		// Queued jobs are run first, then each worker wakes to find the queue empty and quits
+		SDL_LockMutex(jobs->lock);
+		jobs->quit = true;
+		SDL_UnlockMutex(jobs->lock);
+		for (int i = 0; i < jobs->numthreads; ++i)
+		{
+			SDL_SignalSemaphore(jobs->pending);
+		}
+		for (int i = 0; i < jobs->numthreads; ++i)
+		{
+			SDL_WaitThread(jobs->threads[i], NULL);
+		}
+		for (JOB *job; (job = PopJob(jobs, NULL));)
+		{
+			RunJob(job);
+		}
+	}
+	SDL_DestroySemaphore(jobs->pending);
+	SDL_DestroyMutex(jobs->lock);
+	SDL_zerop(jobs);
+}
+
+bool PushJob(JOBQUEUE *jobs, JOB *job, JOBFUNC func, void *data)
+{
+	SDL_assert(jobs && job && func && !jobs->quit);
+	job->func = func;
+	job->data = data;
+	if (!(job->done = SDL_CreateSemaphore(0)))
+	{
+		func(data);
+		return false;
+	}
+
+	SDL_LockMutex(jobs->lock);
+	const bool queued = jobs->count < JOBS_QUEUE_SIZE;
+	if (queued)
+	{
+		jobs->queue[(jobs->head + jobs->count++) % JOBS_QUEUE_SIZE] = job;
+	}
+	SDL_UnlockMutex(jobs->lock);
+	if (!queued)
+	{
+		RunJob(job);
+		return SDL_SetError("Job queue full");
+	}
+	SDL_SignalSemaphore(jobs->pending);
+	return true;
+}
+
+void WaitJob(JOBQUEUE *jobs, JOB *job)
+{
+	if (!job->done)
+	{
+		return;
+	}
+	// Run other queued jobs rather than sit idle, the job being waited on may be one of them
+	PROFILE_BEGIN("Wait job");
+	while (!SDL_TryWaitSemaphore(job->done))
+	{
+		JOB *other = PopJob(jobs, NULL);
+		if (!other)
+		{
+			SDL_WaitSemaphore(job->done);
+			break;
+		}
+		RunJob(other);
+	}
+	PROFILE_END();
+	SDL_DestroySemaphore(job->done);
+	job->done = NULL;
+}
+
+bool JobDone(const JOB *job)
+{
+	return !job->done || SDL_GetSemaphoreValue(job->done) > 0;
+}
+
+bool InitSPSCQueue(SPSCQUEUE *queue, size_t elemsize, int capacity)
+{
+	SDL_assert(capacity > 0);
+	SDL_zerop(queue);
+	// One slot always stays empty to tell a full queue from an empty one
+	if (!(queue->slots = SDL_malloc(elemsize * (size_t)(capacity + 1))))
+	{
+		return false;
+	}
+	queue->elemsize = elemsize;
+	queue->capacity = capacity + 1;
+	return true;
+}
+
+void FreeSPSCQueue(SPSCQUEUE *queue)
+{
+	SDL_free(queue->slots);
+	SDL_zerop(queue);
+}
+
+bool PushSPSC(SPSCQUEUE *queue, const void *elem)
+{
+	const int tail = SDL_GetAtomicInt(&queue->tail);
+	const int next = (tail + 1) % queue->capacity;
+	if (next == SDL_GetAtomicInt(&queue->head))
+	{
+		return false;
+	}
+	SDL_memcpy(queue->slots + queue->elemsize * (size_t)tail, elem, queue->elemsize);
+	SDL_SetAtomicInt(&queue->tail, next);
+	return true;
+}
+
+bool PopSPSC(SPSCQUEUE *queue, void *elem)
+{
+	const int head = SDL_GetAtomicInt(&queue->head);
+	if (head == SDL_GetAtomicInt(&queue->tail))
+	{
+		return false;
+	}
+	SDL_memcpy(elem, queue->slots + queue->elemsize * (size_t)head, queue->elemsize);
+	SDL_SetAtomicInt(&queue->head, (head + 1) % queue->capacity);
+	return true;
+}
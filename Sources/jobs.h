@@ -0,0 +1,73 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_atomic.h>
+
+#define JOBS_MAX_THREADS 16   // Most worker threads started
+#define JOBS_QUEUE_SIZE  256  // Most jobs waiting at once, further jobs run on the caller
+
+typedef void (*JOBFUNC)(void *data);
+
+typedef struct tagJOB
+{
+	JOBFUNC func;
+	void *data;
+	struct SDL_Semaphore *done;  // Signalled once the job has run, NULL when not pushed or already waited on
+} JOB;
+
+typedef struct tagJOBQUEUE
+{
+	struct SDL_Thread *threads[JOBS_MAX_THREADS];
+	int numthreads;
+	struct SDL_Mutex *lock;      // Guards the queue
+	struct SDL_Semaphore *pending;  // Counts queued jobs, idle workers sleep on it
+	JOB *queue[JOBS_QUEUE_SIZE];
+	int head, count;
+	bool quit;
+} JOBQUEUE;
+
+/*  Start a pool of worker threads that run pushed jobs in submission order.         *
+ *  numthreads  - Workers to start, 0 picks one less than the number of CPU cores.   *
+ *                The queue still works with no workers, jobs then run in WaitJob.   */
+bool InitJobQueue(JOBQUEUE *jobs, int numthreads);
+
+/*  Run every job still queued, then stop and join the workers                       */
+void FreeJobQueue(JOBQUEUE *jobs);
+
+/*  Queue func(data) to run on a worker. The job must stay alive until WaitJob       *
+ *  returns for it. Returns false with the error set if the job couldn't be queued,  *
+ *  in which case it has already run on the calling thread.                          */
+bool PushJob(JOBQUEUE *jobs, JOB *job, JOBFUNC func, void *data);
+
+/*  Block until a pushed job has run, helping with queued jobs while waiting. Does   *
+ *  nothing for jobs that were never pushed or have already been waited on.          */
+void WaitJob(JOBQUEUE *jobs, JOB *job);
+
+/*  Whether a pushed job has run, without blocking or helping. WaitJob still has to  *
+ *  be called on it, which then returns at once.                                     */
+bool JobDone(const JOB *job);
+
+/*  Lock-free queue of fixed size elements between exactly one producer thread and   *
+ *  one consumer thread. Each index is only written by its own side, the atomic      *
+ *  store publishing it orders the element copy before it.                           */
+typedef struct tagSPSCQUEUE
+{
+	Uint8 *slots;
+	size_t elemsize;
+	int capacity;
+	SDL_AtomicInt head;          // Next slot to pop, written by the consumer
+	SDL_AtomicInt tail;          // Next slot to push, written by the producer
+} SPSCQUEUE;
+
+bool InitSPSCQueue(SPSCQUEUE *queue, size_t elemsize, int capacity);
+void FreeSPSCQueue(SPSCQUEUE *queue);
+
+/*  Copy an element into the queue, false if it's full. Producer thread only.        */
+bool PushSPSC(SPSCQUEUE *queue, const void *elem);
+
+/*  Copy the oldest element out of the queue, false if it's empty. Consumer thread   *
+ *  only.                                                                            */
+bool PopSPSC(SPSCQUEUE *queue, void *elem);
+
+#endif//JOBS_H
@@ -1,8 +1,88 @@
 #include "matrix.h"
 #include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_intrin.h>
 
+// Pick a 4-wide vector unit at compile time, AVX is used for multiplies when the compiler targets it
+#if defined(SDL_SSE_INTRINSICS)
+typedef __m128 VEC4;
+#define VEC4_LOAD(p)     _mm_loadu_ps(p)
+#define VEC4_STORE(p, v) _mm_storeu_ps(p, v)
+#define VEC4_SPLAT(f)    _mm_set1_ps(f)
+#define VEC4_ADD(a, b)   _mm_add_ps(a, b)
+#define VEC4_SUB(a, b)   _mm_sub_ps(a, b)
+#define VEC4_MUL(a, b)   _mm_mul_ps(a, b)
+#define MATRIX_SIMD
+#elif defined(SDL_NEON_INTRINSICS)
+typedef float32x4_t VEC4;
+#define VEC4_LOAD(p)     vld1q_f32(p)
+#define VEC4_STORE(p, v) vst1q_f32(p, v)
+#define VEC4_SPLAT(f)    vdupq_n_f32(f)
+#define VEC4_ADD(a, b)   vaddq_f32(a, b)
+#define VEC4_SUB(a, b)   vsubq_f32(a, b)
+#define VEC4_MUL(a, b)   vmulq_f32(a, b)
+#define MATRIX_SIMD
+#else
+// Plain C stand-in so the batch functions, which vectorise across matrices, still have one implementation
+typedef struct { float v[4]; } VEC4;
 
-void MulMatrices(mat4f mtx, const mat4f lhs, const mat4f rhs)
+static inline VEC4 Vec4Load(const float *p)
+{
+	VEC4 r;
+	SDL_memcpy(r.v, p, sizeof(r.v));
+	return r;
+}
+
+static inline void Vec4Store(float *p, VEC4 v)
+{
+	SDL_memcpy(p, v.v, sizeof(v.v));
+}
+
+static inline VEC4 Vec4Splat(float f)
+{
+	const VEC4 r = { { f, f, f, f } };
+	return r;
+}
+
+static inline VEC4 Vec4Add(VEC4 a, VEC4 b)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		a.v[i] += b.v[i];
+	}
+	return a;
+}
+
+static inline VEC4 Vec4Sub(VEC4 a, VEC4 b)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		a.v[i] -= b.v[i];
+	}
+	return a;
+}
+
+static inline VEC4 Vec4Mul(VEC4 a, VEC4 b)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		a.v[i] *= b.v[i];
+	}
+	return a;
+}
+
+#define VEC4_LOAD(p)     Vec4Load(p)
+#define VEC4_STORE(p, v) Vec4Store(p, v)
+#define VEC4_SPLAT(f)    Vec4Splat(f)
+#define VEC4_ADD(a, b)   Vec4Add(a, b)
+#define VEC4_SUB(a, b)   Vec4Sub(a, b)
+#define VEC4_MUL(a, b)   Vec4Mul(a, b)
+#endif
+#if defined(SDL_AVX_INTRINSICS) && defined(__AVX__)
+#define MATRIX_AVX
+#endif
+
+
+void MulMatricesScalar(mat4f mtx, const mat4f lhs, const mat4f rhs)
 {
 	int i = 0;
 	for (int col = 0; col < 4; ++col)
@@ -61,22 +141,31 @@ static void MakeRotation(float m[9], float theta, float x, float y, float z)
 	m[8] = rcz * z + c;
 }
 
-void Rotate(mat4f m, float angle, float x, float y, float z)
+static void NormaliseAxis(float *x, float *y, float *z)
 {
-	// Treat inputs like glRotatef
-	const float theta = angle * SDL_PI_F / 180.f;
-	const float axismag = SDL_sqrtf(x * x + y * y + z * z);
+	const float axismag = SDL_sqrtf(*x * *x + *y * *y + *z * *z);
 	if (SDL_fabsf(axismag - 1.f) > SDL_FLT_EPSILON)
 	{
-		x /= axismag;
-		y /= axismag;
-		z /= axismag;
+		*x /= axismag;
+		*y /= axismag;
+		*z /= axismag;
 	}
+}
 
+// Rotation matrix for an angle in degrees about an axis, treating inputs like glRotatef
+static void AxisRotation(float r[9], float angle, float x, float y, float z)
+{
+	const float theta = angle * SDL_PI_F / 180.f;
+	NormaliseAxis(&x, &y, &z);
+	MakeRotation(r, theta, x, y, z);
+}
+
+void RotateScalar(mat4f m, float angle, float x, float y, float z)
+{
 	// Set up temporaries
 	float tmp[12], r[9];
 	SDL_memcpy(tmp, m, sizeof(float) * 12);
-	MakeRotation(r, theta, x, y, z);
+	AxisRotation(r, angle, x, y, z);
 
 	// Partial matrix multiplication
 	m[0]  = r[0] * tmp[0] + r[1] * tmp[4] + r[2] * tmp[8];
@@ -93,7 +182,7 @@ void Rotate(mat4f m, float angle, float x, float y, float z)
 	m[11] = r[6] * tmp[3] + r[7] * tmp[7] + r[8] * tmp[11];
 }
 
-void Translate(float m[16], float x, float y, float z)
+void TranslateScalar(float m[16], float x, float y, float z)
 {
 	/*
 	  m = { [1 0 0 x]
@@ -106,3 +195,232 @@ void Translate(float m[16], float x, float y, float z)
 	m[14] += x * m[2] + y * m[6] + z * m[10];
 	m[15] += x * m[3] + y * m[7] + z * m[11];
 }
+
+#if defined(MATRIX_AVX)
+static inline __m256 BroadcastColumn(const float *column)
+{
+	const __m128 c = _mm_loadu_ps(column);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(c), c, 1);
+}
+#endif
+
+void MulMatrices(mat4f mtx, const mat4f lhs, const mat4f rhs)
+{
+#if defined(MATRIX_AVX)
+	// Two result columns per 256-bit register, each half picks its own column's rhs element
+	const __m256 c0 = BroadcastColumn(&lhs[0]), c1 = BroadcastColumn(&lhs[4]);
+	const __m256 c2 = BroadcastColumn(&lhs[8]), c3 = BroadcastColumn(&lhs[12]);
+	const __m256 r01 = _mm256_loadu_ps(&rhs[0]), r23 = _mm256_loadu_ps(&rhs[8]);
+	__m256 m01 = _mm256_mul_ps(c0, _mm256_shuffle_ps(r01, r01, 0x00));
+	__m256 m23 = _mm256_mul_ps(c0, _mm256_shuffle_ps(r23, r23, 0x00));
+	m01 = _mm256_add_ps(m01, _mm256_mul_ps(c1, _mm256_shuffle_ps(r01, r01, 0x55)));
+	m23 = _mm256_add_ps(m23, _mm256_mul_ps(c1, _mm256_shuffle_ps(r23, r23, 0x55)));
+	m01 = _mm256_add_ps(m01, _mm256_mul_ps(c2, _mm256_shuffle_ps(r01, r01, 0xAA)));
+	m23 = _mm256_add_ps(m23, _mm256_mul_ps(c2, _mm256_shuffle_ps(r23, r23, 0xAA)));
+	m01 = _mm256_add_ps(m01, _mm256_mul_ps(c3, _mm256_shuffle_ps(r01, r01, 0xFF)));
+	m23 = _mm256_add_ps(m23, _mm256_mul_ps(c3, _mm256_shuffle_ps(r23, r23, 0xFF)));
+	_mm256_storeu_ps(&mtx[0], m01);
+	_mm256_storeu_ps(&mtx[8], m23);
+#elif defined(MATRIX_SIMD)
+	const VEC4 c0 = VEC4_LOAD(&lhs[0]), c1 = VEC4_LOAD(&lhs[4]), c2 = VEC4_LOAD(&lhs[8]), c3 = VEC4_LOAD(&lhs[12]);
+	VEC4 out[4];
+	for (int col = 0; col < 4; ++col)
+	{
+		const float *r = &rhs[col * 4];
+		VEC4 a = VEC4_MUL(c0, VEC4_SPLAT(r[0]));
+		a = VEC4_ADD(a, VEC4_MUL(c1, VEC4_SPLAT(r[1])));
+		a = VEC4_ADD(a, VEC4_MUL(c2, VEC4_SPLAT(r[2])));
+		out[col] = VEC4_ADD(a, VEC4_MUL(c3, VEC4_SPLAT(r[3])));
+	}
+	for (int col = 0; col < 4; ++col)
+	{
+		VEC4_STORE(&mtx[col * 4], out[col]);
+	}
+#else
+	MulMatricesScalar(mtx, lhs, rhs);
+#endif
+}
+
+void Rotate(mat4f m, float angle, float x, float y, float z)
+{
+#if defined(MATRIX_SIMD)
+	float r[9];
+	AxisRotation(r, angle, x, y, z);
+	const VEC4 c0 = VEC4_LOAD(&m[0]), c1 = VEC4_LOAD(&m[4]), c2 = VEC4_LOAD(&m[8]);
+	for (int col = 0; col < 3; ++col)
+	{
+		const float *rc = &r[col * 3];
+		VEC4 a = VEC4_MUL(c0, VEC4_SPLAT(rc[0]));
+		a = VEC4_ADD(a, VEC4_MUL(c1, VEC4_SPLAT(rc[1])));
+		VEC4_STORE(&m[col * 4], VEC4_ADD(a, VEC4_MUL(c2, VEC4_SPLAT(rc[2]))));
+	}
+#else
+	RotateScalar(m, angle, x, y, z);
+#endif
+}
+
+void Translate(float m[16], float x, float y, float z)
+{
+#if defined(MATRIX_SIMD)
+	VEC4 a = VEC4_MUL(VEC4_LOAD(&m[0]), VEC4_SPLAT(x));
+	a = VEC4_ADD(a, VEC4_MUL(VEC4_LOAD(&m[4]), VEC4_SPLAT(y)));
+	a = VEC4_ADD(a, VEC4_MUL(VEC4_LOAD(&m[8]), VEC4_SPLAT(z)));
+	VEC4_STORE(&m[12], VEC4_ADD(VEC4_LOAD(&m[12]), a));
+#else
+	TranslateScalar(m, x, y, z);
+#endif
+}
+
+void PackMatrices(MAT4BLOCK *blocks, const mat4f *matrices, size_t count)
+{
+	static const mat4f identity = M4_IDENTITY;
+	for (size_t i = 0; i < MAT4_BLOCKS(count) * MAT4_LANES; ++i)
+	{
+		const float *m = i < count ? matrices[i] : identity;
+		for (int e = 0; e < 16; ++e)
+		{
+			blocks[i / MAT4_LANES].m[e][i % MAT4_LANES] = m[e];
+		}
+	}
+}
+
+void UnpackMatrices(mat4f *matrices, const MAT4BLOCK *blocks, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (int e = 0; e < 16; ++e)
+		{
+			matrices[i][e] = blocks[i / MAT4_LANES].m[e][i % MAT4_LANES];
+		}
+	}
+}
+
+// Load one value per lane for the block starting at matrix first, lanes past count get pad
+static inline VEC4 LoadLanes(const float *values, size_t first, size_t count, float pad)
+{
+	if (first + MAT4_LANES <= count)
+	{
+		return VEC4_LOAD(&values[first]);
+	}
+	float lanes[MAT4_LANES];
+	for (size_t i = 0; i < MAT4_LANES; ++i)
+	{
+		lanes[i] = first + i < count ? values[first + i] : pad;
+	}
+	return VEC4_LOAD(lanes);
+}
+
+void MulMatricesBatch(MAT4BLOCK *out, const mat4f lhs, const MAT4BLOCK *rhs, size_t count)
+{
+	// Each output column only reads the same rhs column, which is loaded before it is written, so out may be rhs
+#if defined(MATRIX_AVX)
+	// Rows are adjacent in a block, so compute two rows of four matrices per 256-bit register
+	__m256 l[4][2];
+	for (int j = 0; j < 4; ++j)
+	{
+		for (int pair = 0; pair < 2; ++pair)
+		{
+			const __m128 lo = _mm_set1_ps(lhs[j * 4 + pair * 2]), hi = _mm_set1_ps(lhs[j * 4 + pair * 2 + 1]);
+			l[j][pair] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+		}
+	}
+	for (size_t b = 0; b < MAT4_BLOCKS(count); ++b)
+	{
+		const MAT4BLOCK *r = &rhs[b];
+		for (int col = 0; col < 4; ++col)
+		{
+			const __m256 r0 = BroadcastColumn(r->m[col * 4]), r1 = BroadcastColumn(r->m[col * 4 + 1]);
+			const __m256 r2 = BroadcastColumn(r->m[col * 4 + 2]), r3 = BroadcastColumn(r->m[col * 4 + 3]);
+			for (int pair = 0; pair < 2; ++pair)
+			{
+				__m256 a = _mm256_mul_ps(l[0][pair], r0);
+				a = _mm256_add_ps(a, _mm256_mul_ps(l[1][pair], r1));
+				a = _mm256_add_ps(a, _mm256_mul_ps(l[2][pair], r2));
+				_mm256_storeu_ps(out[b].m[col * 4 + pair * 2], _mm256_add_ps(a, _mm256_mul_ps(l[3][pair], r3)));
+			}
+		}
+	}
+#else
+	VEC4 l[16];
+	for (int e = 0; e < 16; ++e)
+	{
+		l[e] = VEC4_SPLAT(lhs[e]);
+	}
+	for (size_t b = 0; b < MAT4_BLOCKS(count); ++b)
+	{
+		const MAT4BLOCK *r = &rhs[b];
+		for (int col = 0; col < 4; ++col)
+		{
+			const VEC4 r0 = VEC4_LOAD(r->m[col * 4]), r1 = VEC4_LOAD(r->m[col * 4 + 1]);
+			const VEC4 r2 = VEC4_LOAD(r->m[col * 4 + 2]), r3 = VEC4_LOAD(r->m[col * 4 + 3]);
+			for (int row = 0; row < 4; ++row)
+			{
+				VEC4 a = VEC4_MUL(l[row], r0);
+				a = VEC4_ADD(a, VEC4_MUL(l[4 + row], r1));
+				a = VEC4_ADD(a, VEC4_MUL(l[8 + row], r2));
+				VEC4_STORE(out[b].m[col * 4 + row], VEC4_ADD(a, VEC4_MUL(l[12 + row], r3)));
+			}
+		}
+	}
+#endif
+}
+
+void RotateBatch(MAT4BLOCK *m, size_t count, const float *angles, float x, float y, float z)
+{
+	// The axis is shared so only the sine & cosine differ between lanes, same terms as MakeRotation
+	NormaliseAxis(&x, &y, &z);
+	const VEC4 vx = VEC4_SPLAT(x), vy = VEC4_SPLAT(y), vz = VEC4_SPLAT(z), one = VEC4_SPLAT(1.f);
+	for (size_t b = 0; b < MAT4_BLOCKS(count); ++b)
+	{
+		const size_t first = b * MAT4_LANES;
+		float cosines[MAT4_LANES], sines[MAT4_LANES];
+		for (size_t i = 0; i < MAT4_LANES; ++i)
+		{
+			const float theta = (first + i < count ? angles[first + i] : 0.f) * SDL_PI_F / 180.f;
+			cosines[i] = SDL_cosf(theta);
+			sines[i] = SDL_sinf(theta);
+		}
+		const VEC4 c = VEC4_LOAD(cosines), s = VEC4_LOAD(sines);
+		const VEC4 rc = VEC4_SUB(one, c);
+		const VEC4 rcx = VEC4_MUL(vx, rc), rcy = VEC4_MUL(vy, rc), rcz = VEC4_MUL(vz, rc);
+		const VEC4 sx = VEC4_MUL(vx, s), sy = VEC4_MUL(vy, s), sz = VEC4_MUL(vz, s);
+		const VEC4 r[9] =
+		{
+			VEC4_ADD(VEC4_MUL(rcx, vx), c), VEC4_ADD(VEC4_MUL(rcy, vx), sz), VEC4_SUB(VEC4_MUL(rcz, vx), sy),
+			VEC4_SUB(VEC4_MUL(rcx, vy), sz), VEC4_ADD(VEC4_MUL(rcy, vy), c), VEC4_ADD(VEC4_MUL(rcz, vy), sx),
+			VEC4_ADD(VEC4_MUL(rcx, vz), sy), VEC4_SUB(VEC4_MUL(rcy, vz), sx), VEC4_ADD(VEC4_MUL(rcz, vz), c)
+		};
+
+		MAT4BLOCK *block = &m[b];
+		for (int row = 0; row < 4; ++row)
+		{
+			const VEC4 c0 = VEC4_LOAD(block->m[row]), c1 = VEC4_LOAD(block->m[4 + row]);
+			const VEC4 c2 = VEC4_LOAD(block->m[8 + row]);
+			for (int col = 0; col < 3; ++col)
+			{
+				VEC4 a = VEC4_MUL(r[col * 3], c0);
+				a = VEC4_ADD(a, VEC4_MUL(r[col * 3 + 1], c1));
+				VEC4_STORE(block->m[col * 4 + row], VEC4_ADD(a, VEC4_MUL(r[col * 3 + 2], c2)));
+			}
+		}
+	}
+}
+
+void TranslateBatch(MAT4BLOCK *m, size_t count, const float *x, const float *y, const float *z)
+{
+	for (size_t b = 0; b < MAT4_BLOCKS(count); ++b)
+	{
+		const size_t first = b * MAT4_LANES;
+		const VEC4 vx = LoadLanes(x, first, count, 0.f);
+		const VEC4 vy = LoadLanes(y, first, count, 0.f);
+		const VEC4 vz = LoadLanes(z, first, count, 0.f);
+		MAT4BLOCK *block = &m[b];
+		for (int row = 0; row < 4; ++row)
+		{
+			VEC4 a = VEC4_MUL(vx, VEC4_LOAD(block->m[row]));
+			a = VEC4_ADD(a, VEC4_MUL(vy, VEC4_LOAD(block->m[4 + row])));
+			a = VEC4_ADD(a, VEC4_MUL(vz, VEC4_LOAD(block->m[8 + row])));
+			VEC4_STORE(block->m[12 + row], VEC4_ADD(VEC4_LOAD(block->m[12 + row]), a));
+		}
+	}
+}
@@ -1,6 +1,8 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include <stddef.h>
+
 typedef float mat4f[16];
 
 #define M4_IDENTITY { \
@@ -14,4 +16,35 @@ void MakePerspective(mat4f m, float fovy, float aspect, float near, float far);
 void Rotate(mat4f m, float angle, float x, float y, float z);
 void Translate(float m[16], float x, float y, float z);
 
+// Plain C reference versions of the above, the default versions use SSE, AVX or NEON when compiled for them
+void MulMatricesScalar(mat4f mtx, const mat4f lhs, const mat4f rhs);
+void RotateScalar(mat4f m, float angle, float x, float y, float z);
+void TranslateScalar(float m[16], float x, float y, float z);
+
+/*  Batches of matrices are stored four to a block (AoSoA) so each element of four   *
+ *  matrices can be loaded as one vector, the batch functions vectorise across       *
+ *  matrices rather than within one. A batch of count matrices takes                 *
+ *  MAT4_BLOCKS(count) blocks, unused lanes of the last block are padding.           */
+#define MAT4_LANES 4
+#define MAT4_BLOCKS(count) (((count) + MAT4_LANES - 1) / MAT4_LANES)
+
+typedef struct tagMAT4BLOCK
+{
+	float m[16][MAT4_LANES];  // Element e of the block's matrix i in m[e][i], elements in mat4f order
+} MAT4BLOCK;
+
+/*  Convert between arrays of mat4f and blocks, padding lanes are set to identity    */
+void PackMatrices(MAT4BLOCK *blocks, const mat4f *matrices, size_t count);
+void UnpackMatrices(mat4f *matrices, const MAT4BLOCK *blocks, size_t count);
+
+/*  out[i] = lhs * rhs[i], such as a view & projection applied to many model         *
+ *  matrices. out may be the same array as rhs.                                      */
+void MulMatricesBatch(MAT4BLOCK *out, const mat4f lhs, const MAT4BLOCK *rhs, size_t count);
+
+/*  Rotate each matrix by its own angle in degrees about a shared axis, as Rotate     */
+void RotateBatch(MAT4BLOCK *m, size_t count, const float *angles, float x, float y, float z);
+
+/*  Translate each matrix by its own offset, as Translate                            */
+void TranslateBatch(MAT4BLOCK *m, size_t count, const float *x, const float *y, const float *z);
+
 #endif//MATRIX_H
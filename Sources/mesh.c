@@ -0,0 +1,612 @@
+#include "mesh.h"
+#include "bvh.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_log.h>
+
+#define NO_VERTEX SDL_MAX_UINT32
+#define NO_BOX 0xFF
+#define PACK_SNORM_MAX 32767   // Largest SNORM16 magnitude, -32768 decodes to -1 as well
+#define PACK_MIN_STEP (1.0 / (1 << 20))  // Finest lattice, for meshes that are all one point
+
+
+static inline Uint32 GetIndex(const MESH *mesh, Uint32 i)
+{
+	return mesh->indexsize == 2 ? ((const Uint16 *)mesh->indices)[i] : ((const Uint32 *)mesh->indices)[i];
+}
+
+static float IndicesACMR(const Uint32 *indices, Uint32 numindices, Uint32 numvertices, unsigned cachesize)
+{
+	// FIFO cache simulation, a vertex is resident if fewer than cachesize misses happened since it was loaded
+	Uint32 *loadtime = SDL_calloc(numvertices, sizeof(Uint32));
+	if (!loadtime || numindices == 0)
+	{
+		SDL_free(loadtime);
+		return 0.f;
+	}
+	Uint32 misses = 0, clock = cachesize + 1;
+	for (Uint32 i = 0; i < numindices; ++i)
+	{
+		const Uint32 v = indices[i];
+		if (clock - loadtime[v] > cachesize)
+		{
+			loadtime[v] = clock++;
+			++misses;
+		}
+	}
+	SDL_free(loadtime);
+	return (float)misses / (float)(numindices / 3);
+}
+
+float MeshACMR(const MESH *mesh, unsigned cachesize)
+{
+	Uint32 *indices = SDL_malloc(sizeof(Uint32) * mesh->numindices);
+	if (!indices)
+	{
+		return 0.f;
+	}
+	for (Uint32 i = 0; i < mesh->numindices; ++i)
+	{
+		indices[i] = GetIndex(mesh, i);
+	}
+	const float acmr = IndicesACMR(indices, mesh->numindices, mesh->numvertices, cachesize);
+	SDL_free(indices);
+	return acmr;
+}
+
+float MeshTexcoordDensity(const MESH *mesh)
+{
+	double area = 0.0, uvarea = 0.0;
+	for (Uint32 i = 0; i + 2 < mesh->numindices; i += 3)
+	{
+		const VERTEX *a = &mesh->vertices[GetIndex(mesh, i)];
+		const VERTEX *b = &mesh->vertices[GetIndex(mesh, i + 1)];
+		const VERTEX *c = &mesh->vertices[GetIndex(mesh, i + 2)];
+		const double e1[3] = { b->x - a->x, b->y - a->y, b->z - a->z };
+		const double e2[3] = { c->x - a->x, c->y - a->y, c->z - a->z };
+		const double n[3] =
+		{
+			e1[1] * e2[2] - e1[2] * e2[1],
+			e1[2] * e2[0] - e1[0] * e2[2],
+			e1[0] * e2[1] - e1[1] * e2[0]
+		};
+		area += SDL_sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		uvarea += SDL_fabs((double)(b->u - a->u) * (c->v - a->v) - (double)(c->u - a->u) * (b->v - a->v));
+	}
+	return area > 0.0 ? (float)SDL_sqrt(uvarea / area) : 0.f;
+}
+
+// Merge bitwise identical vertices, fills indices and returns the unique vertex count
+static Uint32 DedupVertices(VERTEX *unique, Uint32 *indices, const VERTEX *vertices, Uint32 numindices)
+{
+	Uint32 tablesize = 1;
+	while (tablesize < numindices * 2)
+	{
+		tablesize <<= 1;
+	}
+	Uint32 *table = SDL_malloc(sizeof(Uint32) * tablesize);
+	if (!table)
+	{
+		return 0;
+	}
+	SDL_memset(table, 0xFF, sizeof(Uint32) * tablesize);
+
+	// Open addressing with linear probing, empty slots hold NO_VERTEX
+	Uint32 numunique = 0;
+	for (Uint32 i = 0; i < numindices; ++i)
+	{
+		Uint32 slot = SDL_murmur3_32(&vertices[i], sizeof(VERTEX), 0) & (tablesize - 1);
+		for (;;)
+		{
+			const Uint32 existing = table[slot];
+			if (existing == NO_VERTEX)
+			{
+				unique[numunique] = vertices[i];
+				table[slot] = numunique;
+				indices[i] = numunique++;
+				break;
+			}
+			if (SDL_memcmp(&unique[existing], &vertices[i], sizeof(VERTEX)) == 0)
+			{
+				indices[i] = existing;
+				break;
+			}
+			slot = (slot + 1) & (tablesize - 1);
+		}
+	}
+
+	SDL_free(table);
+	return numunique;
+}
+
+/*  Reorder triangles for the post-transform cache using Tipsify from                *
+ *  "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"              *
+ *  (Sander, Nehab & Barczak 2007).                                                  */
+static bool TipsifyIndices(Uint32 *out, const Uint32 *indices, Uint32 numindices, Uint32 numvertices,
+	unsigned cachesize)
+{
+	const Uint32 numtriangles = numindices / 3;
+	Uint32 *scratch = SDL_malloc(sizeof(Uint32) * ((Uint32)numvertices * 3 + 1 + numindices * 3 + numtriangles));
+	if (!scratch)
+	{
+		return false;
+	}
+	Uint32 *offsets   = scratch;                  // Start of each vertex's triangle list in adjacency
+	Uint32 *live      = offsets + numvertices + 1; // Triangles not yet emitted per vertex
+	Uint32 *cachetime = live + numvertices;       // Time each vertex entered the cache
+	Uint32 *adjacency = cachetime + numvertices;  // Triangles using each vertex
+	Uint32 *deadend   = adjacency + numindices;   // Recently referenced vertices
+	Uint32 *candidate = deadend + numindices;     // 1-ring of the current fanning vertex
+	Uint32 *emitted   = candidate + numindices;   // Non-zero once a triangle has been output
+
+	// Build vertex -> triangle adjacency
+	SDL_memset(live, 0, sizeof(Uint32) * numvertices);
+	for (Uint32 i = 0; i < numindices; ++i)
+	{
+		++live[indices[i]];
+	}
+	offsets[0] = 0;
+	for (Uint32 v = 0; v < numvertices; ++v)
+	{
+		offsets[v + 1] = offsets[v] + live[v];
+		cachetime[v] = offsets[v];  // Borrowed as a fill cursor
+	}
+	for (Uint32 i = 0; i < numindices; ++i)
+	{
+		adjacency[cachetime[indices[i]]++] = i / 3;
+	}
+	SDL_memset(cachetime, 0, sizeof(Uint32) * numvertices);
+	SDL_memset(emitted, 0, sizeof(Uint32) * numtriangles);
+
+	Uint32 timestamp = cachesize + 1, numdeadend = 0, cursor = 1, numout = 0;
+	Uint32 fan = 0;
+	while (fan != NO_VERTEX)
+	{
+		// Emit all remaining triangles around the fanning vertex
+		Uint32 numcandidates = 0;
+		for (Uint32 a = offsets[fan]; a < offsets[fan + 1]; ++a)
+		{
+			const Uint32 t = adjacency[a];
+			if (emitted[t])
+			{
+				continue;
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				const Uint32 v = indices[t * 3 + k];
+				out[numout++] = v;
+				deadend[numdeadend++] = v;
+				candidate[numcandidates++] = v;
+				--live[v];
+				if (timestamp - cachetime[v] > cachesize)
+				{
+					cachetime[v] = timestamp++;
+				}
+			}
+			emitted[t] = 1;
+		}
+
+		// Prefer the candidate that stays in cache longest while still having triangles to emit
+		Uint32 next = NO_VERTEX;
+		Sint64 bestpriority = -1;
+		for (Uint32 c = 0; c < numcandidates; ++c)
+		{
+			const Uint32 v = candidate[c];
+			if (live[v] == 0)
+			{
+				continue;
+			}
+			Sint64 priority = 0;
+			if ((Sint64)timestamp - cachetime[v] + 2 * (Sint64)live[v] <= (Sint64)cachesize)
+			{
+				priority = (Sint64)timestamp - cachetime[v];
+			}
+			if (priority > bestpriority)
+			{
+				bestpriority = priority;
+				next = v;
+			}
+		}
+
+		// Dead end, fall back to recently used vertices then to input order
+		while (next == NO_VERTEX && numdeadend > 0)
+		{
+			const Uint32 v = deadend[--numdeadend];
+			if (live[v] > 0)
+			{
+				next = v;
+			}
+		}
+		for (; next == NO_VERTEX && cursor < numvertices; ++cursor)
+		{
+			if (live[cursor] > 0)
+			{
+				next = cursor;
+			}
+		}
+		fan = next;
+	}
+
+	SDL_free(scratch);
+	SDL_assert(numout == numindices);
+	return true;
+}
+
+// Tipsify a run of triangles using its own local vertex numbering to keep the cache simulation small
+static bool OptimiseRange(Uint32 *out, const Uint32 *indices, Uint32 count, Uint32 *tolocal, Uint32 *toglobal,
+	Uint32 *local)
+{
+	Uint32 numlocal = 0;
+	for (Uint32 j = 0; j < count; ++j)
+	{
+		const Uint32 v = indices[j];
+		if (tolocal[v] == NO_VERTEX)
+		{
+			tolocal[v] = numlocal;
+			toglobal[numlocal++] = v;
+		}
+		local[j] = tolocal[v];
+	}
+	const bool optimised = TipsifyIndices(out, local, count, numlocal, MESH_CACHE_SIZE);
+	for (Uint32 j = 0; j < count && optimised; ++j)
+	{
+		out[j] = toglobal[out[j]];
+	}
+	for (Uint32 j = 0; j < numlocal; ++j)
+	{
+		tolocal[toglobal[j]] = NO_VERTEX;
+	}
+	return optimised;
+}
+
+/*  Lay sectors out one after another, split each into BVH leaves and Tipsify every  *
+ *  leaf on its own, so sectors, subtrees and leaves all stay contiguous in the      *
+ *  index buffer. indices is reordered into leaf order along the way. Prop models    *
+ *  follow the sectors and are each Tipsified as a whole.                            */
+static bool OptimiseSectors(Uint32 *out, Uint32 *indices, const VERTEX *vertices, Uint32 numvertices, WORLD *world)
+{
+	Uint32 first = 0;
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		SECTOR *sector = &world->sectors[i];
+		sector->firstindex = first;
+		sector->numindices = 3u * (Uint32)sector->numtriangles;
+		first += sector->numindices;
+	}
+	for (int i = 0; i < world->numprops; ++i)
+	{
+		PROP *prop = &world->props[i];
+		prop->firstindex = first;
+		prop->numindices = 3u * (Uint32)prop->numtriangles;
+		first += prop->numindices;
+	}
+	if (!BuildWorldBVH(world, indices, vertices))
+	{
+		return false;
+	}
+
+	const Uint32 numindices = first;
+	Uint32 *scratch = SDL_malloc(sizeof(Uint32) * ((size_t)numvertices + (size_t)numindices * 2));
+	if (!scratch)
+	{
+		return false;
+	}
+	Uint32 *tolocal  = scratch;                  // World vertex -> leaf local vertex
+	Uint32 *toglobal = tolocal + numvertices;    // Leaf local vertex -> world vertex
+	Uint32 *local    = toglobal + numindices;    // Leaf indices using local vertices
+	SDL_memset(tolocal, 0xFF, sizeof(Uint32) * numvertices);
+
+	for (int i = 0; i < world->numnodes; ++i)
+	{
+		const BVHNODE *node = &world->nodes[i];
+		for (int j = 0; j < BVH_WIDTH; ++j)
+		{
+			const Uint32 start = node->firstindex[j], count = node->numindices[j];
+			if (node->child[j] == BVH_LEAF &&
+				!OptimiseRange(&out[start], &indices[start], count, tolocal, toglobal, local))
+			{
+				SDL_free(scratch);
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < world->numprops; ++i)
+	{
+		const PROP *prop = &world->props[i];
+		if (!OptimiseRange(&out[prop->firstindex], &indices[prop->firstindex], prop->numindices,
+			tolocal, toglobal, local))
+		{
+			SDL_free(scratch);
+			return false;
+		}
+	}
+
+	SDL_free(scratch);
+	return true;
+}
+
+bool BuildMesh(MESH *mesh, WORLD *world, MESHSTATS *stats)
+{
+	SDL_assert(mesh && world && world->triangles && world->numtriangles > 0);
+	const int numtriangles = world->numtriangles;
+	if ((size_t)numtriangles > SDL_MAX_UINT32 / (3 * sizeof(VERTEX)))
+	{
+		return SDL_SetError("Mesh too large (%d triangles)", numtriangles);
+	}
+	const Uint32 numindices = 3u * (Uint32)numtriangles;
+
+	VERTEX *unique = SDL_malloc(sizeof(VERTEX) * numindices);
+	Uint32 *indices = SDL_malloc(sizeof(Uint32) * numindices * 2);
+	if (!unique || !indices)
+	{
+		SDL_free(indices);
+		SDL_free(unique);
+		return false;
+	}
+	Uint32 *optimised = indices + numindices;
+
+	const Uint32 numvertices = DedupVertices(unique, indices, &world->triangles->vertex[0], numindices);
+	if (numvertices > 0 && stats)
+	{
+		stats->acmrbefore = IndicesACMR(indices, numindices, numvertices, MESH_CACHE_SIZE);
+	}
+	if (numvertices == 0 || !OptimiseSectors(optimised, indices, unique, numvertices, world))
+	{
+		SDL_free(indices);
+		SDL_free(unique);
+		return false;
+	}
+
+	// Renumber vertices in order of first use so vertex fetches are roughly sequential too
+	Uint32 *remap = indices;  // Original index order is no longer needed
+	SDL_memset(remap, 0xFF, sizeof(Uint32) * numvertices);
+	const Uint32 indexsize = numvertices <= 0x10000u ? 2u : 4u;
+	const size_t vertexbytes = sizeof(VERTEX) * numvertices;
+	VERTEX *vertices = SDL_malloc(vertexbytes + (size_t)indexsize * numindices);
+	if (!vertices)
+	{
+		SDL_free(indices);
+		SDL_free(unique);
+		return false;
+	}
+	void *meshindices = (Uint8 *)vertices + vertexbytes;
+	Uint32 nextvertex = 0;
+	for (Uint32 i = 0; i < numindices; ++i)
+	{
+		const Uint32 v = optimised[i];
+		if (remap[v] == NO_VERTEX)
+		{
+			vertices[nextvertex] = unique[v];
+			remap[v] = nextvertex++;
+		}
+		if (indexsize == 2)
+		{
+			((Uint16 *)meshindices)[i] = (Uint16)remap[v];
+		}
+		else
+		{
+			((Uint32 *)meshindices)[i] = remap[v];
+		}
+	}
+	SDL_free(indices);
+	SDL_free(unique);
+
+	*mesh = (MESH)
+	{
+		.numvertices = numvertices,
+		.numindices = numindices,
+		.indexsize = indexsize,
+		.vertices = vertices,
+		.indices = meshindices
+	};
+	if (stats)
+	{
+		stats->acmrafter = MeshACMR(mesh, MESH_CACHE_SIZE);
+		stats->unindexedbytes = sizeof(TRIANGLE) * (size_t)numtriangles;
+		stats->indexedbytes = vertexbytes + (size_t)indexsize * numindices;
+	}
+	return true;
+}
+
+void FreeMesh(MESH *mesh)
+{
+	SDL_free(mesh->vertices);
+	mesh->vertices = NULL;
+	mesh->indices = NULL;
+	mesh->numvertices = mesh->numindices = 0;
+}
+
+void LogMeshStats(const char *name, const MESH *mesh, const MESHSTATS *stats)
+{
+	const double saved = stats->unindexedbytes > stats->indexedbytes
+		? 100.0 * (double)(stats->unindexedbytes - stats->indexedbytes) / (double)stats->unindexedbytes : 0.0;
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+		"%s: %u unique vertices of %u, %u-bit indices, ACMR %.3f -> %.3f, %zu -> %zu bytes (%.1f%% saved)",
+		name, (unsigned)mesh->numvertices, (unsigned)mesh->numindices, (unsigned)mesh->indexsize * 8,
+		(double)stats->acmrbefore, (double)stats->acmrafter, stats->unindexedbytes, stats->indexedbytes, saved);
+}
+
+// Round to the nearest half float, ties to even, clamping to the largest finite half
+static Uint16 FloatToHalf(float value)
+{
+	Uint32 bits;
+	SDL_memcpy(&bits, &value, sizeof(bits));
+	const Uint32 sign = (bits >> 16) & 0x8000u;
+	const Uint32 magnitude = bits & 0x7FFFFFFFu;
+	if (magnitude >= 0x477FF000u)  // Rounds past 65504, also catches infinities & NaNs
+	{
+		return (Uint16)(sign | 0x7BFFu);
+	}
+	if (magnitude >= 0x38800000u)  // Normal, rebias the exponent from 127 to 15 & round off 13 mantissa bits
+	{
+		return (Uint16)(sign | ((magnitude + 0xC8000FFFu + ((magnitude >> 13) & 1u)) >> 13));
+	}
+
+	// Subnormal, counted in units of 2^-24
+	const int shift = 126 - (int)(magnitude >> 23);
+	if (shift > 24)
+	{
+		return (Uint16)sign;
+	}
+	const Uint32 mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+	const Uint32 half = 1u << (shift - 1), rest = mantissa & ((1u << shift) - 1u);
+	Uint32 rounded = mantissa >> shift;
+	if (rest > half || (rest == half && (rounded & 1u)))
+	{
+		++rounded;
+	}
+	return (Uint16)(sign | rounded);
+}
+
+static float HalfToFloat(Uint16 half)
+{
+	const int exponent = (half >> 10) & 0x1F;
+	const float magnitude = exponent == 0 ? SDL_scalbnf((float)(half & 0x3FF), -24)
+		: SDL_scalbnf((float)((half & 0x3FF) | 0x400), exponent - 25);
+	return (half & 0x8000) ? -magnitude : magnitude;
+}
+
+// Give every vertex the box of the first sector or prop using it, unused vertices go in box 0
+static int AssignPackBoxes(Uint8 *owner, const MESH *mesh, const WORLD *world)
+{
+	SDL_memset(owner, NO_BOX, mesh->numvertices);
+	const int numgroups = world->numsectors + world->numprops;
+	int numboxes = 1;
+	for (int g = 0; g < numgroups; ++g)
+	{
+		const bool sector = g < world->numsectors;
+		const Uint32 first = sector ? world->sectors[g].firstindex : world->props[g - world->numsectors].firstindex;
+		const Uint32 count = sector ? world->sectors[g].numindices : world->props[g - world->numsectors].numindices;
+		// Neighbouring sectors share a box when there are too many
+		const int box = numgroups > MESH_PACK_BOXES ? (int)((Sint64)g * MESH_PACK_BOXES / numgroups) : g;
+		for (Uint32 i = first; i - first < count && i < mesh->numindices; ++i)
+		{
+			const Uint32 v = GetIndex(mesh, i);
+			if (v < mesh->numvertices && owner[v] == NO_BOX)
+			{
+				owner[v] = (Uint8)box;
+				numboxes = SDL_max(numboxes, box + 1);
+			}
+		}
+	}
+	for (Uint32 v = 0; v < mesh->numvertices; ++v)
+	{
+		if (owner[v] == NO_BOX)
+		{
+			owner[v] = 0;
+		}
+	}
+	return numboxes;
+}
+
+bool PackMeshVertices(PACKEDVERTEX *dst, PACKBOX *boxes, const MESH *mesh, const WORLD *world, PACKSTATS *stats)
+{
+	SDL_assert(dst && boxes && mesh && world && stats);
+	Uint8 *owner = SDL_malloc(mesh->numvertices > 0 ? mesh->numvertices : 1);
+	if (!owner)
+	{
+		return false;
+	}
+	const int numboxes = AssignPackBoxes(owner, mesh, world);
+
+	// Bound each box's vertices, the largest box picks the lattice step
+	double mins[MESH_PACK_BOXES][3], maxs[MESH_PACK_BOXES][3];
+	for (int b = 0; b < numboxes; ++b)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			mins[b][axis] = 1e300;  // Empty until a vertex lands in the box
+			maxs[b][axis] = -1e300;
+		}
+	}
+	double extent = 0.0;
+	for (Uint32 v = 0; v < mesh->numvertices; ++v)
+	{
+		const VERTEX *vertex = &mesh->vertices[v];
+		const double position[3] = { vertex->x, vertex->y, vertex->z };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			double *boxmin = &mins[owner[v]][axis], *boxmax = &maxs[owner[v]][axis];
+			*boxmin = SDL_min(*boxmin, position[axis]);
+			*boxmax = SDL_max(*boxmax, position[axis]);
+			extent = SDL_max(extent, *boxmax - *boxmin);
+		}
+	}
+	if (!(extent < (double)SDL_MAX_SINT32))  // Also catches NaNs
+	{
+		SDL_free(owner);
+		return SDL_SetError("Mesh positions out of range for packing");
+	}
+
+	// Every position must land within PACK_SNORM_MAX steps of its box's center lattice point
+	const double span = 2.0 * (PACK_SNORM_MAX - 1);
+	double step = 1.0;
+	while (extent > step * span)
+	{
+		step *= 2.0;
+	}
+	while (step > PACK_MIN_STEP && extent <= step * 0.5 * span)
+	{
+		step *= 0.5;
+	}
+
+	SDL_memset(boxes, 0, sizeof(PACKBOX) * MESH_PACK_BOXES);
+	double centers[MESH_PACK_BOXES][3];
+	for (int b = 0; b < numboxes; ++b)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const double middle = mins[b][axis] <= maxs[b][axis] ? (mins[b][axis] + maxs[b][axis]) * 0.5 : 0.0;
+			centers[b][axis] = SDL_round(middle / step);
+			boxes[b].center[axis] = (float)(centers[b][axis] * step);
+		}
+		boxes[b].scale = (float)(step * PACK_SNORM_MAX);
+	}
+
+	// Quantize, measuring the error the way the vertex shader decodes
+	float maxposerror = 0.f, maxuverror = 0.f;
+	for (Uint32 v = 0; v < mesh->numvertices; ++v)
+	{
+		const VERTEX *vertex = &mesh->vertices[v];
+		const PACKBOX *box = &boxes[owner[v]];
+		const float position[3] = { vertex->x, vertex->y, vertex->z };
+		Sint16 steps[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const double q = SDL_round((double)position[axis] / step) - centers[owner[v]][axis];
+			steps[axis] = (Sint16)SDL_clamp(q, -PACK_SNORM_MAX, PACK_SNORM_MAX);
+			const float decoded = box->center[axis] + (float)steps[axis] / (float)PACK_SNORM_MAX * box->scale;
+			maxposerror = SDL_max(maxposerror, SDL_fabsf(decoded - position[axis]));
+		}
+		const int layer = (int)SDL_clamp(SDL_roundf(vertex->layer), 0.f, 255.f);
+		dst[v] = (PACKEDVERTEX)
+		{
+			.x = steps[0], .y = steps[1], .z = steps[2],
+			.tag = (Sint16)(owner[v] << 8 | layer),
+			.u = FloatToHalf(vertex->u),
+			.v = FloatToHalf(vertex->v)
+		};
+		maxuverror = SDL_max(maxuverror, SDL_fabsf(HalfToFloat(dst[v].u) - vertex->u));
+		maxuverror = SDL_max(maxuverror, SDL_fabsf(HalfToFloat(dst[v].v) - vertex->v));
+	}
+	SDL_free(owner);
+
+	*stats = (PACKSTATS)
+	{
+		.numboxes = numboxes,
+		.step = (float)step,
+		.maxposerror = maxposerror,
+		.maxuverror = maxuverror,
+		.unpackedbytes = sizeof(VERTEX) * (size_t)mesh->numvertices,
+		.packedbytes = sizeof(PACKEDVERTEX) * (size_t)mesh->numvertices
+	};
+	return true;
+}
+
+void LogPackStats(const char *name, const PACKSTATS *stats)
+{
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+		"%s: packed into %d boxes on a %g unit lattice, max error %g units & %g texcoord, %zu -> %zu bytes",
+		name, stats->numboxes, (double)stats->step, (double)stats->maxposerror, (double)stats->maxuverror,
+		stats->unpackedbytes, stats->packedbytes);
+}
@@ -0,0 +1,71 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "world.h"
+
+#define MESH_CACHE_SIZE 16  // Post-transform vertex cache size to optimise for and measure against
+
+typedef struct tagMESHSTATS
+{
+	float acmrbefore, acmrafter;           // Average cache miss ratio in file order and after optimisation
+	size_t unindexedbytes, indexedbytes;   // Size of the flat triangle list and the indexed mesh
+} MESHSTATS;
+
+#define MESH_PACK_BOXES 64  // Most quantization boxes in a packed mesh, sized to the vertex shader's uniform array
+
+typedef struct tagPACKEDVERTEX
+{
+	int16_t x, y, z;   // Lattice steps from the vertex's box center, read as SHORT4_NORM
+	int16_t tag;       // Box << 8 | material layer, the w of the SHORT4_NORM position
+	uint16_t u, v;     // Half floats, read as HALF2
+} PACKEDVERTEX;
+
+typedef struct tagPACKBOX
+{
+	float center[3];   // Position of the box's center lattice point
+	float scale;       // 32767 lattice steps, the distance a SNORM 1 decodes to
+} PACKBOX;
+
+typedef struct tagPACKSTATS
+{
+	int numboxes;
+	float step;                        // Lattice step shared by every box
+	float maxposerror, maxuverror;     // Largest difference of a decoded position or texcoord component
+	size_t unpackedbytes, packedbytes; // Size of the mesh vertices before and after packing
+} PACKSTATS;
+
+/*  Build an indexed mesh from a world's triangles, identical vertices are merged,    *
+ *  each sector gets a bounding volume hierarchy and the triangles of each leaf are  *
+ *  reordered for post-transform cache locality (Tipsify). Sector & prop index       *
+ *  ranges and hierarchies are filled in on the world. Indices are 16-bit when the   *
+ *  vertex count allows it. Release the mesh with FreeMesh.                          *
+ *  stats   - Optional, receives cache miss ratios and memory footprint               */
+bool BuildMesh(MESH *mesh, WORLD *world, MESHSTATS *stats);
+void FreeMesh(MESH *mesh);
+
+/*  Average cache miss ratio (transformed vertices per triangle) of a mesh for a FIFO  *
+ *  post-transform cache of the given size, 0.5 is ideal on a regular grid, 3 worst.   */
+float MeshACMR(const MESH *mesh, unsigned cachesize);
+
+/*  Texture coordinate units per world unit, averaged over the mesh's triangles by   *
+ *  area. Multiplied by a texture's size it gives the texels covering a world unit.  */
+float MeshTexcoordDensity(const MESH *mesh);
+
+/*  Quantize a mesh's vertices to half their size. Each sector, then each prop       *
+ *  model, gets a box around the vertices it uses first, merging neighbours when     *
+ *  there are more than MESH_PACK_BOXES. Positions are stored as steps from their    *
+ *  box center on a power of two lattice shared by every box, so coincident vertices *
+ *  of two boxes decode to the same position and seams stay closed. Texcoords become *
+ *  half floats.                                                                     *
+ *  dst     - mesh->numvertices packed vertices                                      *
+ *  boxes   - MESH_PACK_BOXES boxes, the vertex shader's dequantization uniform      *
+ *  stats   - Receives the box count, lattice step, largest errors & sizes           */
+bool PackMeshVertices(PACKEDVERTEX *dst, PACKBOX *boxes, const MESH *mesh, const WORLD *world, PACKSTATS *stats);
+
+/*  Log the box count, errors & bytes saved of a packed mesh                         */
+void LogPackStats(const char *name, const PACKSTATS *stats);
+
+/*  Log vertex/index counts, ACMR and bytes saved for a built mesh                   */
+void LogMeshStats(const char *name, const MESH *mesh, const MESHSTATS *stats);
+
+#endif//MESH_H
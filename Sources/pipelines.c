@@ -0,0 +1,374 @@
+#include "pipelines.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_assert.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+enum
+{
+	PIPELINE_PENDING,            // Registered, nothing has started creating it
+	PIPELINE_CREATING,           // A thread is creating it, the others wait on the cache's condition
+	PIPELINE_READY,
+	PIPELINE_FAILED
+};
+
+#define HASH_SEED  0xCBF29CE484222325ull  // 64 bit FNV-1a
+#define HASH_PRIME 0x100000001B3ull
+#define HASH(hash, value) HashBytes(hash, &(value), sizeof(value))
+#define PUT(state, value) PutBytes(state, &(value), sizeof(value))
+#define PIPELINE_STATE_BYTES 640  // Packed pipeline state with every array full takes 561
+
+typedef struct tagPIPELINESTATE
+{
+	Uint8 bytes[PIPELINE_STATE_BYTES];
+	size_t size;
+} PIPELINESTATE;
+
+static Uint64 HashBytes(Uint64 hash, const void *data, size_t size)
+{
+	const Uint8 *bytes = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * HASH_PRIME;
+	}
+	return hash;
+}
+
+static void PutBytes(PIPELINESTATE *state, const void *data, size_t size)
+{
+	SDL_assert(state->size + size <= sizeof(state->bytes));
+	SDL_memcpy(state->bytes + state->size, data, size);
+	state->size += size;
+}
+
+bool InitPipelineCache(PIPELINECACHE *cache, SDL_GPUDevice *dev, JOBQUEUE *jobs)
+{
+	SDL_zerop(cache);
+	cache->dev = dev;
+	cache->jobs = jobs;
+	if (!(cache->lock = SDL_CreateMutex()) || !(cache->created = SDL_CreateCondition()))
+	{
+		SDL_DestroyMutex(cache->lock);
+		cache->lock = NULL;
+		return false;
+	}
+	return true;
+}
+
+void FreePipelineCache(PIPELINECACHE *cache)
+{
+	for (int i = 0; i < cache->numpipelines; ++i)
+	{
+		CACHEDPIPELINE *entry = &cache->pipelines[i];
+		if (entry->queued)
+		{
+			WaitJob(cache->jobs, &entry->job);
+		}
+		if (entry->pipeline)
+		{
+			SDL_ReleaseGPUGraphicsPipeline(cache->dev, entry->pipeline);
+		}
+	}
+	for (int i = 0; i < cache->numshaders; ++i)
+	{
+		SDL_ReleaseGPUShader(cache->dev, cache->shaders[i].shader);
+		SDL_free((void *)cache->shaders[i].info.code);
+	}
+	SDL_DestroyCondition(cache->created);
+	SDL_DestroyMutex(cache->lock);
+	SDL_zerop(cache);
+}
+
+static bool SameShaderInfo(const SDL_GPUShaderCreateInfo *a, const SDL_GPUShaderCreateInfo *b)
+{
+	return a->code_size == b->code_size && SDL_memcmp(a->code, b->code, a->code_size) == 0 &&
+		SDL_strcmp(a->entrypoint, b->entrypoint) == 0 && a->format == b->format && a->stage == b->stage &&
+		a->num_samplers == b->num_samplers && a->num_storage_textures == b->num_storage_textures &&
+		a->num_storage_buffers == b->num_storage_buffers && a->num_uniform_buffers == b->num_uniform_buffers;
+}
+
+SDL_GPUShader * CachedShader(PIPELINECACHE *cache, const SDL_GPUShaderCreateInfo *info)
+{
+	Uint64 key = HashBytes(HASH_SEED, info->code, info->code_size);
+	key = HashBytes(key, info->entrypoint, SDL_strlen(info->entrypoint));
+	key = HASH(key, info->format);
+	key = HASH(key, info->stage);
+	key = HASH(key, info->num_samplers);
+	key = HASH(key, info->num_storage_textures);
+	key = HASH(key, info->num_storage_buffers);
+	key = HASH(key, info->num_uniform_buffers);
+	for (int i = 0; i < cache->numshaders; ++i)
+	{
+		if (cache->shaders[i].key == key && SameShaderInfo(&cache->shaders[i].info, info))
+		{
+			SDL_LockMutex(cache->lock);
+			++cache->stats.shaderhits;
+			SDL_UnlockMutex(cache->lock);
+			return cache->shaders[i].shader;
+		}
+	}
+	if (cache->numshaders == PIPELINE_MAX_SHADERS)
+	{
+		SDL_SetError("Too many shaders (%d)", PIPELINE_MAX_SHADERS);
+		return NULL;
+	}
+	// Keep the code & entry point to compare later requests against, the caller frees its own
+	const size_t entrysize = SDL_strlen(info->entrypoint) + 1;
+	Uint8 *copy = SDL_malloc(info->code_size + entrysize);
+	if (!copy)
+	{
+		return NULL;
+	}
+	SDL_GPUShader *shader = SDL_CreateGPUShader(cache->dev, info);
+	if (!shader)
+	{
+		SDL_free(copy);
+		return NULL;
+	}
+	SDL_memcpy(copy, info->code, info->code_size);
+	SDL_memcpy(copy + info->code_size, info->entrypoint, entrysize);
+	CACHEDSHADER *entry = &cache->shaders[cache->numshaders++];
+	*entry = (CACHEDSHADER){ .key = key, .info = *info, .shader = shader };
+	entry->info.code = copy;
+	entry->info.entrypoint = (const char *)copy + info->code_size;
+	SDL_LockMutex(cache->lock);
+	++cache->stats.shaders;
+	SDL_UnlockMutex(cache->lock);
+	return shader;
+}
+
+// Pack the state field by field, padding between them is left uninitialized by some callers
+static void GetPipelineState(const SDL_GPUGraphicsPipelineCreateInfo *info, PIPELINESTATE *state)
+{
+	state->size = 0;
+	PUT(state, info->vertex_shader);
+	PUT(state, info->fragment_shader);
+	const SDL_GPUVertexInputState *input = &info->vertex_input_state;
+	for (Uint32 i = 0; i < SDL_min(input->num_vertex_buffers, PIPELINE_MAX_VERTEX_BUFFERS); ++i)
+	{
+		const SDL_GPUVertexBufferDescription *buffer = &input->vertex_buffer_descriptions[i];
+		PUT(state, buffer->slot);
+		PUT(state, buffer->pitch);
+		PUT(state, buffer->input_rate);
+		PUT(state, buffer->instance_step_rate);
+	}
+	PUT(state, input->num_vertex_buffers);
+	for (Uint32 i = 0; i < SDL_min(input->num_vertex_attributes, PIPELINE_MAX_ATTRIBUTES); ++i)
+	{
+		const SDL_GPUVertexAttribute *attrib = &input->vertex_attributes[i];
+		PUT(state, attrib->location);
+		PUT(state, attrib->buffer_slot);
+		PUT(state, attrib->format);
+		PUT(state, attrib->offset);
+	}
+	PUT(state, input->num_vertex_attributes);
+	PUT(state, info->primitive_type);
+
+	const SDL_GPURasterizerState *raster = &info->rasterizer_state;
+	PUT(state, raster->fill_mode);
+	PUT(state, raster->cull_mode);
+	PUT(state, raster->front_face);
+	PUT(state, raster->depth_bias_constant_factor);
+	PUT(state, raster->depth_bias_clamp);
+	PUT(state, raster->depth_bias_slope_factor);
+	PUT(state, raster->enable_depth_bias);
+	PUT(state, raster->enable_depth_clip);
+
+	const SDL_GPUMultisampleState *multisample = &info->multisample_state;
+	PUT(state, multisample->sample_count);
+	PUT(state, multisample->sample_mask);
+	PUT(state, multisample->enable_mask);
+
+	const SDL_GPUDepthStencilState *depth = &info->depth_stencil_state;
+	const SDL_GPUStencilOpState *stencils[2] = { &depth->back_stencil_state, &depth->front_stencil_state };
+	PUT(state, depth->compare_op);
+	for (int i = 0; i < 2; ++i)
+	{
+		PUT(state, stencils[i]->fail_op);
+		PUT(state, stencils[i]->pass_op);
+		PUT(state, stencils[i]->depth_fail_op);
+		PUT(state, stencils[i]->compare_op);
+	}
+	PUT(state, depth->compare_mask);
+	PUT(state, depth->write_mask);
+	PUT(state, depth->enable_depth_test);
+	PUT(state, depth->enable_depth_write);
+	PUT(state, depth->enable_stencil_test);
+
+	const SDL_GPUGraphicsPipelineTargetInfo *targets = &info->target_info;
+	for (Uint32 i = 0; i < SDL_min(targets->num_color_targets, PIPELINE_MAX_COLOR_TARGETS); ++i)
+	{
+		const SDL_GPUColorTargetDescription *target = &targets->color_target_descriptions[i];
+		const SDL_GPUColorTargetBlendState *blend = &target->blend_state;
+		PUT(state, target->format);
+		PUT(state, blend->src_color_blendfactor);
+		PUT(state, blend->dst_color_blendfactor);
+		PUT(state, blend->color_blend_op);
+		PUT(state, blend->src_alpha_blendfactor);
+		PUT(state, blend->dst_alpha_blendfactor);
+		PUT(state, blend->alpha_blend_op);
+		PUT(state, blend->color_write_mask);
+		PUT(state, blend->enable_blend);
+		PUT(state, blend->enable_color_write_mask);
+	}
+	PUT(state, targets->num_color_targets);
+	PUT(state, targets->depth_stencil_format);
+	PUT(state, targets->has_depth_stencil_target);
+	PUT(state, info->props);
+}
+
+Uint64 HashPipelineInfo(const SDL_GPUGraphicsPipelineCreateInfo *info)
+{
+	PIPELINESTATE state;
+	GetPipelineState(info, &state);
+	return HashBytes(HASH_SEED, state.bytes, state.size);
+}
+
+static bool SamePipelineInfo(const SDL_GPUGraphicsPipelineCreateInfo *a, const SDL_GPUGraphicsPipelineCreateInfo *b)
+{
+	PIPELINESTATE first, second;
+	GetPipelineState(a, &first);
+	GetPipelineState(b, &second);
+	return first.size == second.size && SDL_memcmp(first.bytes, second.bytes, first.size) == 0;
+}
+
+int AddPipeline(PIPELINECACHE *cache, const SDL_GPUGraphicsPipelineCreateInfo *info)
+{
+	const Uint64 key = HashPipelineInfo(info);
+	for (int i = 0; i < cache->numpipelines; ++i)
+	{
+		// The hash only finds the candidate, a collision must not hand back another pipeline
+		if (cache->pipelines[i].key == key && SamePipelineInfo(&cache->pipelines[i].info, info))
+		{
+			return i;
+		}
+	}
+	const SDL_GPUVertexInputState *input = &info->vertex_input_state;
+	const SDL_GPUGraphicsPipelineTargetInfo *targets = &info->target_info;
+	if (cache->numpipelines == PIPELINE_MAX_PIPELINES ||
+		input->num_vertex_buffers > PIPELINE_MAX_VERTEX_BUFFERS ||
+		input->num_vertex_attributes > PIPELINE_MAX_ATTRIBUTES ||
+		targets->num_color_targets > PIPELINE_MAX_COLOR_TARGETS)
+	{
+		SDL_SetError("Pipeline %d doesn't fit the cache", cache->numpipelines);
+		return -1;
+	}
+
+	CACHEDPIPELINE *entry = &cache->pipelines[cache->numpipelines];
+	SDL_zerop(entry);
+	entry->key = key;
+	entry->info = *info;
+	entry->state = PIPELINE_PENDING;
+	entry->owner = cache;
+	SDL_memcpy(entry->vtxbuffers, input->vertex_buffer_descriptions,
+		sizeof(SDL_GPUVertexBufferDescription) * input->num_vertex_buffers);
+	SDL_memcpy(entry->vtxattribs, input->vertex_attributes,
+		sizeof(SDL_GPUVertexAttribute) * input->num_vertex_attributes);
+	SDL_memcpy(entry->targets, targets->color_target_descriptions,
+		sizeof(SDL_GPUColorTargetDescription) * targets->num_color_targets);
+	entry->info.vertex_input_state.vertex_buffer_descriptions = entry->vtxbuffers;
+	entry->info.vertex_input_state.vertex_attributes = entry->vtxattribs;
+	entry->info.target_info.color_target_descriptions = entry->targets;
+	return cache->numpipelines++;
+}
+
+// Create a pipeline unless another thread already is or has, on a worker when warming
+static void CreatePipeline(CACHEDPIPELINE *entry, bool warming)
+{
+	PIPELINECACHE *cache = entry->owner;
+	SDL_LockMutex(cache->lock);
+	const bool claimed = entry->state == PIPELINE_PENDING;
+	if (claimed)
+	{
+		entry->state = PIPELINE_CREATING;
+	}
+	SDL_UnlockMutex(cache->lock);
+	if (!claimed)
+	{
+		return;
+	}
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+	SDL_GPUGraphicsPipeline *pipeline = SDL_CreateGPUGraphicsPipeline(cache->dev, &entry->info);
+	const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+	if (!pipeline)
+	{
+		// Errors are per thread, the one asking for the pipeline may never see a worker's
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateGPUGraphicsPipeline(): %s", SDL_GetError());
+	}
+
+	SDL_LockMutex(cache->lock);
+	entry->pipeline = pipeline;
+	entry->state = pipeline ? PIPELINE_READY : PIPELINE_FAILED;
+	PIPELINESTATS *stats = &cache->stats;
+	stats->created += pipeline != NULL;
+	stats->warmed += pipeline && warming;
+	stats->failed += pipeline == NULL;
+	stats->createticks += ticks;
+	stats->slowestticks = SDL_max(stats->slowestticks, ticks);
+	SDL_BroadcastCondition(cache->created);
+	SDL_UnlockMutex(cache->lock);
+}
+
+static void WarmPipeline(void *data)
+{
+	CreatePipeline(data, true);
+}
+
+void WarmPipelines(PIPELINECACHE *cache)
+{
+	if (!cache->jobs || cache->jobs->numthreads == 0)
+	{
+		return;  // Warming on the caller would only move the wait
+	}
+	for (int i = 0; i < cache->numpipelines; ++i)
+	{
+		CACHEDPIPELINE *entry = &cache->pipelines[i];
+		if (!entry->queued && entry->state == PIPELINE_PENDING)
+		{
+			entry->queued = true;
+			PushJob(cache->jobs, &entry->job, WarmPipeline, entry);  // Runs here when the queue is full
+		}
+	}
+}
+
+SDL_GPUGraphicsPipeline * GetPipeline(PIPELINECACHE *cache, int id)
+{
+	SDL_assert(id >= 0 && id < cache->numpipelines);
+	CACHEDPIPELINE *entry = &cache->pipelines[id];
+	SDL_LockMutex(cache->lock);
+	if (entry->state == PIPELINE_READY)
+	{
+		++cache->stats.hits;
+		SDL_UnlockMutex(cache->lock);
+		return entry->pipeline;
+	}
+	const bool pending = entry->state == PIPELINE_PENDING;
+	cache->stats.misses += pending || entry->state == PIPELINE_CREATING;
+	SDL_UnlockMutex(cache->lock);
+
+	if (pending)
+	{
+		CreatePipeline(entry, false);
+	}
+	SDL_LockMutex(cache->lock);
+	while (entry->state == PIPELINE_CREATING)
+	{
+		SDL_WaitCondition(cache->created, cache->lock);
+	}
+	SDL_GPUGraphicsPipeline *pipeline = entry->pipeline;
+	SDL_UnlockMutex(cache->lock);
+	if (!pipeline)
+	{
+		SDL_SetError("Pipeline %d couldn't be created", id);
+	}
+	return pipeline;
+}
+
+void GetPipelineStats(PIPELINECACHE *cache, PIPELINESTATS *stats)
+{
+	SDL_LockMutex(cache->lock);
+	*stats = cache->stats;
+	SDL_UnlockMutex(cache->lock);
+}
@@ -0,0 +1,97 @@
+#ifndef PIPELINES_H
+#define PIPELINES_H
+
+#include "jobs.h"
+#include <SDL3/SDL_gpu.h>
+#include <SDL3/SDL_mutex.h>
+
+#define PIPELINE_MAX_PIPELINES      32  // Most distinct pipelines registered
+#define PIPELINE_MAX_SHADERS        32  // Most distinct shaders created
+#define PIPELINE_MAX_VERTEX_BUFFERS 4   // Most vertex buffers a registered pipeline reads
+#define PIPELINE_MAX_ATTRIBUTES     16  // Most vertex attributes a registered pipeline reads
+#define PIPELINE_MAX_COLOR_TARGETS  4   // Most color targets a registered pipeline draws to
+
+typedef struct tagPIPELINESTATS
+{
+	unsigned hits;               // Lookups finding their pipeline already created
+	unsigned misses;             // Lookups creating their pipeline, or waiting for the worker creating it
+	unsigned created, warmed;    // Pipelines created so far, and of those how many on a worker ahead of use
+	unsigned failed;             // Pipelines that couldn't be created
+	unsigned shaders;            // Shaders created
+	unsigned shaderhits;         // Shader requests given a shader already created from the same code
+	Uint64 createticks;          // Performance counter ticks spent creating pipelines, over every thread
+	Uint64 slowestticks;         // Of the slowest pipeline to create
+} PIPELINESTATS;
+
+typedef struct tagCACHEDSHADER
+{
+	Uint64 key;                  // Hash of the code, entry point & stage
+	SDL_GPUShaderCreateInfo info;  // Code & entry point point into a copy owned by the cache
+	SDL_GPUShader *shader;
+} CACHEDSHADER;
+
+typedef struct tagCACHEDPIPELINE
+{
+	Uint64 key;                  // Hash of the create info, see HashPipelineInfo, a match is then compared
+	SDL_GPUGraphicsPipelineCreateInfo info;  // Arrays point into the copies below
+	SDL_GPUVertexBufferDescription vtxbuffers[PIPELINE_MAX_VERTEX_BUFFERS];
+	SDL_GPUVertexAttribute vtxattribs[PIPELINE_MAX_ATTRIBUTES];
+	SDL_GPUColorTargetDescription targets[PIPELINE_MAX_COLOR_TARGETS];
+
+	// Internal, guarded by the cache's lock
+	int state;                   // PIPELINE_PENDING, _CREATING, _READY or _FAILED
+	SDL_GPUGraphicsPipeline *pipeline;
+	bool queued;                 // Warming job pushed, waited on when the cache is freed
+	JOB job;
+	struct tagPIPELINECACHE *owner;
+} CACHEDPIPELINE;
+
+typedef struct tagPIPELINECACHE
+{
+	SDL_GPUDevice *dev;
+	JOBQUEUE *jobs;              // Workers warming pipelines, NULL leaves every pipeline to its first use
+	SDL_Mutex *lock;
+	SDL_Condition *created;      // Broadcast whenever a pipeline is done being created
+	int numpipelines, numshaders;
+	CACHEDPIPELINE pipelines[PIPELINE_MAX_PIPELINES];
+	CACHEDSHADER shaders[PIPELINE_MAX_SHADERS];
+	PIPELINESTATS stats;
+} PIPELINECACHE;
+
+/*  Keep every pipeline & shader the game creates for the life of the device.        *
+ *  Pipelines are registered by their create info and only created on first use,     *
+ *  unless a worker warming them gets there first. Pipelines & shaders are created   *
+ *  on whichever thread gets to them, SDL GPU allows it from any thread.             */
+bool InitPipelineCache(PIPELINECACHE *cache, SDL_GPUDevice *dev, JOBQUEUE *jobs);
+
+/*  Wait for any pipeline still being warmed, then release every pipeline & shader   */
+void FreePipelineCache(PIPELINECACHE *cache);
+
+/*  Create a shader, or return the one already created from the same code, entry     *
+ *  point & stage. The cache owns the shader, it's released with the cache. NULL     *
+ *  with the error set on failure.                                                   */
+SDL_GPUShader * CachedShader(PIPELINECACHE *cache, const SDL_GPUShaderCreateInfo *info);
+
+/*  Hash the state of a pipeline's create info, following its arrays. Shaders are    *
+ *  hashed by address, CachedShader gives the same code the same address. A hash     *
+ *  match only finds a candidate, the cache then compares the state itself.          */
+Uint64 HashPipelineInfo(const SDL_GPUGraphicsPipelineCreateInfo *info);
+
+/*  Register a pipeline without creating it. The info's arrays are copied, its       *
+ *  shaders & properties have to outlive the cache. Registering the same state again *
+ *  returns the first registration's id. Returns -1 with the error set when full.    */
+int AddPipeline(PIPELINECACHE *cache, const SDL_GPUGraphicsPipelineCreateInfo *info);
+
+/*  Create every registered pipeline nothing has used yet on the workers, so they're *
+ *  ready by their first use. Called on the thread that registers pipelines.         */
+void WarmPipelines(PIPELINECACHE *cache);
+
+/*  The pipeline registered as id, created now if nothing has yet and waiting for    *
+ *  the worker if one is creating it. NULL with the error set if it couldn't be.     *
+ *  Safe from any thread once registering is done.                                   */
+SDL_GPUGraphicsPipeline * GetPipeline(PIPELINECACHE *cache, int id);
+
+/*  Copy out the counters, safe from any thread                                      */
+void GetPipelineStats(PIPELINECACHE *cache, PIPELINESTATS *stats);
+
+#endif//PIPELINES_H
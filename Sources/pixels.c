@@ -0,0 +1,352 @@
+#include "pixels.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_assert.h>
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_intrin.h>
+
+#define LINEAR_BITS 14  // Precision of linear colors, four still sum without overflowing 16 bits
+
+typedef struct tagPIXELBAND PIXELBAND;
+typedef void (*PIXELBANDFUNC)(const PIXELBAND *band);
+
+// Rows first to end of a destination image, converted or filtered on one thread
+struct tagPIXELBAND
+{
+	PIXELBANDFUNC func;
+	const Uint8 *src;
+	size_t srcpitch;
+	SDL_PixelFormat format;
+	int width, height;           // Of the source image
+	bool flip;
+	bool simd;                   // Filter with SIMD, the scalar reference otherwise
+	Uint32 *dst;
+	int dstwidth;
+	Uint16 *scratch;             // Rows of linear colors, scratchsize per band
+	size_t scratchsize;
+	int first, end;
+};
+
+static SDL_InitState tablesinit;
+static Uint16 tolinear[256];                  // sRGB encoded to linear colors
+static Uint8 fromlinear[1 << LINEAR_BITS];    // Linear colors to sRGB encoded
+
+static void InitTables(void)
+{
+	if (!SDL_ShouldInit(&tablesinit))
+	{
+		return;
+	}
+	const float scale = (float)((1 << LINEAR_BITS) - 1);
+	for (int i = 0; i < 256; ++i)
+	{
+		const float c = i / 255.f;
+		const float linear = c <= 0.04045f ? c / 12.92f : SDL_powf((c + 0.055f) / 1.055f, 2.4f);
+		tolinear[i] = (Uint16)(linear * scale + 0.5f);
+	}
+	for (int i = 0; i < 1 << LINEAR_BITS; ++i)
+	{
+		const float c = i / scale;
+		const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * SDL_powf(c, 1.f / 2.4f) - 0.055f;
+		fromlinear[i] = (Uint8)SDL_clamp((int)(s * 255.f + 0.5f), 0, 255);
+	}
+	SDL_SetInitialized(&tablesinit, true);
+}
+
+static int CountBands(const JOBQUEUE *jobs, int rows)
+{
+	if (!jobs || rows < 2 * PIXELS_MIN_JOB_ROWS)
+	{
+		return 1;
+	}
+	return SDL_min(jobs->numthreads + 1, rows / PIXELS_MIN_JOB_ROWS);
+}
+
+static void RunBand(void *data)
+{
+	const PIXELBAND *band = data;
+	band->func(band);
+}
+
+// Split rows between numbands copies of the first band, each with its own scratch
+static void RunBands(JOBQUEUE *jobs, PIXELBAND *bands, int rows, int numbands)
+{
+	JOB work[JOBS_MAX_THREADS];
+	for (int i = numbands - 1; i >= 0; --i)
+	{
+		bands[i] = bands[0];
+		bands[i].scratch = bands[0].scratch ? bands[0].scratch + bands[0].scratchsize * i : NULL;
+		bands[i].first = (int)((Sint64)rows * i / numbands);
+		bands[i].end = (int)((Sint64)rows * (i + 1) / numbands);
+	}
+	// The caller takes the first band itself rather than wait idle
+	for (int i = 1; i < numbands; ++i)
+	{
+		PushJob(jobs, &work[i - 1], RunBand, &bands[i]);
+	}
+	RunBand(&bands[0]);
+	for (int i = 1; i < numbands; ++i)
+	{
+		WaitJob(jobs, &work[i - 1]);
+	}
+}
+
+bool CanConvertRGBA(SDL_PixelFormat format)
+{
+	switch (format)
+	{
+	case SDL_PIXELFORMAT_ABGR8888:
+	case SDL_PIXELFORMAT_XBGR8888:
+	case SDL_PIXELFORMAT_ARGB8888:
+	case SDL_PIXELFORMAT_XRGB8888:
+	case SDL_PIXELFORMAT_BGR24:
+	case SDL_PIXELFORMAT_RGB24:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*  Swap red & blue of packed 32 bit pixels, ARGB to ABGR, OR'ing in alpha for the   *
+ *  formats without it                                                               */
+static void SwizzleRow(Uint32 *dst, const Uint32 *src, int width, Uint32 alpha)
+{
+	int x = 0;
+#if defined(SDL_SSE2_INTRINSICS)
+	const __m128i keep = _mm_set1_epi32((int)0xFF00FF00u), low = _mm_set1_epi32(0xFF);
+	const __m128i fill = _mm_set1_epi32((int)alpha);
+	for (; x + 4 <= width; x += 4)
+	{
+		const __m128i p = _mm_loadu_si128((const __m128i *)(src + x));
+		const __m128i swapped = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low),
+			_mm_slli_epi32(_mm_and_si128(p, low), 16));
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_or_si128(_mm_and_si128(p, keep), swapped), fill));
+	}
+#elif defined(SDL_NEON_INTRINSICS)
+	const uint32x4_t keep = vdupq_n_u32(0xFF00FF00u), low = vdupq_n_u32(0xFF), fill = vdupq_n_u32(alpha);
+	for (; x + 4 <= width; x += 4)
+	{
+		const uint32x4_t p = vld1q_u32(src + x);
+		const uint32x4_t swapped = vorrq_u32(vandq_u32(vshrq_n_u32(p, 16), low), vshlq_n_u32(vandq_u32(p, low), 16));
+		vst1q_u32(dst + x, vorrq_u32(vorrq_u32(vandq_u32(p, keep), swapped), fill));
+	}
+#endif
+	for (; x < width; ++x)
+	{
+		const Uint32 p = src[x];
+		dst[x] = (p & 0xFF00FF00u) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16) | alpha;
+	}
+}
+
+static void ConvertRow(Uint32 *dst, const Uint8 *src, int width, SDL_PixelFormat format)
+{
+	switch (format)
+	{
+	case SDL_PIXELFORMAT_ABGR8888:
+		SDL_memcpy(dst, src, (size_t)width * 4);
+		break;
+	case SDL_PIXELFORMAT_XBGR8888:
+		for (int x = 0; x < width; ++x)
+		{
+			dst[x] = ((const Uint32 *)src)[x] | 0xFF000000u;
+		}
+		break;
+	case SDL_PIXELFORMAT_ARGB8888:
+		SwizzleRow(dst, (const Uint32 *)src, width, 0);
+		break;
+	case SDL_PIXELFORMAT_XRGB8888:
+		SwizzleRow(dst, (const Uint32 *)src, width, 0xFF000000u);
+		break;
+	case SDL_PIXELFORMAT_BGR24:
+		for (int x = 0; x < width; ++x, src += 3)
+		{
+			dst[x] = 0xFF000000u | (Uint32)src[0] << 16 | (Uint32)src[1] << 8 | src[2];
+		}
+		break;
+	case SDL_PIXELFORMAT_RGB24:
+		for (int x = 0; x < width; ++x, src += 3)
+		{
+			dst[x] = 0xFF000000u | (Uint32)src[2] << 16 | (Uint32)src[1] << 8 | src[0];
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void ConvertBand(const PIXELBAND *band)
+{
+	for (int y = band->first; y < band->end; ++y)
+	{
+		const int row = band->flip ? band->height - 1 - y : y;
+		ConvertRow(band->dst + (size_t)band->width * y, band->src + band->srcpitch * row, band->width, band->format);
+	}
+}
+
+bool ConvertImageRGBA(JOBQUEUE *jobs, void *dst, const SDL_Surface *image, bool flip)
+{
+	SDL_assert(dst && image);
+	if (!CanConvertRGBA(image->format))
+	{
+		return SDL_SetError("Can't convert pixel format %u to RGBA directly", (unsigned)image->format);
+	}
+	PIXELBAND bands[JOBS_MAX_THREADS + 1];
+	bands[0] = (PIXELBAND)
+	{
+		.func = ConvertBand,
+		.src = image->pixels,
+		.srcpitch = (size_t)image->pitch,
+		.format = image->format,
+		.width = image->w,
+		.height = image->h,
+		.flip = flip,
+		.dst = dst
+	};
+	RunBands(jobs, bands, image->h, CountBands(jobs, image->h));
+	return true;
+}
+
+static void DecodeRow(Uint16 *dst, const Uint32 *src, int width)
+{
+	for (int x = 0; x < width; ++x, dst += 4)
+	{
+		const Uint32 p = src[x];
+		dst[0] = tolinear[p & 0xFF];
+		dst[1] = tolinear[(p >> 8) & 0xFF];
+		dst[2] = tolinear[(p >> 16) & 0xFF];
+		dst[3] = (Uint16)(p >> 24);  // Alpha is linear already
+	}
+}
+
+static Uint32 EncodePixel(const Uint16 *linear)
+{
+	return fromlinear[linear[0]] | (Uint32)fromlinear[linear[1]] << 8 | (Uint32)fromlinear[linear[2]] << 16 |
+		(Uint32)linear[3] << 24;
+}
+
+/*  Filter output pixels x to the end of the row, from a sum of two rows' linear     *
+ *  colors. The last column repeats when the source is one pixel wide.               */
+static void AverageColumns(Uint32 *dst, const Uint16 *sum, int width, int x, int dstwidth)
+{
+	for (; x < dstwidth; ++x)
+	{
+		const Uint16 *left = sum + 8 * x, *right = sum + 4 * SDL_min(2 * x + 1, width - 1);
+		Uint16 average[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			average[c] = (Uint16)((left[c] + right[c] + 2) >> 2);
+		}
+		dst[x] = EncodePixel(average);
+	}
+}
+
+// Add a row of linear colors to another and average horizontal pairs, 2 pixels per vector
+static void FilterRow(Uint32 *dst, Uint16 *sum, const Uint16 *below, int width, int dstwidth)
+{
+	const int n = 4 * width;
+	int i = 0, x = 0;
+#if defined(SDL_SSE2_INTRINSICS)
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm_storeu_si128((__m128i *)(sum + i), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sum + i)),
+			_mm_loadu_si128((const __m128i *)(below + i))));
+	}
+#elif defined(SDL_NEON_INTRINSICS)
+	for (; i + 8 <= n; i += 8)
+	{
+		vst1q_u16(sum + i, vaddq_u16(vld1q_u16(sum + i), vld1q_u16(below + i)));
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		sum[i] = (Uint16)(sum[i] + below[i]);
+	}
+
+#if defined(SDL_SSE2_INTRINSICS)
+	const __m128i round = _mm_set1_epi16(2);
+	for (; width > 1 && x + 2 <= dstwidth; x += 2)
+	{
+		// Pixels 2x & 2x+2 in one vector, their right neighbours in the other
+		const __m128i p0 = _mm_loadu_si128((const __m128i *)(sum + 8 * x));
+		const __m128i p1 = _mm_loadu_si128((const __m128i *)(sum + 8 * x + 8));
+		const __m128i quads = _mm_add_epi16(_mm_unpacklo_epi64(p0, p1), _mm_unpackhi_epi64(p0, p1));
+		Uint16 average[8];
+		_mm_storeu_si128((__m128i *)average, _mm_srli_epi16(_mm_add_epi16(quads, round), 2));
+		dst[x] = EncodePixel(average);
+		dst[x + 1] = EncodePixel(average + 4);
+	}
+#elif defined(SDL_NEON_INTRINSICS)
+	for (; width > 1 && x + 2 <= dstwidth; x += 2)
+	{
+		const uint16x8_t p0 = vld1q_u16(sum + 8 * x), p1 = vld1q_u16(sum + 8 * x + 8);
+		const uint16x8_t quads = vaddq_u16(vcombine_u16(vget_low_u16(p0), vget_low_u16(p1)),
+			vcombine_u16(vget_high_u16(p0), vget_high_u16(p1)));
+		Uint16 average[8];
+		vst1q_u16(average, vrshrq_n_u16(quads, 2));
+		dst[x] = EncodePixel(average);
+		dst[x + 1] = EncodePixel(average + 4);
+	}
+#endif
+	AverageColumns(dst, sum, width, x, dstwidth);
+}
+
+static void DownsampleBand(const PIXELBAND *band)
+{
+	const Uint32 *src = (const Uint32 *)band->src;
+	Uint16 *sum = band->scratch, *below = band->scratch + 4 * (size_t)band->width;
+	for (int y = band->first; y < band->end; ++y)
+	{
+		// The last row repeats when the source is one pixel tall
+		DecodeRow(sum, src + (size_t)band->width * (2 * y), band->width);
+		DecodeRow(below, src + (size_t)band->width * SDL_min(2 * y + 1, band->height - 1), band->width);
+		Uint32 *dst = band->dst + (size_t)band->dstwidth * y;
+		if (band->simd)
+		{
+			FilterRow(dst, sum, below, band->width, band->dstwidth);
+			continue;
+		}
+		for (int i = 0; i < 4 * band->width; ++i)
+		{
+			sum[i] = (Uint16)(sum[i] + below[i]);
+		}
+		AverageColumns(dst, sum, band->width, 0, band->dstwidth);
+	}
+}
+
+static bool Downsample(JOBQUEUE *jobs, void *dst, const void *src, int width, int height, bool simd)
+{
+	SDL_assert(dst && src && width > 0 && height > 0);
+	InitTables();
+	const int dstheight = SDL_max(height / 2, 1);
+	const int numbands = simd ? CountBands(jobs, dstheight) : 1;
+	PIXELBAND bands[JOBS_MAX_THREADS + 1];
+	bands[0] = (PIXELBAND)
+	{
+		.func = DownsampleBand,
+		.src = src,
+		.width = width,
+		.height = height,
+		.simd = simd,
+		.dst = dst,
+		.dstwidth = SDL_max(width / 2, 1),
+		.scratchsize = 8 * (size_t)width
+	};
+	Uint16 *scratch = SDL_malloc(bands[0].scratchsize * sizeof(Uint16) * numbands);
+	if (!(bands[0].scratch = scratch))
+	{
+		return false;
+	}
+	RunBands(jobs, bands, dstheight, numbands);
+	SDL_free(scratch);
+	return true;
+}
+
+bool DownsampleRGBA(JOBQUEUE *jobs, void *dst, const void *src, int width, int height)
+{
+	return Downsample(jobs, dst, src, width, height, true);
+}
+
+bool DownsampleRGBAScalar(void *dst, const void *src, int width, int height)
+{
+	return Downsample(NULL, dst, src, width, height, false);
+}
@@ -0,0 +1,30 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include "jobs.h"
+#include <SDL3/SDL_surface.h>
+
+#define PIXELS_MIN_JOB_ROWS 64  // Fewest rows worth handing to a worker
+
+/*  Whether ConvertImageRGBA handles images of a format directly, other formats have *
+ *  to be converted to SDL_PIXELFORMAT_ABGR8888 with SDL_ConvertSurface first        */
+bool CanConvertRGBA(SDL_PixelFormat format);
+
+/*  Convert an image to tightly packed RGBA8 rows (SDL_PIXELFORMAT_ABGR8888) in one  *
+ *  pass, flipping it vertically on the way when flip is set. Rows are converted in  *
+ *  bands spread over the workers & the caller, so dst can be mapped GPU memory.     *
+ *  jobs        - Workers to share the rows with, NULL converts them on the caller   *
+ *  dst         - 4 * w * h bytes                                                    */
+bool ConvertImageRGBA(JOBQUEUE *jobs, void *dst, const SDL_Surface *image, bool flip);
+
+/*  Make the next mip level of a tightly packed RGBA8 image, max(w/2,1) by           *
+ *  max(h/2,1), averaging each 2x2 quad in linear light. Colors are sRGB encoded,    *
+ *  alpha is linear, the last row or column repeats past an odd edge. Rows are       *
+ *  spread over the workers like ConvertImageRGBA.                                   */
+bool DownsampleRGBA(JOBQUEUE *jobs, void *dst, const void *src, int width, int height);
+
+/*  Reference for DownsampleRGBA, one row at a time without SIMD or workers, giving  *
+ *  the same result                                                                  */
+bool DownsampleRGBAScalar(void *dst, const void *src, int width, int height);
+
+#endif//PIXELS_H
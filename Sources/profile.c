@@ -0,0 +1,208 @@
+#include "profile.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_timer.h>
+#include <SDL3/SDL_iostream.h>
+
+#if defined(_MSC_VER)
+# define THREAD_LOCAL __declspec(thread)
+#else
+# define THREAD_LOCAL __thread
+#endif
+
+#define PROFILE_CALIBRATION_ZONES 100000  // Empty zones timed to measure the profiler's own cost
+
+typedef struct tagZONE
+{
+	const char *name;
+	Uint64 start, end;
+} ZONE;
+
+typedef struct tagPROFILEBUFFER
+{
+	const char *name;                       // Thread name, NULL if never named
+	int numzones, maxzones;
+	Uint64 dropped;                         // Zones closed after the buffer reached PROFILE_MAX_EVENTS
+	ZONE *zones;                            // Closed zones in the order they ended
+	int depth;                              // Open zones, may exceed PROFILE_MAX_DEPTH
+	const char *opennames[PROFILE_MAX_DEPTH];
+	Uint64 openstarts[PROFILE_MAX_DEPTH];
+} PROFILEBUFFER;
+
+// Buffers are only written by their own thread, and only read once those threads have been joined
+static PROFILEBUFFER *buffers[PROFILE_MAX_THREADS];
+static SDL_AtomicInt numbuffers;
+static THREAD_LOCAL PROFILEBUFFER *threadbuffer;
+static THREAD_LOCAL bool registered;
+
+static PROFILEBUFFER * ThreadBuffer(void)
+{
+	if (!registered)
+	{
+		registered = true;
+		const int slot = SDL_AddAtomicInt(&numbuffers, 1);
+		if (slot < PROFILE_MAX_THREADS && (threadbuffer = SDL_calloc(1, sizeof(PROFILEBUFFER))))
+		{
+			buffers[slot] = threadbuffer;
+		}
+	}
+	return threadbuffer;
+}
+
+void ProfileBegin(const char *name)
+{
+	PROFILEBUFFER *buffer = ThreadBuffer();
+	if (!buffer)
+	{
+		return;
+	}
+	if (buffer->depth < PROFILE_MAX_DEPTH)
+	{
+		buffer->opennames[buffer->depth] = name;
+		buffer->openstarts[buffer->depth] = SDL_GetPerformanceCounter();
+	}
+	++buffer->depth;
+}
+
+void ProfileEnd(void)
+{
+	const Uint64 end = SDL_GetPerformanceCounter();
+	PROFILEBUFFER *buffer = threadbuffer;
+	if (!buffer || buffer->depth == 0 || --buffer->depth >= PROFILE_MAX_DEPTH)
+	{
+		return;
+	}
+	if (buffer->numzones == buffer->maxzones)
+	{
+		const int newmax = buffer->maxzones ? buffer->maxzones * 2 : 4096;
+		ZONE *newzones = newmax <= PROFILE_MAX_EVENTS ?
+			SDL_realloc(buffer->zones, sizeof(ZONE) * (size_t)newmax) : NULL;
+		if (!newzones)
+		{
+			++buffer->dropped;
+			return;
+		}
+		buffer->zones = newzones;
+		buffer->maxzones = newmax;
+	}
+	buffer->zones[buffer->numzones++] = (ZONE)
+	{
+		.name = buffer->opennames[buffer->depth],
+		.start = buffer->openstarts[buffer->depth],
+		.end = end
+	};
+}
+
+void ProfileThreadName(const char *name)
+{
+	PROFILEBUFFER *buffer = ThreadBuffer();
+	if (buffer)
+	{
+		buffer->name = name;
+	}
+}
+
+// Nanoseconds to open & close an empty zone, the calibration zones are discarded
+static double MeasureZoneCost(void)
+{
+	PROFILEBUFFER *buffer = ThreadBuffer();
+	if (!buffer)
+	{
+		return 0.0;
+	}
+	const int numzones = buffer->numzones;
+	const Uint64 dropped = buffer->dropped;
+	const Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < PROFILE_CALIBRATION_ZONES; ++i)
+	{
+		ProfileBegin("Calibration");
+		ProfileEnd();
+	}
+	const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+	buffer->numzones = numzones;
+	buffer->dropped = dropped;
+	return (double)ticks * 1e9 / (double)SDL_GetPerformanceFrequency() / PROFILE_CALIBRATION_ZONES;
+}
+
+static void FreeProfileBuffers(int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (buffers[i])
+		{
+			SDL_free(buffers[i]->zones);
+			SDL_free(buffers[i]);
+			buffers[i] = NULL;
+		}
+	}
+	SDL_SetAtomicInt(&numbuffers, 0);
+	threadbuffer = NULL;
+	registered = false;
+}
+
+bool WriteProfileTrace(const char *path)
+{
+	const double zonens = MeasureZoneCost();
+	const int count = SDL_min(SDL_GetAtomicInt(&numbuffers), PROFILE_MAX_THREADS);
+
+	// Timestamps are written relative to the earliest zone
+	Uint64 base = SDL_MAX_UINT64, dropped = 0;
+	int numzones = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const PROFILEBUFFER *buffer = buffers[i];
+		for (int j = 0; buffer && j < buffer->numzones; ++j)
+		{
+			base = SDL_min(base, buffer->zones[j].start);
+		}
+		numzones += buffer ? buffer->numzones : 0;
+		dropped += buffer ? buffer->dropped : 0;
+	}
+
+	SDL_IOStream *out = SDL_IOFromFile(path, "w");
+	bool written = out && SDL_IOprintf(out, "{\"displayTimeUnit\":\"ms\",\"otherData\":"
+		"{\"zone_overhead_ns\":%.1f,\"dropped_zones\":%" SDL_PRIu64 "},\"traceEvents\":[\n",
+		zonens, dropped) > 0;
+	const double tous = 1e6 / (double)SDL_GetPerformanceFrequency();
+	bool first = true;
+	for (int i = 0; i < count && written; ++i)
+	{
+		const PROFILEBUFFER *buffer = buffers[i];
+		if (!buffer)
+		{
+			continue;
+		}
+		if (buffer->name)
+		{
+			written = SDL_IOprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", i, buffer->name) > 0;
+			first = false;
+		}
+		for (int j = 0; j < buffer->numzones && written; ++j)
+		{
+			const ZONE *zone = &buffer->zones[j];
+			written = SDL_IOprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n", zone->name, i, (double)(zone->start - base) * tous,
+				(double)(zone->end - zone->start) * tous) > 0;
+			first = false;
+		}
+	}
+	written = written && SDL_IOprintf(out, "\n]}\n") > 0;
+	if (out && !SDL_CloseIO(out))
+	{
+		written = false;
+	}
+	FreeProfileBuffers(count);
+
+	if (!written)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write profile trace \"%s\": %s", path, SDL_GetError());
+		return false;
+	}
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+		"Wrote %d zones from %d threads to \"%s\" (%" SDL_PRIu64 " dropped), %.1f ns per zone",
+		numzones, count, path, dropped, zonens);
+	return true;
+}
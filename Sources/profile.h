@@ -0,0 +1,45 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/*  Scoped timing zones, compiled in when PROFILE is defined (the PROFILE CMake      *
+ *  option) and compiled out to nothing otherwise. Each thread records its zones    *
+ *  into its own buffer without locking, the buffers are merged into a Chrome trace *
+ *  (chrome://tracing or ui.perfetto.dev) by WriteProfileTrace once every other     *
+ *  thread that recorded zones has been joined.                                     */
+#ifdef PROFILE
+
+#include <stdbool.h>
+
+#define PROFILE_MAX_THREADS 32        // Threads that may record zones, further threads are ignored
+#define PROFILE_MAX_DEPTH   32        // Deepest nesting of zones recorded on a thread
+#define PROFILE_MAX_EVENTS  (1 << 22) // Most zones kept per thread, later ones are counted as dropped
+#define PROFILE_TRACE_FILE  "Lesson10.trace.json"
+
+/*  Open a zone on the calling thread, name must outlive the profiler (use literals) */
+void ProfileBegin(const char *name);
+
+/*  Close the innermost open zone on the calling thread                              */
+void ProfileEnd(void);
+
+/*  Name the calling thread in the trace, name must outlive the profiler             */
+void ProfileThreadName(const char *name);
+
+/*  Write every thread's zones as Chrome trace JSON and free the buffers, also       *
+ *  measures and logs the cost of a zone on this machine.                            */
+bool WriteProfileTrace(const char *path);
+
+#define PROFILE_BEGIN(name)  ProfileBegin(name)
+#define PROFILE_END()        ProfileEnd()
+#define PROFILE_THREAD(name) ProfileThreadName(name)
+#define PROFILE_WRITE(path)  WriteProfileTrace(path)
+
+#else
+
+#define PROFILE_BEGIN(name)  ((void)0)
+#define PROFILE_END()        ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_WRITE(path)  ((void)0)
+
+#endif//PROFILE
+
+#endif//PROFILE_H
@@ -0,0 +1,276 @@
+#include "residency.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_assert.h>
+
+bool InitResidency(RESIDENCY *res, const RESIDENCYBACKEND *backend, JOBQUEUE *jobs, int maxtextures,
+	Uint64 budget)
+{
+	SDL_assert(res && backend && backend->read && backend->resize && maxtextures > 0);
+	SDL_zerop(res);
+	// Fixed storage, workers write into the textures while levels are read
+	if (!(res->textures = SDL_calloc((size_t)maxtextures, sizeof(RESIDENTTEXTURE))))
+	{
+		return false;
+	}
+	res->backend = *backend;
+	res->jobs = jobs;
+	res->maxtextures = maxtextures;
+	res->stats.budget = budget;
+	return true;
+}
+
+void FreeResidency(RESIDENCY *res)
+{
+	for (int i = 0; i < res->numtextures; ++i)
+	{
+		RESIDENTTEXTURE *texture = &res->textures[i];
+		if (texture->loading >= 0)
+		{
+			WaitJob(res->jobs, &texture->job);
+			SDL_free(texture->texels);
+		}
+	}
+	SDL_free(res->textures);
+	SDL_zerop(res);
+}
+
+int AddResidentTexture(RESIDENCY *res, int numlevels, const Uint32 *levelsizes, int first)
+{
+	if (res->numtextures == res->maxtextures)
+	{
+		SDL_SetError("Too many resident textures (%d)", res->maxtextures);
+		return -1;
+	}
+	if (numlevels <= 0 || numlevels > RESIDENCY_MAX_LEVELS || first < 0 || first >= numlevels)
+	{
+		SDL_SetError("Resident texture levels %d to %d out of range", first, numlevels - 1);
+		return -1;
+	}
+	RESIDENTTEXTURE *texture = &res->textures[res->numtextures];
+	*texture = (RESIDENTTEXTURE)
+	{
+		.numlevels = numlevels,
+		.first = first,
+		.tail = first,
+		.wanted = first,
+		.lastused = 0,
+		.loading = -1,
+		.deferred = 0,
+		.texels = NULL,
+		.read = false,
+		.owner = res,
+		.index = res->numtextures
+	};
+	SDL_memcpy(texture->levelsizes, levelsizes, sizeof(Uint32) * (size_t)numlevels);
+	for (int level = first; level < numlevels; ++level)
+	{
+		res->stats.residentbytes += levelsizes[level];
+	}
+	return res->numtextures++;
+}
+
+void SetResidencyBudget(RESIDENCY *res, Uint64 budget)
+{
+	res->stats.budget = budget;
+}
+
+void UseResidentTexture(RESIDENCY *res, int texture, int level)
+{
+	SDL_assert(texture >= 0 && texture < res->numtextures);
+	RESIDENTTEXTURE *used = &res->textures[texture];
+	level = SDL_clamp(level, 0, used->numlevels - 1);
+	if (used->lastused != res->frame || level < used->wanted)
+	{
+		used->wanted = level;
+	}
+	used->lastused = res->frame;
+}
+
+// Whether a texture's finest resident level is more than this frame asks of it
+static bool Surplus(const RESIDENCY *res, const RESIDENTTEXTURE *texture)
+{
+	return texture->lastused != res->frame || texture->first < texture->wanted;
+}
+
+/*  Drop the finest resident level of the least recently used texture above its      *
+ *  tail, preferring the larger level between textures last used the same frame.     *
+ *  Only surplus levels unless needed is set, never keep's. False if none could be.  */
+static bool EvictLevel(RESIDENCY *res, void *context, const RESIDENTTEXTURE *keep, bool needed)
+{
+	RESIDENTTEXTURE *victim = NULL;
+	for (int i = 0; i < res->numtextures; ++i)
+	{
+		RESIDENTTEXTURE *texture = &res->textures[i];
+		if (texture == keep || texture->first >= texture->tail || (!needed && !Surplus(res, texture)))
+		{
+			continue;
+		}
+		if (!victim || texture->lastused < victim->lastused || (texture->lastused == victim->lastused &&
+			texture->levelsizes[texture->first] > victim->levelsizes[victim->first]))
+		{
+			victim = texture;
+		}
+	}
+	if (!victim || !res->backend.resize(res->backend.data, context, victim->index, victim->first + 1,
+		victim->first, NULL))
+	{
+		res->stats.failed += victim != NULL;
+		return false;
+	}
+	const Uint32 size = victim->levelsizes[victim->first++];
+	res->stats.residentbytes -= size;
+	res->stats.evictedbytes += size;
+	++res->stats.evicted;
+	return true;
+}
+
+/*  Evict surplus levels of other textures until size more bytes fit in the budget.  *
+ *  Fails when only levels still asked for are left, the budget was lowered.         */
+static bool MakeRoom(RESIDENCY *res, void *context, const RESIDENTTEXTURE *texture, Uint64 size)
+{
+	while (res->stats.residentbytes + size > res->stats.budget)
+	{
+		if (!EvictLevel(res, context, texture, false))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Bytes EvictLevel could free without dropping anything still asked for
+static Uint64 SurplusBytes(const RESIDENCY *res, const RESIDENTTEXTURE *keep)
+{
+	Uint64 bytes = 0;
+	for (int i = 0; i < res->numtextures; ++i)
+	{
+		const RESIDENTTEXTURE *texture = &res->textures[i];
+		if (texture == keep)
+		{
+			continue;
+		}
+		const int end = texture->lastused != res->frame ? texture->tail : SDL_min(texture->wanted, texture->tail);
+		for (int level = texture->first; level < end; ++level)
+		{
+			bytes += texture->levelsizes[level];
+		}
+	}
+	return bytes;
+}
+
+static void ReadLevel(void *data)
+{
+	RESIDENTTEXTURE *texture = data;
+	const RESIDENCYBACKEND *backend = &texture->owner->backend;
+	texture->read = backend->read(backend->data, texture->index, texture->loading, texture->texels,
+		texture->levelsizes[texture->loading]);
+}
+
+// Upload a level that has been read if it's still the next one wanted, making room for it first
+static void FinishLevel(RESIDENCY *res, void *context, RESIDENTTEXTURE *texture)
+{
+	WaitJob(res->jobs, &texture->job);
+	const int level = texture->loading;
+	const Uint32 size = texture->levelsizes[level];
+	const bool wanted = texture->lastused == res->frame && texture->wanted <= level && level == texture->first - 1;
+	if (!texture->read)
+	{
+		texture->deferred = res->frame + RESIDENCY_RETRY_FRAMES;
+		++res->stats.failed;
+	}
+	else if (wanted && MakeRoom(res, context, texture, size))
+	{
+		if (res->backend.resize(res->backend.data, context, texture->index, level, texture->first, texture->texels))
+		{
+			texture->first = level;
+			res->stats.residentbytes += size;
+			res->stats.streamedbytes += size;
+			++res->stats.streamed;
+		}
+		else
+		{
+			++res->stats.failed;
+		}
+	}
+	SDL_free(texture->texels);
+	texture->texels = NULL;
+	texture->loading = -1;
+	res->pendingbytes -= size;
+	--res->stats.pending;
+}
+
+// Start reading the next finer level of a texture, on a worker when there are any
+static bool StartLevel(RESIDENCY *res, RESIDENTTEXTURE *texture)
+{
+	const int level = texture->first - 1;
+	if (!(texture->texels = SDL_malloc(texture->levelsizes[level])))
+	{
+		++res->stats.failed;
+		return false;
+	}
+	texture->loading = level;
+	texture->read = false;
+	res->pendingbytes += texture->levelsizes[level];
+	++res->stats.pending;
+	if (res->jobs && res->jobs->numthreads > 0)
+	{
+		PushJob(res->jobs, &texture->job, ReadLevel, texture);  // Runs here when the queue is full
+	}
+	else
+	{
+		ReadLevel(texture);
+		texture->job.done = NULL;
+	}
+	return true;
+}
+
+void UpdateResidency(RESIDENCY *res, void *context)
+{
+	// Upload the levels that finished reading since the last frame
+	for (int i = 0; i < res->numtextures; ++i)
+	{
+		RESIDENTTEXTURE *texture = &res->textures[i];
+		if (texture->loading >= 0 && JobDone(&texture->job))
+		{
+			FinishLevel(res, context, texture);
+		}
+	}
+
+	// A lowered budget drops levels even if they're asked for, least recently used first
+	while (res->stats.residentbytes > res->stats.budget && EvictLevel(res, context, NULL, true))
+	{
+	}
+
+	// Start reading for the textures furthest from the level they're asked for, when the level fits without
+	// evicting anything that's still asked for
+	while (res->stats.pending < RESIDENCY_MAX_PENDING)
+	{
+		RESIDENTTEXTURE *next = NULL;
+		for (int i = 0; i < res->numtextures; ++i)
+		{
+			RESIDENTTEXTURE *texture = &res->textures[i];
+			if (texture->loading < 0 && texture->lastused == res->frame && texture->wanted < texture->first &&
+				res->frame >= texture->deferred &&
+				(!next || texture->first - texture->wanted > next->first - next->wanted))
+			{
+				next = texture;
+			}
+		}
+		if (!next)
+		{
+			break;
+		}
+		const Uint64 size = next->levelsizes[next->first - 1];
+		if (res->stats.residentbytes + res->pendingbytes + size > res->stats.budget + SurplusBytes(res, next))
+		{
+			next->deferred = res->frame + 1;  // Try the others
+			continue;
+		}
+		if (!StartLevel(res, next))
+		{
+			break;
+		}
+	}
+	++res->frame;
+}
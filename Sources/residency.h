@@ -0,0 +1,98 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include "jobs.h"
+
+#define RESIDENCY_MAX_LEVELS   16  // Mip levels of the largest texture tracked
+#define RESIDENCY_MAX_PENDING  4   // Most levels being read on the workers at once
+#define RESIDENCY_RETRY_FRAMES 60  // Frames before a level that failed to read is tried again
+
+/*  GPU side of texture streaming, the app's SDL GPU textures or a mock driving the  *
+ *  policy without a device. Textures are the indices AddResidentTexture returned.   */
+typedef struct tagRESIDENCYBACKEND
+{
+	void *data;
+	// Read the texels of one level into dst, size bytes, on a worker thread
+	bool (*read)(void *data, int texture, int level, void *dst, Uint32 size);
+	// Recreate a texture holding levels first to the last, keeping the levels it held from oldfirst. texels holds
+	// level first when streaming in (first < oldfirst) and is NULL when evicting. Called from UpdateResidency.
+	bool (*resize)(void *data, void *context, int texture, int first, int oldfirst, const void *texels);
+} RESIDENCYBACKEND;
+
+typedef struct tagRESIDENCYSTATS
+{
+	Uint64 budget;               // Most bytes the resident levels may take
+	Uint64 residentbytes;        // Bytes of every level on the GPU
+	int pending;                 // Levels being read on the workers, uploaded once read
+	unsigned streamed, evicted;  // Levels uploaded & dropped so far
+	Uint64 streamedbytes, evictedbytes;
+	unsigned failed;             // Levels whose read or upload failed
+} RESIDENCYSTATS;
+
+typedef struct tagRESIDENTTEXTURE
+{
+	int numlevels;
+	Uint32 levelsizes[RESIDENCY_MAX_LEVELS];  // Bytes of each level, finest first
+	int first;                   // Finest level resident, every coarser level is too
+	int tail;                    // Low mips resident from the start & never evicted
+	int wanted;                  // Finest level asked for the last frame the texture was used
+	Uint64 lastused;             // Frame the texture was last used
+
+	// Internal
+	int loading;                 // Level being read on a worker, -1 when none
+	Uint64 deferred;             // Frame the next level may be read from, after failing or not fitting
+	void *texels;                // Level being read
+	bool read;                   // Set by the worker when the read succeeded
+	JOB job;
+	struct tagRESIDENCY *owner;
+	int index;
+} RESIDENTTEXTURE;
+
+typedef struct tagRESIDENCY
+{
+	RESIDENCYBACKEND backend;
+	JOBQUEUE *jobs;              // Workers reading levels, NULL reads them on the caller
+	int numtextures, maxtextures;
+	RESIDENTTEXTURE *textures;
+	Uint64 frame;                // Frames updated so far, textures used are stamped with it
+	Uint64 pendingbytes;         // Bytes of the levels being read
+	RESIDENCYSTATS stats;
+} RESIDENCY;
+
+/*  Track the mip levels resident on the GPU against a budget. Each frame textures   *
+ *  are asked for the finest level drawing needs, finer levels are then read on the  *
+ *  workers one at a time and uploaded once read, evicting the least recently used   *
+ *  levels nothing asks for to make room. Levels are never evicted below the tail.   *
+ *  jobs        - Workers to read levels on, NULL or a queue without workers reads   *
+ *                them on the caller                                                 *
+ *  maxtextures - Most textures added                                                *
+ *  budget      - Most bytes the resident levels may take                            */
+bool InitResidency(RESIDENCY *res, const RESIDENCYBACKEND *backend, JOBQUEUE *jobs, int maxtextures,
+	Uint64 budget);
+
+/*  Wait for every level still being read, then release the tracking. The backend's  *
+ *  textures are left alone.                                                         */
+void FreeResidency(RESIDENCY *res);
+
+/*  Track a texture the backend has already created with levels first to the last    *
+ *  resident, these stay resident as its tail. Returns the texture's index, or -1    *
+ *  with the error set.                                                              *
+ *  levelsizes  - Bytes of each of the numlevels levels, finest first                */
+int AddResidentTexture(RESIDENCY *res, int numlevels, const Uint32 *levelsizes, int first);
+
+/*  Change the budget, levels over it are evicted least recently used first on the   *
+ *  next update even if they're still asked for                                      */
+void SetResidencyBudget(RESIDENCY *res, Uint64 budget);
+
+/*  Ask for a texture's levels from level down to be resident for this frame. Called *
+ *  any number of times before the frame's update, the finest level asked wins.      */
+void UseResidentTexture(RESIDENCY *res, int texture, int level);
+
+/*  Upload the levels that finished reading & are still wanted, evict over the       *
+ *  budget and start reading the next finer level of the textures that want one,     *
+ *  furthest from the level they're asked for first. Called once per frame on the    *
+ *  thread drawing.                                                                  *
+ *  context     - Passed on to the backend's resize, the frame's command buffer      */
+void UpdateResidency(RESIDENCY *res, void *context);
+
+#endif//RESIDENCY_H
@@ -0,0 +1,95 @@
+#include "resolution.h"
+
+#define RESOLUTION_MAX_STEPS ((int)(1.0f / RESOLUTION_STEP + 0.5f))
+#define RESOLUTION_MIN_STEPS ((int)(RESOLUTION_MIN_SCALE / RESOLUTION_STEP + 0.5f))
+
+void InitResolutionScaler(RESOLUTIONSCALER *scaler, float budgetms)
+{
+	SDL_zerop(scaler);
+	scaler->budgetms = budgetms;
+	scaler->scale = 1.0f;
+	scaler->percentilems = -1.0f;
+}
+
+static int FrameBin(const RESOLUTIONSCALER *scaler, float ms)
+{
+	const float bin = ms * (float)RESOLUTION_BINS / (2.0f * scaler->budgetms);
+	return bin >= (float)(RESOLUTION_BINS - 1) ? RESOLUTION_BINS - 1 : bin > 0.0f ? (int)bin : 0;
+}
+
+// Upper edge of the bin the window's percentile falls in, erring on the slow side
+static float WindowPercentile(const RESOLUTIONSCALER *scaler)
+{
+	const int rank = (scaler->count * RESOLUTION_PERCENTILE + 99) / 100;
+	int bin = 0;
+	for (int seen = 0; bin < RESOLUTION_BINS - 1; ++bin)
+	{
+		seen += scaler->bins[bin];
+		if (seen >= rank)
+		{
+			break;
+		}
+	}
+	return (float)(bin + 1) * 2.0f * scaler->budgetms / (float)RESOLUTION_BINS;
+}
+
+void ClearResolutionWindow(RESOLUTIONSCALER *scaler, int settling)
+{
+	SDL_zeroa(scaler->bins);
+	scaler->next = 0;
+	scaler->count = 0;
+	scaler->settling = settling;
+}
+
+bool AddResolutionFrame(RESOLUTIONSCALER *scaler, float ms)
+{
+	if (scaler->settling > 0)
+	{
+		--scaler->settling;
+		return false;
+	}
+	if (scaler->count == RESOLUTION_WINDOW_FRAMES)
+	{
+		--scaler->bins[FrameBin(scaler, scaler->window[scaler->next])];
+	}
+	else
+	{
+		++scaler->count;
+	}
+	scaler->window[scaler->next] = ms;
+	++scaler->bins[FrameBin(scaler, ms)];
+	scaler->next = (scaler->next + 1) % RESOLUTION_WINDOW_FRAMES;
+	if (scaler->count < RESOLUTION_WINDOW_FRAMES)
+	{
+		return false;
+	}
+
+	const float percentile = scaler->percentilems = WindowPercentile(scaler);
+	const int steps = (int)SDL_roundf(scaler->scale / RESOLUTION_STEP);
+	int picked = steps;
+	if (percentile > scaler->budgetms)
+	{
+		// Frame time taken to go with the pixels drawn, the square of the scale
+		const float target = 0.5f * (1.0f + RESOLUTION_RAISE_FRACTION) * scaler->budgetms;
+		const float fit = scaler->scale * SDL_sqrtf(target / percentile);
+		picked = SDL_min((int)SDL_floorf(fit / RESOLUTION_STEP + 0.001f), steps - 1);
+	}
+	else if (percentile < RESOLUTION_RAISE_FRACTION * scaler->budgetms)
+	{
+		picked = steps + 1;
+	}
+	picked = SDL_clamp(picked, RESOLUTION_MIN_STEPS, RESOLUTION_MAX_STEPS);
+	if (picked == steps)
+	{
+		return false;
+	}
+	scaler->scale = (float)picked * RESOLUTION_STEP;
+	ClearResolutionWindow(scaler, 0);
+	return true;
+}
+
+Uint32 ScaledExtent(const RESOLUTIONSCALER *scaler, Uint32 extent)
+{
+	const Uint32 scaled = (Uint32)((float)extent * scaler->scale + 0.5f);
+	return scaled > 0 ? scaled : 1;
+}
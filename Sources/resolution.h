@@ -0,0 +1,43 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <SDL3/SDL_stdinc.h>
+
+#define RESOLUTION_WINDOW_FRAMES  60    // Latest frame times in the rolling histogram
+#define RESOLUTION_BINS           64    // Histogram bins, spanning twice the budget, longer times land in the last
+#define RESOLUTION_PERCENTILE     90    // Frame time percentile held under the budget
+#define RESOLUTION_MIN_SCALE      0.5f  // Least fraction of the target's width & height drawn
+#define RESOLUTION_STEP           0.05f // Scales are multiples of this, so small changes don't resize the targets
+#define RESOLUTION_RAISE_FRACTION 0.75f // Fraction of the budget the percentile must be under to raise the scale
+
+/*  Picks the fraction of the target's width & height to draw from a rolling         *
+ *  histogram of frame times. Independent of the GPU, the frame times can come from  *
+ *  anywhere.                                                                        */
+typedef struct tagRESOLUTIONSCALER
+{
+	float budgetms;              // Frame time the percentile is held under, 0 keeps drawing at full size
+	float scale;                 // Fraction of the target's width & height drawn
+	float window[RESOLUTION_WINDOW_FRAMES];  // Ring of the latest frame times
+	int next, count;
+	Uint16 bins[RESOLUTION_BINS];  // Histogram of the times in window
+	int settling;                // Frames still to come that were drawn before the window was cleared, not counted
+	float percentilems;          // Percentile when the window was last full, -1 before it first was
+} RESOLUTIONSCALER;
+
+void InitResolutionScaler(RESOLUTIONSCALER *scaler, float budgetms);
+
+/*  Add a frame's time to the histogram, and once the window is full reconsider the  *
+ *  scale. Over budget it drops to what should fit midway between raising & the      *
+ *  budget, taking frame time to follow the pixels drawn. Under the raise fraction   *
+ *  it rises a step. Between the two it stays, and after either change the window    *
+ *  has to fill again at the new scale. Returns whether the scale changed.           */
+bool AddResolutionFrame(RESOLUTIONSCALER *scaler, float ms);
+
+/*  Empty the window, once something else changed what frames cost                   *
+ *  settling    - Frames still to be added that were drawn before the change         */
+void ClearResolutionWindow(RESOLUTIONSCALER *scaler, int settling);
+
+/*  An extent of the target scaled, at least 1 pixel                                 */
+Uint32 ScaledExtent(const RESOLUTIONSCALER *scaler, Uint32 extent);
+
+#endif//RESOLUTION_H
@@ -0,0 +1,128 @@
+#include "simulation.h"
+
+void InitSimulation(SIMULATION *sim, const CAMERA *camera)
+{
+	*sim = (SIMULATION)
+	{
+		.camera = *camera,
+		.prevcamera = *camera,
+		.ticks = 0,
+		.accumulator = 0,
+		.lastns = 0
+	};
+}
+
+void TickSimulation(SIMULATION *sim, const CAMERAINPUT *input)
+{
+	const float piover180 = 0.0174532925f;
+	CAMERA *camera = &sim->camera;
+	sim->prevcamera = *camera;
+	++sim->ticks;
+
+	if (input->lookup)
+	{
+		camera->z -= 0.02f;
+	}
+
+	if (input->lookdown)
+	{
+		camera->z += 0.02f;
+	}
+
+	if (input->forward)
+	{
+		camera->xpos -= SDL_sinf(camera->heading * piover180) * 0.05f;
+		camera->zpos -= SDL_cosf(camera->heading * piover180) * 0.05f;
+		if (camera->walkbiasangle >= 359.0f)
+		{
+			camera->walkbiasangle = 0.0f;
+		}
+		else
+		{
+			camera->walkbiasangle += 10;
+		}
+		camera->walkbias = SDL_sinf(camera->walkbiasangle * piover180) / 20.0f;
+	}
+
+	if (input->back)
+	{
+		camera->xpos += SDL_sinf(camera->heading * piover180) * 0.05f;
+		camera->zpos += SDL_cosf(camera->heading * piover180) * 0.05f;
+		if (camera->walkbiasangle <= 1.0f)
+		{
+			camera->walkbiasangle = 359.0f;
+		}
+		else
+		{
+			camera->walkbiasangle -= 10;
+		}
+		camera->walkbias = SDL_sinf(camera->walkbiasangle * piover180) / 20.0f;
+	}
+
+	if (input->turnright)
+	{
+		camera->heading -= 1.0f;
+		camera->yrot = camera->heading;
+	}
+
+	if (input->turnleft)
+	{
+		camera->heading += 1.0f;
+		camera->yrot = camera->heading;
+	}
+
+	if (input->lookup)
+	{
+		camera->lookupdown -= 1.0f;
+	}
+
+	if (input->lookdown)
+	{
+		camera->lookupdown += 1.0f;
+	}
+}
+
+int UpdateSimulation(SIMULATION *sim, Uint64 nowns, const CAMERAINPUT *input)
+{
+	if (sim->lastns == 0 || nowns < sim->lastns)
+	{
+		sim->lastns = nowns;
+		return 0;
+	}
+	sim->accumulator += nowns - sim->lastns;
+	sim->lastns = nowns;
+
+	// After a stall (window drag, breakpoint) catch up by at most SIM_MAX_TICKS rather than all at once
+	if (sim->accumulator > SIM_MAX_TICKS * SIM_TICK_NS)
+	{
+		sim->accumulator = SIM_MAX_TICKS * SIM_TICK_NS;
+	}
+	int ticks = 0;
+	for (; sim->accumulator >= SIM_TICK_NS; sim->accumulator -= SIM_TICK_NS, ++ticks)
+	{
+		TickSimulation(sim, input);
+	}
+	return ticks;
+}
+
+static float Lerp(float a, float b, float t)
+{
+	return a + (b - a) * t;
+}
+
+void InterpolateCamera(const SIMULATION *sim, CAMERA *camera)
+{
+	const CAMERA *prev = &sim->prevcamera, *next = &sim->camera;
+	const float t = (float)((double)sim->accumulator / (double)SIM_TICK_NS);
+	*camera = (CAMERA)
+	{
+		.heading = Lerp(prev->heading, next->heading, t),
+		.xpos = Lerp(prev->xpos, next->xpos, t),
+		.zpos = Lerp(prev->zpos, next->zpos, t),
+		.yrot = Lerp(prev->yrot, next->yrot, t),
+		.walkbias = Lerp(prev->walkbias, next->walkbias, t),
+		.walkbiasangle = next->walkbiasangle,  // Only drives walkbias, which is interpolated instead
+		.lookupdown = Lerp(prev->lookupdown, next->lookupdown, t),
+		.z = Lerp(prev->z, next->z, t)
+	};
+}
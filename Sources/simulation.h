@@ -0,0 +1,50 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_timer.h>
+
+#define SIM_TICK_NS   (SDL_NS_PER_SECOND / 60)  // Length of a simulation tick, the camera speeds are per tick
+#define SIM_MAX_TICKS 8                         // Most ticks run per update, longer stalls are dropped
+
+typedef struct tagCAMERA
+{
+	float heading;
+	float xpos, zpos;
+	float yrot;
+	float walkbias, walkbiasangle;
+	float lookupdown;
+	float z;
+} CAMERA;
+
+typedef struct tagCAMERAINPUT
+{
+	bool forward, back;
+	bool turnleft, turnright;
+	bool lookup, lookdown;
+} CAMERAINPUT;
+
+typedef struct tagSIMULATION
+{
+	CAMERA camera;             // State after the latest tick
+	CAMERA prevcamera;         // State after the tick before, drawn frames interpolate from it
+	Uint64 ticks;              // Ticks simulated so far
+	Uint64 accumulator;        // Real time not simulated yet, less than a tick after an update
+	Uint64 lastns;             // Time of the previous update, 0 before the first
+} SIMULATION;
+
+void InitSimulation(SIMULATION *sim, const CAMERA *camera);
+
+/*  Advance the simulation by exactly one tick, independent of any clock so tests    *
+ *  and tools can step it deterministically                                          */
+void TickSimulation(SIMULATION *sim, const CAMERAINPUT *input);
+
+/*  Run every tick that has come due by nowns (SDL_GetTicksNS), applying the same    *
+ *  input to each. Returns the number of ticks run.                                  */
+int UpdateSimulation(SIMULATION *sim, Uint64 nowns, const CAMERAINPUT *input);
+
+/*  Camera to draw, between the last two ticks by how far real time has moved into   *
+ *  the next one                                                                     */
+void InterpolateCamera(const SIMULATION *sim, CAMERA *camera);
+
+#endif//SIMULATION_H
@@ -0,0 +1,83 @@
+#include "texture.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_iostream.h>
+
+#define TEXTURE_BINARY_HEADER_SIZE 20u
+
+uint32_t BlockSize(uint32_t format)
+{
+	switch (format)
+	{
+	case BLOCKFORMAT_BC1: return 8;
+	case BLOCKFORMAT_BC3: return 16;
+	default: return 0;
+	}
+}
+
+uint32_t BlockLevelSize(uint32_t format, uint32_t width, uint32_t height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * BlockSize(format);
+}
+
+uint64_t BlockLevelOffset(const TEXTUREHEADER *header, uint32_t level)
+{
+	uint64_t offset = 0;
+	for (uint32_t finer = 0; finer < level; ++finer)
+	{
+		const uint32_t width = SDL_max(header->width >> finer, 1u), height = SDL_max(header->height >> finer, 1u);
+		offset += BlockLevelSize(header->format, width, height);
+	}
+	return offset;
+}
+
+uint64_t BlockTextureSize(const TEXTUREHEADER *header)
+{
+	return BlockLevelOffset(header, header->numlevels);
+}
+
+bool WriteBlockTexture(SDL_IOStream *out, const TEXTUREHEADER *header, const void *data)
+{
+	SDL_assert(out && header && data);
+	const size_t datasize = (size_t)BlockTextureSize(header);
+	return SDL_WriteU32LE(out, TEXTURE_BINARY_MAGIC) &&
+		SDL_WriteU16LE(out, TEXTURE_BINARY_VERSION) &&
+		SDL_WriteU16LE(out, header->format) &&
+		SDL_WriteU32LE(out, header->width) &&
+		SDL_WriteU32LE(out, header->height) &&
+		SDL_WriteU32LE(out, header->numlevels) &&
+		SDL_WriteIO(out, data, datasize) == datasize;
+}
+
+bool ReadBlockTexture(SDL_IOStream *in, TEXTUREHEADER *header)
+{
+	SDL_assert(in && header);
+	const Sint64 filesize = SDL_GetIOSize(in);
+	if (!SDL_ReadU32LE(in, &header->magic) ||
+		!SDL_ReadU16LE(in, &header->version) ||
+		!SDL_ReadU16LE(in, &header->format) ||
+		!SDL_ReadU32LE(in, &header->width) ||
+		!SDL_ReadU32LE(in, &header->height) ||
+		!SDL_ReadU32LE(in, &header->numlevels))
+	{
+		return SDL_SetError("Compiled texture: Truncated header");
+	}
+	if (header->magic != TEXTURE_BINARY_MAGIC)
+	{
+		return SDL_SetError("Compiled texture: Bad magic");
+	}
+	if (header->version != TEXTURE_BINARY_VERSION || BlockSize(header->format) == 0)
+	{
+		return SDL_SetError("Compiled texture: Unsupported version %u (format %u)",
+			(unsigned)header->version, (unsigned)header->format);
+	}
+	const uint32_t largest = SDL_max(header->width, header->height);
+	if (header->width == 0 || header->height == 0 || largest > TEXTURE_MAX_SIZE ||
+		header->numlevels != (uint32_t)SDL_MostSignificantBitIndex32(largest) + 1 ||
+		(filesize >= 0 && (Uint64)filesize < TEXTURE_BINARY_HEADER_SIZE + BlockTextureSize(header)))
+	{
+		return SDL_SetError("Compiled texture: Invalid size (%ux%u, %u levels)",
+			(unsigned)header->width, (unsigned)header->height, (unsigned)header->numlevels);
+	}
+	return true;
+}
@@ -0,0 +1,55 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*  Compiled texture format (.btex), all fields are little-endian. The header is     *
+ *  followed by every mip level from the full size image down to 1x1, each one a     *
+ *  tightly packed grid of 4x4 pixel blocks in the order the GPU expects them, so    *
+ *  the levels can be copied straight into a transfer buffer. Images are stored      *
+ *  bottom row first, already flipped for the texture coordinates the world uses.    */
+#define TEXTURE_BINARY_MAGIC   0x58455442u  // "BTEX"
+#define TEXTURE_BINARY_VERSION 1u
+#define TEXTURE_MAX_LEVELS     16           // Mip levels of a 32768 pixel wide image
+#define TEXTURE_MAX_SIZE       (1u << (TEXTURE_MAX_LEVELS - 1))
+
+typedef enum
+{
+	BLOCKFORMAT_BC1 = 1,   // 8 bytes per block, RGB with 1-bit alpha
+	BLOCKFORMAT_BC3 = 3    // 16 bytes per block, RGB with interpolated alpha
+} BLOCKFORMAT;
+
+typedef struct tagTEXTUREHEADER
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t format;        // BLOCKFORMAT
+	uint32_t width, height; // Size of the first mip level in pixels
+	uint32_t numlevels;     // Mip levels stored, always the full chain down to 1x1
+} TEXTUREHEADER;
+
+/*  Size in bytes of one block of a format, 0 if the format is unknown               */
+uint32_t BlockSize(uint32_t format);
+
+/*  Size in bytes of a width x height mip level, partial blocks are padded out       */
+uint32_t BlockLevelSize(uint32_t format, uint32_t width, uint32_t height);
+
+/*  Offset in bytes of a mip level from the start of the first, the size of every    *
+ *  finer level                                                                      */
+uint64_t BlockLevelOffset(const TEXTUREHEADER *header, uint32_t level);
+
+/*  Size in bytes of every mip level of a compiled texture                           */
+uint64_t BlockTextureSize(const TEXTUREHEADER *header);
+
+struct SDL_IOStream;
+
+/*  Write a compiled texture, data holds the mip levels in order                     */
+bool WriteBlockTexture(struct SDL_IOStream *out, const TEXTUREHEADER *header, const void *data);
+
+/*  Read and validate a compiled texture header, leaving the stream positioned at    *
+ *  the start of the first mip level                                                 */
+bool ReadBlockTexture(struct SDL_IOStream *in, TEXTUREHEADER *header);
+
+#endif//TEXTURE_H
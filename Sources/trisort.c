@@ -0,0 +1,392 @@
+#include "trisort.h"
+#include <SDL3/SDL_error.h>
+
+#define TRISORT_MAX_KEY ((1u << TRISORT_KEY_BITS) - 1)
+
+// A cluster's visible triangles are one bit each of a Uint64
+SDL_COMPILE_TIME_ASSERT(trisort_cluster, TRISORT_CLUSTER <= 64);
+
+bool InitTriangleSort(TRISORT *sort, const MESH *mesh, Uint32 numtriangles)
+{
+	SDL_zerop(sort);
+	if ((Uint64)numtriangles * 3 > mesh->numindices)
+	{
+		return SDL_SetError("Sorting %u triangles of a mesh with %u indices", (unsigned)numtriangles,
+			(unsigned)mesh->numindices);
+	}
+
+	const size_t count = SDL_max(numtriangles, 1u);
+	const Uint32 numclusters = (numtriangles + TRISORT_CLUSTER - 1) / TRISORT_CLUSTER;
+	const size_t clusters = SDL_max(numclusters, 1u);
+	sort->numtriangles = numtriangles;
+	sort->numclusters = numclusters;
+	sort->indexsize = mesh->indexsize;
+	sort->indices     = SDL_malloc((size_t)mesh->indexsize * 3 * count);
+	sort->centroids   = SDL_malloc(sizeof(float[3]) * count);
+	sort->local       = SDL_malloc(sizeof(Uint8) * count);
+	sort->order       = SDL_malloc(sizeof(Uint64) * clusters);
+	sort->scratch     = SDL_malloc(sizeof(Uint64) * clusters);
+	sort->visible     = SDL_malloc(sizeof(Uint32) * clusters);
+	sort->centers     = SDL_calloc(clusters, sizeof(float[3]));
+	sort->sortedalong = SDL_calloc(clusters, sizeof(float[3]));
+	sort->clusterpass = SDL_calloc(clusters, sizeof(Uint32));
+	sort->visiblemask = SDL_calloc(clusters, sizeof(Uint64));
+	if (!sort->indices || !sort->centroids || !sort->local || !sort->order || !sort->scratch || !sort->visible ||
+		!sort->centers || !sort->sortedalong || !sort->clusterpass || !sort->visiblemask)
+	{
+		FreeTriangleSort(sort);
+		return false;
+	}
+
+	SDL_memcpy(sort->indices, mesh->indices, (size_t)mesh->indexsize * 3 * numtriangles);
+	float mins[3] = { SDL_MAX_SINT32, SDL_MAX_SINT32, SDL_MAX_SINT32 };
+	float maxs[3] = { SDL_MIN_SINT32, SDL_MIN_SINT32, SDL_MIN_SINT32 };
+	for (Uint32 t = 0; t < numtriangles; ++t)
+	{
+		float *centroid = sort->centroids[t];
+		centroid[0] = centroid[1] = centroid[2] = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			const Uint32 index = mesh->indexsize == 2 ? ((const Uint16 *)mesh->indices)[3 * t + i] :
+				((const Uint32 *)mesh->indices)[3 * t + i];
+			const VERTEX *vertex = &mesh->vertices[index];
+			centroid[0] += vertex->x / 3.0f;
+			centroid[1] += vertex->y / 3.0f;
+			centroid[2] += vertex->z / 3.0f;
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			mins[axis] = SDL_min(mins[axis], centroid[axis]);
+			maxs[axis] = SDL_max(maxs[axis], centroid[axis]);
+		}
+	}
+
+	// Centroids relative to their center, so a depth along any direction is within the radius of 0
+	float radiussq = 0.0f;
+	for (Uint32 t = 0; t < numtriangles; ++t)
+	{
+		float *centroid = sort->centroids[t];
+		float *center = sort->centers[t / TRISORT_CLUSTER];
+		const float size = (float)SDL_min(TRISORT_CLUSTER, numtriangles - t / TRISORT_CLUSTER * TRISORT_CLUSTER);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			centroid[axis] -= (mins[axis] + maxs[axis]) * 0.5f;
+			center[axis] += centroid[axis] / size;
+		}
+		radiussq = SDL_max(radiussq, centroid[0] * centroid[0] + centroid[1] * centroid[1] + centroid[2] * centroid[2]);
+	}
+	sort->radius = SDL_sqrtf(radiussq) + 1.0f;
+	ResetTriangleSort(sort);
+	return true;
+}
+
+void FreeTriangleSort(TRISORT *sort)
+{
+	SDL_free(sort->ranges);
+	SDL_free(sort->visiblemask);
+	SDL_free(sort->clusterpass);
+	SDL_free(sort->sortedalong);
+	SDL_free(sort->centers);
+	SDL_free(sort->visible);
+	SDL_free(sort->scratch);
+	SDL_free(sort->order);
+	SDL_free(sort->local);
+	SDL_free(sort->centroids);
+	SDL_free(sort->indices);
+	SDL_zerop(sort);
+}
+
+void ResetTriangleSort(TRISORT *sort)
+{
+	sort->count = 0;
+	sort->numorder = 0;
+	sort->numranges = -1;
+	sort->cursor = 0;
+	SDL_zero(sort->stats);
+	for (Uint32 t = 0; t < sort->numtriangles; ++t)
+	{
+		sort->local[t] = (Uint8)(t % TRISORT_CLUSTER);
+	}
+	if (sort->numclusters > 0)
+	{
+		SDL_memset(sort->sortedalong, 0, sizeof(float[3]) * sort->numclusters);
+	}
+}
+
+// Remember the ranges the order was built from, an allocation failure only means the next sort rebuilds it
+static void KeepRanges(TRISORT *sort, const DRAWRANGE *ranges, int numranges)
+{
+	if (numranges > sort->maxranges)
+	{
+		DRAWRANGE *grown = SDL_realloc(sort->ranges, sizeof(DRAWRANGE) * (size_t)numranges);
+		if (!grown)
+		{
+			sort->numranges = -1;
+			return;
+		}
+		sort->ranges = grown;
+		sort->maxranges = numranges;
+	}
+	if (numranges > 0)
+	{
+		SDL_memcpy(sort->ranges, ranges, sizeof(DRAWRANGE) * (size_t)numranges);
+	}
+	sort->numranges = numranges;
+}
+
+/*  LSD radix sort by the key in the top 32 bits, one pass per byte of the key.      *
+ *  Every byte's counts are taken in one read of the items, and a byte that's the    *
+ *  same in every key is skipped. Stable, so equal keys keep their order. Returns    *
+ *  the sorted array, either items or scratch.                                       */
+static Uint64 * RadixSortKeys(Uint64 *items, Uint64 *scratch, Uint32 count)
+{
+	enum { NUM_DIGITS = TRISORT_KEY_BITS / 8 };
+	Uint32 offsets[NUM_DIGITS][256];
+	SDL_memset(offsets, 0, sizeof(offsets));
+	for (Uint32 i = 0; i < count; ++i)
+	{
+		const Uint32 key = (Uint32)(items[i] >> 32);
+		for (int digit = 0; digit < NUM_DIGITS; ++digit)
+		{
+			++offsets[digit][(key >> (8 * digit)) & 0xFF];
+		}
+	}
+	for (int digit = 0; digit < NUM_DIGITS; ++digit)
+	{
+		const int shift = 32 + 8 * digit;
+		Uint32 *digitoffsets = offsets[digit];
+		if (count == 0 || digitoffsets[(items[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+		for (Uint32 i = 0, sum = 0; i < 256; ++i)
+		{
+			const Uint32 n = digitoffsets[i];
+			digitoffsets[i] = sum;
+			sum += n;
+		}
+		for (Uint32 i = 0; i < count; ++i)
+		{
+			scratch[digitoffsets[(items[i] >> shift) & 0xFF]++] = items[i];
+		}
+		Uint64 *swap = items;
+		items = scratch;
+		scratch = swap;
+	}
+	return items;
+}
+
+// Key of a point's depth along a view direction, the furthest get the smallest key
+static inline Uint16 DepthKey(const TRISORT *sort, const float point[3], const float direction[3], float scale)
+{
+	const float depth = direction[0] * point[0] + direction[1] * point[1] + direction[2] * point[2];
+	return (Uint16)SDL_clamp((sort->radius - depth) * scale, 0.0f, (float)TRISORT_MAX_KEY);
+}
+
+static inline Uint32 CountBits(Uint64 bits)
+{
+	bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+	bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (Uint32)((bits * 0x0101010101010101ull) >> 56);
+}
+
+/*  Key a cluster's triangles along a view direction & insertion sort them from      *
+ *  their last order, which after turning a few degrees needs few moves              */
+static void SortCluster(TRISORT *sort, Uint32 cluster, const float direction[3], float scale)
+{
+	const Uint32 first = cluster * TRISORT_CLUSTER;
+	const Uint32 size = SDL_min(TRISORT_CLUSTER, sort->numtriangles - first);
+	Uint8 *local = &sort->local[first];
+	Uint16 indexkeys[TRISORT_CLUSTER], keys[TRISORT_CLUSTER];
+	for (Uint32 i = 0; i < size; ++i)
+	{
+		indexkeys[i] = DepthKey(sort, sort->centroids[first + i], direction, scale);
+	}
+	for (Uint32 i = 0; i < size; ++i)
+	{
+		keys[i] = indexkeys[local[i]];
+	}
+	for (Uint32 i = 1; i < size; ++i)
+	{
+		const Uint16 key = keys[i];
+		const Uint8 t = local[i];
+		Uint32 j = i;
+		for (; j > 0 && keys[j - 1] > key; --j)
+		{
+			keys[j] = keys[j - 1];
+			local[j] = local[j - 1];
+		}
+		keys[j] = key;
+		local[j] = t;
+	}
+	SDL_memcpy(sort->sortedalong[cluster], direction, sizeof(float[3]));
+}
+
+/*  Mark the triangles in the ranges visible & list the clusters they're in, keyed   *
+ *  by the depth of their centers, into order. Returns the triangles marked.         */
+static Uint32 FindClusters(TRISORT *sort, const DRAWRANGE *ranges, int numranges, const float direction[3],
+	float scale)
+{
+	const Uint32 pass = ++sort->pass;
+	Uint32 count = 0;
+	sort->numorder = 0;
+	for (int i = 0; i < numranges; ++i)
+	{
+		const Uint32 end = SDL_min((ranges[i].firstindex + ranges[i].numindices) / 3, sort->numtriangles);
+		for (Uint32 t = ranges[i].firstindex / 3; t < end; )
+		{
+			const Uint32 cluster = t / TRISORT_CLUSTER, offset = t % TRISORT_CLUSTER;
+			const Uint32 n = SDL_min(TRISORT_CLUSTER - offset, end - t);
+			const Uint64 bits = (n == 64 ? ~(Uint64)0 : (((Uint64)1 << n) - 1)) << offset;
+			if (sort->clusterpass[cluster] != pass)
+			{
+				// A cluster coming back into view was sorted along who knows what, sort it before it's drawn
+				if (sort->clusterpass[cluster] != pass - 1)
+				{
+					SDL_memset(sort->sortedalong[cluster], 0, sizeof(float[3]));
+				}
+				sort->clusterpass[cluster] = pass;
+				sort->visiblemask[cluster] = 0;
+				const Uint16 key = DepthKey(sort, sort->centers[cluster], direction, scale);
+				sort->visible[sort->numorder] = cluster;
+				sort->order[sort->numorder++] = (Uint64)key << 32 | cluster;
+			}
+			count += CountBits(bits & ~sort->visiblemask[cluster]);
+			sort->visiblemask[cluster] |= bits;
+			t += n;
+		}
+	}
+	return count;
+}
+
+/*  Sort the triangles of the visible clusters again where the view has turned too   *
+ *  far from the direction they were sorted along, up to the budget, starting from   *
+ *  the cursor. Clusters that were never sorted go first, a cluster coming into view *
+ *  is drawn in the order it was left in until then. Returns the number sorted,      *
+ *  pending is set to the number left waiting.                                       */
+static Uint32 ResortClusters(TRISORT *sort, const float direction[3], float scale, Uint32 *pending)
+{
+	const float mincos = SDL_cosf(TRISORT_RESORT_DEGREES * SDL_PI_F / 180.0f);
+	const Uint32 numorder = sort->numorder;
+	Sint32 budget = TRISORT_RESORT_BUDGET;
+	Uint32 resorted = 0, waiting = 0, next = sort->cursor;
+	for (int round = 0; round < 2; ++round)
+	{
+		for (Uint32 i = 0; i < numorder; ++i)
+		{
+			const Uint32 at = (sort->cursor + i) % numorder, cluster = sort->visible[at];
+			const float *along = sort->sortedalong[cluster];
+			const bool never = along[0] == 0.0f && along[1] == 0.0f && along[2] == 0.0f;
+			if (never != (round == 0) ||
+				direction[0] * along[0] + direction[1] * along[1] + direction[2] * along[2] >= mincos)
+			{
+				continue;
+			}
+			if (budget <= 0)
+			{
+				++waiting;
+				continue;
+			}
+			SortCluster(sort, cluster, direction, scale);
+			budget -= TRISORT_CLUSTER;
+			next = at + 1;
+			++resorted;
+		}
+	}
+	sort->cursor = numorder > 0 ? next % numorder : 0;
+	*pending = waiting;
+	return resorted;
+}
+
+void SortTriangles(TRISORT *sort, const DRAWRANGE *ranges, int numranges, const mat4f viewproj)
+{
+	// View depth is the w row, its translation is the same for every triangle and doesn't change their order
+	float direction[3] = { viewproj[3], viewproj[7], viewproj[11] };
+	const float length = SDL_sqrtf(direction[0] * direction[0] + direction[1] * direction[1] +
+		direction[2] * direction[2]);
+	for (int axis = 0; axis < 3 && length > 0.0f; ++axis)
+	{
+		direction[axis] /= length;
+	}
+	const bool turned = SDL_memcmp(direction, sort->direction, sizeof(direction)) != 0;
+	const bool sameranges = numranges == sort->numranges &&
+		(numranges == 0 || SDL_memcmp(ranges, sort->ranges, sizeof(DRAWRANGE) * (size_t)numranges) == 0);
+
+	// The same ranges seen the same way as last time are already in order, unless clusters are waiting
+	if (sameranges && !turned && sort->stats.pending == 0)
+	{
+		sort->stats.resorted = 0;
+		sort->stats.turned = false;
+		sort->stats.changed = false;
+		return;
+	}
+	const float scale = (float)TRISORT_MAX_KEY / (2.0f * sort->radius);
+	if (!sameranges || turned)
+	{
+		SDL_memcpy(sort->direction, direction, sizeof(direction));
+		if (!sameranges)
+		{
+			KeepRanges(sort, ranges, numranges);
+		}
+		sort->count = FindClusters(sort, ranges, numranges, direction, scale);
+		Uint64 *sorted = RadixSortKeys(sort->order, sort->scratch, sort->numorder);
+		if (sorted != sort->order)
+		{
+			sort->scratch = sort->order;
+			sort->order = sorted;
+		}
+	}
+	Uint32 pending;
+	const Uint32 resorted = ResortClusters(sort, direction, scale, &pending);
+	sort->stats = (TRISORTSTATS)
+	{
+		.triangles = sort->count,
+		.clusters = sort->numorder,
+		.resorted = resorted,
+		.pending = pending,
+		.turned = turned,
+		.changed = !sameranges || turned || resorted > 0
+	};
+}
+
+void WriteSortedIndices(const TRISORT *sort, void *dst)
+{
+	Uint16 *out16 = dst;
+	Uint32 *out32 = dst;
+	for (Uint32 i = 0; i < sort->numorder; ++i)
+	{
+		const Uint32 cluster = (Uint32)sort->order[i], first = cluster * TRISORT_CLUSTER;
+		const Uint32 size = SDL_min(TRISORT_CLUSTER, sort->numtriangles - first);
+		const Uint64 mask = sort->visiblemask[cluster];
+		const Uint8 *local = &sort->local[first];
+		if (sort->indexsize == 2)
+		{
+			for (Uint32 j = 0; j < size; ++j)
+			{
+				if (mask >> local[j] & 1)
+				{
+					const Uint16 *tri = &((const Uint16 *)sort->indices)[3 * (first + local[j])];
+					out16[0] = tri[0];
+					out16[1] = tri[1];
+					out16[2] = tri[2];
+					out16 += 3;
+				}
+			}
+		}
+		else
+		{
+			for (Uint32 j = 0; j < size; ++j)
+			{
+				if (mask >> local[j] & 1)
+				{
+					const Uint32 *tri = &((const Uint32 *)sort->indices)[3 * (first + local[j])];
+					out32[0] = tri[0];
+					out32[1] = tri[1];
+					out32[2] = tri[2];
+					out32 += 3;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef TRISORT_H
+#define TRISORT_H
+
+#include "bvh.h"
+#include <SDL3/SDL_stdinc.h>
+
+#define TRISORT_KEY_BITS       16     // Depth across the mesh is quantized to this many bits, two radix passes
+#define TRISORT_CLUSTER        64     // Triangles per cluster, consecutive in the index buffer like a BVH leaf's
+#define TRISORT_RESORT_DEGREES 15.0f  // Turn after which a cluster's triangles are sorted again
+#define TRISORT_RESORT_BUDGET  4096   // Triangles of new & turned clusters sorted per sort, the rest wait
+
+typedef struct tagTRISORTSTATS
+{
+	Uint32 triangles;          // Triangles in the order
+	Uint32 clusters;           // Clusters they're in
+	Uint32 resorted;           // Of those, clusters whose triangles were sorted again
+	Uint32 pending;            // New clusters & ones turned past TRISORT_RESORT_DEGREES waiting to be sorted
+	bool turned;               // The view direction changed and the clusters were sorted again
+	bool changed;              // Order differs from the last sort, the index data has to be written again
+} TRISORTSTATS;
+
+typedef struct tagTRISORT
+{
+	Uint32 numtriangles;       // Triangles sorted from, the first of the mesh's index buffer
+	Uint32 indexsize;
+	void *indices;             // Copy of those triangles' indices, written out in sorted order
+	float (*centroids)[3];     // Centroid of each triangle, relative to the center of them all
+	float radius;              // Furthest centroid from the center, the depth range keys are quantized over
+	Uint32 count;              // Triangles in order
+	Uint32 numorder;           // Clusters in order
+	Uint64 *order;             // Depth key << 32 | cluster, the visible clusters back to front as of the last sort
+	TRISORTSTATS stats;        // Of the last sort
+
+	// Internal
+	float direction[3];        // Unit view direction of the last sort
+	Uint32 numclusters;
+	float (*centers)[3];       // Mean of each cluster's centroids
+	float (*sortedalong)[3];   // View direction each cluster's triangles were last sorted along, 0 never
+	Uint8 *local;              // Triangles of each cluster back to front, as offsets into it
+	Uint32 *clusterpass;       // Pass each cluster was last visible in
+	Uint64 *visiblemask;       // Bit per triangle of each cluster, set when visible in that pass
+	Uint64 *scratch;           // Radix sort buffer, as large as order
+	Uint32 *visible;           // Clusters in order as they came in the ranges, which stays put while turning
+	Uint32 pass;
+	Uint32 cursor;             // Where in the order the next look for turned clusters starts
+	int numranges, maxranges;
+	DRAWRANGE *ranges;         // Ranges the order was built from, unchanged ranges skip rebuilding it
+} TRISORT;
+
+/*  Prepare to sort the first numtriangles triangles of a mesh, keeping their        *
+ *  centroids & a copy of their indices. Release with FreeTriangleSort.              */
+bool InitTriangleSort(TRISORT *sort, const MESH *mesh, Uint32 numtriangles);
+void FreeTriangleSort(TRISORT *sort);
+
+/*  Forget the last order, the next sort starts from scratch                         */
+void ResetTriangleSort(TRISORT *sort);
+
+/*  Order the triangles of a frame's index ranges roughly back to front for          *
+ *  blending. The triangles are split into clusters of TRISORT_CLUSTER in index      *
+ *  order, and the clusters holding visible triangles are radix sorted by the depth  *
+ *  of their centers, so the triangles of clusters overlapping in depth aren't       *
+ *  ordered against each other. Each cluster keeps the order of its triangles along  *
+ *  the direction it was last sorted along, which is sorted again once the view has  *
+ *  turned more than TRISORT_RESORT_DEGREES from it, by insertion sort starting from *
+ *  that order. Only up to TRISORT_RESORT_BUDGET triangles are sorted per call,      *
+ *  clusters coming into view first, then turned ones round robin, so the rest catch *
+ *  up over the next calls. Standing still costs nothing once every cluster is up to *
+ *  date, and moving without turning only sorts the clusters again. Both sorts are   *
+ *  stable, so triangles at the same quantized depth don't flicker.                  *
+ *  ranges      - Index ranges of triangles within the sorted ones, 3 indices each   *
+ *  viewproj    - Combined view & projection matrix, its w row gives view depth      */
+void SortTriangles(TRISORT *sort, const DRAWRANGE *ranges, int numranges, const mat4f viewproj);
+
+/*  Write the indices of the visible triangles in order, each cluster's in turn,     *
+ *  3 * count indices of indexsize bytes                                             */
+void WriteSortedIndices(const TRISORT *sort, void *dst);
+
+#endif//TRISORT_H
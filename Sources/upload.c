@@ -0,0 +1,160 @@
+#include "upload.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_assert.h>
+
+Uint32 SubAllocate(Uint32 *used, Uint32 capacity, Uint32 size, Uint32 align)
+{
+	SDL_assert(align > 0 && (align & (align - 1)) == 0);
+	const Uint64 offset = ((Uint64)*used + align - 1) & ~(Uint64)(align - 1);
+	if (offset + size > capacity)
+	{
+		return UPLOAD_FULL;
+	}
+	*used = (Uint32)(offset + size);
+	return (Uint32)offset;
+}
+
+bool InitUploadRing(UPLOADRING *ring, SDL_GPUDevice *dev, Uint32 capacity)
+{
+	SDL_zerop(ring);
+	ring->dev = dev;
+	ring->capacity = capacity;
+	for (int i = 0; i < UPLOAD_FRAMES; ++i)
+	{
+		ring->buffers[i] = SDL_CreateGPUTransferBuffer(dev, &(SDL_GPUTransferBufferCreateInfo)
+		{
+			.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+			.size = capacity,
+			.props = 0
+		});
+		if (!ring->buffers[i])
+		{
+			FreeUploadRing(ring);
+			return false;
+		}
+	}
+	// Start on the last buffer so the first frame begins on buffer 0
+	ring->frame = UPLOAD_FRAMES - 1;
+	return true;
+}
+
+void FreeUploadRing(UPLOADRING *ring)
+{
+	if (ring->dev)
+	{
+		if (ring->map)
+		{
+			SDL_UnmapGPUTransferBuffer(ring->dev, ring->buffers[ring->frame]);
+		}
+		for (int i = 0; i < UPLOAD_FRAMES; ++i)
+		{
+			if (ring->fences[i])
+			{
+				SDL_WaitForGPUFences(ring->dev, true, &ring->fences[i], 1);
+				SDL_ReleaseGPUFence(ring->dev, ring->fences[i]);
+			}
+			SDL_ReleaseGPUTransferBuffer(ring->dev, ring->buffers[i]);
+		}
+	}
+	SDL_free(ring->copies);
+	SDL_zerop(ring);
+}
+
+void BeginUploadFrame(UPLOADRING *ring)
+{
+	SDL_assert(!ring->map);
+	ring->frame = (ring->frame + 1) % UPLOAD_FRAMES;
+	SDL_GPUFence **fence = &ring->fences[ring->frame];
+	if (*fence)
+	{
+		// Normally signalled long ago, the swapchain limits how far ahead of the GPU we get
+		SDL_WaitForGPUFences(ring->dev, true, fence, 1);
+		SDL_ReleaseGPUFence(ring->dev, *fence);
+		*fence = NULL;
+	}
+	ring->used = 0;
+	ring->numcopies = 0;
+	ring->fenced = false;
+}
+
+void * AllocUpload(UPLOADRING *ring, SDL_GPUBuffer *buffer, Uint32 offset, Uint32 size, Uint32 align, bool cycle)
+{
+	Uint32 used = ring->used;
+	const Uint32 srcoffset = SubAllocate(&used, ring->capacity, size, align);
+	if (srcoffset == UPLOAD_FULL)
+	{
+		SDL_SetError("Upload ring full (%u of %u bytes used, %u requested)",
+			(unsigned)ring->used, (unsigned)ring->capacity, (unsigned)size);
+		return NULL;
+	}
+	if (ring->numcopies == ring->maxcopies)
+	{
+		const int newmax = ring->maxcopies ? ring->maxcopies * 2 : 16;
+		UPLOADCOPY *newcopies = SDL_realloc(ring->copies, sizeof(UPLOADCOPY) * (size_t)newmax);
+		if (!newcopies)
+		{
+			return NULL;
+		}
+		ring->copies = newcopies;
+		ring->maxcopies = newmax;
+	}
+	// Nothing else writes the buffer once its fence has signalled, so it's mapped without cycling
+	if (!ring->map && !(ring->map = SDL_MapGPUTransferBuffer(ring->dev, ring->buffers[ring->frame], false)))
+	{
+		return NULL;
+	}
+
+	ring->copies[ring->numcopies++] = (UPLOADCOPY)
+	{
+		.buffer = buffer,
+		.srcoffset = srcoffset,
+		.dstoffset = offset,
+		.size = size,
+		.cycle = cycle
+	};
+	ring->used = used;
+	ring->peak = SDL_max(ring->peak, used);
+	return ring->map + srcoffset;
+}
+
+void FlushUploads(UPLOADRING *ring, SDL_GPUCommandBuffer *cmdbuf)
+{
+	if (ring->map)
+	{
+		SDL_UnmapGPUTransferBuffer(ring->dev, ring->buffers[ring->frame]);
+		ring->map = NULL;
+	}
+	if (ring->numcopies == 0)
+	{
+		return;
+	}
+
+	SDL_GPUTransferBuffer *xferbuf = ring->buffers[ring->frame];
+	SDL_GPUCopyPass *pass = SDL_BeginGPUCopyPass(cmdbuf);
+	for (int i = 0; i < ring->numcopies; ++i)
+	{
+		const UPLOADCOPY *copy = &ring->copies[i];
+		SDL_UploadToGPUBuffer(pass,
+			&(SDL_GPUTransferBufferLocation){ .transfer_buffer = xferbuf, .offset = copy->srcoffset },
+			&(SDL_GPUBufferRegion){ .buffer = copy->buffer, .offset = copy->dstoffset, .size = copy->size },
+			copy->cycle);
+	}
+	SDL_EndGPUCopyPass(pass);
+}
+
+void FenceUploadFrame(UPLOADRING *ring)
+{
+	ring->fenced = true;
+}
+
+bool SubmitUploadFrame(UPLOADRING *ring, SDL_GPUCommandBuffer *cmdbuf)
+{
+	SDL_assert(!ring->map && !ring->fences[ring->frame]);
+	if (ring->numcopies == 0 && !ring->fenced)
+	{
+		return SDL_SubmitGPUCommandBuffer(cmdbuf);
+	}
+	ring->fences[ring->frame] = SDL_SubmitGPUCommandBufferAndAcquireFence(cmdbuf);
+	return ring->fences[ring->frame] != NULL;
+}
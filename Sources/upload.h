@@ -0,0 +1,70 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include <SDL3/SDL_gpu.h>
+
+#define UPLOAD_FRAMES 3  // Frames in flight, each owns one of the ring's transfer buffers
+
+typedef struct tagUPLOADCOPY
+{
+	SDL_GPUBuffer *buffer;     // Destination
+	Uint32 srcoffset, dstoffset, size;
+	bool cycle;                // Previous contents of the destination are no longer needed
+} UPLOADCOPY;
+
+typedef struct tagUPLOADRING
+{
+	SDL_GPUDevice *dev;
+	SDL_GPUTransferBuffer *buffers[UPLOAD_FRAMES];  // Persistent transfer buffers, one per frame in flight
+	SDL_GPUFence *fences[UPLOAD_FRAMES];  // Signalled once the GPU has consumed each buffer's uploads
+	Uint32 capacity;           // Size of each transfer buffer
+	unsigned frame;            // Buffer the current frame allocates from
+	Uint8 *map;                // Current buffer's mapping, NULL until the frame's first allocation
+	Uint32 used;               // Bytes allocated this frame
+	Uint32 peak;               // Most bytes allocated in a single frame
+	int numcopies, maxcopies;  // Copies recorded this frame
+	UPLOADCOPY *copies;
+	bool fenced;               // Take the frame's fence even without copies, see FenceUploadFrame
+} UPLOADRING;
+
+/*  Create a ring of UPLOAD_FRAMES persistent transfer buffers for streaming dynamic *
+ *  data to the GPU. Each frame sub-allocates from its own buffer, which is only     *
+ *  reused once the fence of the frame that last used it has signalled.              *
+ *  capacity    - Size in bytes of each frame's transfer buffer                      */
+bool InitUploadRing(UPLOADRING *ring, SDL_GPUDevice *dev, Uint32 capacity);
+void FreeUploadRing(UPLOADRING *ring);
+
+/*  Start a new frame of uploads on the next buffer in the ring, waiting for the     *
+ *  GPU to finish with it if it's still in flight                                    */
+void BeginUploadFrame(UPLOADRING *ring);
+
+/*  Sub-allocate size bytes of this frame's transfer buffer, to be copied into a GPU *
+ *  buffer by FlushUploads. Returns a pointer to write the data to, or NULL with the *
+ *  error set when the frame's buffer is full.                                       *
+ *  buffer      - Destination GPU buffer                                             *
+ *  offset      - Destination offset in bytes                                        *
+ *  align       - Alignment of the allocation in the transfer buffer, a power of 2   *
+ *  cycle       - Discard the destination's previous contents, lets the driver       *
+ *                rename a buffer earlier frames may still be drawing from. Only use *
+ *                on the first upload to a buffer each frame.                        */
+void * AllocUpload(UPLOADRING *ring, SDL_GPUBuffer *buffer, Uint32 offset, Uint32 size, Uint32 align, bool cycle);
+
+/*  Record every upload allocated this frame in a single copy pass, must be called   *
+ *  outside of any other pass before the data is used                                */
+void FlushUploads(UPLOADRING *ring, SDL_GPUCommandBuffer *cmdbuf);
+
+/*  Take this frame's fence when it's submitted even if nothing was uploaded, for    *
+ *  other work recorded with the frame, such as a download, that has to be done by   *
+ *  the time BeginUploadFrame comes back round to the frame's buffer                 */
+void FenceUploadFrame(UPLOADRING *ring);
+
+/*  Submit a command buffer that flushed this frame's uploads, keeping its fence to  *
+ *  know when the frame's transfer buffer may be reused                              */
+bool SubmitUploadFrame(UPLOADRING *ring, SDL_GPUCommandBuffer *cmdbuf);
+
+/*  Offset of a size byte allocation aligned to align after used bytes of capacity,  *
+ *  or UPLOAD_FULL when it doesn't fit. Independent of the GPU.                      */
+#define UPLOAD_FULL SDL_MAX_UINT32
+Uint32 SubAllocate(Uint32 *used, Uint32 capacity, Uint32 size, Uint32 align);
+
+#endif//UPLOAD_H
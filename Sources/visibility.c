@@ -0,0 +1,291 @@
+#include "visibility.h"
+#include <SDL3/SDL_stdinc.h>
+
+#define PORTAL_NEAR_EPSILON 0.15f  // Treat portals this close to the camera as filling the view
+
+
+bool InitVisibility(VISIBILITY *vis, const WORLD *world)
+{
+	SDL_zerop(vis);
+
+	// Culling emits at most one range per leaf, or one per sector without a hierarchy
+	size_t maxranges = (size_t)world->numsectors;
+	for (int i = 0; i < world->numnodes; ++i)
+	{
+		for (int j = 0; j < BVH_WIDTH; ++j)
+		{
+			maxranges += world->nodes[i].child[j] == BVH_LEAF;
+		}
+	}
+
+	const size_t numsectors = (size_t)world->numsectors;
+	vis->visible        = SDL_malloc(sizeof(int) * numsectors);
+	vis->ranges         = SDL_malloc(sizeof(DRAWRANGE) * maxranges);
+	vis->rangedistances = SDL_malloc(sizeof(float) * maxranges);
+	vis->portaloffsets  = SDL_calloc(numsectors + 1, sizeof(int));
+	vis->sectorportals  = SDL_malloc(sizeof(int) * ((size_t)world->numportals * 2 + 1));
+	vis->windows        = SDL_malloc(sizeof(float[4]) * numsectors);
+	vis->windowpass     = SDL_calloc(numsectors, sizeof(unsigned));
+	if (!vis->visible || !vis->ranges || !vis->rangedistances || !vis->portaloffsets ||
+		!vis->sectorportals || !vis->windows || !vis->windowpass)
+	{
+		FreeVisibility(vis);
+		return false;
+	}
+
+	// Bucket portals by the sectors on either side
+	for (int i = 0; i < world->numportals; ++i)
+	{
+		++vis->portaloffsets[world->portals[i].sectors[0] + 1];
+		++vis->portaloffsets[world->portals[i].sectors[1] + 1];
+	}
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		vis->portaloffsets[i + 1] += vis->portaloffsets[i];
+	}
+	int *fill = SDL_malloc(sizeof(int) * numsectors);
+	if (!fill)
+	{
+		FreeVisibility(vis);
+		return false;
+	}
+	SDL_memcpy(fill, vis->portaloffsets, sizeof(int) * numsectors);
+	for (int i = 0; i < world->numportals; ++i)
+	{
+		vis->sectorportals[fill[world->portals[i].sectors[0]]++] = i;
+		vis->sectorportals[fill[world->portals[i].sectors[1]]++] = i;
+	}
+	SDL_free(fill);
+
+	vis->camerasector = -1;
+	return true;
+}
+
+void FreeVisibility(VISIBILITY *vis)
+{
+	SDL_free(vis->windowpass);
+	SDL_free(vis->windows);
+	SDL_free(vis->sectorportals);
+	SDL_free(vis->portaloffsets);
+	SDL_free(vis->rangedistances);
+	SDL_free(vis->ranges);
+	SDL_free(vis->visible);
+	SDL_zerop(vis);
+}
+
+static float BoxDistanceSq(const SECTOR *sector, const float pos[3])
+{
+	float d = 0.f;
+	for (int i = 0; i < 3; ++i)
+	{
+		const float e = SDL_max(sector->mins[i] - pos[i], 0.f) + SDL_max(pos[i] - sector->maxs[i], 0.f);
+		d += e * e;
+	}
+	return d;
+}
+
+int FindSector(const WORLD *world, const float pos[3], int previous)
+{
+	if (previous >= 0 && previous < world->numsectors && BoxDistanceSq(&world->sectors[previous], pos) == 0.f)
+	{
+		return previous;
+	}
+
+	int best = -1;
+	float bestdist = SDL_FLT_MAX, bestvolume = SDL_FLT_MAX;
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		const SECTOR *sector = &world->sectors[i];
+		const float dist = BoxDistanceSq(sector, pos);
+		const float volume =
+			(sector->maxs[0] - sector->mins[0]) *
+			(sector->maxs[1] - sector->mins[1]) *
+			(sector->maxs[2] - sector->mins[2]);
+		if (dist < bestdist || (dist == bestdist && volume < bestvolume))
+		{
+			best = i;
+			bestdist = dist;
+			bestvolume = volume;
+		}
+	}
+	return best;
+}
+
+// Project a portal quad, clipped to the near plane, and return its NDC bounds
+static bool ProjectPortal(const PORTAL *portal, const mat4f m, float rect[4])
+{
+	float clip[4][4], poly[8][4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const float *p = portal->corners[i];
+		for (int row = 0; row < 4; ++row)
+		{
+			clip[i][row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+		}
+	}
+
+	// Clip against the near plane (z >= -w)
+	int count = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		const float *a = clip[i], *b = clip[(i + 1) & 3];
+		const float da = a[2] + a[3], db = b[2] + b[3];
+		if (da >= 0.f)
+		{
+			SDL_memcpy(poly[count++], a, sizeof(float[4]));
+		}
+		if ((da >= 0.f) != (db >= 0.f))
+		{
+			const float t = da / (da - db);
+			for (int k = 0; k < 4; ++k)
+			{
+				poly[count][k] = a[k] + (b[k] - a[k]) * t;
+			}
+			++count;
+		}
+	}
+
+	rect[0] = rect[1] = SDL_FLT_MAX;
+	rect[2] = rect[3] = -SDL_FLT_MAX;
+	for (int i = 0; i < count; ++i)
+	{
+		if (poly[i][3] <= SDL_FLT_EPSILON)
+		{
+			continue;
+		}
+		const float x = poly[i][0] / poly[i][3], y = poly[i][1] / poly[i][3];
+		rect[0] = SDL_min(rect[0], x);
+		rect[1] = SDL_min(rect[1], y);
+		rect[2] = SDL_max(rect[2], x);
+		rect[3] = SDL_max(rect[3], y);
+	}
+	return rect[0] <= rect[2] && rect[1] <= rect[3];
+}
+
+static bool NearPortal(const PORTAL *portal, const float eye[3])
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		float lo = portal->corners[0][k], hi = lo;
+		for (int i = 1; i < 4; ++i)
+		{
+			lo = SDL_min(lo, portal->corners[i][k]);
+			hi = SDL_max(hi, portal->corners[i][k]);
+		}
+		if (eye[k] < lo - PORTAL_NEAR_EPSILON || eye[k] > hi + PORTAL_NEAR_EPSILON)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void EnterSector(VISIBILITY *vis, const WORLD *world, const mat4f viewproj, const float eye[3],
+	int sector, int fromportal, const float window[4], int depth)
+{
+	// Skip if this sector was already walked through a window covering this one
+	float *seen = vis->windows[sector];
+	if (vis->windowpass[sector] == vis->pass)
+	{
+		if (window[0] >= seen[0] && window[1] >= seen[1] && window[2] <= seen[2] && window[3] <= seen[3])
+		{
+			return;
+		}
+		seen[0] = SDL_min(seen[0], window[0]);
+		seen[1] = SDL_min(seen[1], window[1]);
+		seen[2] = SDL_max(seen[2], window[2]);
+		seen[3] = SDL_max(seen[3], window[3]);
+	}
+	else
+	{
+		vis->windowpass[sector] = vis->pass;
+		SDL_memcpy(seen, window, sizeof(float[4]));
+		vis->visible[vis->numvisible++] = sector;
+	}
+	if (depth >= MAX_PORTAL_DEPTH)
+	{
+		return;
+	}
+
+	for (int i = vis->portaloffsets[sector]; i < vis->portaloffsets[sector + 1]; ++i)
+	{
+		const int p = vis->sectorportals[i];
+		if (p == fromportal)
+		{
+			continue;
+		}
+		const PORTAL *portal = &world->portals[p];
+		const int next = portal->sectors[0] == sector ? portal->sectors[1] : portal->sectors[0];
+
+		// Narrow the window to the portal, standing in a doorway keeps the current window
+		float rect[4];
+		++vis->portalstested;
+		if (NearPortal(portal, eye))
+		{
+			SDL_memcpy(rect, window, sizeof(float[4]));
+		}
+		else
+		{
+			if (!ProjectPortal(portal, viewproj, rect))
+			{
+				continue;
+			}
+			rect[0] = SDL_max(rect[0], window[0]);
+			rect[1] = SDL_max(rect[1], window[1]);
+			rect[2] = SDL_min(rect[2], window[2]);
+			rect[3] = SDL_min(rect[3], window[3]);
+			if (rect[0] >= rect[2] || rect[1] >= rect[3])
+			{
+				continue;
+			}
+		}
+		EnterSector(vis, world, viewproj, eye, next, p, rect, depth + 1);
+	}
+}
+
+static int CompareSectors(const void *lhs, const void *rhs)
+{
+	const int a = *(const int *)lhs, b = *(const int *)rhs;
+	return (a > b) - (a < b);
+}
+
+void ComputeVisibility(VISIBILITY *vis, const WORLD *world, const mat4f viewproj, const float eye[3])
+{
+	vis->numvisible = vis->numranges = 0;
+	vis->numtriangles = vis->portalstested = vis->nodestested = 0;
+	vis->camerasector = FindSector(world, eye, vis->camerasector);
+	if (vis->camerasector < 0)
+	{
+		return;
+	}
+
+	if (++vis->pass == 0)
+	{
+		SDL_memset(vis->windowpass, 0, sizeof(unsigned) * (size_t)world->numsectors);
+		vis->pass = 1;
+	}
+	const float fullscreen[4] = { -1.f, -1.f, 1.f, 1.f };
+	EnterSector(vis, world, viewproj, eye, vis->camerasector, -1, fullscreen, 0);
+
+	// Cull visible sectors in index buffer order against the window each was seen through,
+	// contiguous ranges of a sector are merged into as few draws as possible
+	SDL_qsort(vis->visible, (size_t)vis->numvisible, sizeof(int), CompareSectors);
+	for (int i = 0; i < vis->numvisible; ++i)
+	{
+		const SECTOR *sector = &world->sectors[vis->visible[i]];
+		FRUSTUM frustum;
+		MakeFrustum(&frustum, viewproj, vis->windows[vis->visible[i]]);
+		int numranges = 0;
+		vis->nodestested += CullSector(world, sector, &frustum, &vis->ranges[vis->numranges], &numranges);
+		const float distance = SDL_sqrtf(BoxDistanceSq(sector, eye));
+		for (int j = 0; j < numranges; ++j)
+		{
+			vis->rangedistances[vis->numranges + j] = distance;
+		}
+		vis->numranges += numranges;
+	}
+	for (int i = 0; i < vis->numranges; ++i)
+	{
+		vis->numtriangles += vis->ranges[i].numindices / 3;
+	}
+}
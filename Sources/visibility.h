@@ -0,0 +1,50 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "bvh.h"
+
+#define MAX_PORTAL_DEPTH 64  // Deepest chain of portals followed from the camera's sector
+
+typedef struct tagVISIBILITY
+{
+	int camerasector;          // Sector containing the camera, -1 when outside the world
+	int numvisible;            // Sectors reached this pass
+	int *visible;
+	int numranges;             // Index ranges to draw, sorted and merged within each sector
+	DRAWRANGE *ranges;
+	float *rangedistances;     // Distance from the eye to the box of each range's sector, 0 inside it
+	unsigned numtriangles;     // Triangles left after culling this pass
+	unsigned portalstested;    // Portals projected this pass
+	unsigned nodestested;      // BVH nodes tested against the frustum this pass
+
+	// Internal
+	int *sectorportals;        // Portals touching each sector, indexed by portaloffsets
+	int *portaloffsets;
+	float (*windows)[4];       // Largest screen rect each sector was entered through (min x/y, max x/y)
+	unsigned *windowpass;      // Pass each window belongs to
+	unsigned pass;
+} VISIBILITY;
+
+bool InitVisibility(VISIBILITY *vis, const WORLD *world);
+void FreeVisibility(VISIBILITY *vis);
+
+/*  Find the sector containing a point, preferring the previous sector when still     *
+ *  inside it, otherwise the smallest sector containing it or failing that the       *
+ *  nearest sector.                                                                  */
+int FindSector(const WORLD *world, const float pos[3], int previous);
+
+/*  Walk portals outwards from the camera's sector, narrowing the view to each        *
+ *  portal's screen-space bounds, then cull each visible sector's BVH against the     *
+ *  frustum narrowed to the window it was seen through and build the list of index   *
+ *  ranges to draw. Ranges never span sectors, so each has its sector's distance.    *
+ *  viewproj    - Combined view & projection matrix                                  *
+ *  eye         - Camera position in world space                                     */
+void ComputeVisibility(VISIBILITY *vis, const WORLD *world, const mat4f viewproj, const float eye[3]);
+
+/*  Whether a sector was reached by the last ComputeVisibility pass                  */
+static inline bool SectorVisible(const VISIBILITY *vis, int sector)
+{
+	return vis->numvisible > 0 && vis->windowpass[sector] == vis->pass;
+}
+
+#endif//VISIBILITY_H
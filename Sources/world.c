@@ -0,0 +1,912 @@
+#include "world.h"
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_iostream.h>
+
+
+typedef struct tagPARSER
+{
+	const char *p, *end;
+	int line;
+} PARSER;
+
+static inline bool IsBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool IsDigit(char c)
+{
+	return (unsigned)(c - '0') < 10u;
+}
+
+static void SkipLine(PARSER *ps)
+{
+	while (ps->p < ps->end && *ps->p != '\n')
+	{
+		++ps->p;
+	}
+	if (ps->p < ps->end)
+	{
+		++ps->p;
+		++ps->line;
+	}
+}
+
+// Move to the first token of the next line that isn't empty or a comment
+static bool NextLine(PARSER *ps)
+{
+	while (ps->p < ps->end)
+	{
+		while (ps->p < ps->end && IsBlank(*ps->p))
+		{
+			++ps->p;
+		}
+		if (ps->p < ps->end && *ps->p != '\n' && *ps->p != '/')
+		{
+			return true;
+		}
+		SkipLine(ps);
+	}
+	return false;
+}
+
+static bool ParseInt(PARSER *ps, int *out)
+{
+	const char *s = ps->p;
+	while (s < ps->end && IsBlank(*s))
+	{
+		++s;
+	}
+	if (s == ps->end || !IsDigit(*s))
+	{
+		return false;
+	}
+	int value = 0;
+	for (; s < ps->end && IsDigit(*s); ++s)
+	{
+		if (value > (SDL_MAX_SINT32 - 9) / 10)
+		{
+			return false;
+		}
+		value = value * 10 + (*s - '0');
+	}
+	ps->p = s;
+	*out = value;
+	return true;
+}
+
+static bool ParseFloat(PARSER *ps, float *out)
+{
+	// Powers of ten that are exactly representable as a double
+	static const double pow10[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const int maxpow = (int)SDL_arraysize(pow10) - 1;
+
+	const char *s = ps->p, *end = ps->end;
+	while (s < end && IsBlank(*s))
+	{
+		++s;
+	}
+
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+'))
+	{
+		negative = (*s++ == '-');
+	}
+
+	// Accumulate up to 18 significant digits into an integer mantissa
+	Uint64 mantissa = 0;
+	int exponent = 0, digits = 0;
+	for (; s < end && IsDigit(*s); ++s, ++digits)
+	{
+		if (mantissa < 100000000000000000ull)
+			mantissa = mantissa * 10u + (Uint64)(*s - '0');
+		else
+			++exponent;
+	}
+	if (s < end && *s == '.')
+	{
+		for (++s; s < end && IsDigit(*s); ++s, ++digits)
+		{
+			if (mantissa < 100000000000000000ull)
+			{
+				mantissa = mantissa * 10u + (Uint64)(*s - '0');
+				--exponent;
+			}
+		}
+	}
+	if (digits == 0)
+	{
+		return false;
+	}
+
+	// Optional exponent, only consumed if digits follow
+	if (s < end && (*s == 'e' || *s == 'E'))
+	{
+		const char *e = s + 1;
+		bool expnegative = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			expnegative = (*e++ == '-');
+		}
+		if (e < end && IsDigit(*e))
+		{
+			int expvalue = 0;
+			for (; e < end && IsDigit(*e); ++e)
+			{
+				if (expvalue < 1000)
+					expvalue = expvalue * 10 + (*e - '0');
+			}
+			exponent += expnegative ? -expvalue : expvalue;
+			s = e;
+		}
+	}
+
+	double value = (double)mantissa;
+	if (mantissa != 0)
+	{
+		for (; exponent > maxpow; exponent -= maxpow)
+			value *= pow10[maxpow];
+		for (; exponent < -maxpow; exponent += maxpow)
+			value /= pow10[maxpow];
+		value = exponent < 0 ? value / pow10[-exponent] : value * pow10[exponent];
+	}
+
+	*out = (float)(negative ? -value : value);
+	ps->p = s;
+	return true;
+}
+
+static bool MatchKeyword(PARSER *ps, const char *keyword)
+{
+	const size_t len = SDL_strlen(keyword);
+	if ((size_t)(ps->end - ps->p) < len || SDL_memcmp(ps->p, keyword, len) != 0 ||
+		(ps->p + len < ps->end && !IsBlank(ps->p[len]) && ps->p[len] != '\n'))
+	{
+		return false;
+	}
+	ps->p += len;
+	return true;
+}
+
+// Grow a dynamic array to hold at least count elements
+static bool Reserve(void **array, size_t *capacity, size_t count, size_t elemsize)
+{
+	if (count <= *capacity)
+	{
+		return true;
+	}
+	size_t newcapacity = *capacity ? *capacity : 16;
+	while (newcapacity < count)
+	{
+		newcapacity *= 2;
+	}
+	void *newarray = SDL_realloc(*array, elemsize * newcapacity);
+	if (!newarray)
+	{
+		return false;
+	}
+	*array = newarray;
+	*capacity = newcapacity;
+	return true;
+}
+
+// Each vertex line needs at least 9 characters ("0 0 0 0 0"), reject counts the file can't possibly hold
+static bool ParseTriangleCount(PARSER *ps, int *numtriangles, int parsedtriangles, size_t size)
+{
+	if (!ParseInt(ps, numtriangles) || *numtriangles <= 0 ||
+		(size_t)parsedtriangles + (size_t)*numtriangles > size / (3 * 9))
+	{
+		return SDL_SetError("World line %d: Invalid triangle count", ps->line);
+	}
+	SkipLine(ps);
+	return true;
+}
+
+static bool ParseUseMaterial(PARSER *ps, int *material, int *maxmaterial)
+{
+	if (!ParseInt(ps, material) || *material >= WORLD_MAX_MATERIALS)
+	{
+		return SDL_SetError("World line %d: Expected USEMATERIAL <material>", ps->line);
+	}
+	*maxmaterial = SDL_max(*maxmaterial, *material);
+	SkipLine(ps);
+	return true;
+}
+
+/*  Tokenize vertex lines straight into the final triangle array, a USEMATERIAL line *
+ *  may come before any triangle to switch the material of the ones that follow      */
+static bool ParseTriangles(PARSER *ps, TRIANGLE *triangles, int numtriangles, int *material, int *maxmaterial)
+{
+	for (int loop = 0; loop < numtriangles; loop++)
+	{
+		for (int vert = 0; vert < 3; vert++)
+		{
+			VERTEX *v = &triangles[loop].vertex[vert];
+			bool found = NextLine(ps);
+			while (found && vert == 0 && MatchKeyword(ps, "USEMATERIAL"))
+			{
+				if (!ParseUseMaterial(ps, material, maxmaterial))
+				{
+					return false;
+				}
+				found = NextLine(ps);
+			}
+			if (!found ||
+				!ParseFloat(ps, &v->x) || !ParseFloat(ps, &v->y) || !ParseFloat(ps, &v->z) ||
+				!ParseFloat(ps, &v->u) || !ParseFloat(ps, &v->v))
+			{
+				return SDL_SetError("World line %d: Expected vertex %d of %d", ps->line,
+					loop * 3 + vert + 1, numtriangles * 3);
+			}
+			v->layer = (float)*material;
+			SkipLine(ps);
+		}
+	}
+	return true;
+}
+
+static bool ParseSector(PARSER *ps, WORLD *world, size_t *sectorcap, size_t *trianglecap,
+	int proptriangles, size_t size, int *material, int *maxmaterial)
+{
+	int numtriangles;
+	if (!ParseTriangleCount(ps, &numtriangles, world->numtriangles + proptriangles, size))
+	{
+		return false;
+	}
+	if (!Reserve((void **)&world->sectors, sectorcap, (size_t)world->numsectors + 1, sizeof(SECTOR)) ||
+		!Reserve((void **)&world->triangles, trianglecap,
+			(size_t)world->numtriangles + (size_t)numtriangles, sizeof(TRIANGLE)) ||
+		!ParseTriangles(ps, &world->triangles[world->numtriangles], numtriangles, material, maxmaterial))
+	{
+		return false;
+	}
+
+	world->sectors[world->numsectors++] = (SECTOR){ .numtriangles = numtriangles };
+	world->numtriangles += numtriangles;
+	return true;
+}
+
+// Prop triangles are kept apart while parsing and appended after every sector's once the file is done
+static bool ParseProp(PARSER *ps, WORLD *world, size_t *propcap, TRIANGLE **proptriangles, size_t *trianglecap,
+	int *numproptriangles, size_t size, int *material, int *maxmaterial)
+{
+	int numtriangles;
+	if (!ParseTriangleCount(ps, &numtriangles, world->numtriangles + *numproptriangles, size))
+	{
+		return false;
+	}
+	if (!Reserve((void **)&world->props, propcap, (size_t)world->numprops + 1, sizeof(PROP)) ||
+		!Reserve((void **)proptriangles, trianglecap,
+			(size_t)*numproptriangles + (size_t)numtriangles, sizeof(TRIANGLE)) ||
+		!ParseTriangles(ps, &(*proptriangles)[*numproptriangles], numtriangles, material, maxmaterial))
+	{
+		return false;
+	}
+
+	world->props[world->numprops++] = (PROP){ .numtriangles = numtriangles };
+	*numproptriangles += numtriangles;
+	return true;
+}
+
+static bool ParseInstance(PARSER *ps, WORLD *world, size_t *instancecap)
+{
+	INSTANCE instance;
+	if (!ParseInt(ps, &instance.prop) ||
+		!ParseFloat(ps, &instance.origin[0]) ||
+		!ParseFloat(ps, &instance.origin[1]) ||
+		!ParseFloat(ps, &instance.origin[2]) ||
+		!ParseFloat(ps, &instance.yaw) ||
+		!ParseFloat(ps, &instance.scale))
+	{
+		return SDL_SetError("World line %d: Expected INSTANCE <prop> <x> <y> <z> <yaw> <scale>", ps->line);
+	}
+	SkipLine(ps);
+
+	if (!Reserve((void **)&world->instances, instancecap, (size_t)world->numinstances + 1, sizeof(INSTANCE)))
+	{
+		return false;
+	}
+	world->instances[world->numinstances++] = instance;
+	return true;
+}
+
+static bool ParseMaterial(PARSER *ps, WORLD *world, size_t *materialcap)
+{
+	while (ps->p < ps->end && IsBlank(*ps->p))
+	{
+		++ps->p;
+	}
+	const char *name = ps->p;
+	while (ps->p < ps->end && !IsBlank(*ps->p) && *ps->p != '\n')
+	{
+		++ps->p;
+	}
+	const size_t len = (size_t)(ps->p - name);
+	if (len == 0 || len >= WORLD_MATERIAL_PATH)
+	{
+		return SDL_SetError("World line %d: Expected MATERIAL <image> of at most %d characters", ps->line,
+			WORLD_MATERIAL_PATH - 1);
+	}
+	if (world->nummaterials == WORLD_MAX_MATERIALS)
+	{
+		return SDL_SetError("World line %d: More than %d materials", ps->line, WORLD_MAX_MATERIALS);
+	}
+	SkipLine(ps);
+
+	if (!Reserve((void **)&world->materials, materialcap, (size_t)world->nummaterials + 1, sizeof(MATERIAL)))
+	{
+		return false;
+	}
+	MATERIAL *material = &world->materials[world->nummaterials++];
+	SDL_zerop(material);
+	SDL_memcpy(material->image, name, len);
+	return true;
+}
+
+static bool ParsePortal(PARSER *ps, WORLD *world, size_t *portalcap)
+{
+	PORTAL portal;
+	if (!ParseInt(ps, &portal.sectors[0]) || !ParseInt(ps, &portal.sectors[1]))
+	{
+		return SDL_SetError("World line %d: Expected PORTAL <sector> <sector>", ps->line);
+	}
+	SkipLine(ps);
+	for (int i = 0; i < 4; ++i)
+	{
+		if (!NextLine(ps) ||
+			!ParseFloat(ps, &portal.corners[i][0]) ||
+			!ParseFloat(ps, &portal.corners[i][1]) ||
+			!ParseFloat(ps, &portal.corners[i][2]))
+		{
+			return SDL_SetError("World line %d: Expected portal corner %d of 4", ps->line, i + 1);
+		}
+		SkipLine(ps);
+	}
+
+	if (!Reserve((void **)&world->portals, portalcap, (size_t)world->numportals + 1, sizeof(PORTAL)))
+	{
+		return false;
+	}
+	world->portals[world->numportals++] = portal;
+	return true;
+}
+
+static void SectorBounds(SECTOR *sector)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		sector->mins[i] = SDL_FLT_MAX;
+		sector->maxs[i] = -SDL_FLT_MAX;
+	}
+	for (int loop = 0; loop < sector->numtriangles; loop++)
+	{
+		for (int vert = 0; vert < 3; vert++)
+		{
+			const VERTEX *v = &sector->triangle[loop].vertex[vert];
+			const float p[3] = { v->x, v->y, v->z };
+			for (int i = 0; i < 3; ++i)
+			{
+				sector->mins[i] = SDL_min(sector->mins[i], p[i]);
+				sector->maxs[i] = SDL_max(sector->maxs[i], p[i]);
+			}
+		}
+	}
+}
+
+// Sort instances by prop with a counting sort so each prop's placements are one contiguous range
+static bool GroupInstances(WORLD *world)
+{
+	if (world->numinstances == 0)
+	{
+		return true;
+	}
+	INSTANCE *sorted = SDL_malloc(sizeof(INSTANCE) * (size_t)world->numinstances);
+	if (!sorted)
+	{
+		return false;
+	}
+	for (int i = 0; i < world->numinstances; ++i)
+	{
+		world->props[world->instances[i].prop].numinstances++;
+	}
+	int first = 0;
+	for (int i = 0; i < world->numprops; ++i)
+	{
+		PROP *prop = &world->props[i];
+		prop->firstinstance = first;
+		first += prop->numinstances;
+		prop->numinstances = 0;
+	}
+	for (int i = 0; i < world->numinstances; ++i)
+	{
+		PROP *prop = &world->props[world->instances[i].prop];
+		sorted[prop->firstinstance + prop->numinstances++] = world->instances[i];
+	}
+	SDL_free(world->instances);
+	world->instances = sorted;
+	return true;
+}
+
+bool ParseWorld(WORLD *world, const char *text, size_t size)
+{
+	SDL_assert(world && (text || !size));
+	PARSER ps = { .p = text, .end = text + size, .line = 1 };
+	WORLD parsed = { 0 };
+	size_t sectorcap = 0, trianglecap = 0, portalcap = 0, propcap = 0, proptrianglecap = 0, instancecap = 0;
+	size_t materialcap = 0;
+	TRIANGLE *proptriangles = NULL;
+	int numproptriangles = 0;
+	int material = 0, maxmaterial = 0;  // Material of the triangles being parsed & highest one used
+
+	while (NextLine(&ps))
+	{
+		bool ok;
+		if (MatchKeyword(&ps, "NUMPOLLIES"))
+			ok = ParseSector(&ps, &parsed, &sectorcap, &trianglecap, numproptriangles, size, &material, &maxmaterial);
+		else if (MatchKeyword(&ps, "PORTAL"))
+			ok = ParsePortal(&ps, &parsed, &portalcap);
+		else if (MatchKeyword(&ps, "PROP"))
+			ok = ParseProp(&ps, &parsed, &propcap, &proptriangles, &proptrianglecap, &numproptriangles, size,
+				&material, &maxmaterial);
+		else if (MatchKeyword(&ps, "INSTANCE"))
+			ok = ParseInstance(&ps, &parsed, &instancecap);
+		else if (MatchKeyword(&ps, "MATERIAL"))
+			ok = ParseMaterial(&ps, &parsed, &materialcap);
+		else if (MatchKeyword(&ps, "USEMATERIAL"))
+			ok = ParseUseMaterial(&ps, &material, &maxmaterial);
+		else
+			ok = SDL_SetError("World line %d: Expected NUMPOLLIES, PORTAL, PROP, INSTANCE, MATERIAL or USEMATERIAL",
+				ps.line);
+		if (!ok)
+		{
+			SDL_free(proptriangles);
+			FreeWorld(&parsed);
+			return false;
+		}
+	}
+	if (parsed.numsectors == 0)
+	{
+		SDL_free(proptriangles);
+		FreeWorld(&parsed);
+		return SDL_SetError("World has no sectors");
+	}
+	for (int i = 0; i < parsed.numportals; ++i)
+	{
+		const int *joined = parsed.portals[i].sectors;
+		if (joined[0] >= parsed.numsectors || joined[1] >= parsed.numsectors || joined[0] == joined[1])
+		{
+			SDL_free(proptriangles);
+			FreeWorld(&parsed);
+			return SDL_SetError("World portal %d joins invalid sectors %d and %d", i, joined[0], joined[1]);
+		}
+	}
+	for (int i = 0; i < parsed.numinstances; ++i)
+	{
+		if (parsed.instances[i].prop >= parsed.numprops)
+		{
+			SDL_free(proptriangles);
+			FreeWorld(&parsed);
+			return SDL_SetError("World instance %d places invalid prop %d", i, parsed.instances[i].prop);
+		}
+	}
+	if (maxmaterial >= SDL_max(parsed.nummaterials, 1))
+	{
+		SDL_free(proptriangles);
+		FreeWorld(&parsed);
+		return SDL_SetError("World uses material %d but declares %d", maxmaterial, parsed.nummaterials);
+	}
+
+	// Append prop triangles after the sectors' so the mesh builder sees one triangle array
+	if (numproptriangles > 0)
+	{
+		const bool reserved = Reserve((void **)&parsed.triangles, &trianglecap,
+			(size_t)parsed.numtriangles + (size_t)numproptriangles, sizeof(TRIANGLE));
+		if (reserved)
+		{
+			SDL_memcpy(&parsed.triangles[parsed.numtriangles], proptriangles,
+				sizeof(TRIANGLE) * (size_t)numproptriangles);
+			parsed.numtriangles += numproptriangles;
+		}
+		SDL_free(proptriangles);
+		if (!reserved)
+		{
+			FreeWorld(&parsed);
+			return false;
+		}
+	}
+	if (!GroupInstances(&parsed))
+	{
+		FreeWorld(&parsed);
+		return false;
+	}
+
+	// Triangle storage may have moved while growing, point sectors & props at their triangles now
+	TRIANGLE *triangle = parsed.triangles;
+	for (int i = 0; i < parsed.numsectors; ++i)
+	{
+		parsed.sectors[i].triangle = triangle;
+		triangle += parsed.sectors[i].numtriangles;
+		parsed.sectors[i].bvhroot = -1;
+		SectorBounds(&parsed.sectors[i]);
+	}
+	for (int i = 0; i < parsed.numprops; ++i)
+	{
+		parsed.props[i].triangle = triangle;
+		triangle += parsed.props[i].numtriangles;
+	}
+
+	*world = parsed;
+	return true;
+}
+
+void FreeWorld(WORLD *world)
+{
+	SDL_free(world->materials);
+	SDL_free(world->instances);
+	SDL_free(world->props);
+	SDL_free(world->nodes);
+	SDL_free(world->triangles);
+	SDL_free(world->portals);
+	SDL_free(world->sectors);
+	SDL_zerop(world);
+}
+
+static bool WriteFloats(SDL_IOStream *out, const float *values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		Uint32 bits;
+		SDL_memcpy(&bits, &values[i], sizeof(bits));
+		if (!SDL_WriteU32LE(out, bits))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool ReadFloats(SDL_IOStream *in, float *values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		Uint32 bits;
+		if (!SDL_ReadU32LE(in, &bits))
+		{
+			return false;
+		}
+		SDL_memcpy(&values[i], &bits, sizeof(bits));
+	}
+	return true;
+}
+
+#define WORLD_BINARY_HEADER_SIZE   40u
+#define WORLD_BINARY_SECTOR_SIZE   36u
+#define WORLD_BINARY_PORTAL_SIZE   56u
+#define WORLD_BINARY_NODE_SIZE     144u
+#define WORLD_BINARY_PROP_SIZE     16u
+#define WORLD_BINARY_INSTANCE_SIZE 24u
+#define WORLD_BINARY_MATERIAL_SIZE 64u
+
+// Material records are written & read as they are, the path padded out with zeros
+SDL_COMPILE_TIME_ASSERT(material_size, sizeof(MATERIAL) == WORLD_BINARY_MATERIAL_SIZE);
+
+bool WriteWorldBinary(SDL_IOStream *out, const WORLD *world, const MESH *mesh)
+{
+	SDL_assert(out && world && mesh);
+	if (!SDL_WriteU32LE(out, WORLD_BINARY_MAGIC) ||
+		!SDL_WriteU16LE(out, WORLD_BINARY_VERSION) ||
+		!SDL_WriteU16LE(out, (Uint16)sizeof(VERTEX)) ||
+		!SDL_WriteU32LE(out, mesh->numvertices) ||
+		!SDL_WriteU32LE(out, mesh->numindices) ||
+		!SDL_WriteU16LE(out, (Uint16)mesh->indexsize) ||
+		!SDL_WriteU16LE(out, (Uint16)world->nummaterials) ||
+		!SDL_WriteU32LE(out, (Uint32)world->numsectors) ||
+		!SDL_WriteU32LE(out, (Uint32)world->numportals) ||
+		!SDL_WriteU32LE(out, (Uint32)world->numnodes) ||
+		!SDL_WriteU32LE(out, (Uint32)world->numprops) ||
+		!SDL_WriteU32LE(out, (Uint32)world->numinstances))
+	{
+		return false;
+	}
+	for (int i = 0; i < world->numsectors; ++i)
+	{
+		const SECTOR *sector = &world->sectors[i];
+		if (!SDL_WriteU32LE(out, sector->firstindex) ||
+			!SDL_WriteU32LE(out, sector->numindices) ||
+			!WriteFloats(out, sector->mins, 3) ||
+			!WriteFloats(out, sector->maxs, 3) ||
+			!SDL_WriteU32LE(out, (Uint32)sector->bvhroot))
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < world->numportals; ++i)
+	{
+		const PORTAL *portal = &world->portals[i];
+		if (!SDL_WriteU32LE(out, (Uint32)portal->sectors[0]) ||
+			!SDL_WriteU32LE(out, (Uint32)portal->sectors[1]) ||
+			!WriteFloats(out, &portal->corners[0][0], 12))
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < world->numnodes; ++i)
+	{
+		const BVHNODE *node = &world->nodes[i];
+		if (!WriteFloats(out, &node->bounds[0][0], 6 * BVH_WIDTH))
+		{
+			return false;
+		}
+		for (int j = 0; j < BVH_WIDTH; ++j)
+		{
+			if (!SDL_WriteU32LE(out, (Uint32)node->child[j]) ||
+				!SDL_WriteU32LE(out, node->firstindex[j]) ||
+				!SDL_WriteU32LE(out, node->numindices[j]))
+			{
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < world->numprops; ++i)
+	{
+		const PROP *prop = &world->props[i];
+		if (!SDL_WriteU32LE(out, prop->firstindex) ||
+			!SDL_WriteU32LE(out, prop->numindices) ||
+			!SDL_WriteU32LE(out, (Uint32)prop->firstinstance) ||
+			!SDL_WriteU32LE(out, (Uint32)prop->numinstances))
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < world->numinstances; ++i)
+	{
+		const INSTANCE *instance = &world->instances[i];
+		if (!SDL_WriteU32LE(out, (Uint32)instance->prop) ||
+			!WriteFloats(out, instance->origin, 3) ||
+			!WriteFloats(out, &instance->yaw, 1) ||
+			!WriteFloats(out, &instance->scale, 1))
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < world->nummaterials; ++i)
+	{
+		if (SDL_WriteIO(out, world->materials[i].image, WORLD_BINARY_MATERIAL_SIZE) != WORLD_BINARY_MATERIAL_SIZE)
+		{
+			return false;
+		}
+	}
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	return SDL_SetError("Compiled world: The mesh is stored little-endian, big-endian hosts aren't supported");
+#else
+	const size_t datasize = sizeof(VERTEX) * mesh->numvertices + (size_t)mesh->indexsize * mesh->numindices;
+	return SDL_WriteIO(out, mesh->vertices, datasize) == datasize;
+#endif
+}
+
+bool ReadWorldBinary(SDL_IOStream *in, WORLDHEADER *header, WORLD *world)
+{
+	SDL_assert(in && header && world);
+	const Sint64 filesize = SDL_GetIOSize(in);
+	if (!SDL_ReadU32LE(in, &header->magic) ||
+		!SDL_ReadU16LE(in, &header->version) ||
+		!SDL_ReadU16LE(in, &header->vertexsize) ||
+		!SDL_ReadU32LE(in, &header->numvertices) ||
+		!SDL_ReadU32LE(in, &header->numindices) ||
+		!SDL_ReadU16LE(in, &header->indexsize) ||
+		!SDL_ReadU16LE(in, &header->nummaterials) ||
+		!SDL_ReadU32LE(in, &header->numsectors) ||
+		!SDL_ReadU32LE(in, &header->numportals) ||
+		!SDL_ReadU32LE(in, &header->numnodes) ||
+		!SDL_ReadU32LE(in, &header->numprops) ||
+		!SDL_ReadU32LE(in, &header->numinstances))
+	{
+		return SDL_SetError("Compiled world: Truncated header");
+	}
+	if (header->magic != WORLD_BINARY_MAGIC)
+	{
+		return SDL_SetError("Compiled world: Bad magic");
+	}
+	if (header->version != WORLD_BINARY_VERSION || header->vertexsize != sizeof(VERTEX) ||
+		(header->indexsize != 2 && header->indexsize != 4))
+	{
+		return SDL_SetError("Compiled world: Unsupported version %u (vertex size %u, index size %u)",
+			(unsigned)header->version, (unsigned)header->vertexsize, (unsigned)header->indexsize);
+	}
+	const Uint64 tablesize = (Uint64)WORLD_BINARY_SECTOR_SIZE * header->numsectors +
+		(Uint64)WORLD_BINARY_PORTAL_SIZE * header->numportals +
+		(Uint64)WORLD_BINARY_NODE_SIZE * header->numnodes +
+		(Uint64)WORLD_BINARY_PROP_SIZE * header->numprops +
+		(Uint64)WORLD_BINARY_INSTANCE_SIZE * header->numinstances +
+		(Uint64)WORLD_BINARY_MATERIAL_SIZE * header->nummaterials;
+	const Uint64 datasize = (Uint64)sizeof(VERTEX) * header->numvertices +
+		(Uint64)header->indexsize * header->numindices;
+	if (header->numvertices == 0 || header->numindices == 0 || header->numindices % 3 != 0 ||
+		header->numsectors == 0 || header->numsectors > SDL_MAX_SINT32 || header->numportals > SDL_MAX_SINT32 ||
+		header->numnodes > SDL_MAX_SINT32 || header->numprops > SDL_MAX_SINT32 ||
+		header->numinstances > SDL_MAX_SINT32 || header->nummaterials > WORLD_MAX_MATERIALS ||
+		datasize > SDL_MAX_UINT32 ||
+		(filesize >= 0 && (Uint64)filesize < WORLD_BINARY_HEADER_SIZE + tablesize + datasize))
+	{
+		return SDL_SetError("Compiled world: Invalid size (%u vertices, %u indices, %u sectors, %u portals, "
+			"%u nodes, %u props, %u instances, %u materials)",
+			(unsigned)header->numvertices, (unsigned)header->numindices,
+			(unsigned)header->numsectors, (unsigned)header->numportals, (unsigned)header->numnodes,
+			(unsigned)header->numprops, (unsigned)header->numinstances, (unsigned)header->nummaterials);
+	}
+
+	WORLD loaded =
+	{
+		.numsectors = (int)header->numsectors,
+		.numportals = (int)header->numportals,
+		.sectors = SDL_calloc(header->numsectors, sizeof(SECTOR)),
+		.portals = header->numportals ? SDL_calloc(header->numportals, sizeof(PORTAL)) : NULL,
+		.numnodes = (int)header->numnodes,
+		.nodes = header->numnodes ? SDL_calloc(header->numnodes, sizeof(BVHNODE)) : NULL,
+		.numprops = (int)header->numprops,
+		.numinstances = (int)header->numinstances,
+		.props = header->numprops ? SDL_calloc(header->numprops, sizeof(PROP)) : NULL,
+		.instances = header->numinstances ? SDL_calloc(header->numinstances, sizeof(INSTANCE)) : NULL,
+		.nummaterials = header->nummaterials,
+		.materials = header->nummaterials ? SDL_calloc(header->nummaterials, sizeof(MATERIAL)) : NULL
+	};
+	if (!loaded.sectors || (header->numportals && !loaded.portals) || (header->numnodes && !loaded.nodes) ||
+		(header->numprops && !loaded.props) || (header->numinstances && !loaded.instances) ||
+		(header->nummaterials && !loaded.materials))
+	{
+		FreeWorld(&loaded);
+		return false;
+	}
+	for (int i = 0; i < loaded.numsectors; ++i)
+	{
+		SECTOR *sector = &loaded.sectors[i];
+		Uint32 root;
+		if (!SDL_ReadU32LE(in, &sector->firstindex) ||
+			!SDL_ReadU32LE(in, &sector->numindices) ||
+			!ReadFloats(in, sector->mins, 3) ||
+			!ReadFloats(in, sector->maxs, 3) ||
+			!SDL_ReadU32LE(in, &root) ||
+			sector->numindices % 3 != 0 || sector->firstindex > header->numindices ||
+			sector->numindices > header->numindices - sector->firstindex ||
+			((Sint32)root < -1 || (Sint32)root >= loaded.numnodes))
+		{
+			FreeWorld(&loaded);
+			return SDL_SetError("Compiled world: Invalid sector %d", i);
+		}
+		sector->numtriangles = (int)(sector->numindices / 3);
+		sector->bvhroot = (Sint32)root;
+	}
+	for (int i = 0; i < loaded.numportals; ++i)
+	{
+		PORTAL *portal = &loaded.portals[i];
+		Uint32 joined[2];
+		if (!SDL_ReadU32LE(in, &joined[0]) ||
+			!SDL_ReadU32LE(in, &joined[1]) ||
+			!ReadFloats(in, &portal->corners[0][0], 12) ||
+			joined[0] >= header->numsectors || joined[1] >= header->numsectors || joined[0] == joined[1])
+		{
+			FreeWorld(&loaded);
+			return SDL_SetError("Compiled world: Invalid portal %d", i);
+		}
+		portal->sectors[0] = (int)joined[0];
+		portal->sectors[1] = (int)joined[1];
+	}
+	for (int i = 0; i < loaded.numnodes; ++i)
+	{
+		// Children always follow their parent, which rules out cycles
+		BVHNODE *node = &loaded.nodes[i];
+		bool valid = ReadFloats(in, &node->bounds[0][0], 6 * BVH_WIDTH);
+		for (int j = 0; j < BVH_WIDTH && valid; ++j)
+		{
+			Uint32 child;
+			valid = SDL_ReadU32LE(in, &child) &&
+				SDL_ReadU32LE(in, &node->firstindex[j]) &&
+				SDL_ReadU32LE(in, &node->numindices[j]) &&
+				((Sint32)child == BVH_LEAF || (Sint32)child == BVH_EMPTY ||
+				((Sint32)child > i && (Sint32)child < loaded.numnodes)) &&
+				node->firstindex[j] <= header->numindices &&
+				node->numindices[j] <= header->numindices - node->firstindex[j];
+			node->child[j] = (Sint32)child;
+		}
+		if (!valid)
+		{
+			FreeWorld(&loaded);
+			return SDL_SetError("Compiled world: Invalid BVH node %d", i);
+		}
+	}
+	for (int i = 0; i < loaded.numprops; ++i)
+	{
+		PROP *prop = &loaded.props[i];
+		Uint32 first, count;
+		if (!SDL_ReadU32LE(in, &prop->firstindex) ||
+			!SDL_ReadU32LE(in, &prop->numindices) ||
+			!SDL_ReadU32LE(in, &first) ||
+			!SDL_ReadU32LE(in, &count) ||
+			prop->numindices % 3 != 0 || prop->firstindex > header->numindices ||
+			prop->numindices > header->numindices - prop->firstindex ||
+			first > header->numinstances || count > header->numinstances - first)
+		{
+			FreeWorld(&loaded);
+			return SDL_SetError("Compiled world: Invalid prop %d", i);
+		}
+		prop->numtriangles = (int)(prop->numindices / 3);
+		prop->firstinstance = (int)first;
+		prop->numinstances = (int)count;
+	}
+	for (int i = 0; i < loaded.numinstances; ++i)
+	{
+		INSTANCE *instance = &loaded.instances[i];
+		Uint32 prop;
+		if (!SDL_ReadU32LE(in, &prop) ||
+			!ReadFloats(in, instance->origin, 3) ||
+			!ReadFloats(in, &instance->yaw, 1) ||
+			!ReadFloats(in, &instance->scale, 1) ||
+			prop >= header->numprops ||
+			i < loaded.props[prop].firstinstance ||
+			i >= loaded.props[prop].firstinstance + loaded.props[prop].numinstances)
+		{
+			FreeWorld(&loaded);
+			return SDL_SetError("Compiled world: Invalid instance %d", i);
+		}
+		instance->prop = (int)prop;
+	}
+	for (int i = 0; i < loaded.nummaterials; ++i)
+	{
+		char *image = loaded.materials[i].image;
+		if (SDL_ReadIO(in, image, WORLD_BINARY_MATERIAL_SIZE) != WORLD_BINARY_MATERIAL_SIZE ||
+			image[0] == '\0' || image[WORLD_MATERIAL_PATH - 1] != '\0')
+		{
+			FreeWorld(&loaded);
+			return SDL_SetError("Compiled world: Invalid material %d", i);
+		}
+	}
+
+	*world = loaded;
+	return true;
+}
+
+bool ReadWorldMesh(SDL_IOStream *in, const WORLDHEADER *header, MESH *mesh)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	return SDL_SetError("Compiled world: The mesh is stored little-endian, big-endian hosts aren't supported");
+#endif
+	// ReadWorldBinary made sure the file holds this much, so a short read is an IO error
+	const size_t vertexsize = sizeof(VERTEX) * header->numvertices;
+	const size_t datasize = vertexsize + (size_t)header->indexsize * header->numindices;
+	VERTEX *vertices = SDL_malloc(datasize);
+	if (!vertices)
+	{
+		return false;
+	}
+	if (SDL_ReadIO(in, vertices, datasize) != datasize)
+	{
+		SDL_free(vertices);
+		return SDL_SetError("Compiled world: Truncated mesh");
+	}
+	// Everything downstream indexes the vertex array directly, so a corrupt index must not get past here
+	void *indices = (Uint8 *)vertices + vertexsize;
+	for (Uint32 i = 0; i < header->numindices; ++i)
+	{
+		const Uint32 index = header->indexsize == sizeof(Uint16) ?
+			((const Uint16 *)indices)[i] : ((const Uint32 *)indices)[i];
+		if (index >= header->numvertices)
+		{
+			SDL_free(vertices);
+			return SDL_SetError("Compiled world: Index %u out of range at %u", (unsigned)index, (unsigned)i);
+		}
+	}
+	*mesh = (MESH)
+	{
+		.numvertices = header->numvertices,
+		.numindices = header->numindices,
+		.indexsize = header->indexsize,
+		.vertices = vertices,
+		.indices = indices
+	};
+	return true;
+}
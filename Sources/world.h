@@ -0,0 +1,153 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct tagVERTEX
+{
+	float x, y, z;
+	float u, v;
+	float layer;   // Material of the vertex's triangle, the texture array layer it samples
+} VERTEX;
+
+typedef struct tagTRIANGLE
+{
+	VERTEX vertex[3];
+} TRIANGLE;
+
+typedef struct tagSECTOR
+{
+	int numtriangles;
+	TRIANGLE *triangle;               // Parsed triangles, NULL when loaded from a compiled world
+	uint32_t firstindex, numindices;  // Range of the sector in the world mesh index buffer
+	float mins[3], maxs[3];           // Bounding box
+	int bvhroot;                      // Root node of the sector's bounding volume hierarchy, -1 if none
+} SECTOR;
+
+typedef struct tagPORTAL
+{
+	int sectors[2];        // The two sectors joined by the portal
+	float corners[4][3];   // Portal quad
+} PORTAL;
+
+typedef struct tagPROP
+{
+	int numtriangles;
+	TRIANGLE *triangle;               // Parsed model space triangles, NULL when loaded from a compiled world
+	uint32_t firstindex, numindices;  // Range of the prop's model in the world mesh index buffer
+	int firstinstance, numinstances;  // Range of the prop's placements in the world instance array
+} PROP;
+
+typedef struct tagINSTANCE
+{
+	int prop;          // Prop placed
+	float origin[3];   // Position of the prop's model space origin
+	float yaw;         // Rotation about the y axis in degrees
+	float scale;       // Uniform scale
+} INSTANCE;
+
+#define WORLD_MAX_MATERIALS 256  // Most materials a world can declare, texture array layers are limited
+#define WORLD_MATERIAL_PATH 64   // Size of a material image path, including the terminator
+
+typedef struct tagMATERIAL
+{
+	char image[WORLD_MATERIAL_PATH];  // Image path relative to the resource directory, e.g. "Data/Mud.bmp"
+} MATERIAL;
+
+#define BVH_WIDTH 4    // Children per bounding volume hierarchy node
+#define BVH_LEAF  -1   // Child is a leaf batch of triangles
+#define BVH_EMPTY -2   // Unused child slot, its bounds are inverted so it never passes a test
+
+typedef struct tagBVHNODE
+{
+	float bounds[6][BVH_WIDTH];   // Child boxes as rows of min x, y, z then max x, y, z for SIMD tests
+	int32_t child[BVH_WIDTH];     // Inner child node index, BVH_LEAF or BVH_EMPTY
+	uint32_t firstindex[BVH_WIDTH], numindices[BVH_WIDTH];  // Index range covered by each child
+} BVHNODE;
+
+typedef struct tagWORLD
+{
+	int numsectors, numportals;
+	SECTOR *sectors;
+	PORTAL *portals;
+	TRIANGLE *triangles;   // Storage for every sector's then every prop's triangles, in order
+	int numtriangles;
+	BVHNODE *nodes;        // Every sector's hierarchy, built with the mesh
+	int numnodes;
+	int numprops, numinstances;
+	PROP *props;
+	INSTANCE *instances;   // Prop placements, grouped by prop
+	int nummaterials;      // 0 when the world declares none and everything uses the default texture
+	MATERIAL *materials;
+} WORLD;
+
+typedef struct tagMESH
+{
+	uint32_t numvertices, numindices;
+	uint32_t indexsize;  // Size of an index in bytes, 2 or 4
+	VERTEX *vertices;    // Vertices immediately followed by the index data in the same allocation
+	void *indices;
+} MESH;
+
+/*  Parse World.txt style text. Each "NUMPOLLIES n" block starts a new sector of n    *
+ *  triangles, and "PORTAL a b" followed by four "x y z" lines joins sectors a and b  *
+ *  (counted from 0 in file order) through a quad. A file with a single NUMPOLLIES    *
+ *  block and no portals is the original single sector world. "PROP n" declares a    *
+ *  prop model of n triangles in model space, using the same vertex lines as a       *
+ *  sector, and "INSTANCE p x y z yaw scale" places prop p (counted from 0 in file   *
+ *  order) at x y z, turned yaw degrees about the y axis. "MATERIAL image" declares  *
+ *  a material, counted from 0 in file order, and "USEMATERIAL m" (between blocks or *
+ *  between the triangles of one) sets the material of every triangle after it until *
+ *  the next, material 0 to begin with. A world without materials is drawn with the  *
+ *  default texture. Release the world with FreeWorld, on failure the error is set   *
+ *  with SDL_SetError.                                                               *
+ *  text    - Contents of the world file, does not need to be null terminated        *
+ *  size    - Size of the world file contents in bytes                               */
+bool ParseWorld(WORLD *world, const char *text, size_t size);
+void FreeWorld(WORLD *world);
+
+/*  Compiled world format (.wbin). The header and the sector, portal, BVH node,      *
+ *  prop, instance and material tables are little-endian. They're followed by the    *
+ *  mesh vertices and then its indices, written raw in host byte order exactly as    *
+ *  the GPU vertex and index buffers expect them, so the format is only read and     *
+ *  written on little-endian hosts. ReadWorldMesh reads the whole mesh payload into  *
+ *  one heap allocation and checks every index against the vertex count. Vertex      *
+ *  material layers aren't validated, texture array sampling clamps the layer to     *
+ *  the array.                                                                       */
+#define WORLD_BINARY_MAGIC   0x4E494257u  // "WBIN"
+#define WORLD_BINARY_VERSION 6u
+
+typedef struct tagWORLDHEADER
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t vertexsize;    // sizeof(VERTEX) when the file was compiled
+	uint32_t numvertices;
+	uint32_t numindices;
+	uint16_t indexsize;
+	uint16_t nummaterials;
+	uint32_t numsectors;
+	uint32_t numportals;
+	uint32_t numnodes;
+	uint32_t numprops;
+	uint32_t numinstances;
+} WORLDHEADER;
+
+struct SDL_IOStream;
+
+/*  Write a world and its mesh in the compiled world format                          */
+bool WriteWorldBinary(struct SDL_IOStream *out, const WORLD *world, const MESH *mesh);
+
+/*  Read and validate a compiled world header along with the sector, portal, node,   *
+ *  prop, instance & material tables, leaving the stream positioned at the start of  *
+ *  the mesh vertex data. The world has no triangles and should be released with     *
+ *  FreeWorld.                                                                       */
+bool ReadWorldBinary(struct SDL_IOStream *in, WORLDHEADER *header, WORLD *world);
+
+/*  Read the mesh following the tables in one read, straight from the stream into a  *
+ *  single allocation laid out like BuildMesh's, to be released with FreeMesh        */
+bool ReadWorldMesh(struct SDL_IOStream *in, const WORLDHEADER *header, MESH *mesh);
+
+#endif//WORLD_H